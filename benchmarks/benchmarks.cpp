@@ -0,0 +1,780 @@
+#include "../src/durable_search_server.h"
+#include "../src/file_io.h"
+#include "../src/result_writer.h"
+#include "../src/search_server.h"
+#include "../src/string_processing.h"
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// Бенчмарки производительности. Запуск: ./benchmarks <режим> [файл с текстом]
+// Без файла используется синтетический корпус. Строки файла считаются отдельными документами.
+namespace benchmarks {
+
+using namespace std::string_literals;
+using namespace search_server;
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t SYNTHETIC_CORPUS_BYTES = 64u << 20;
+constexpr int REPEAT_COUNT = 5;
+
+struct Corpus {
+    std::string text;                     // весь текст
+    std::vector<std::string_view> lines;  // документы (строки текста)
+};
+
+// Синтетический корпус: слова из небольшого алфавита, документы по 8-40 слов
+Corpus MakeSyntheticCorpus(size_t bytes) {
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> word_length(2, 10);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<int> words_in_document(8, 40);
+    std::uniform_int_distribution<int> spaces(1, 2);
+
+    Corpus corpus;
+    corpus.text.reserve(bytes + 1024);
+    while (corpus.text.size() < bytes) {
+        for (int i = words_in_document(generator); i > 0; --i) {
+            for (int j = word_length(generator); j > 0; --j) {
+                corpus.text.push_back(static_cast<char>(letter(generator)));
+            }
+            corpus.text.append(static_cast<size_t>(spaces(generator)), ' ');
+        }
+        corpus.text.push_back('\n');
+    }
+    return corpus;
+}
+
+Corpus LoadCorpus(const std::vector<std::string>& args) {
+    Corpus corpus;
+    if (args.empty()) {
+        corpus = MakeSyntheticCorpus(SYNTHETIC_CORPUS_BYTES);
+    } else {
+        std::ifstream input(args[0], std::ios::binary);
+        if (!input) {
+            throw std::runtime_error("Cannot open "s + args[0]);
+        }
+        std::ostringstream buffer;
+        buffer << input.rdbuf();
+        corpus.text = std::move(buffer).str();
+    }
+    // Переводы строк разделяют документы и не должны попадать в слова
+    std::string_view text = corpus.text;
+    for (size_t pos = 0; pos < text.size();) {
+        const size_t end = std::min(text.find('\n', pos), text.size());
+        if (end > pos) {
+            corpus.lines.push_back(text.substr(pos, end - pos));
+        }
+        pos = end + 1;
+    }
+    return corpus;
+}
+
+// Выполняет fn REPEAT_COUNT раз и печатает лучшую пропускную способность
+void ReportThroughput(const std::string& name, size_t bytes, const std::function<void()>& fn) {
+    double best_seconds = std::numeric_limits<double>::max();
+    for (int i = 0; i < REPEAT_COUNT; ++i) {
+        const auto start = Clock::now();
+        fn();
+        best_seconds = std::min(best_seconds, std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    std::cout << name << ": "s << bytes / best_seconds / 1e9 << " GB/s ("s << best_seconds * 1000 << " ms)"s << std::endl;
+}
+
+size_t CountBytes(const Corpus& corpus) {
+    size_t bytes = 0;
+    for (std::string_view line : corpus.lines) {
+        bytes += line.size();
+    }
+    return bytes;
+}
+
+// Нормализация текста: токенизатор без нормализации против NormalizeText + токенизатор и индексация с нормализацией
+// и стеммингом.
+// Второй прогон - тот же корпус кириллицей (буквы a-z заменены на а-я, каждое восьмое слово с заглавной)
+void BenchmarkNormalize(const std::vector<std::string>& args) {
+    const Corpus corpus = LoadCorpus(args);
+    Corpus cyrillic;
+    std::vector<std::pair<size_t, size_t>> line_bounds;
+    size_t word_index = 0;
+    for (std::string_view line : corpus.lines) {
+        const size_t begin = cyrillic.text.size();
+        for (size_t i = 0; i < line.size(); ++i) {
+            const char c = line[i];
+            if (c < 'a' || c > 'z') {
+                cyrillic.text.push_back(c);
+                continue;
+            }
+            const bool is_word_start = i == 0 || line[i - 1] == ' ';
+            const bool is_upper = is_word_start && word_index++ % 8 == 0;
+            // а-п: U+0430-U+043F, р-я: U+0440-U+044F, заглавные на 0x20 меньше
+            const int code_point = 0x0430 + (c - 'a') - (is_upper ? 0x20 : 0);
+            cyrillic.text.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+            cyrillic.text.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        }
+        line_bounds.emplace_back(begin, cyrillic.text.size());
+    }
+    for (const auto& [begin, end] : line_bounds) {
+        cyrillic.lines.push_back(std::string_view(cyrillic.text).substr(begin, end - begin));
+    }
+
+    for (const auto& [name, text] : {std::pair{"ascii"s, &corpus}, std::pair{"cyrillic"s, static_cast<const Corpus*>(&cyrillic)}}) {
+        const size_t bytes = CountBytes(*text);
+        std::vector<std::string_view> words;
+        size_t word_count = 0;
+        ReportThroughput(name + " SplitIntoWordsView"s, bytes, [&] {
+            word_count = 0;
+            for (std::string_view line : text->lines) {
+                string_processing::SplitIntoWordsView(line, words);
+                word_count += words.size();
+            }
+        });
+        std::string normalized;
+        ReportThroughput(name + " NormalizeText + SplitIntoWordsView"s, bytes, [&] {
+            word_count = 0;
+            for (std::string_view line : text->lines) {
+                NormalizeText(line, NormalizationMode::DOCUMENT, normalized);
+                string_processing::SplitIntoWordsView(normalized, words);
+                word_count += words.size();
+            }
+        });
+        IndexOptions normalized_options;
+        normalized_options.normalize_text = true;
+        IndexOptions stemmed_options = normalized_options;
+        stemmed_options.stemmer = StemWord;
+        const std::pair<std::string, IndexOptions> chains[] = {
+            {" AddDocument"s, IndexOptions{}},
+            {" AddDocument normalized"s, normalized_options},
+            {" AddDocument normalized + stemmed"s, stemmed_options},
+        };
+        for (const auto& [chain, options] : chains) {
+            ReportThroughput(name + chain, bytes, [&] {
+                SearchServer server("and in at the on with a"s, options);
+                int document_id = 0;
+                for (std::string_view line : text->lines) {
+                    server.AddDocument(document_id++, std::string(line), DocumentStatus::ACTUAL, {1, 2, 3});
+                }
+            });
+        }
+    }
+}
+
+// Токенизатор: SplitIntoWordsView против разбиения через std::views::split
+void BenchmarkTokenizer(const std::vector<std::string>& args) {
+    const Corpus corpus = LoadCorpus(args);
+    const size_t bytes = CountBytes(corpus);
+
+    size_t word_count = 0;
+    ReportThroughput("views::split"s, bytes, [&] {
+        word_count = 0;
+        for (std::string_view line : corpus.lines) {
+            for (auto word : line | std::views::split(' ')) {
+                word_count += !word.empty();
+            }
+        }
+    });
+    std::vector<std::string_view> words;
+    ReportThroughput("SplitIntoWordsView"s, bytes, [&] {
+        word_count = 0;
+        for (std::string_view line : corpus.lines) {
+            string_processing::SplitIntoWordsView(line, words);
+            word_count += words.size();
+        }
+    });
+    std::cout << "words: "s << word_count << std::endl;
+}
+
+// Индексация: полный путь AddDocument и отдельно фильтр стоп-слов (хеш-множество против совершенной хеш-функции)
+void BenchmarkIngest(const std::vector<std::string>& args) {
+    const Corpus corpus = LoadCorpus(args);
+    const size_t bytes = CountBytes(corpus);
+
+    const std::string stop_words_text =
+        "a about above after again against all am an and any are as at be because been before being below between both but by "
+        "can did do does doing down during each few for from further had has have having he her here hers herself him himself "
+        "his how i if in into is it its itself just me more most my myself no nor not now of off on once only or other our ours "
+        "out over own same she should so some such than that the their theirs them then there these they this those through to "
+        "too under until up very was we were what when where which while who whom why will with you your yours"s;
+    const StringSet stop_word_hash_set = MakeUniqueNonEmptyStrings(SplitIntoWords(stop_words_text));
+    const StopWordSet stop_word_set(stop_word_hash_set);
+    std::vector<std::string_view> words;
+    for (std::string_view line : corpus.lines) {
+        std::vector<std::string_view> line_words;
+        string_processing::SplitIntoWordsView(line, line_words);
+        words.insert(words.end(), line_words.begin(), line_words.end());
+    }
+    const auto measure_stop_filter = [&words](const std::string& name, const auto& is_stop_word) {
+        double best_ns = std::numeric_limits<double>::max();
+        size_t stop_count = 0;
+        for (int i = 0; i < REPEAT_COUNT; ++i) {
+            stop_count = 0;
+            const auto start = Clock::now();
+            for (std::string_view word : words) {
+                stop_count += is_stop_word(word);
+            }
+            best_ns = std::min(best_ns, std::chrono::duration<double, std::nano>(Clock::now() - start).count() / words.size());
+        }
+        std::cout << name << ": "s << best_ns << " ns/word, "s << stop_count << " stop words"s << std::endl;
+    };
+    measure_stop_filter("stop filter unordered_set"s, [&](std::string_view word) {
+        return stop_word_hash_set.contains(word);
+    });
+    measure_stop_filter("stop filter StopWordSet"s, [&](std::string_view word) {
+        return stop_word_set.Contains(word);
+    });
+
+    ReportThroughput("AddDocument"s, bytes, [&] {
+        SearchServer server("and in at the on with a"s);
+        int document_id = 0;
+        for (std::string_view line : corpus.lines) {
+            server.AddDocument(document_id++, std::string(line), DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    });
+}
+
+// Индексация с журналом: AddDocument в памяти против DurableSearchServer с групповым сбросом журнала на диск.
+// Второй аргумент - каталог для журнала (по умолчанию во временном каталоге)
+void BenchmarkWal(const std::vector<std::string>& args) {
+    const Corpus corpus = LoadCorpus(std::vector<std::string>(args.begin(), args.begin() + std::min<size_t>(args.size(), 1)));
+    const size_t bytes = CountBytes(corpus);
+    const std::filesystem::path directory = args.size() > 1 ? std::filesystem::path(args[1])
+                                                            : std::filesystem::temp_directory_path() / "search-server-wal-benchmark"s;
+
+    ReportThroughput("in-memory"s, bytes, [&] {
+        SearchServer server("and in at the on with a"s);
+        int document_id = 0;
+        for (std::string_view line : corpus.lines) {
+            server.AddDocument(document_id++, std::string(line), DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    });
+    ReportThroughput("write-ahead log"s, bytes, [&] {
+        std::filesystem::remove_all(directory);
+        durable_search_server::DurableSearchServer server(directory, SearchServer("and in at the on with a"s));
+        int document_id = 0;
+        for (std::string_view line : corpus.lines) {
+            server.AddDocument(document_id++, std::string(line), DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        server.Sync();
+    });
+    std::filesystem::remove_all(directory);
+}
+
+// Сегменты индекса после индексации корпуса: размеры сегментов, усиление записи и число слияний
+void BenchmarkSegments(const std::vector<std::string>& args) {
+    const Corpus corpus = LoadCorpus(args);
+    const auto start = Clock::now();
+    SearchServer server("and in at the on with a"s);
+    int document_id = 0;
+    for (std::string_view line : corpus.lines) {
+        server.AddDocument(document_id++, std::string(line), DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    server.WaitForMerges();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    const IndexStats stats = server.GetIndexStats();
+    std::cout << "ingest: "s << seconds * 1000 << " ms"s << std::endl;
+    for (const SegmentStats& segment : stats.segments) {
+        std::cout << "segment "s << segment.sequence << ": "s << segment.term_count << " terms, "s << segment.posting_count << " postings, "s
+                  << segment.document_count << " documents, "s << segment.memory_bytes << " bytes"s << std::endl;
+    }
+    std::cout << "mutable: "s << stats.mutable_posting_count << " postings"s << std::endl;
+    std::cout << "merges: "s << stats.merge_count << ", write amplification: "s << stats.GetWriteAmplification() << std::endl;
+}
+
+// Запросы с фильтром по статусу: части списков документов по статусам против предиката, проверяющего каждую запись.
+// Актуальна четверть документов, поэтому предикат отбрасывает три записи из четырёх
+void BenchmarkStatus(const std::vector<std::string>& args) {
+    const Corpus corpus = LoadCorpus(args);
+    SearchServer server("and in at the on with a"s);
+    int document_id = 0;
+    for (std::string_view line : corpus.lines) {
+        server.AddDocument(document_id, std::string(line), static_cast<DocumentStatus>(document_id % DOCUMENT_STATUS_COUNT), {1, 2, 3});
+        ++document_id;
+    }
+    server.WaitForMerges();
+
+    std::mt19937 generator(11);
+    std::vector<std::string> queries;
+    std::vector<std::string_view> words;
+    while (queries.size() < 200) {
+        string_processing::SplitIntoWordsView(corpus.lines[generator() % corpus.lines.size()], words);
+        if (words.size() >= 2) {
+            queries.push_back(std::string(words[0]) + ' ' + std::string(words[1]));
+        }
+    }
+
+    const auto measure = [&](const std::string& name, const std::function<std::vector<Document>(const std::string&)>& find) {
+        size_t found = 0;
+        const auto start = Clock::now();
+        for (const std::string& query : queries) {
+            found += find(query).size();
+        }
+        const double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / queries.size();
+        std::cout << name << ": "s << us << " us/query, "s << found << " documents found"s << std::endl;
+    };
+    measure("predicate"s, [&server](const std::string& query) {
+        return server.FindTopDocuments(query, []([[maybe_unused]] int id, DocumentStatus status, [[maybe_unused]] int rating) {
+            return status == DocumentStatus::ACTUAL;
+        });
+    });
+    measure("status partition"s, [&server](const std::string& query) {
+        return server.FindTopDocuments(query, DocumentStatus::ACTUAL);
+    });
+}
+
+// Память индекса по структурам после индексации корпуса, в байтах на документ и на запись (слово, документ).
+// Второй прогон - с пределом в половину памяти первого и сбросом сегментов на диск
+void BenchmarkMemory(const std::vector<std::string>& args) {
+    const Corpus corpus = LoadCorpus(args);
+    const auto report = [&corpus](const std::string& name, const IndexOptions& options) {
+        SearchServer server("and in at the on with a"s, options);
+        int document_id = 0;
+        for (std::string_view line : corpus.lines) {
+            server.AddDocument(document_id++, std::string(line), DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        server.WaitForMerges();
+
+        const IndexStats stats = server.GetIndexStats();
+        size_t posting_count = stats.mutable_posting_count;
+        for (const SegmentStats& segment : stats.segments) {
+            posting_count += segment.posting_count;
+        }
+        const MemoryUsage usage = server.GetMemoryUsage();
+        const double documents = static_cast<double>(server.GetDocumentCount());
+        std::cout << name << ": "s << usage.GetTotal() << " bytes, "s << usage.GetTotal() / documents << " bytes/document, "s
+                  << static_cast<double>(usage.GetTotal()) / posting_count << " bytes/posting ("s << posting_count << " postings)"s << std::endl;
+        const std::pair<std::string, size_t> parts[] = {
+            {"term dictionary"s, usage.term_dictionary}, {"postings"s, usage.postings}, {"document table"s, usage.document_table},
+            {"document ids"s, usage.document_ids}, {"stop words"s, usage.stop_words}, {"positions"s, usage.positions},
+            {"stems"s, usage.stems}, {"spilled postings"s, usage.spilled_postings},
+        };
+        for (const auto& [part, bytes] : parts) {
+            std::cout << "  "s << part << ": "s << bytes << " bytes, "s << bytes / documents << " bytes/document"s << std::endl;
+        }
+        return usage.GetTotal();
+    };
+
+    const size_t total = report("in memory"s, IndexOptions{});
+    IndexOptions spill_options;
+    spill_options.memory.max_bytes = total / 2;
+    spill_options.memory.policy = MemoryLimitPolicy::SPILL;
+    report("spill at half"s, spill_options);
+}
+
+// Top-K по спискам в порядке убывания TF с досрочной остановкой против полного перебора, а также фильтр
+// по диапазону рейтинга с пропуском блоков. Запросы - пары слов из документов корпуса
+void BenchmarkImpact(const std::vector<std::string>& args) {
+    const Corpus corpus = LoadCorpus(args);
+    SearchServer exhaustive("and in at the on with a"s);
+    IndexOptions impact_options;
+    impact_options.segments.impact_ordered = true;
+    SearchServer impact("and in at the on with a"s, impact_options);
+    int document_id = 0;
+    for (std::string_view line : corpus.lines) {
+        const std::vector<int> ratings = { document_id % 21 - 10 };
+        exhaustive.AddDocument(document_id, std::string(line), DocumentStatus::ACTUAL, ratings);
+        impact.AddDocument(document_id, std::string(line), DocumentStatus::ACTUAL, ratings);
+        ++document_id;
+    }
+    exhaustive.WaitForMerges();
+    impact.WaitForMerges();
+    std::cout << "index memory: "s;
+    for (const SearchServer* server : {&exhaustive, &impact}) {
+        size_t bytes = 0;
+        for (const SegmentStats& segment : server->GetIndexStats().segments) {
+            bytes += segment.memory_bytes;
+        }
+        std::cout << bytes << " bytes "s;
+    }
+    std::cout << "(document order, + impact order)"s << std::endl;
+
+    // Короткие слова встречаются чаще всего: у них длинные списки документов
+    std::mt19937 generator(5);
+    std::vector<std::string> queries;
+    std::vector<std::string_view> words;
+    while (queries.size() < 200) {
+        string_processing::SplitIntoWordsView(corpus.lines[generator() % corpus.lines.size()], words);
+        std::erase_if(words, [](std::string_view word) {
+            return word.size() > 2;
+        });
+        if (words.size() >= 2) {
+            queries.push_back(std::string(words[0]) + ' ' + std::string(words[1]));
+        }
+    }
+
+    const auto measure = [&](const std::string& name, const std::function<std::vector<Document>(const SearchServer&, const std::string&)>& find) {
+        for (const auto& [server_name, server] : {std::pair{"exhaustive"s, &exhaustive}, std::pair{"impact"s, &impact}}) {
+            size_t found = 0;
+            const auto start = Clock::now();
+            for (const std::string& query : queries) {
+                found += find(*server, query).size();
+            }
+            const double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / queries.size();
+            std::cout << name << ", "s << server_name << ": "s << us << " us/query, "s << found << " documents found"s << std::endl;
+        }
+    };
+    measure("top-5"s, [](const SearchServer& server, const std::string& query) {
+        return server.FindTopDocuments(query);
+    });
+    RatingRangePredicate high_ratings;
+    high_ratings.min_rating = 9;
+    measure("top-5, rating >= 9"s, [&high_ratings](const SearchServer& server, const std::string& query) {
+        return server.FindTopDocuments(query, high_ratings, PageRequest{});
+    });
+}
+
+// Top-K по TF-IDF: блочные накопители против хеш-таблицы полного перебора на синтетических коротких документах
+void BenchmarkAccumulators(const std::vector<std::string>& args) {
+    // Наследник TfIdfRanking ранжирует так же, но идёт через FindAllDocuments
+    struct HashTfIdfRanking : TfIdfRanking {};
+    const int document_count = args.empty() ? 1'000'000 : std::stoi(args[0]);
+
+    // Частоты слов убывают по степенному закону: первые слова словаря встречаются в большой доле документов
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::uniform_int_distribution<int> words_in_document(3, 8);
+    const auto next_word = [&]() {
+        return "w"s + std::to_string(static_cast<int>(std::pow(20000.0, uniform(generator))) - 1);
+    };
+    SearchServer server("and in at the on with a"s);
+    const auto start = Clock::now();
+    std::string text;
+    for (int document_id = 0; document_id < document_count; ++document_id) {
+        text.clear();
+        for (int i = words_in_document(generator); i > 0; --i) {
+            text += next_word();
+            text.push_back(' ');
+        }
+        const DocumentStatus status = document_id % 8 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        server.AddDocument(document_id, text, status, { document_id % 21 - 10 });
+    }
+    server.WaitForMerges();
+    std::cout << document_count << " documents indexed in "s << std::chrono::duration<double>(Clock::now() - start).count() << " s"s << std::endl;
+
+    std::vector<std::string> queries;
+    while (queries.size() < 100) {
+        std::string query = next_word() + ' ' + next_word() + ' ' + next_word();
+        if (queries.size() % 2 == 1) {
+            query += " -"s + next_word();
+        }
+        queries.push_back(std::move(query));
+    }
+
+    const auto measure = [&](const std::string& name, const std::function<std::vector<Document>(const std::string&, bool)>& find) {
+        std::vector<std::vector<Document>> results[2];
+        for (const bool blocked : {false, true}) {
+            double best_us = std::numeric_limits<double>::max();
+            for (int repeat = 0; repeat < 3; ++repeat) {
+                results[blocked].clear();
+                const auto query_start = Clock::now();
+                for (const std::string& query : queries) {
+                    results[blocked].push_back(find(query, blocked));
+                }
+                best_us = std::min(best_us, std::chrono::duration<double, std::micro>(Clock::now() - query_start).count() / queries.size());
+            }
+            std::cout << name << ", "s << (blocked ? "blocked"s : "hash"s) << ": "s << best_us << " us/query"s << std::endl;
+        }
+        if (results[0] != results[1]) {
+            throw std::logic_error("Blocked results differ for "s + name);
+        }
+    };
+    measure("top-5"s, [&server](const std::string& query, bool blocked) {
+        return blocked ? server.FindTopDocuments(query)
+                       : server.FindTopDocuments(query, StatusPredicate{}, PageRequest{ .limit = MAX_RESULT_DOCUMENT_COUNT }, HashTfIdfRanking{});
+    });
+    measure("top-100, rating >= 5"s, [&server](const std::string& query, bool blocked) {
+        RatingRangePredicate range;
+        range.min_rating = 5;
+        return blocked ? server.FindTopDocuments(query, range, PageRequest{ .limit = 100 })
+                       : server.FindTopDocuments(query, range, PageRequest{ .limit = 100 }, HashTfIdfRanking{});
+    });
+}
+
+// Индексирует texts сервером с политикой Policy и печатает время запроса top-5 по TF-IDF (блочные накопители)
+// и по BM25 (хеш-таблица накопителей полного перебора)
+template <typename Policy>
+void MeasureSearchPolicy(const std::string& name, const std::vector<std::string>& texts, const std::vector<std::string>& queries) {
+    BasicSearchServer<Policy> server("and in at the on with a"s);
+    for (int document_id = 0; document_id < static_cast<int>(texts.size()); ++document_id) {
+        server.AddDocument(document_id, texts[static_cast<size_t>(document_id)], DocumentStatus::ACTUAL, { document_id % 21 - 10 });
+    }
+    server.WaitForMerges();
+
+    size_t result_count = 0;
+    const auto measure = [&](const std::string& ranking_name, const std::function<std::vector<Document>(const std::string&)>& find) {
+        double best_us = std::numeric_limits<double>::max();
+        for (int repeat = 0; repeat < 3; ++repeat) {
+            const auto query_start = Clock::now();
+            for (const std::string& query : queries) {
+                result_count += find(query).size();
+            }
+            best_us = std::min(best_us, std::chrono::duration<double, std::micro>(Clock::now() - query_start).count() / queries.size());
+        }
+        std::cout << name << ", "s << ranking_name << ": "s << best_us << " us/query"s << std::endl;
+    };
+    measure("tf-idf"s, [&server](const std::string& query) {
+        return server.FindTopDocuments(query);
+    });
+    measure("bm25"s, [&server](const std::string& query) {
+        return server.FindTopDocuments(query, DocumentStatus::ACTUAL, Bm25Ranking{});
+    });
+    if (result_count == 0) {
+        throw std::logic_error("No results for "s + name);
+    }
+}
+
+// Варианты сервера с политиками: накопители релевантности double против float
+void BenchmarkPolicies(const std::vector<std::string>& args) {
+    const int document_count = args.empty() ? 1'000'000 : std::stoi(args[0]);
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::uniform_int_distribution<int> words_in_document(3, 8);
+    const auto next_word = [&]() {
+        return "w"s + std::to_string(static_cast<int>(std::pow(20000.0, uniform(generator))) - 1);
+    };
+    std::vector<std::string> texts(static_cast<size_t>(document_count));
+    for (std::string& text : texts) {
+        for (int i = words_in_document(generator); i > 0; --i) {
+            text += next_word();
+            text.push_back(' ');
+        }
+    }
+    std::vector<std::string> queries;
+    while (queries.size() < 100) {
+        queries.push_back(next_word() + ' ' + next_word() + ' ' + next_word());
+    }
+
+    MeasureSearchPolicy<DefaultSearchPolicy>("double, int"s, texts, queries);
+    MeasureSearchPolicy<FloatScorePolicy>("float, int"s, texts, queries);
+}
+
+StringSet CollectVocabulary(const Corpus& corpus) {
+    StringSet vocabulary;
+    std::vector<std::string_view> words;
+    for (std::string_view line : corpus.lines) {
+        string_processing::SplitIntoWordsView(line, words);
+        for (std::string_view word : words) {
+            if (!vocabulary.contains(word)) {
+                vocabulary.emplace(word);
+            }
+        }
+    }
+    return vocabulary;
+}
+
+// Словарь терминов: объём front-coded словаря против ключей хеш-таблицы и скорость раскрытия префиксов
+void BenchmarkDictionary(const std::vector<std::string>& args) {
+    const Corpus corpus = LoadCorpus(args);
+    const StringSet vocabulary = CollectVocabulary(corpus);
+
+    size_t key_bytes = 0;
+    std::vector<std::string_view> terms;
+    for (const std::string& word : vocabulary) {
+        key_bytes += sizeof(std::string) + (word.capacity() > 15 ? word.capacity() + 1 : 0);
+        terms.push_back(word);
+    }
+    std::sort(terms.begin(), terms.end());
+
+    const auto start = Clock::now();
+    const TermDictionary dictionary(terms);
+    const double build_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::cout << "terms: "s << terms.size() << std::endl;
+    std::cout << "hash-map keys: "s << key_bytes << " bytes"s << std::endl;
+    std::cout << "front-coded dictionary: "s << dictionary.GetMemoryUsage() << " bytes (build "s << build_ms << " ms)"s << std::endl;
+
+    size_t expanded = 0;
+    const auto expand_start = Clock::now();
+    for (size_t i = 0; i < terms.size(); i += 97) {
+        expanded += dictionary.ExpandPrefix(terms[i].substr(0, 3), 64).size();
+    }
+    const double expand_ms = std::chrono::duration<double, std::milli>(Clock::now() - expand_start).count();
+    std::cout << "prefix expansions: "s << terms.size() / 97 + 1 << " queries, "s << expanded << " terms, "s << expand_ms << " ms"s << std::endl;
+}
+
+// Нечёткий поиск: задержка раскрытия слова с опечаткой против точного поиска термина
+void BenchmarkFuzzy(const std::vector<std::string>& args) {
+    const Corpus corpus = LoadCorpus(args);
+    const StringSet vocabulary = CollectVocabulary(corpus);
+    std::vector<std::string_view> terms(vocabulary.begin(), vocabulary.end());
+    std::sort(terms.begin(), terms.end());
+    const TermDictionary dictionary(terms);
+    std::cout << "terms: "s << terms.size() << std::endl;
+
+    // Слова запросов: термины словаря с заменённой буквой
+    std::mt19937 generator(7);
+    std::vector<std::string> queries;
+    for (size_t i = 0; i < 200; ++i) {
+        std::string word(terms[generator() % terms.size()]);
+        word[generator() % word.size()] = 'q';
+        queries.push_back(std::move(word));
+    }
+
+    const auto measure = [&](const std::string& name, const std::function<size_t(const std::string&)>& lookup) {
+        size_t found = 0;
+        const auto start = Clock::now();
+        for (const std::string& query : queries) {
+            found += lookup(query);
+        }
+        const double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / queries.size();
+        std::cout << name << ": "s << us << " us/query, "s << found << " terms found"s << std::endl;
+    };
+    measure("exact (hash)"s, [&](const std::string& query) {
+        return static_cast<size_t>(vocabulary.contains(query));
+    });
+    measure("exact (dictionary)"s, [&](const std::string& query) {
+        return static_cast<size_t>(dictionary.Contains(query));
+    });
+    measure("fuzzy distance 1"s, [&](const std::string& query) {
+        return dictionary.ExpandFuzzy(query, 1, 16).size();
+    });
+    measure("fuzzy distance 2"s, [&](const std::string& query) {
+        return dictionary.ExpandFuzzy(query, 2, 16).size();
+    });
+
+    // Запросы сервера вперемешку с добавлением документов: новые термины не перестраивают словари,
+    // раскрытие обходит словари неизменяемых сегментов и перебирает только изменяемый сегмент
+    constexpr size_t INDEXED_LINE_COUNT = 20000;
+    IndexOptions options;
+    options.expand_fuzzy = true;
+    SearchServer server(""s, options);
+    const size_t line_count = std::min(corpus.lines.size(), INDEXED_LINE_COUNT);
+    for (size_t i = 0; i + queries.size() < line_count; ++i) {
+        server.AddDocument(static_cast<int>(i), std::string(corpus.lines[i]), DocumentStatus::ACTUAL, {1});
+    }
+    server.WaitForMerges();
+    size_t next_line = line_count > queries.size() ? line_count - queries.size() : 0;
+    const auto measure_server = [&](const std::string& name, bool interleave) {
+        double total_us = 0.0;
+        size_t found = 0;
+        for (const std::string& query : queries) {
+            if (interleave && next_line < line_count) {
+                server.AddDocument(static_cast<int>(next_line), std::string(corpus.lines[next_line]), DocumentStatus::ACTUAL, {1});
+                ++next_line;
+            }
+            const auto start = Clock::now();
+            found += server.FindTopDocuments(query + "~"s).size();
+            total_us += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        }
+        std::cout << name << ": "s << total_us / queries.size() << " us/query, "s << found << " documents found"s << std::endl;
+    };
+    std::cout << "server: "s << server.GetIndexStats().segments.size() << " segments"s << std::endl;
+    measure_server("server fuzzy, no ingest"s, false);
+    measure_server("server fuzzy, ingest between queries"s, true);
+}
+
+// Вывод результатов: operator<< через iostreams против ResultWriter (текст, JSON, бинарный формат) в /dev/null.
+// Пропускная способность всех вариантов считается по объёму текстового вывода
+void BenchmarkEmit([[maybe_unused]] const std::vector<std::string>& args) {
+    constexpr int RESPONSE_COUNT = 200000;
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<double> relevance(0.0, 5.0);
+    std::vector<Document> response;
+    for (int i = 0; i < MAX_RESULT_DOCUMENT_COUNT; ++i) {
+        response.emplace_back(static_cast<int>(generator() % 1000000), relevance(generator), static_cast<int>(generator() % 10));
+    }
+
+    const int fd = file_io::OpenFile(file_io::NULL_DEVICE, file_io::OpenMode::APPEND);
+    std::ofstream null_stream(std::string(file_io::NULL_DEVICE));
+    result_writer::ResultWriter writer;
+    writer.AppendText(response);
+    const size_t bytes = writer.GetSize() * RESPONSE_COUNT;
+    writer.Clear();
+
+    ReportThroughput("operator<<"s, bytes, [&] {
+        for (int i = 0; i < RESPONSE_COUNT; ++i) {
+            for (const Document& document : response) {
+                null_stream << document;
+            }
+            null_stream.flush();
+        }
+    });
+    const auto measure = [&](const std::string& name, void (result_writer::ResultWriter::*append)(const std::vector<Document>&)) {
+        ReportThroughput(name, bytes, [&] {
+            for (int i = 0; i < RESPONSE_COUNT; ++i) {
+                (writer.*append)(response);
+                writer.FlushTo(fd);
+            }
+        });
+    };
+    measure("ResultWriter text"s, &result_writer::ResultWriter::AppendText);
+    measure("ResultWriter json"s, &result_writer::ResultWriter::AppendJson);
+    measure("ResultWriter binary"s, &result_writer::ResultWriter::AppendBinary);
+    file_io::CloseFile(fd);
+}
+
+// Сводка оценок: скалярный проход (std::accumulate в int64_t, std::minmax_element) против SIMD-редукции AggregateRatings.
+// Аргумент - число оценок (по умолчанию 16M)
+void BenchmarkRatings(const std::vector<std::string>& args) {
+    const size_t count = args.empty() ? size_t{ 1 } << 24 : std::stoull(args[0]);
+    std::mt19937 generator(5);
+    std::uniform_int_distribution<int> rating(-1000000, 1000000);
+    std::vector<int> ratings(count);
+    for (int& value : ratings) {
+        value = rating(generator);
+    }
+    const size_t bytes = count * sizeof(int);
+
+    int64_t scalar_sum = 0;
+    ReportThroughput("scalar"s, bytes, [&] {
+        scalar_sum = std::accumulate(ratings.begin(), ratings.end(), int64_t{ 0 });
+        const auto [min, max] = std::minmax_element(ratings.begin(), ratings.end());
+        scalar_sum += *min - *max;
+    });
+    rating_stats::RatingAggregate aggregate;
+    ReportThroughput("AggregateRatings"s, bytes, [&] {
+        aggregate = rating_stats::AggregateRatings(ratings);
+    });
+    if (aggregate.sum + aggregate.min - aggregate.max != scalar_sum) {
+        throw std::runtime_error("Rating aggregates differ"s);
+    }
+    std::cout << "mean rating: "s << aggregate.GetMean() << std::endl;
+}
+
+} // namespace benchmarks
+
+int main(int argc, char* argv[]) {
+    using namespace benchmarks;
+
+    const std::map<std::string, std::function<void(const std::vector<std::string>&)>> modes = {
+        {"tokenizer"s, BenchmarkTokenizer},
+        {"ingest"s, BenchmarkIngest},
+        {"dictionary"s, BenchmarkDictionary},
+        {"fuzzy"s, BenchmarkFuzzy},
+        {"emit"s, BenchmarkEmit},
+        {"wal"s, BenchmarkWal},
+        {"segments"s, BenchmarkSegments},
+        {"status"s, BenchmarkStatus},
+        {"impact"s, BenchmarkImpact},
+        {"accumulators"s, BenchmarkAccumulators},
+        {"ratings"s, BenchmarkRatings},
+        {"policies"s, BenchmarkPolicies},
+        {"memory"s, BenchmarkMemory},
+        {"normalize"s, BenchmarkNormalize},
+    };
+
+    if (argc < 2 || !modes.contains(argv[1])) {
+        std::cerr << "Usage: "s << argv[0] << " <mode> [args...]\nModes:"s;
+        for (const auto& [name, _] : modes) {
+            std::cerr << ' ' << name;
+        }
+        std::cerr << std::endl;
+        return 1;
+    }
+    modes.at(argv[1])(std::vector<std::string>(argv + 2, argv + argc));
+    return 0;
+}
@@ -0,0 +1,409 @@
+#include "../src/request_queue.h"
+#include "../src/search_server.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+// Проигрывание журнала запросов против индекса корпуса: N потоков вызывают RequestQueue::AddFindRequest
+// с фиксированной суммарной частотой (открытая нагрузка - запрос k отправляется в момент start + k / rate,
+// независимо от того, успели ли выполниться предыдущие). Задержка считается от запланированного момента отправки,
+// поэтому отставание от расписания попадает в задержку, а не прячется.
+// Печатает пропускную способность, распределение задержки и долю пустых выдач; с --baseline завершается с кодом 1,
+// если p50 или p99 хуже сохранённых значений больше чем на --tolerance
+
+namespace replay {
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+using namespace request_queue;
+using namespace search_server;
+
+using Clock = std::chrono::steady_clock;
+
+struct ReplayOptions {
+    std::string corpus_path;
+    std::string log_path;
+    std::string field = "query"s; // поле JSON-объекта строки журнала с текстом запроса
+    std::string stop_words;
+    bool normalize = false;
+    size_t threads = 4;
+    double rate = 1000.0;    // запросов в секунду, суммарно по потокам
+    size_t requests = 0;     // 0 - каждый запрос журнала один раз
+    std::string baseline_path;
+    std::string save_baseline_path;
+    double tolerance = 0.2;
+};
+
+struct Report {
+    size_t requests = 0;
+    size_t errors = 0;       // запросы, на которые сервер бросил исключение
+    size_t empty_results = 0;
+    double seconds = 0.0;
+    std::vector<int64_t> latencies_ns; // отсортированы
+
+    double GetLatencyUs(double fraction) const {
+        if (latencies_ns.empty()) {
+            return 0.0;
+        }
+        const size_t index = std::min(latencies_ns.size() - 1, static_cast<size_t>(fraction * latencies_ns.size()));
+        return latencies_ns[index] / 1000.0;
+    }
+};
+
+void PrintUsage() {
+    std::cerr << "Usage: search-server-replay <corpus.txt> <queries.jsonl> [--field NAME] [--threads N] [--rate R] "
+                 "[--requests N] [--stop-words \"a the\"] [--normalize] [--baseline FILE] [--save-baseline FILE] "
+                 "[--tolerance 0.2]"s << std::endl;
+}
+
+ReplayOptions ParseArguments(int argc, char* argv[]) {
+    ReplayOptions options;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const auto next_value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for "s + arg);
+            }
+            return argv[++i];
+        };
+        if (arg == "--field"s) {
+            options.field = next_value();
+        } else if (arg == "--threads"s) {
+            options.threads = std::max<size_t>(std::stoul(next_value()), 1);
+        } else if (arg == "--rate"s) {
+            options.rate = std::stod(next_value());
+        } else if (arg == "--requests"s) {
+            options.requests = std::stoul(next_value());
+        } else if (arg == "--stop-words"s) {
+            options.stop_words = next_value();
+        } else if (arg == "--normalize"s) {
+            options.normalize = true;
+        } else if (arg == "--baseline"s) {
+            options.baseline_path = next_value();
+        } else if (arg == "--save-baseline"s) {
+            options.save_baseline_path = next_value();
+        } else if (arg == "--tolerance"s) {
+            options.tolerance = std::stod(next_value());
+        } else if (arg.starts_with("--"s)) {
+            throw std::invalid_argument("Unknown argument: "s + arg);
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() != 2) {
+        throw std::invalid_argument("Corpus and query log are required"s);
+    }
+    if (options.rate <= 0.0) {
+        throw std::invalid_argument("Rate must be positive"s);
+    }
+    options.corpus_path = positional[0];
+    options.log_path = positional[1];
+    return options;
+}
+
+void AppendUtf8(uint32_t code_point, std::string& out) {
+    if (code_point < 0x80) {
+        out.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+uint32_t ParseHex4(std::string_view text, size_t pos) {
+    if (pos + 4 > text.size()) {
+        throw std::invalid_argument("Truncated \\u escape"s);
+    }
+    uint32_t value = 0;
+    for (size_t i = pos; i < pos + 4; ++i) {
+        const char c = text[i];
+        const int digit = c >= '0' && c <= '9' ? c - '0'
+                        : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                        : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                        : -1;
+        if (digit < 0) {
+            throw std::invalid_argument("Incorrect \\u escape"s);
+        }
+        value = value * 16 + digit;
+    }
+    return value;
+}
+
+// Строковое значение поля верхнего уровня в JSON-объекте из одной строки; nullopt - поля нет или оно не строка.
+// Вложенные объекты и массивы пропускаются, escape-последовательности (включая суррогатные пары \u) раскрываются
+std::optional<std::string> ExtractJsonString(std::string_view line, std::string_view field) {
+    size_t pos = 0;
+    int depth = 0;
+    std::string key;
+    bool expect_key = false;
+    // Читает строку с позиции pos (на открывающей кавычке), pos ставится после закрывающей
+    const auto read_string = [&]() {
+        std::string value;
+        for (++pos; pos < line.size(); ++pos) {
+            const char c = line[pos];
+            if (c == '"') {
+                ++pos;
+                return value;
+            }
+            if (c != '\\') {
+                value.push_back(c);
+                continue;
+            }
+            if (++pos >= line.size()) {
+                break;
+            }
+            switch (line[pos]) {
+            case 'n': value.push_back('\n'); break;
+            case 't': value.push_back('\t'); break;
+            case 'r': value.push_back('\r'); break;
+            case 'b': value.push_back('\b'); break;
+            case 'f': value.push_back('\f'); break;
+            case 'u': {
+                uint32_t code_point = ParseHex4(line, pos + 1);
+                pos += 4;
+                if (code_point >= 0xD800 && code_point < 0xDC00 && line.substr(pos + 1, 2) == "\\u"sv) {
+                    const uint32_t low = ParseHex4(line, pos + 3);
+                    if (low >= 0xDC00 && low < 0xE000) {
+                        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                        pos += 6;
+                    }
+                }
+                AppendUtf8(code_point, value);
+                break;
+            }
+            default: value.push_back(line[pos]); break;
+            }
+        }
+        throw std::invalid_argument("Unterminated JSON string"s);
+    };
+
+    while (pos < line.size()) {
+        const char c = line[pos];
+        if (c == '"') {
+            const bool is_key = depth == 1 && expect_key;
+            std::string text = read_string();
+            if (is_key) {
+                key = std::move(text);
+                expect_key = false;
+            } else if (depth == 1 && key == field) {
+                return text;
+            }
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            ++depth;
+            expect_key = c == '{' && depth == 1;
+        } else if (c == '}' || c == ']') {
+            --depth;
+        } else if (c == ',' && depth == 1) {
+            expect_key = true;
+            key.clear();
+        }
+        ++pos;
+    }
+    return std::nullopt;
+}
+
+// Строки журнала: JSON-объект (запрос - значение options.field) или просто текст запроса
+std::vector<std::string> LoadQueries(const ReplayOptions& options) {
+    std::ifstream input(options.log_path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Cannot open "s + options.log_path);
+    }
+    std::vector<std::string> queries;
+    for (std::string line; std::getline(input, line);) {
+        if (line.empty()) {
+            continue;
+        }
+        if (line.front() != '{') {
+            queries.push_back(std::move(line));
+        } else if (std::optional<std::string> query = ExtractJsonString(line, options.field)) {
+            queries.push_back(std::move(*query));
+        }
+    }
+    if (queries.empty()) {
+        throw std::invalid_argument("No queries with field \""s + options.field + "\" in "s + options.log_path);
+    }
+    return queries;
+}
+
+// Каждая непустая строка файла - документ со статусом ACTUAL, ID - номер строки начиная с 1
+void LoadCorpus(const std::string& path, SearchServer& server) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Cannot open "s + path);
+    }
+    int document_id = 0;
+    for (std::string line; std::getline(input, line);) {
+        ++document_id;
+        if (!line.empty()) {
+            try {
+                server.AddDocument(document_id, line, DocumentStatus::ACTUAL, {});
+            } catch (const std::invalid_argument&) {
+                // Строки с управляющими символами пропускаются
+            }
+        }
+    }
+    server.WaitForMerges();
+}
+
+Report Replay(const ReplayOptions& options, const SearchServer& server, const std::vector<std::string>& queries) {
+    RequestQueue queue(server);
+    const size_t total = options.requests == 0 ? queries.size() : options.requests;
+    const auto interval = std::chrono::duration<double>(1.0 / options.rate);
+
+    struct ThreadReport {
+        std::vector<int64_t> latencies_ns;
+        size_t errors = 0;
+        size_t empty_results = 0;
+    };
+    std::vector<ThreadReport> reports(options.threads);
+    std::vector<std::thread> threads;
+    // Запас на запуск потоков, чтобы первые запросы не начинали с отставания
+    const Clock::time_point start = Clock::now() + std::chrono::milliseconds(10);
+    for (size_t t = 0; t < options.threads; ++t) {
+        threads.emplace_back([&, t] {
+            ThreadReport& report = reports[t];
+            report.latencies_ns.reserve(total / options.threads + 1);
+            for (size_t k = t; k < total; k += options.threads) {
+                const Clock::time_point scheduled = start + std::chrono::duration_cast<Clock::duration>(interval * k);
+                std::this_thread::sleep_until(scheduled);
+                try {
+                    if (queue.AddFindRequest(queries[k % queries.size()]).empty()) {
+                        ++report.empty_results;
+                    }
+                } catch (const std::exception&) {
+                    ++report.errors;
+                }
+                report.latencies_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - scheduled).count());
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    Report result;
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (const ThreadReport& report : reports) {
+        result.latencies_ns.insert(result.latencies_ns.end(), report.latencies_ns.begin(), report.latencies_ns.end());
+        result.errors += report.errors;
+        result.empty_results += report.empty_results;
+    }
+    result.requests = result.latencies_ns.size();
+    std::sort(result.latencies_ns.begin(), result.latencies_ns.end());
+    return result;
+}
+
+// Базовая линия - строки "имя значение"
+std::map<std::string, double> LoadBaseline(const std::string& path) {
+    std::ifstream input(path);
+    if (!input) {
+        throw std::runtime_error("Cannot open "s + path);
+    }
+    std::map<std::string, double> values;
+    std::string name;
+    double value;
+    while (input >> name >> value) {
+        values[name] = value;
+    }
+    return values;
+}
+
+void SaveBaseline(const std::string& path, const Report& report) {
+    std::ofstream output(path);
+    if (!output) {
+        throw std::runtime_error("Cannot open "s + path);
+    }
+    output << std::fixed << std::setprecision(3);
+    output << "p50_us "s << report.GetLatencyUs(0.50) << '\n';
+    output << "p99_us "s << report.GetLatencyUs(0.99) << '\n';
+    output << "throughput "s << report.requests / report.seconds << '\n';
+}
+
+// Сравнивает p50 и p99 с базовой линией, печатает отклонения; true - задержка выросла больше допуска
+bool CheckRegression(const std::map<std::string, double>& baseline, const Report& report, double tolerance) {
+    bool regressed = false;
+    for (const auto& [name, fraction] : {std::pair{"p50_us"s, 0.50}, std::pair{"p99_us"s, 0.99}}) {
+        const auto it = baseline.find(name);
+        if (it == baseline.end()) {
+            continue;
+        }
+        const double current = report.GetLatencyUs(fraction);
+        const double limit = it->second * (1.0 + tolerance);
+        const bool is_worse = current > limit;
+        std::cout << name << ": "s << current << " (baseline "s << it->second << ", limit "s << limit << ")"s
+                  << (is_worse ? " REGRESSION"s : ""s) << std::endl;
+        regressed = regressed || is_worse;
+    }
+    return regressed;
+}
+
+} // namespace replay
+
+int main(int argc, char* argv[]) {
+    using namespace replay;
+
+    ReplayOptions options;
+    try {
+        options = ParseArguments(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        PrintUsage();
+        return 2;
+    }
+
+    try {
+        const std::vector<std::string> queries = LoadQueries(options);
+        IndexOptions index_options;
+        index_options.normalize_text = options.normalize;
+        SearchServer server(options.stop_words, index_options);
+        LoadCorpus(options.corpus_path, server);
+
+        const Report report = Replay(options, server, queries);
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "documents: "s << server.GetDocumentCount() << ", queries in log: "s << queries.size()
+                  << ", threads: "s << options.threads << ", target rate: "s << options.rate << " req/s"s << std::endl;
+        std::cout << "requests: "s << report.requests << ", errors: "s << report.errors << ", throughput: "s
+                  << report.requests / report.seconds << " req/s"s << std::endl;
+        std::cout << "latency us: p50 "s << report.GetLatencyUs(0.50) << ", p90 "s << report.GetLatencyUs(0.90)
+                  << ", p99 "s << report.GetLatencyUs(0.99) << ", p99.9 "s << report.GetLatencyUs(0.999)
+                  << ", max "s << report.GetLatencyUs(1.0) << std::endl;
+        std::cout << std::setprecision(3) << "empty results: "s
+                  << (report.requests == 0 ? 0.0 : static_cast<double>(report.empty_results) / report.requests)
+                  << std::endl;
+
+        if (!options.save_baseline_path.empty()) {
+            SaveBaseline(options.save_baseline_path, report);
+        }
+        if (!options.baseline_path.empty() && CheckRegression(LoadBaseline(options.baseline_path), report, options.tolerance)) {
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+// Нагрузочный клиент для search-server-daemon: connections соединений, в каждом до pipeline запросов в полёте.
+// Запросы берутся по кругу из файла (строка - запрос FIND, с --raw строка отправляется как есть).
+// Печатает пропускную способность и перцентили задержки от отправки запроса до получения ответа
+
+using namespace std::string_literals;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct LoadOptions {
+    std::string address; // host:port или unix:PATH
+    std::string queries_path;
+    size_t connections = 4;
+    size_t pipeline = 8;
+    double duration_seconds = 5.0;
+    bool raw = false;
+};
+
+struct WorkerResult {
+    std::vector<int64_t> latencies_ns;
+    uint64_t errors = 0;
+};
+
+void PrintUsage() {
+    std::cerr << "Usage: search-server-loadgen <host:port | unix:PATH> <queries.txt> [--connections N] [--pipeline N] "
+                 "[--duration SECONDS] [--raw]"s << std::endl;
+}
+
+LoadOptions ParseArguments(int argc, char* argv[]) {
+    LoadOptions options;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const auto next_value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for "s + arg);
+            }
+            return argv[++i];
+        };
+        if (arg == "--connections"s) {
+            options.connections = std::max<size_t>(std::stoul(next_value()), 1);
+        } else if (arg == "--pipeline"s) {
+            options.pipeline = std::max<size_t>(std::stoul(next_value()), 1);
+        } else if (arg == "--duration"s) {
+            options.duration_seconds = std::stod(next_value());
+        } else if (arg == "--raw"s) {
+            options.raw = true;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() != 2) {
+        throw std::invalid_argument("Address and queries file are required"s);
+    }
+    options.address = positional[0];
+    options.queries_path = positional[1];
+    return options;
+}
+
+int Connect(const std::string& address) {
+    int fd;
+    if (address.starts_with("unix:"s)) {
+        const std::string path = address.substr(5);
+        sockaddr_un socket_address{};
+        socket_address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(socket_address.sun_path)) {
+            throw std::invalid_argument("Unix socket path is too long: "s + path);
+        }
+        std::memcpy(socket_address.sun_path, path.data(), path.size());
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&socket_address), sizeof(socket_address)) != 0) {
+            throw std::system_error(errno, std::generic_category(), "Cannot connect to "s + path);
+        }
+    } else {
+        const size_t colon = address.rfind(':');
+        if (colon == std::string::npos) {
+            throw std::invalid_argument("Incorrect address: "s + address);
+        }
+        sockaddr_in socket_address{};
+        socket_address.sin_family = AF_INET;
+        socket_address.sin_port = htons(static_cast<uint16_t>(std::stoul(address.substr(colon + 1))));
+        if (inet_pton(AF_INET, address.substr(0, colon).c_str(), &socket_address.sin_addr) != 1) {
+            throw std::invalid_argument("Incorrect IPv4 address: "s + address);
+        }
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&socket_address), sizeof(socket_address)) != 0) {
+            throw std::system_error(errno, std::generic_category(), "Cannot connect to "s + address);
+        }
+        const int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    }
+    return fd;
+}
+
+void SendAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "send failed"s);
+        }
+        data.remove_prefix(sent);
+    }
+}
+
+// Держит в соединении options.pipeline запросов в полёте до истечения deadline, затем дожидается оставшихся ответов
+void RunConnection(const LoadOptions& options, const std::vector<std::string>& requests, size_t first_request,
+                   Clock::time_point deadline, WorkerResult& result) {
+    const int fd = Connect(options.address);
+    std::deque<Clock::time_point> in_flight;
+    std::string input;
+    std::string batch;
+    std::array<char, 64 * 1024> buffer;
+    size_t next_request = first_request;
+
+    while (true) {
+        const Clock::time_point now = Clock::now();
+        batch.clear();
+        while (now < deadline && in_flight.size() < options.pipeline) {
+            batch += requests[next_request];
+            next_request = (next_request + 1) % requests.size();
+            in_flight.push_back(now);
+        }
+        SendAll(fd, batch);
+        if (in_flight.empty()) {
+            break;
+        }
+
+        const ssize_t read_bytes = read(fd, buffer.data(), buffer.size());
+        if (read_bytes <= 0) {
+            if (read_bytes < 0 && errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            throw std::runtime_error("Connection closed by server"s);
+        }
+        const Clock::time_point received = Clock::now();
+        input.append(buffer.data(), read_bytes);
+        size_t line_begin = 0;
+        for (size_t line_end; (line_end = input.find('\n', line_begin)) != std::string::npos; line_begin = line_end + 1) {
+            if (input.compare(line_begin, 3, "OK "s) != 0) {
+                ++result.errors;
+            }
+            result.latencies_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(received - in_flight.front()).count());
+            in_flight.pop_front();
+        }
+        input.erase(0, line_begin);
+    }
+    close(fd);
+}
+
+double Percentile(const std::vector<int64_t>& sorted, double fraction) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()));
+    return sorted[index] / 1000.0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    std::vector<std::string> requests;
+    try {
+        options = ParseArguments(argc, argv);
+        std::ifstream input(options.queries_path, std::ios::binary);
+        if (!input) {
+            throw std::runtime_error("Cannot open "s + options.queries_path);
+        }
+        for (std::string line; std::getline(input, line);) {
+            if (!line.empty()) {
+                requests.push_back((options.raw ? ""s : "FIND "s) + line + "\n"s);
+            }
+        }
+        if (requests.empty()) {
+            throw std::invalid_argument("Queries file is empty"s);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        PrintUsage();
+        return 2;
+    }
+
+    std::vector<WorkerResult> results(options.connections);
+    std::vector<std::thread> threads;
+    std::atomic<bool> failed = false;
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.duration_seconds));
+    for (size_t i = 0; i < options.connections; ++i) {
+        threads.emplace_back([&, i] {
+            try {
+                RunConnection(options, requests, i * requests.size() / options.connections, deadline, results[i]);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                failed = true;
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<int64_t> latencies;
+    uint64_t errors = 0;
+    for (const WorkerResult& result : results) {
+        latencies.insert(latencies.end(), result.latencies_ns.begin(), result.latencies_ns.end());
+        errors += result.errors;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "requests: "s << latencies.size() << ", errors: "s << errors << ", connections: "s << options.connections
+              << ", pipeline: "s << options.pipeline << std::endl;
+    std::cout << "throughput: "s << latencies.size() / elapsed << " req/s"s << std::endl;
+    std::cout << "latency us: p50 "s << Percentile(latencies, 0.50) << ", p90 "s << Percentile(latencies, 0.90)
+              << ", p99 "s << Percentile(latencies, 0.99) << ", max "s << (latencies.empty() ? 0.0 : latencies.back() / 1000.0)
+              << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,141 @@
+#include "query_service.h"
+
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+
+using namespace std::string_literals;
+using namespace query_service;
+
+namespace {
+
+void PrintUsage() {
+    std::cerr << "Usage: search-server-daemon <corpus.txt> [--port N | --unix PATH] [--host ADDR] [--workers N] "
+                 "[--batch N] [--stop-words \"a the\"] [--positions] [--slow-ms N]"s << std::endl;
+}
+
+struct DaemonOptions {
+    std::string corpus_path;
+    std::string stop_words;
+    IndexOptions index;
+    ServiceOptions service;
+};
+
+DaemonOptions ParseArguments(int argc, char* argv[]) {
+    DaemonOptions options;
+    std::vector<std::string> args(argv + 1, argv + argc);
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        const auto next_value = [&]() -> const std::string& {
+            if (i + 1 >= args.size()) {
+                throw std::invalid_argument("Missing value for "s + arg);
+            }
+            return args[++i];
+        };
+        if (arg == "--port"s) {
+            options.service.port = static_cast<uint16_t>(std::stoul(next_value()));
+        } else if (arg == "--unix"s) {
+            options.service.unix_socket_path = next_value();
+        } else if (arg == "--host"s) {
+            options.service.host = next_value();
+        } else if (arg == "--workers"s) {
+            options.service.worker_count = std::stoul(next_value());
+        } else if (arg == "--batch"s) {
+            options.service.max_batch_size = std::stoul(next_value());
+        } else if (arg == "--stop-words"s) {
+            options.stop_words = next_value();
+        } else if (arg == "--positions"s) {
+            options.index.store_positions = true;
+        } else if (arg == "--slow-ms"s) {
+            options.service.slow_query_threshold = std::chrono::milliseconds(std::stoul(next_value()));
+        } else if (options.corpus_path.empty() && !arg.starts_with("--"s)) {
+            options.corpus_path = arg;
+        } else {
+            throw std::invalid_argument("Unknown argument: "s + arg);
+        }
+    }
+    if (options.corpus_path.empty()) {
+        throw std::invalid_argument("Corpus file is not specified"s);
+    }
+    return options;
+}
+
+// Каждая непустая строка файла - документ со статусом ACTUAL, ID - номер строки начиная с 1
+void LoadCorpus(const std::string& path, SearchServer& server) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Cannot open "s + path);
+    }
+    std::string line;
+    int document_id = 0;
+    while (std::getline(input, line)) {
+        ++document_id;
+        if (line.empty()) {
+            continue;
+        }
+        try {
+            server.AddDocument(document_id, line, DocumentStatus::ACTUAL, {});
+        } catch (const std::invalid_argument& e) {
+            std::cerr << "Line "s << document_id << " skipped: "s << e.what() << std::endl;
+        }
+    }
+    server.WaitForMerges();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        const DaemonOptions options = ParseArguments(argc, argv);
+
+        // Сигналы завершения блокируются до запуска потоков и ожидаются в главном потоке через sigwait
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        SearchServer server(options.stop_words, options.index);
+        LoadCorpus(options.corpus_path, server);
+
+        QueryService service(server, options.service);
+        std::thread service_thread([&service] { service.Run(); });
+        if (options.service.unix_socket_path.empty()) {
+            std::cerr << "Serving "s << server.GetDocumentCount() << " documents on "s << options.service.host << ":"s
+                      << service.GetPort() << std::endl;
+        } else {
+            std::cerr << "Serving "s << server.GetDocumentCount() << " documents on "s
+                      << options.service.unix_socket_path << std::endl;
+        }
+
+        int signal = 0;
+        sigwait(&signals, &signal);
+        service.Stop();
+        service_thread.join();
+
+        const ServiceStats stats = service.GetStats();
+        std::cerr << "Stopped: "s << stats.requests << " requests in "s << stats.batches << " batches, "s
+                  << stats.accepted_connections << " connections"s << std::endl;
+        for (const SlowQuery& slow_query : service.GetSlowQueries()) {
+            std::cerr << "Slow query #"s << slow_query.sequence << ": "s
+                      << std::chrono::duration<double, std::milli>(slow_query.duration).count() << " ms, "s
+                      << slow_query.result_count << " results: "s << slow_query.query << std::endl;
+        }
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << std::endl;
+        PrintUsage();
+        return 2;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
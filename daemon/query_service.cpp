@@ -0,0 +1,449 @@
+#include "query_service.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+namespace query_service {
+
+using namespace std::string_literals;
+
+namespace {
+
+// Значения epoll_event::data.u64 служебных дескрипторов; соединения нумеруются с FIRST_CONNECTION_ID
+constexpr uint64_t LISTEN_ID = 0;
+constexpr uint64_t COMPLETION_ID = 1;
+constexpr uint64_t STOP_ID = 2;
+constexpr uint64_t FIRST_CONNECTION_ID = 16;
+
+constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+constexpr int MAX_EVENTS = 256;
+
+[[noreturn]] void ThrowSystemError(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void AddToEpoll(int epoll_fd, int fd, uint32_t events, uint64_t id) {
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = id;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        ThrowSystemError("epoll_ctl failed"s);
+    }
+}
+
+void SignalEventFd(int fd) {
+    const uint64_t one = 1;
+    // Переполнение счётчика невозможно, EAGAIN означает, что сигнал уже ждёт обработки
+    [[maybe_unused]] const ssize_t written = write(fd, &one, sizeof(one));
+}
+
+void DrainEventFd(int fd) {
+    uint64_t value;
+    [[maybe_unused]] const ssize_t read_bytes = read(fd, &value, sizeof(value));
+}
+
+} // namespace
+
+QueryService::QueryService(const SearchServer& server, ServiceOptions options)
+    : server_(server)
+    , queue_(server)
+    , options_(std::move(options))
+    , next_connection_id_(FIRST_CONNECTION_ID) {
+    if (options_.worker_count == 0) {
+        options_.worker_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    options_.max_batch_size = std::max<size_t>(options_.max_batch_size, 1);
+    options_.max_pending_requests = std::max<size_t>(options_.max_pending_requests, 1);
+    if (options_.slow_query_threshold.count() > 0) {
+        queue_.EnableSlowQueryLog(options_.slow_query_threshold);
+    }
+    try {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            ThrowSystemError("epoll_create1 failed"s);
+        }
+        completion_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (completion_fd_ < 0 || stop_fd_ < 0) {
+            ThrowSystemError("eventfd failed"s);
+        }
+        OpenListener();
+        AddToEpoll(epoll_fd_, listen_fd_, EPOLLIN, LISTEN_ID);
+        AddToEpoll(epoll_fd_, completion_fd_, EPOLLIN, COMPLETION_ID);
+        AddToEpoll(epoll_fd_, stop_fd_, EPOLLIN, STOP_ID);
+    } catch (...) {
+        for (const int fd : {listen_fd_, epoll_fd_, completion_fd_, stop_fd_}) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+        throw;
+    }
+}
+
+QueryService::~QueryService() {
+    for (auto& [id, connection] : connections_) {
+        close(connection.fd);
+    }
+    close(listen_fd_);
+    close(epoll_fd_);
+    close(completion_fd_);
+    close(stop_fd_);
+    if (!options_.unix_socket_path.empty()) {
+        unlink(options_.unix_socket_path.c_str());
+    }
+}
+
+void QueryService::OpenListener() {
+    if (!options_.unix_socket_path.empty()) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (options_.unix_socket_path.size() >= sizeof(address.sun_path)) {
+            throw std::invalid_argument("Unix socket path is too long: "s + options_.unix_socket_path);
+        }
+        std::memcpy(address.sun_path, options_.unix_socket_path.data(), options_.unix_socket_path.size());
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0) {
+            ThrowSystemError("socket failed"s);
+        }
+        // Файл сокета от предыдущего запуска
+        unlink(options_.unix_socket_path.c_str());
+        if (bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            ThrowSystemError("Cannot bind "s + options_.unix_socket_path);
+        }
+    } else {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(options_.port);
+        if (inet_pton(AF_INET, options_.host.c_str(), &address.sin_addr) != 1) {
+            throw std::invalid_argument("Incorrect IPv4 address: "s + options_.host);
+        }
+        listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0) {
+            ThrowSystemError("socket failed"s);
+        }
+        const int enable = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        if (bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            ThrowSystemError("Cannot bind "s + options_.host + ":"s + std::to_string(options_.port));
+        }
+        socklen_t length = sizeof(address);
+        getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &length);
+        port_ = ntohs(address.sin_port);
+    }
+    if (listen(listen_fd_, SOMAXCONN) != 0) {
+        ThrowSystemError("listen failed"s);
+    }
+}
+
+void QueryService::Run() {
+    {
+        std::lock_guard lock(tasks_mutex_);
+        stopping_ = false;
+    }
+    for (size_t i = 0; i < options_.worker_count; ++i) {
+        workers_.emplace_back([this] { WorkerLoop(); });
+    }
+
+    std::array<epoll_event, MAX_EVENTS> events;
+    std::vector<Task> tasks;
+    bool stop = false;
+    while (!stop) {
+        const int count = epoll_wait(epoll_fd_, events.data(), MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("epoll_wait failed"s);
+        }
+        for (int i = 0; i < count; ++i) {
+            const uint64_t id = events[i].data.u64;
+            if (id == LISTEN_ID) {
+                AcceptConnections();
+            } else if (id == COMPLETION_ID) {
+                DrainEventFd(completion_fd_);
+                DeliverCompletions();
+            } else if (id == STOP_ID) {
+                DrainEventFd(stop_fd_);
+                stop = true;
+            } else {
+                // Соединение могло быть закрыто при обработке предыдущего события
+                const auto it = connections_.find(id);
+                if (it == connections_.end()) {
+                    continue;
+                }
+                Connection& connection = it->second;
+                if ((events[i].events & EPOLLERR) != 0 || ((events[i].events & EPOLLHUP) != 0 && connection.read_closed)) {
+                    CloseConnection(id);
+                    continue;
+                }
+                if ((events[i].events & EPOLLOUT) != 0 && !FlushConnection(id, connection)) {
+                    continue;
+                }
+                if ((events[i].events & (EPOLLIN | EPOLLHUP)) != 0) {
+                    ReadConnection(id, connection, tasks);
+                }
+            }
+        }
+        SubmitTasks(tasks);
+    }
+
+    {
+        std::lock_guard lock(tasks_mutex_);
+        stopping_ = true;
+        tasks_.clear();
+    }
+    tasks_cv_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+    completions_.clear();
+}
+
+void QueryService::Stop() {
+    SignalEventFd(stop_fd_);
+}
+
+uint16_t QueryService::GetPort() const {
+    return port_;
+}
+
+ServiceStats QueryService::GetStats() const {
+    return {
+        accepted_connections_.load(std::memory_order_relaxed),
+        open_connections_.load(std::memory_order_relaxed),
+        requests_.load(std::memory_order_relaxed),
+        batches_.load(std::memory_order_relaxed),
+    };
+}
+
+std::vector<SlowQuery> QueryService::GetSlowQueries() const {
+    const SlowQueryLog* slow_query_log = queue_.GetSlowQueryLog();
+    return slow_query_log ? slow_query_log->GetEntries() : std::vector<SlowQuery>{};
+}
+
+void QueryService::AcceptConnections() {
+    while (true) {
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            // EAGAIN - очередь пуста; прочие ошибки (EMFILE, ECONNABORTED) не останавливают службу
+            return;
+        }
+        if (options_.unix_socket_path.empty()) {
+            const int enable = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        }
+        const uint64_t id = next_connection_id_++;
+        Connection& connection = connections_[id];
+        connection.fd = fd;
+        connection.events = EPOLLIN;
+        AddToEpoll(epoll_fd_, fd, connection.events, id);
+        accepted_connections_.fetch_add(1, std::memory_order_relaxed);
+        open_connections_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void QueryService::ReadConnection(uint64_t id, Connection& connection, std::vector<Task>& tasks) {
+    // За один вызов читается не больше READ_CHUNK_SIZE байт, чтобы одно соединение не задерживало остальные
+    const size_t old_size = connection.input.size();
+    connection.input.resize(old_size + READ_CHUNK_SIZE);
+    const ssize_t read_bytes = read(connection.fd, connection.input.data() + old_size, READ_CHUNK_SIZE);
+    connection.input.resize(old_size + std::max<ssize_t>(read_bytes, 0));
+    if (read_bytes < 0) {
+        if (errno != EAGAIN && errno != EINTR) {
+            CloseConnection(id);
+        }
+        return;
+    }
+    if (read_bytes == 0) {
+        connection.read_closed = true;
+    }
+
+    size_t line_begin = 0;
+    while (true) {
+        const size_t line_end = connection.input.find('\n', line_begin);
+        if (line_end == std::string::npos) {
+            break;
+        }
+        if (line_end - line_begin > MAX_REQUEST_SIZE) {
+            break;
+        }
+        tasks.push_back({id, connection.next_sequence++, connection.input.substr(line_begin, line_end - line_begin)});
+        line_begin = line_end + 1;
+    }
+    connection.input.erase(0, line_begin);
+
+    if (connection.input.size() > MAX_REQUEST_SIZE) {
+        // Ошибка отправляется после ответов на предыдущие запросы, остаток соединения не читается
+        std::string error;
+        AppendError("Request is too long", error);
+        connection.ready.emplace(connection.next_sequence++, std::move(error));
+        connection.input.clear();
+        connection.read_closed = true;
+    } else if (connection.read_closed && !connection.input.empty()) {
+        // Последний запрос без завершающего перевода строки
+        tasks.push_back({id, connection.next_sequence++, std::move(connection.input)});
+        connection.input.clear();
+    }
+    FlushConnection(id, connection);
+}
+
+void QueryService::SubmitTasks(std::vector<Task>& tasks) {
+    if (tasks.empty()) {
+        return;
+    }
+    requests_.fetch_add(tasks.size(), std::memory_order_relaxed);
+    {
+        std::lock_guard lock(tasks_mutex_);
+        std::move(tasks.begin(), tasks.end(), std::back_inserter(tasks_));
+    }
+    tasks.clear();
+    tasks_cv_.notify_all();
+}
+
+void QueryService::WorkerLoop() {
+    std::vector<Task> batch;
+    std::vector<Completion> results;
+    while (true) {
+        {
+            std::unique_lock lock(tasks_mutex_);
+            tasks_cv_.wait(lock, [this] {
+                return stopping_ || !tasks_.empty();
+            });
+            if (stopping_) {
+                return;
+            }
+            const size_t batch_size = std::min(tasks_.size(), options_.max_batch_size);
+            std::move(tasks_.begin(), tasks_.begin() + batch_size, std::back_inserter(batch));
+            tasks_.erase(tasks_.begin(), tasks_.begin() + batch_size);
+        }
+        batches_.fetch_add(1, std::memory_order_relaxed);
+
+        const ServiceStats stats = GetStats();
+        for (Task& task : batch) {
+            std::string response;
+            HandleRequest(task.request, server_, queue_, stats, response);
+            results.push_back({task.connection_id, task.sequence, std::move(response)});
+        }
+        batch.clear();
+
+        bool was_empty;
+        {
+            std::lock_guard lock(completions_mutex_);
+            was_empty = completions_.empty();
+            std::move(results.begin(), results.end(), std::back_inserter(completions_));
+        }
+        results.clear();
+        // Если очередь ответов не была пуста, цикл уже разбужен и заберёт и эти ответы
+        if (was_empty) {
+            SignalEventFd(completion_fd_);
+        }
+    }
+}
+
+void QueryService::DeliverCompletions() {
+    std::vector<Completion> completions;
+    {
+        std::lock_guard lock(completions_mutex_);
+        completions.swap(completions_);
+    }
+    std::vector<uint64_t> touched;
+    for (Completion& completion : completions) {
+        const auto it = connections_.find(completion.connection_id);
+        if (it == connections_.end()) {
+            continue;
+        }
+        it->second.ready.emplace(completion.sequence, std::move(completion.response));
+        touched.push_back(completion.connection_id);
+    }
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    for (const uint64_t id : touched) {
+        const auto it = connections_.find(id);
+        if (it != connections_.end()) {
+            FlushConnection(id, it->second);
+        }
+    }
+}
+
+bool QueryService::FlushConnection(uint64_t id, Connection& connection) {
+    // Готовые ответы переносятся в буфер отправки строго по порядку запросов
+    for (auto it = connection.ready.begin(); it != connection.ready.end() && it->first == connection.next_response;
+         it = connection.ready.erase(it)) {
+        connection.output.append(it->second);
+        ++connection.next_response;
+    }
+
+    while (connection.output_offset < connection.output.size()) {
+        const ssize_t sent = send(connection.fd, connection.output.data() + connection.output_offset,
+                                  connection.output.size() - connection.output_offset, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                break;
+            }
+            CloseConnection(id);
+            return false;
+        }
+        connection.output_offset += sent;
+    }
+    if (connection.output_offset == connection.output.size()) {
+        connection.output.clear();
+        connection.output_offset = 0;
+    } else if (connection.output_offset > connection.output.size() / 2) {
+        connection.output.erase(0, connection.output_offset);
+        connection.output_offset = 0;
+    }
+
+    const bool all_answered = connection.next_response == connection.next_sequence;
+    if (connection.read_closed && all_answered && connection.output.empty()) {
+        CloseConnection(id);
+        return false;
+    }
+    UpdateEvents(id, connection);
+    return true;
+}
+
+void QueryService::UpdateEvents(uint64_t id, Connection& connection) {
+    const uint64_t pending = connection.next_sequence - connection.next_response;
+    uint32_t events = 0;
+    if (!connection.read_closed && pending < options_.max_pending_requests) {
+        events |= EPOLLIN;
+    }
+    if (!connection.output.empty()) {
+        events |= EPOLLOUT;
+    }
+    if (events == connection.events) {
+        return;
+    }
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = id;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.events = events;
+}
+
+void QueryService::CloseConnection(uint64_t id) {
+    const auto it = connections_.find(id);
+    // Закрытый дескриптор удаляется из epoll автоматически; ответы на запросы в работе будут отброшены
+    close(it->second.fd);
+    connections_.erase(it);
+    open_connections_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+}; // namespace query_service
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../src/query_protocol.h"
+#include "../src/request_queue.h"
+#include "../src/search_server.h"
+
+
+// Сетевая служба запросов (Linux): цикл epoll принимает соединения и читает строки протокола query_protocol,
+// запросы соединения выполняются конвейером - следующий читается, не дожидаясь ответа на предыдущий,
+// ответы возвращаются в порядке запросов. Запросы, прочитанные за один проход цикла, передаются пулу рабочих потоков
+// одной пачкой; рабочий поток забирает до max_batch_size запросов за раз и будит цикл один раз на пачку
+namespace query_service {
+
+using namespace query_protocol;
+using namespace request_queue;
+using namespace search_server;
+
+struct ServiceOptions {
+    std::string unix_socket_path;   // непустой - слушать Unix-сокет вместо TCP
+    std::string host = "127.0.0.1";
+    uint16_t port = 0;              // 0 - любой свободный порт, см. GetPort()
+    size_t worker_count = 0;        // 0 - по числу ядер
+    size_t max_batch_size = 64;     // запросов, которые рабочий поток забирает за раз
+    size_t max_pending_requests = 1024; // на соединение; больше - чтение соединения приостанавливается
+    std::chrono::milliseconds slow_query_threshold{ 0 }; // FIND не быстрее порога попадает в журнал медленных запросов; 0 - без журнала
+};
+
+class QueryService {
+public:
+    // Создаёт слушающий сокет; при ошибке бросает std::system_error. Сервер не должен меняться, пока служба работает
+    QueryService(const SearchServer& server, ServiceOptions options);
+    ~QueryService();
+
+    QueryService(const QueryService&) = delete;
+    QueryService& operator=(const QueryService&) = delete;
+
+    // Цикл обработки в вызывающем потоке до Stop()
+    void Run();
+
+    // Можно вызывать из любого потока
+    void Stop();
+
+    // Порт TCP (полезно при port = 0), для Unix-сокета - 0
+    uint16_t GetPort() const;
+
+    ServiceStats GetStats() const;
+
+    // Последние медленные запросы (ServiceOptions::slow_query_threshold)
+    std::vector<SlowQuery> GetSlowQueries() const;
+
+private:
+    struct Task {
+        uint64_t connection_id;
+        uint64_t sequence;
+        std::string request;
+    };
+
+    struct Completion {
+        uint64_t connection_id;
+        uint64_t sequence;
+        std::string response;
+    };
+
+    struct Connection {
+        int fd = -1;
+        uint32_t events = 0;        // зарегистрированные в epoll события
+        std::string input;
+        std::string output;
+        size_t output_offset = 0;   // отправленная часть output
+        uint64_t next_sequence = 0; // номер следующего прочитанного запроса
+        uint64_t next_response = 0; // номер следующего ответа к отправке
+        std::map<uint64_t, std::string> ready; // ответы, пришедшие раньше предыдущих
+        bool read_closed = false;   // клиент закрыл запись или прислал слишком длинную строку
+    };
+
+    const SearchServer& server_;
+    RequestQueue queue_;
+    ServiceOptions options_;
+
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int completion_fd_ = -1; // eventfd: рабочие потоки сообщают о готовых ответах
+    int stop_fd_ = -1;       // eventfd: Stop()
+    uint16_t port_ = 0;
+
+    std::unordered_map<uint64_t, Connection> connections_;
+    uint64_t next_connection_id_;
+
+    std::vector<std::thread> workers_;
+    std::mutex tasks_mutex_;
+    std::condition_variable tasks_cv_;
+    std::deque<Task> tasks_;
+    bool stopping_ = false;
+
+    std::mutex completions_mutex_;
+    std::vector<Completion> completions_;
+
+    std::atomic<uint64_t> accepted_connections_ = 0;
+    std::atomic<uint64_t> open_connections_ = 0;
+    std::atomic<uint64_t> requests_ = 0;
+    std::atomic<uint64_t> batches_ = 0;
+
+    void OpenListener();
+    void AcceptConnections();
+    void ReadConnection(uint64_t id, Connection& connection, std::vector<Task>& tasks);
+    void DeliverCompletions();
+    // Отправляет накопленные ответы, обновляет события epoll; false - соединение закрыто
+    bool FlushConnection(uint64_t id, Connection& connection);
+    void CloseConnection(uint64_t id);
+    void UpdateEvents(uint64_t id, Connection& connection);
+
+    void SubmitTasks(std::vector<Task>& tasks);
+    void WorkerLoop();
+};
+
+}; // namespace query_service
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <iostream>
 
 
@@ -12,9 +13,12 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+constexpr size_t DOCUMENT_STATUS_COUNT = 4;
+
 struct DocumentData {
     int rating;
     DocumentStatus status;
+    int length = 0; // число слов документа без стоп-слов
 };
 
 struct Document {
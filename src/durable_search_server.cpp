@@ -0,0 +1,245 @@
+#include "durable_search_server.h"
+
+#include "file_io.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <unordered_map>
+
+
+namespace durable_search_server {
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace {
+
+constexpr std::string_view SNAPSHOT_FILE_NAME = "snapshot"sv;
+constexpr std::string_view LOG_FILE_PREFIX = "wal."sv;
+
+std::filesystem::path GetSnapshotPath(const std::filesystem::path& directory) {
+    return directory / SNAPSHOT_FILE_NAME;
+}
+
+std::filesystem::path GetLogPath(const std::filesystem::path& directory, uint64_t generation) {
+    return directory / (std::string(LOG_FILE_PREFIX) + std::to_string(generation));
+}
+
+// Номера журналов в каталоге по возрастанию
+std::vector<uint64_t> ListLogGenerations(const std::filesystem::path& directory) {
+    std::vector<uint64_t> generations;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        const std::string name = entry.path().filename().string();
+        if (!name.starts_with(LOG_FILE_PREFIX)) {
+            continue;
+        }
+        const char* const begin = name.data() + LOG_FILE_PREFIX.size();
+        const char* const end = name.data() + name.size();
+        uint64_t generation = 0;
+        const auto [ptr, ec] = std::from_chars(begin, end, generation);
+        if (ec == std::errc{} && ptr == end && begin != end) {
+            generations.push_back(generation);
+        }
+    }
+    std::sort(generations.begin(), generations.end());
+    return generations;
+}
+
+// Сворачивает снимок и журналы с номерами меньше next_generation в новый снимок, затем удаляет эти журналы.
+// Выполняется в фоновом потоке и работает только с файлами
+void CompactFiles(const std::filesystem::path& directory, uint64_t next_generation) {
+    const std::filesystem::path snapshot_path = GetSnapshotPath(directory);
+    Snapshot snapshot;
+    if (std::filesystem::exists(snapshot_path)) {
+        snapshot = ReadSnapshot(snapshot_path);
+    }
+
+    // Живые документы в порядке добавления; удалённые помечаются и пропускаются при записи, смена статуса
+    // записывается в запись добавления, новые оценки дописываются к её оценкам (сводка оценок от этого не меняется)
+    std::vector<LogRecord>& records = snapshot.records;
+    std::vector<bool> is_alive(records.size(), true);
+    std::unordered_map<int, size_t> document_to_record;
+    for (size_t i = 0; i < records.size(); ++i) {
+        document_to_record[records[i].document_id] = i;
+    }
+    for (uint64_t generation : ListLogGenerations(directory)) {
+        if (generation < snapshot.next_log_generation || generation >= next_generation) {
+            continue;
+        }
+        for (LogRecord& record : ReadLogFile(GetLogPath(directory, generation)).records) {
+            if (record.type == LogRecord::Type::ADD_DOCUMENT) {
+                document_to_record[record.document_id] = records.size();
+                records.push_back(std::move(record));
+                is_alive.push_back(true);
+            } else if (record.type == LogRecord::Type::SET_DOCUMENT_STATUS) {
+                if (const auto it = document_to_record.find(record.document_id); it != document_to_record.end()) {
+                    records[it->second].status = record.status;
+                }
+            } else if (record.type == LogRecord::Type::ADD_RATINGS) {
+                if (const auto it = document_to_record.find(record.document_id); it != document_to_record.end()) {
+                    std::vector<int>& ratings = records[it->second].ratings;
+                    ratings.insert(ratings.end(), record.ratings.begin(), record.ratings.end());
+                }
+            } else if (const auto it = document_to_record.find(record.document_id); it != document_to_record.end()) {
+                is_alive[it->second] = false;
+                document_to_record.erase(it);
+            }
+        }
+    }
+
+    Snapshot compacted;
+    compacted.next_log_generation = next_generation;
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (is_alive[i]) {
+            compacted.records.push_back(std::move(records[i]));
+        }
+    }
+    WriteSnapshot(snapshot_path, compacted);
+
+    for (uint64_t generation : ListLogGenerations(directory)) {
+        if (generation < next_generation) {
+            std::filesystem::remove(GetLogPath(directory, generation));
+        }
+    }
+    file_io::SyncDirectory(directory);
+}
+
+} // namespace
+
+DurableSearchServer::DurableSearchServer(std::filesystem::path directory, SearchServer server, GroupCommitOptions options)
+    : directory_(std::move(directory))
+    , server_(std::move(server))
+    , options_(options) {
+    Recover();
+}
+
+DurableSearchServer::~DurableSearchServer() {
+    if (compaction_.valid()) {
+        compaction_.wait();
+    }
+}
+
+void DurableSearchServer::AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings) {
+    // Некорректный документ отвергается индексом и не попадает в журнал. Проверки индекса (слова, ID, предел памяти)
+    // не повторить заранее, поэтому документ добавляется первым и удаляется, если журнал не принял запись
+    server_.AddDocument(document_id, document, status, ratings);
+    try {
+        log_->Append({ LogRecord::Type::ADD_DOCUMENT, document_id, status, ratings, document });
+    } catch (...) {
+        server_.RemoveDocument(document_id);
+        throw;
+    }
+}
+
+// Остальные изменения отвергаются только при неизвестном ID: он проверяется до записи в журнал,
+// а индекс меняется лишь после того, как журнал принял запись
+
+void DurableSearchServer::RemoveDocument(int document_id) {
+    CheckDocumentId(document_id);
+    log_->Append({ LogRecord::Type::REMOVE_DOCUMENT, document_id, DocumentStatus::ACTUAL, {}, {} });
+    server_.RemoveDocument(document_id);
+}
+
+void DurableSearchServer::SetDocumentStatus(int document_id, DocumentStatus status) {
+    CheckDocumentId(document_id);
+    log_->Append({ LogRecord::Type::SET_DOCUMENT_STATUS, document_id, status, {}, {} });
+    server_.SetDocumentStatus(document_id, status);
+}
+
+void DurableSearchServer::AddRatings(int document_id, const std::vector<int>& ratings) {
+    CheckDocumentId(document_id);
+    log_->Append({ LogRecord::Type::ADD_RATINGS, document_id, DocumentStatus::ACTUAL, ratings, {} });
+    server_.AddRatings(document_id, ratings);
+}
+
+void DurableSearchServer::Sync() {
+    log_->Sync();
+}
+
+bool DurableSearchServer::Compact() {
+    if (compaction_.valid()) {
+        if (compaction_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+        compaction_.get();
+    }
+    // Всё записанное в текущий журнал должно попасть в снимок, новые изменения идут в следующий журнал.
+    // Если журнал не удалось сбросить, сворачивание не начинается, а закрытый журнал с ошибкой остаётся текущим
+    log_->Close();
+    ++log_generation_;
+    log_ = std::make_unique<WriteAheadLog>(GetLogPath(directory_, log_generation_), options_);
+    file_io::SyncDirectory(directory_);
+
+    compaction_ = std::async(std::launch::async, CompactFiles, directory_, log_generation_);
+    return true;
+}
+
+void DurableSearchServer::WaitForCompaction() {
+    if (compaction_.valid()) {
+        compaction_.get();
+    }
+}
+
+const SearchServer& DurableSearchServer::GetServer() const {
+    return server_;
+}
+
+void DurableSearchServer::CheckDocumentId(int document_id) const {
+    // Сводка оценок есть у каждого документа сервера, для неизвестного ID - std::invalid_argument
+    server_.GetDocumentRatings(document_id);
+}
+
+void DurableSearchServer::Apply(const LogRecord& record) {
+    switch (record.type) {
+    case LogRecord::Type::ADD_DOCUMENT:
+        server_.AddDocument(record.document_id, record.text, record.status, record.ratings);
+        break;
+    case LogRecord::Type::REMOVE_DOCUMENT:
+        server_.RemoveDocument(record.document_id);
+        break;
+    case LogRecord::Type::SET_DOCUMENT_STATUS:
+        server_.SetDocumentStatus(record.document_id, record.status);
+        break;
+    case LogRecord::Type::ADD_RATINGS:
+        server_.AddRatings(record.document_id, record.ratings);
+        break;
+    }
+}
+
+void DurableSearchServer::Recover() {
+    std::filesystem::create_directories(directory_);
+
+    uint64_t next_generation = 0;
+    const std::filesystem::path snapshot_path = GetSnapshotPath(directory_);
+    if (std::filesystem::exists(snapshot_path)) {
+        const Snapshot snapshot = ReadSnapshot(snapshot_path);
+        for (const LogRecord& record : snapshot.records) {
+            Apply(record);
+        }
+        next_generation = snapshot.next_log_generation;
+    }
+
+    for (uint64_t generation : ListLogGenerations(directory_)) {
+        const std::filesystem::path log_path = GetLogPath(directory_, generation);
+        // Журналы, уже вошедшие в снимок, остаются после сбоя во время сворачивания
+        if (generation < next_generation) {
+            std::filesystem::remove(log_path);
+            continue;
+        }
+        const ParsedFrames frames = ReadLogFile(log_path);
+        for (const LogRecord& record : frames.records) {
+            Apply(record);
+        }
+        if (frames.valid_bytes < std::filesystem::file_size(log_path)) {
+            std::filesystem::resize_file(log_path, frames.valid_bytes);
+        }
+        next_generation = generation + 1;
+    }
+
+    log_generation_ = next_generation;
+    log_ = std::make_unique<WriteAheadLog>(GetLogPath(directory_, log_generation_), options_);
+    file_io::SyncDirectory(directory_);
+}
+
+}; // namespace durable_search_server
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+
+namespace durable_search_server {
+
+using namespace document;
+using namespace search_server;
+using namespace write_ahead_log;
+
+// Поисковый сервер с восстановлением после сбоя.
+// Каталог хранения содержит снимок (snapshot) и журналы wal.<номер>: каждое изменение дописывается в текущий журнал
+// с групповым сбросом на диск и применяется к индексу в памяти; изменение, не принятое журналом, не остаётся в индексе.
+// При создании состояние восстанавливается из снимка и журналов после него; оборванный при сбое хвост журнала отбрасывается.
+// Запросы выполняются по индексу в памяти (GetServer) и не затрагивают файлы. Сам сервер не потокобезопасен для записи.
+// После ошибки записи журнала (из Sync, Compact или очередного изменения) сервер доступен только для чтения:
+// каждое изменение бросает ту же ошибку. Изменения, которые уже в индексе, но не попали на диск, могут быть потеряны;
+// чтобы продолжить запись, каталог восстанавливают заново - новым DurableSearchServer
+class DurableSearchServer {
+public:
+    // server - пустой сервер с нужными стоп-словами и настройками индекса
+    DurableSearchServer(std::filesystem::path directory, SearchServer server, GroupCommitOptions options = {});
+
+    DurableSearchServer(const DurableSearchServer&) = delete;
+    DurableSearchServer& operator=(const DurableSearchServer&) = delete;
+
+    // Дожидается фонового сворачивания и сбрасывает журнал на диск. Ошибку сброса деструктор не сообщает -
+    // чтобы узнать о ней, перед уничтожением вызывают Sync
+    ~DurableSearchServer();
+
+    void AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    void SetDocumentStatus(int document_id, DocumentStatus status);
+
+    void AddRatings(int document_id, const std::vector<int>& ratings);
+
+    // Ждёт, пока все выполненные изменения попадут на диск; бросает ошибку записи журнала
+    void Sync();
+
+    // Сбрасывает и закрывает текущий журнал, начинает новый и в фоновом потоке сворачивает снимок и предыдущие журналы
+    // в новый снимок. Запросы и новые изменения не ждут сворачивания. false, если предыдущее сворачивание ещё идёт.
+    // Ошибку сброса закрываемого журнала бросает, не начиная сворачивания
+    bool Compact();
+
+    // Ждёт окончания фонового сворачивания; пробрасывает его ошибку
+    void WaitForCompaction();
+
+    const SearchServer& GetServer() const;
+
+private:
+    std::filesystem::path directory_;
+    SearchServer server_;
+    GroupCommitOptions options_;
+    uint64_t log_generation_ = 0; // номер текущего журнала
+    std::unique_ptr<WriteAheadLog> log_;
+    std::future<void> compaction_;
+
+    // Неизвестный ID - std::invalid_argument
+    void CheckDocumentId(int document_id) const;
+    void Apply(const LogRecord& record);
+    void Recover();
+};
+
+}; // namespace durable_search_server
@@ -0,0 +1,254 @@
+#include "file_io.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <string>
+#include <system_error>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+
+namespace file_io {
+
+using namespace std::string_literals;
+
+namespace {
+
+[[noreturn]] void ThrowError(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+#ifndef _WIN32
+// Число фрагментов в одном вызове writev: массив iovec на стеке
+constexpr size_t GATHER_BATCH_SIZE = std::min<size_t>(64, IOV_MAX);
+#endif
+
+} // namespace
+
+#ifdef _WIN32
+
+int OpenFile(const std::filesystem::path& path, OpenMode mode) {
+    int flags = _O_BINARY | _O_NOINHERIT;
+    switch (mode) {
+    case OpenMode::CREATE_NEW:
+        flags |= _O_RDWR | _O_CREAT | _O_EXCL;
+        break;
+    case OpenMode::TRUNCATE:
+        flags |= _O_WRONLY | _O_CREAT | _O_TRUNC;
+        break;
+    case OpenMode::APPEND:
+        flags |= _O_WRONLY | _O_CREAT | _O_APPEND;
+        break;
+    }
+    const int fd = ::_wopen(path.c_str(), flags, _S_IREAD | _S_IWRITE);
+    if (fd < 0) {
+        ThrowError("Cannot open "s + path.string());
+    }
+    return fd;
+}
+
+void CloseFile(int fd) noexcept {
+    ::_close(fd);
+}
+
+void WriteAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const unsigned int size = static_cast<unsigned int>(std::min<size_t>(data.size(), INT_MAX));
+        const int written = ::_write(fd, data.data(), size);
+        if (written < 0) {
+            ThrowError("write failed"s);
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+void WriteAll(int fd, std::span<const WriteBuffer> buffers) {
+    for (const WriteBuffer& buffer : buffers) {
+        WriteAll(fd, std::string_view(buffer.data, buffer.size));
+    }
+}
+
+void WriteAt(int fd, std::string_view data, uint64_t offset) {
+    const int64_t position = ::_telli64(fd);
+    if (position < 0 || ::_lseeki64(fd, static_cast<int64_t>(offset), SEEK_SET) < 0) {
+        ThrowError("seek failed"s);
+    }
+    WriteAll(fd, data);
+    if (::_lseeki64(fd, position, SEEK_SET) < 0) {
+        ThrowError("seek failed"s);
+    }
+}
+
+void SyncData(int fd) {
+    if (::_commit(fd) != 0) {
+        ThrowError("_commit failed"s);
+    }
+}
+
+void SyncFile(int fd) {
+    SyncData(fd);
+}
+
+void SyncDirectory([[maybe_unused]] const std::filesystem::path& directory) {
+}
+
+std::shared_ptr<const void> MapReadOnly(int fd, size_t size) {
+    std::shared_ptr<char[]> copy(new char[size]);
+    if (::_lseeki64(fd, 0, SEEK_SET) < 0) {
+        ThrowError("seek failed"s);
+    }
+    size_t offset = 0;
+    while (offset < size) {
+        const unsigned int chunk = static_cast<unsigned int>(std::min<size_t>(size - offset, INT_MAX));
+        const int count = ::_read(fd, copy.get() + offset, chunk);
+        if (count <= 0) {
+            if (count == 0) {
+                errno = EIO;
+            }
+            ThrowError("read failed"s);
+        }
+        offset += static_cast<size_t>(count);
+    }
+    return std::shared_ptr<const void>(copy, copy.get());
+}
+
+int GetProcessId() {
+    return ::_getpid();
+}
+
+#else
+
+int OpenFile(const std::filesystem::path& path, OpenMode mode) {
+    int flags = O_CLOEXEC;
+    switch (mode) {
+    case OpenMode::CREATE_NEW:
+        flags |= O_RDWR | O_CREAT | O_EXCL;
+        break;
+    case OpenMode::TRUNCATE:
+        flags |= O_WRONLY | O_CREAT | O_TRUNC;
+        break;
+    case OpenMode::APPEND:
+        flags |= O_WRONLY | O_CREAT | O_APPEND;
+        break;
+    }
+    const int fd = ::open(path.c_str(), flags, mode == OpenMode::CREATE_NEW ? 0600 : 0644);
+    if (fd < 0) {
+        ThrowError("Cannot open "s + path.string());
+    }
+    return fd;
+}
+
+void CloseFile(int fd) noexcept {
+    ::close(fd);
+}
+
+void WriteAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = ::write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowError("write failed"s);
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+void WriteAll(int fd, std::span<const WriteBuffer> buffers) {
+    size_t first = 0;   // первый не записанный до конца фрагмент
+    size_t skipped = 0; // уже записанное начало этого фрагмента
+    while (first < buffers.size()) {
+        std::array<iovec, GATHER_BATCH_SIZE> batch;
+        size_t count = 0;
+        for (size_t i = first; i < buffers.size() && count < batch.size(); ++i) {
+            const size_t offset = i == first ? skipped : 0;
+            batch[count++] = { const_cast<char*>(buffers[i].data) + offset, buffers[i].size - offset };
+        }
+        const ssize_t written = ::writev(fd, batch.data(), static_cast<int>(count));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowError("writev failed"s);
+        }
+        // Пропускаем полностью записанные фрагменты и запоминаем, сколько записано от частично записанного
+        size_t left = skipped + static_cast<size_t>(written);
+        while (first < buffers.size() && left >= buffers[first].size) {
+            left -= buffers[first].size;
+            ++first;
+        }
+        skipped = left;
+    }
+}
+
+void WriteAt(int fd, std::string_view data, uint64_t offset) {
+    while (!data.empty()) {
+        const ssize_t written = ::pwrite(fd, data.data(), data.size(), static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowError("pwrite failed"s);
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+        offset += static_cast<uint64_t>(written);
+    }
+}
+
+void SyncData(int fd) {
+    if (::fdatasync(fd) != 0) {
+        ThrowError("fdatasync failed"s);
+    }
+}
+
+void SyncFile(int fd) {
+    if (::fsync(fd) != 0) {
+        ThrowError("fsync failed"s);
+    }
+}
+
+void SyncDirectory(const std::filesystem::path& directory) {
+    const std::filesystem::path path = directory.empty() ? std::filesystem::path(".") : directory;
+    const int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        ThrowError("Cannot open "s + path.string());
+    }
+    const int result = ::fsync(fd);
+    const int error = errno;
+    ::close(fd);
+    if (result != 0) {
+        errno = error;
+        ThrowError("fsync failed"s);
+    }
+}
+
+std::shared_ptr<const void> MapReadOnly(int fd, size_t size) {
+    void* address = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        ThrowError("mmap failed"s);
+    }
+    return std::shared_ptr<const void>(address, [size](const void* data) {
+        ::munmap(const_cast<void*>(data), size);
+    });
+}
+
+int GetProcessId() {
+    return static_cast<int>(::getpid());
+}
+
+#endif
+
+}; // namespace file_io
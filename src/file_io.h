@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+
+
+namespace file_io {
+
+// Низкоуровневый файловый ввод-вывод по дескрипторам. На POSIX - writev, pwrite, mmap и fdatasync;
+// на Windows (MinGW) - CRT-функции _write, _commit и копия файла в куче вместо отображения.
+// Ошибки - std::system_error
+
+// Дескриптор стандартного вывода
+constexpr int STANDARD_OUTPUT = 1;
+
+// Устройство, которое принимает и отбрасывает любые данные
+#ifdef _WIN32
+inline constexpr std::string_view NULL_DEVICE = "NUL";
+#else
+inline constexpr std::string_view NULL_DEVICE = "/dev/null";
+#endif
+
+enum class OpenMode {
+    CREATE_NEW,     // чтение и запись, файл не должен существовать
+    TRUNCATE,       // запись с начала, файл создаётся или обрезается
+    APPEND,         // дозапись в конец, файл создаётся при необходимости
+};
+
+// Фрагмент данных для сборной записи
+struct WriteBuffer {
+    const char* data = nullptr;
+    size_t size = 0;
+};
+
+// Дескриптор не наследуется дочерними процессами
+int OpenFile(const std::filesystem::path& path, OpenMode mode);
+void CloseFile(int fd) noexcept;
+
+// Записывает данные целиком, повторяя запись после частичной записи и EINTR
+void WriteAll(int fd, std::string_view data);
+
+// Сборная запись фрагментов подряд: writev пачками по IOV_MAX без выделения памяти, на Windows - по одному фрагменту
+void WriteAll(int fd, std::span<const WriteBuffer> buffers);
+
+// Записывает данные целиком со смещения offset, не меняя позицию дозаписи
+void WriteAt(int fd, std::string_view data, uint64_t offset);
+
+// Сбрасывает на диск данные файла (fdatasync) или данные и метаданные (fsync)
+void SyncData(int fd);
+void SyncFile(int fd);
+
+// Сбрасывает на диск запись каталога (после создания, переименования или удаления файлов).
+// На Windows каталог нельзя открыть как файл, и вызов ничего не делает
+void SyncDirectory(const std::filesystem::path& directory);
+
+// Первые size байт файла только для чтения: отображение в память (действует и после закрытия fd и удаления файла),
+// на Windows - копия в куче
+std::shared_ptr<const void> MapReadOnly(int fd, size_t size);
+
+int GetProcessId();
+
+}; // namespace file_io
@@ -1,29 +1,40 @@
 #include "paginator.h"
 #include "search_server.h"
 #include "request_queue.h"
+#include "result_writer.h"
 
 
 using namespace std::string_literals;
+using namespace std::string_view_literals;
 
 using namespace search_server;
 using namespace request_queue;
 using namespace paginator;
+using namespace result_writer;
 
 // ==================== для демонстрации функционала =========================
 
-template <typename T>
-void PrintPaginatedResults(const std::vector<T>& results, int page_size = 2) {
+// Страницы выводятся через ResultWriter напрямую в stdout, минуя iostreams
+void PrintPaginatedResults(const std::vector<Document>& results, int page_size = 2) {
+    static ResultWriter writer;
     int page_number = 1;
     if (results.empty()) {
-        std::cout << "Page "s << page_number << ": No results found"s << std::endl;
-        std::cout << "Page break"s << std::endl;
-        return;
+        writer.Append("Page "sv);
+        writer.AppendInteger(page_number);
+        writer.Append(": No results found\nPage break\n"sv);
     }
-    const auto pages = Paginate(results, page_size);
-    for (auto page = pages.begin(); page != pages.end(); ++page, ++page_number) {
-        std::cout << "Page "s << page_number << ": "s << *page << std::endl;
-        std::cout << "Page break"s << std::endl;
+    for (const auto page : Paginate(results, page_size)) {
+        writer.Append("Page "sv);
+        writer.AppendInteger(page_number++);
+        writer.Append(": "sv);
+        for (const Document& document : page) {
+            writer.AppendText(document);
+        }
+        writer.Append("\nPage break\n"sv);
     }
+    // Всё, что уже выведено через std::cout, должно оказаться в выводе раньше
+    std::cout.flush();
+    writer.FlushTo(file_io::STANDARD_OUTPUT);
 }
 
 int main() {
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+
+namespace memory_usage {
+
+// Оценки памяти контейнеров стандартной библиотеки в раскладке libstdc++.
+// Узел хеш-таблицы - указатель на следующий узел, значение и сохранённый хеш (для нецелых ключей),
+// массив корзин - по указателю на корзину. Строка занимает кучу только вне SSO (больше 15 символов)
+
+inline size_t GetStringHeapBytes(const std::string& value) {
+    return value.capacity() > 15 ? value.capacity() + 1 : 0;
+}
+
+template <typename T>
+size_t GetVectorBytes(const std::vector<T>& values) {
+    return values.capacity() * sizeof(T);
+}
+
+template <typename HashTable>
+constexpr size_t GetHashNodeBytes() {
+    const size_t hash_bytes = std::is_integral_v<typename HashTable::key_type> ? 0 : sizeof(size_t);
+    return sizeof(void*) + sizeof(typename HashTable::value_type) + hash_bytes;
+}
+
+// Узлы и корзины без памяти, на которую ссылаются сами элементы
+template <typename HashTable>
+size_t GetHashTableBytes(const HashTable& table) {
+    return table.size() * GetHashNodeBytes<HashTable>() + table.bucket_count() * sizeof(void*);
+}
+
+}; // namespace memory_usage
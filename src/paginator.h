@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -9,7 +12,7 @@ namespace paginator {
 
 using namespace std::string_literals;
 
-template<typename Iterator> 
+template<typename Iterator>
 class IteratorRange {
 public:
     explicit IteratorRange(Iterator begin, Iterator end)
@@ -17,15 +20,15 @@ public:
         , end_(end)
         , size_of_page_(distance(begin_, end_)) {
     }
-  
+
     auto begin() const{
         return begin_;
-    } 
-    
+    }
+
     auto end() const{
         return end_;
     }
-    
+
     size_t size() const{
         return size_of_page_;
     }
@@ -36,35 +39,94 @@ private:
     size_t size_of_page_;
 };
 
+// Ленивый диапазон страниц: страницы не хранятся, а вычисляются при обращении.
+// Для итераторов произвольного доступа создание и operator[] выполняются за O(1)
 template <typename Iterator>
 class Paginator {
 public:
-    Paginator(Iterator begin, Iterator end, size_t page_size) {
-        for (size_t left = distance(begin, end); left > 0;) {
-            const size_t current_page_size = std::min(page_size, left);
-            const Iterator current_page_end = std::next(begin, current_page_size);
-            pages_.push_back(IteratorRange{ begin, current_page_end });
-
-            left -= current_page_size;
-            begin = current_page_end;
+    // Итератор по страницам, продвигается от страницы к странице без повторного прохода с начала
+    class PageIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = IteratorRange<Iterator>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = IteratorRange<Iterator>;
+
+        PageIterator() = default;
+        PageIterator(Iterator page_begin, size_t items_left, size_t page_size)
+            : page_begin_(page_begin)
+            , items_left_(items_left)
+            , page_size_(page_size) {
+        }
+
+        IteratorRange<Iterator> operator*() const {
+            return IteratorRange{ page_begin_, std::next(page_begin_, CurrentPageSize()) };
+        }
+
+        PageIterator& operator++() {
+            const size_t current_page_size = CurrentPageSize();
+            page_begin_ = std::next(page_begin_, current_page_size);
+            items_left_ -= current_page_size;
+            return *this;
+        }
+
+        PageIterator operator++(int) {
+            PageIterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const PageIterator& other) const {
+            return items_left_ == other.items_left_;
+        }
+
+    private:
+        Iterator page_begin_{};
+        size_t items_left_ = 0;
+        size_t page_size_ = 1;
+
+        size_t CurrentPageSize() const {
+            return std::min(page_size_, items_left_);
+        }
+    };
+
+    Paginator(Iterator begin, Iterator end, size_t page_size)
+        : begin_(begin)
+        , items_count_(static_cast<size_t>(distance(begin, end)))
+        , page_size_(page_size) {
+        if (page_size_ == 0) {
+            throw std::invalid_argument("Page size must be positive"s);
         }
     }
-    
-    auto begin() const {
-        return pages_.begin();
-    } 
-    
-    auto end() const {
-        return pages_.end();
+
+    PageIterator begin() const {
+        return PageIterator{ begin_, items_count_, page_size_ };
+    }
+
+    PageIterator end() const {
+        return PageIterator{ begin_, 0, page_size_ };
     }
-    
+
     size_t size() const {
-        return pages_.size();
+        return (items_count_ + page_size_ - 1) / page_size_;
+    }
+
+    // Страница с номером page (с нуля)
+    IteratorRange<Iterator> operator[](size_t page) const {
+        if (page >= size()) {
+            throw std::out_of_range("Page "s + std::to_string(page) + " is out of range"s);
+        }
+        const size_t offset = page * page_size_;
+        const Iterator page_begin = std::next(begin_, offset);
+        return IteratorRange{ page_begin, std::next(page_begin, std::min(page_size_, items_count_ - offset)) };
     }
-    
+
 private:
-    std::vector<IteratorRange<Iterator>> pages_;
-}; 
+    Iterator begin_;
+    size_t items_count_;
+    size_t page_size_;
+};
 
 template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
@@ -79,4 +141,4 @@ std::ostream& operator<<(std::ostream& out, const IteratorRange<Iterator>& range
     return out;
 }
 
-}; //namespace paginator
\ No newline at end of file
+}; //namespace paginator
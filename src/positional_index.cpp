@@ -0,0 +1,154 @@
+#include "positional_index.h"
+
+#include <algorithm>
+
+
+namespace positional_index {
+
+EncodedPositions EncodePositions(const std::vector<uint32_t>& positions) {
+    EncodedPositions encoded;
+    encoded.reserve(positions.size());
+    uint32_t previous = 0;
+    for (uint32_t position : positions) {
+        uint32_t delta = position - previous;
+        previous = position;
+        while (delta >= 0x80) {
+            encoded.push_back(static_cast<uint8_t>(delta | 0x80));
+            delta >>= 7;
+        }
+        encoded.push_back(static_cast<uint8_t>(delta));
+    }
+    return encoded;
+}
+
+void DecodePositions(const EncodedPositions& encoded, std::vector<uint32_t>& positions) {
+    positions.clear();
+    uint32_t previous = 0;
+    for (size_t i = 0; i < encoded.size();) {
+        uint32_t delta = 0;
+        for (int shift = 0;; shift += 7) {
+            const uint8_t byte = encoded[i++];
+            delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+        previous += delta;
+        positions.push_back(previous);
+    }
+}
+
+size_t GallopLowerBound(const std::vector<uint32_t>& values, size_t from, uint32_t target) {
+    size_t step = 1;
+    size_t high = from;
+    while (high < values.size() && values[high] < target) {
+        from = high + 1;
+        high += step;
+        step *= 2;
+    }
+    high = std::min(high, values.size());
+    return static_cast<size_t>(std::lower_bound(values.begin() + from, values.begin() + high, target) - values.begin());
+}
+
+bool HasPhrase(const std::vector<std::vector<uint32_t>>& word_positions) {
+    if (word_positions.empty()) {
+        return false;
+    }
+    // Кандидаты - позиции начала фразы, на каждом шаге пересекаются со сдвинутым списком следующего слова
+    std::vector<uint32_t> candidates = word_positions.front();
+    std::vector<uint32_t> next_candidates;
+    for (size_t i = 1; i < word_positions.size() && !candidates.empty(); ++i) {
+        const std::vector<uint32_t>& positions = word_positions[i];
+        const uint32_t offset = static_cast<uint32_t>(i);
+        next_candidates.clear();
+        size_t cursor = 0;
+        for (uint32_t start : candidates) {
+            cursor = GallopLowerBound(positions, cursor, start + offset);
+            if (cursor == positions.size()) {
+                break;
+            }
+            if (positions[cursor] == start + offset) {
+                next_candidates.push_back(start);
+            }
+        }
+        candidates.swap(next_candidates);
+    }
+    return !candidates.empty();
+}
+
+bool HasNear(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs, uint32_t max_distance) {
+    size_t cursor = 0;
+    for (uint32_t position : lhs) {
+        const uint32_t low = position > max_distance ? position - max_distance : 0;
+        cursor = GallopLowerBound(rhs, cursor, low);
+        if (cursor == rhs.size()) {
+            return false;
+        }
+        if (rhs[cursor] <= position + max_distance) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PositionalIndex::AddDocument(int document_id, const std::vector<std::string_view>& words) {
+    std::unordered_map<std::string_view, std::vector<uint32_t>> positions;
+    for (size_t i = 0; i < words.size(); ++i) {
+        positions[words[i]].push_back(static_cast<uint32_t>(i));
+    }
+    std::vector<std::string_view>& document_words = document_to_words_[document_id];
+    document_words.reserve(positions.size());
+    for (const auto& [word, word_positions] : positions) {
+        auto it = word_to_document_positions_.find(word);
+        if (it == word_to_document_positions_.end()) {
+            it = word_to_document_positions_.emplace(std::string(word), std::unordered_map<int, EncodedPositions>{}).first;
+            heap_bytes_ += GetStringHeapBytes(it->first) + GetHashTableBytes(it->second);
+        }
+        const size_t table_bytes = GetHashTableBytes(it->second);
+        const auto document_it = it->second.emplace(document_id, EncodePositions(word_positions)).first;
+        heap_bytes_ += GetHashTableBytes(it->second) - table_bytes + GetVectorBytes(document_it->second);
+        document_words.push_back(it->first);
+    }
+    heap_bytes_ += GetVectorBytes(document_words);
+}
+
+void PositionalIndex::RemoveDocument(int document_id) {
+    const auto document_it = document_to_words_.find(document_id);
+    if (document_it == document_to_words_.end()) {
+        return;
+    }
+    for (std::string_view word : document_it->second) {
+        const auto it = word_to_document_positions_.find(word);
+        const auto positions_it = it->second.find(document_id);
+        heap_bytes_ -= GetVectorBytes(positions_it->second);
+        const size_t table_bytes = GetHashTableBytes(it->second);
+        it->second.erase(positions_it);
+        if (it->second.empty()) {
+            heap_bytes_ -= table_bytes + GetStringHeapBytes(it->first);
+            word_to_document_positions_.erase(it);
+        } else {
+            heap_bytes_ -= table_bytes - GetHashTableBytes(it->second);
+        }
+    }
+    heap_bytes_ -= GetVectorBytes(document_it->second);
+    document_to_words_.erase(document_it);
+}
+
+size_t PositionalIndex::GetMemoryUsage() const {
+    return GetHashTableBytes(word_to_document_positions_) + GetHashTableBytes(document_to_words_) + heap_bytes_;
+}
+
+bool PositionalIndex::GetPositions(std::string_view word, int document_id, std::vector<uint32_t>& positions) const {
+    const auto word_it = word_to_document_positions_.find(word);
+    if (word_it == word_to_document_positions_.end()) {
+        return false;
+    }
+    const auto document_it = word_it->second.find(document_id);
+    if (document_it == word_it->second.end()) {
+        return false;
+    }
+    DecodePositions(document_it->second, positions);
+    return true;
+}
+
+}; // namespace positional_index
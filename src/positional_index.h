@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "memory_usage.h"
+#include "string_processing.h"
+
+
+namespace positional_index {
+
+using namespace memory_usage;
+using namespace string_processing;
+
+// Позиции слова в документе: возрастающие номера слов, закодированные разностями в varint
+using EncodedPositions = std::vector<uint8_t>;
+
+EncodedPositions EncodePositions(const std::vector<uint32_t>& positions);
+void DecodePositions(const EncodedPositions& encoded, std::vector<uint32_t>& positions);
+
+// Первый индекс i >= from, для которого values[i] >= target (экспоненциальный поиск + бинарный)
+size_t GallopLowerBound(const std::vector<uint32_t>& values, size_t from, uint32_t target);
+
+// Есть ли позиция p, для которой слово i стоит на позиции p + i во всех списках
+bool HasPhrase(const std::vector<std::vector<uint32_t>>& word_positions);
+
+// Есть ли пара позиций на расстоянии не более max_distance (порядок слов не важен)
+bool HasNear(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs, uint32_t max_distance);
+
+// Позиционный индекс: слово -> ID документа -> позиции слова.
+// Заполняется только при включенной опции IndexOptions::store_positions
+class PositionalIndex {
+public:
+    // words - слова документа без стоп-слов в порядке следования
+    void AddDocument(int document_id, const std::vector<std::string_view>& words);
+
+    // Удаляет позиции документа, O(число разных слов документа)
+    void RemoveDocument(int document_id);
+
+    // Декодирует позиции слова в документе в positions; false, если слова в документе нет
+    bool GetPositions(std::string_view word, int document_id, std::vector<uint32_t>& positions) const;
+
+    // Оценка занятой памяти в байтах, O(1): учитывается по ходу добавления документов
+    size_t GetMemoryUsage() const;
+
+private:
+    StringMap<std::unordered_map<int, EncodedPositions>> word_to_document_positions_;
+    std::unordered_map<int, std::vector<std::string_view>> document_to_words_; // слова документа - ключи word_to_document_positions_
+    size_t heap_bytes_ = 0; // строки слов, таблицы документов слов, закодированные позиции и списки слов документов
+};
+
+}; // namespace positional_index
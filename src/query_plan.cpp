@@ -0,0 +1,263 @@
+#include "query_plan.h"
+
+#include <algorithm>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+
+namespace query_plan {
+
+namespace {
+
+using SortedPostings = SegmentedIndex::SortedPostings;
+
+// Первый индекс i >= from, для которого document_ids[i] >= target (экспоненциальный поиск + бинарный)
+size_t GallopLowerBound(const int* document_ids, size_t size, size_t from, int target) {
+    size_t step = 1;
+    size_t high = from;
+    while (high < size && document_ids[high] < target) {
+        from = high + 1;
+        high += step;
+        step *= 2;
+    }
+    high = std::min(high, size);
+    return static_cast<size_t>(std::lower_bound(document_ids + from, document_ids + high, target) - document_ids);
+}
+
+std::vector<int> Unite(const std::vector<int>& lhs, const std::vector<int>& rhs) {
+    std::vector<int> result;
+    result.reserve(lhs.size() + rhs.size());
+    std::set_union(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(result));
+    return result;
+}
+
+std::vector<int> Subtract(const std::vector<int>& lhs, const std::vector<int>& rhs) {
+    std::vector<int> result;
+    result.reserve(lhs.size());
+    std::set_difference(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(result));
+    return result;
+}
+
+bool IsEmpty(const PlanNode& node) {
+    return node.type != PlanNode::Type::NOT && node.estimate == 0;
+}
+
+void MakeEmpty(PlanNode& node) {
+    node = PlanNode{};
+}
+
+std::vector<int> Filter(const PlanNode& node, std::vector<int> candidates);
+
+std::vector<int> FilterTerms(const PlanNode& node, const std::vector<int>& candidates) {
+    struct Cursor {
+        const SortedPostings* postings;
+        const SortedPostings::List* list;
+        size_t position = 0;
+    };
+    std::vector<Cursor> cursors;
+    for (const SortedPostings& postings : node.postings) {
+        for (const SortedPostings::List& list : postings.GetLists()) {
+            cursors.push_back({ &postings, &list });
+        }
+    }
+    std::vector<int> result;
+    for (const int document_id : candidates) {
+        for (Cursor& cursor : cursors) {
+            cursor.position = GallopLowerBound(cursor.list->document_ids, cursor.list->size, cursor.position, document_id);
+            if (cursor.position < cursor.list->size && cursor.list->document_ids[cursor.position] == document_id
+                && cursor.postings->IsLive(*cursor.list, document_id)) {
+                result.push_back(document_id);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+// Кандидаты проходят операнды AND начиная с first_child: чем раньше операнд, тем меньше его оценка
+std::vector<int> FilterAnd(const PlanNode& node, std::vector<int> candidates, size_t first_child) {
+    for (size_t i = first_child; i < node.children.size() && !candidates.empty(); ++i) {
+        const PlanNode& child = node.children[i];
+        if (child.type == PlanNode::Type::NOT) {
+            candidates = Subtract(candidates, Filter(child.children.front(), candidates));
+        } else {
+            candidates = Filter(child, std::move(candidates));
+        }
+    }
+    if (node.verifier) {
+        std::erase_if(candidates, [&node](int document_id) {
+            return !node.verifier(document_id);
+        });
+    }
+    return candidates;
+}
+
+std::vector<int> Filter(const PlanNode& node, std::vector<int> candidates) {
+    switch (node.type) {
+        case PlanNode::Type::TERMS:
+            return FilterTerms(node, candidates);
+        case PlanNode::Type::AND:
+            return FilterAnd(node, std::move(candidates), 0);
+        case PlanNode::Type::OR: {
+            std::vector<int> result;
+            for (const PlanNode& child : node.children) {
+                result = Unite(result, Filter(child, candidates));
+            }
+            return result;
+        }
+        case PlanNode::Type::NOT:
+            return Subtract(candidates, Filter(node.children.front(), candidates));
+    }
+    return {};
+}
+
+void CheckNotOperands(const PlanNode& node) {
+    if (node.type == PlanNode::Type::NOT) {
+        throw std::invalid_argument("Incorrect query, NOT must be an operand of AND with a positive operand"s);
+    }
+}
+
+}; // namespace
+
+void CompilePlan(const SegmentedIndex& index, PlanNode& node) {
+    switch (node.type) {
+        case PlanNode::Type::TERMS:
+            node.estimate = 0;
+            for (const std::string& term : node.terms) {
+                const SortedPostings& postings = node.postings.emplace_back(index.GetSortedPostings(term, std::nullopt));
+                for (const SortedPostings::List& list : postings.GetLists()) {
+                    node.estimate += list.size;
+                }
+            }
+            return;
+        case PlanNode::Type::NOT:
+            CompilePlan(index, node.children.front());
+            node.estimate = node.children.front().estimate;
+            return;
+        case PlanNode::Type::AND:
+        case PlanNode::Type::OR:
+            break;
+    }
+
+    // Операнды того же типа без проверки позиций поднимаются на уровень выше
+    std::vector<PlanNode> children;
+    for (PlanNode& child : node.children) {
+        CompilePlan(index, child);
+        if (child.type == node.type && !child.verifier) {
+            std::move(child.children.begin(), child.children.end(), std::back_inserter(children));
+        } else {
+            children.push_back(std::move(child));
+        }
+    }
+    node.children = std::move(children);
+
+    if (node.type == PlanNode::Type::OR) {
+        std::for_each(node.children.begin(), node.children.end(), CheckNotOperands);
+        std::erase_if(node.children, IsEmpty);
+        node.estimate = 0;
+        for (const PlanNode& child : node.children) {
+            node.estimate += child.estimate;
+        }
+    } else {
+        const auto is_positive = [](const PlanNode& child) {
+            return child.type != PlanNode::Type::NOT;
+        };
+        if (std::none_of(node.children.begin(), node.children.end(), is_positive)) {
+            throw std::invalid_argument("Incorrect query, NOT must be an operand of AND with a positive operand"s);
+        }
+        if (std::any_of(node.children.begin(), node.children.end(), IsEmpty)) {
+            MakeEmpty(node);
+            return;
+        }
+        // Отрицание без документов ничего не исключает
+        std::erase_if(node.children, [](const PlanNode& child) {
+            return child.type == PlanNode::Type::NOT && child.estimate == 0;
+        });
+        std::stable_sort(node.children.begin(), node.children.end(), [&is_positive](const PlanNode& lhs, const PlanNode& rhs) {
+            if (is_positive(lhs) != is_positive(rhs)) {
+                return is_positive(lhs);
+            }
+            return lhs.estimate < rhs.estimate;
+        });
+        node.estimate = node.children.front().estimate;
+    }
+    if (node.children.empty()) {
+        MakeEmpty(node);
+    } else if (node.children.size() == 1 && !node.verifier) {
+        PlanNode child = std::move(node.children.front());
+        node = std::move(child);
+    }
+}
+
+std::vector<int> EvaluatePlan(const PlanNode& node) {
+    switch (node.type) {
+        case PlanNode::Type::TERMS: {
+            std::vector<int> result;
+            for (const SortedPostings& postings : node.postings) {
+                for (const SortedPostings::List& list : postings.GetLists()) {
+                    for (size_t i = 0; i < list.size; ++i) {
+                        if (postings.IsLive(list, list.document_ids[i])) {
+                            result.push_back(list.document_ids[i]);
+                        }
+                    }
+                }
+            }
+            std::sort(result.begin(), result.end());
+            result.erase(std::unique(result.begin(), result.end()), result.end());
+            return result;
+        }
+        case PlanNode::Type::AND:
+            return FilterAnd(node, EvaluatePlan(node.children.front()), 1);
+        case PlanNode::Type::OR: {
+            std::vector<int> result;
+            for (const PlanNode& child : node.children) {
+                result = Unite(result, EvaluatePlan(child));
+            }
+            return result;
+        }
+        case PlanNode::Type::NOT:
+            CheckNotOperands(node);
+    }
+    return {};
+}
+
+bool MatchesPlan(const PlanNode& node, int document_id) {
+    CheckNotOperands(node);
+    return !Filter(node, { document_id }).empty();
+}
+
+std::string DescribePlan(const PlanNode& node, const std::function<std::string(std::string_view term)>& describe_term) {
+    std::string description;
+    switch (node.type) {
+        case PlanNode::Type::TERMS:
+            if (node.terms.empty()) {
+                return "EMPTY"s;
+            }
+            for (size_t i = 0; i < node.terms.size(); ++i) {
+                description += (i > 0 ? "|"s : ""s) + describe_term(node.terms[i]);
+            }
+            if (node.terms.size() > 1) {
+                description = '(' + description + ')';
+            }
+            return description + '[' + std::to_string(node.estimate) + ']';
+        case PlanNode::Type::AND:
+            description = node.verifier ? "POSITIONS"s : "AND"s;
+            break;
+        case PlanNode::Type::OR:
+            description = "OR"s;
+            break;
+        case PlanNode::Type::NOT:
+            description = "NOT"s;
+            break;
+    }
+    description += '[' + std::to_string(node.estimate) + "]("s;
+    for (size_t i = 0; i < node.children.size(); ++i) {
+        description += (i > 0 ? ", "s : ""s) + DescribePlan(node.children[i], describe_term);
+    }
+    return description + ')';
+}
+
+}; // namespace query_plan
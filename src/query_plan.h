@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "segmented_index.h"
+
+
+namespace query_plan {
+
+using namespace segmented_index;
+
+// Узел плана булева запроса. Парсер заполняет термины и операнды, CompilePlan - списки документов и оценки
+struct PlanNode {
+    enum class Type : uint8_t {
+        TERMS, // документы хотя бы с одним из терминов
+        AND,
+        OR,
+        NOT,   // только операнд AND
+    };
+
+    Type type = Type::TERMS;
+    std::vector<std::string> terms;                           // TERMS
+    std::vector<PlanNode> children;                            // AND, OR, NOT
+    std::function<bool(int document_id)> verifier;             // AND: проверка фразы или NEAR по позициям
+    std::vector<SegmentedIndex::SortedPostings> postings;      // TERMS, заполняет CompilePlan
+    size_t estimate = 0;                                       // верхняя оценка числа документов, заполняет CompilePlan
+};
+
+// Читает списки терминов и упрощает дерево: вложенные AND и OR раскрываются, операнды OR без документов
+// отбрасываются, AND с пустым операндом становится пустым узлом, операнды AND упорядочиваются по возрастанию
+// оценки (отрицания - последними). Отрицание без операнда AND - std::invalid_argument
+void CompilePlan(const SegmentedIndex& index, PlanNode& node);
+
+// Документы, удовлетворяющие плану, по возрастанию ID. Список первого операнда AND читается целиком,
+// остальные операнды проверяют только оставшихся кандидатов галопирующим поиском по своим спискам
+std::vector<int> EvaluatePlan(const PlanNode& node);
+
+// Удовлетворяет ли документ плану
+bool MatchesPlan(const PlanNode& node, int document_id);
+
+// Текстовый вид плана с оценками: AND[3](dog[3], (cat|cats)[12], NOT[2](black[2])), операнды AND - в порядке
+// выполнения, фраза или NEAR - POSITIONS[n](...). describe_term переводит термин в читаемый вид
+std::string DescribePlan(const PlanNode& node, const std::function<std::string(std::string_view term)>& describe_term);
+
+}; // namespace query_plan
@@ -0,0 +1,166 @@
+#include "query_protocol.h"
+
+#include "result_writer.h"
+
+#include <array>
+#include <charconv>
+#include <stdexcept>
+
+
+namespace query_protocol {
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace {
+
+constexpr std::array<std::string_view, DOCUMENT_STATUS_COUNT> STATUS_NAMES = {
+    "ACTUAL"sv, "IRRELEVANT"sv, "BANNED"sv, "REMOVED"sv,
+};
+
+// Отделяет первое слово строки (до пробела), в line остаётся хвост без ведущих пробелов
+std::string_view TakeWord(std::string_view& line) {
+    const size_t end = std::min(line.find(' '), line.size());
+    const std::string_view word = line.substr(0, end);
+    line.remove_prefix(end);
+    line.remove_prefix(std::min(line.find_first_not_of(' '), line.size()));
+    return word;
+}
+
+DocumentStatus ParseStatus(std::string_view name) {
+    for (size_t i = 0; i < STATUS_NAMES.size(); ++i) {
+        if (STATUS_NAMES[i] == name) {
+            return static_cast<DocumentStatus>(i);
+        }
+    }
+    throw std::invalid_argument("Unknown document status: "s + std::string(name));
+}
+
+void AppendJsonString(std::string_view text, std::string& out) {
+    out.push_back('"');
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (c >= '\0' && c < ' ') {
+            static constexpr char HEX[] = "0123456789abcdef";
+            out.append("\\u00"sv);
+            out.push_back(HEX[c >> 4]);
+            out.push_back(HEX[c & 0xF]);
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+void AppendNumberField(std::string_view name, uint64_t value, std::string& out) {
+    std::array<char, 24> buffer;
+    const auto [end, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+    out.push_back('"');
+    out.append(name);
+    out.append("\":"sv);
+    out.append(buffer.data(), end);
+}
+
+void ExecuteRequest(const Request& request, const SearchServer& server, RequestQueue& queue, const ServiceStats& stats,
+                    std::string& out) {
+    switch (request.type) {
+    case Request::Type::FIND: {
+        const std::vector<Document> documents = queue.AddFindRequest(request.query, request.status);
+        thread_local result_writer::ResultWriter writer;
+        writer.Clear();
+        writer.AppendJson(documents);
+        out.append("OK "sv);
+        out.append(writer.ToString());
+        break;
+    }
+    case Request::Type::MATCH: {
+        const auto [words, status] = server.MatchDocument(request.query, request.document_id);
+        out.append("OK {\"status\":"sv);
+        AppendJsonString(STATUS_NAMES[static_cast<size_t>(status)], out);
+        out.append(",\"words\":["sv);
+        for (size_t i = 0; i < words.size(); ++i) {
+            if (i > 0) {
+                out.push_back(',');
+            }
+            AppendJsonString(words[i], out);
+        }
+        out.append("]}"sv);
+        break;
+    }
+    case Request::Type::STATS:
+        out.append("OK {"sv);
+        AppendNumberField("no_result_requests"sv, static_cast<uint64_t>(queue.GetNoResultRequests()), out);
+        out.push_back(',');
+        AppendNumberField("slow_queries"sv, queue.GetSlowQueryLog() ? queue.GetSlowQueryLog()->GetSlowQueryCount() : 0, out);
+        out.push_back(',');
+        AppendNumberField("requests"sv, stats.requests, out);
+        out.push_back(',');
+        AppendNumberField("batches"sv, stats.batches, out);
+        out.push_back(',');
+        AppendNumberField("accepted_connections"sv, stats.accepted_connections, out);
+        out.push_back(',');
+        AppendNumberField("open_connections"sv, stats.open_connections, out);
+        out.push_back('}');
+        break;
+    }
+    out.push_back('\n');
+}
+
+} // namespace
+
+Request ParseRequest(std::string_view line) {
+    if (line.ends_with('\r')) {
+        line.remove_suffix(1);
+    }
+    const std::string_view command = TakeWord(line);
+    Request request;
+    if (command == "FIND"sv) {
+        request.type = Request::Type::FIND;
+    } else if (command == "FIND_BY_STATUS"sv) {
+        request.type = Request::Type::FIND;
+        request.status = ParseStatus(TakeWord(line));
+    } else if (command == "MATCH"sv) {
+        request.type = Request::Type::MATCH;
+        const std::string_view id = TakeWord(line);
+        const auto [ptr, ec] = std::from_chars(id.data(), id.data() + id.size(), request.document_id);
+        if (ec != std::errc{} || ptr != id.data() + id.size() || id.empty()) {
+            throw std::invalid_argument("Incorrect document ID: "s + std::string(id));
+        }
+    } else if (command == "STATS"sv) {
+        request.type = Request::Type::STATS;
+        if (!line.empty()) {
+            throw std::invalid_argument("STATS takes no arguments"s);
+        }
+        return request;
+    } else {
+        throw std::invalid_argument("Unknown command: "s + std::string(command));
+    }
+    if (line.empty()) {
+        throw std::invalid_argument("Empty query"s);
+    }
+    request.query = std::string(line);
+    return request;
+}
+
+void HandleRequest(std::string_view line, const SearchServer& server, RequestQueue& queue, const ServiceStats& stats, std::string& out) {
+    const size_t response_begin = out.size();
+    try {
+        ExecuteRequest(ParseRequest(line), server, queue, stats, out);
+    } catch (const std::exception& e) {
+        out.resize(response_begin);
+        AppendError(e.what(), out);
+    }
+}
+
+void AppendError(std::string_view message, std::string& out) {
+    out.append("ERR "sv);
+    // Ответ занимает ровно одну строку
+    for (const char c : message) {
+        out.push_back(c == '\n' || c == '\r' ? ' ' : c);
+    }
+    out.push_back('\n');
+}
+
+}; // namespace query_protocol
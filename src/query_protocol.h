@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "document.h"
+#include "request_queue.h"
+#include "search_server.h"
+
+
+// Строчный протокол службы запросов (search-server-daemon): запрос - строка, завершённая '\n' (завершающий '\r'
+// отбрасывается), ответ - одна строка на каждый запрос в порядке запросов соединения.
+//   FIND <запрос>                    -> OK [{"document_id":1,"relevance":0.5,"rating":3},...] (документы ACTUAL)
+//   FIND_BY_STATUS <статус> <запрос> -> то же для статуса ACTUAL, IRRELEVANT, BANNED или REMOVED
+//   MATCH <ID> <запрос>              -> OK {"status":"ACTUAL","words":["cat","dog"]}
+//   STATS                            -> OK {"no_result_requests":0,"requests":10,...}
+// Ошибка разбора или выполнения - ERR <сообщение>
+namespace query_protocol {
+
+using namespace document;
+using namespace request_queue;
+using namespace search_server;
+
+constexpr size_t MAX_REQUEST_SIZE = 64 * 1024; // длиннее - ошибка, соединение закрывается
+
+struct Request {
+    enum class Type {
+        FIND,
+        MATCH,
+        STATS,
+    };
+
+    Type type = Type::FIND;
+    DocumentStatus status = DocumentStatus::ACTUAL; // FIND_BY_STATUS
+    int document_id = 0;                            // MATCH
+    std::string query;
+};
+
+// Счётчики службы для ответа на STATS
+struct ServiceStats {
+    uint64_t accepted_connections = 0;
+    uint64_t open_connections = 0;
+    uint64_t requests = 0;
+    uint64_t batches = 0; // пачек запросов, переданных рабочим потокам
+};
+
+// Бросает std::invalid_argument для неизвестной команды или неверных аргументов
+Request ParseRequest(std::string_view line);
+
+// Разбирает и выполняет строку запроса, дописывает в out строку ответа с '\n'. Ошибки запроса становятся ответом ERR.
+// Можно вызывать из нескольких потоков одновременно, пока server не меняется
+void HandleRequest(std::string_view line, const SearchServer& server, RequestQueue& queue, const ServiceStats& stats, std::string& out);
+
+void AppendError(std::string_view message, std::string& out);
+
+}; // namespace query_protocol
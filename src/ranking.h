@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cmath>
+#include <concepts>
+
+
+namespace ranking {
+
+// Политика ранжирования задаёт IDF слова и вклад слова в релевантность документа.
+// term_freq - доля слова среди слов документа (TF), document_length - число слов документа без стоп-слов
+template <typename Ranking>
+concept RankingPolicy = requires(const Ranking& ranking, int count, double value) {
+    { ranking.ComputeInverseDocumentFreq(count, count) } -> std::convertible_to<double>;
+    { ranking.ComputeScore(value, count, value, value) } -> std::convertible_to<double>;
+};
+
+// TF-IDF: релевантность - сумма TF * IDF (по умолчанию)
+struct TfIdfRanking {
+    double ComputeInverseDocumentFreq(int document_count, int document_freq) const {
+        return std::log(document_count * 1.0 / document_freq);
+    }
+
+    double ComputeScore(double term_freq, [[maybe_unused]] int document_length, [[maybe_unused]] double average_length,
+                        double inverse_document_freq) const {
+        return term_freq * inverse_document_freq;
+    }
+};
+
+// Okapi BM25 с нормализацией по длине документа
+struct Bm25Ranking {
+    double k1 = 1.2; // насыщение по числу вхождений слова
+    double b = 0.75; // сила нормализации по длине документа (0 - без нормализации)
+
+    double ComputeInverseDocumentFreq(int document_count, int document_freq) const {
+        return std::log(1.0 + (document_count - document_freq + 0.5) / (document_freq + 0.5));
+    }
+
+    double ComputeScore(double term_freq, int document_length, double average_length, double inverse_document_freq) const {
+        const double count = term_freq * document_length;
+        const double norm = k1 * (1.0 - b + b * document_length / average_length);
+        return inverse_document_freq * count * (k1 + 1.0) / (count + norm);
+    }
+};
+
+}; // namespace ranking
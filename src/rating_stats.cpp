@@ -0,0 +1,126 @@
+#include "rating_stats.h"
+
+#include <algorithm>
+#include <iterator>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+
+namespace rating_stats {
+
+namespace {
+
+// Скалярная обработка оценок [begin, size) (используется и для хвоста SIMD-версии)
+void AggregateScalar(const int* ratings, size_t begin, size_t size, RatingAggregate& aggregate) {
+    for (size_t i = begin; i < size; ++i) {
+        aggregate.sum += ratings[i];
+        aggregate.min = std::min(aggregate.min, ratings[i]);
+        aggregate.max = std::max(aggregate.max, ratings[i]);
+    }
+}
+
+#if defined(__AVX2__)
+
+// Обрабатывает оценки блоками по 8, возвращает число обработанных
+size_t AggregateSimd(const int* ratings, size_t size, RatingAggregate& aggregate) {
+    // Оценки расширяются со знаком до 64 бит: по 4 частичные суммы в каждой из двух половин блока
+    __m256i sum_low = _mm256_setzero_si256();
+    __m256i sum_high = _mm256_setzero_si256();
+    __m256i min = _mm256_set1_epi32(aggregate.min);
+    __m256i max = _mm256_set1_epi32(aggregate.max);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ratings + i));
+        sum_low = _mm256_add_epi64(sum_low, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(chunk)));
+        sum_high = _mm256_add_epi64(sum_high, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(chunk, 1)));
+        min = _mm256_min_epi32(min, chunk);
+        max = _mm256_max_epi32(max, chunk);
+    }
+    alignas(32) int64_t sums[4];
+    alignas(32) int mins[8];
+    alignas(32) int maxs[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(sums), _mm256_add_epi64(sum_low, sum_high));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(mins), min);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(maxs), max);
+    for (int64_t sum : sums) {
+        aggregate.sum += sum;
+    }
+    aggregate.min = *std::min_element(std::begin(mins), std::end(mins));
+    aggregate.max = *std::max_element(std::begin(maxs), std::end(maxs));
+    return i;
+}
+
+#elif defined(__SSE2__)
+
+// Обрабатывает оценки блоками по 4, возвращает число обработанных
+size_t AggregateSimd(const int* ratings, size_t size, RatingAggregate& aggregate) {
+    // В SSE2 нет расширения 32 -> 64 бит и min/max для int32: старшие половины 64-битных слагаемых - знаковая маска,
+    // наименьшее и наибольшее выбираются по маске сравнения
+    __m128i sum = _mm_setzero_si128();
+    __m128i min = _mm_set1_epi32(aggregate.min);
+    __m128i max = _mm_set1_epi32(aggregate.max);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ratings + i));
+        const __m128i sign = _mm_srai_epi32(chunk, 31);
+        sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(chunk, sign));
+        sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(chunk, sign));
+        const __m128i is_less = _mm_cmplt_epi32(chunk, min);
+        min = _mm_or_si128(_mm_and_si128(is_less, chunk), _mm_andnot_si128(is_less, min));
+        const __m128i is_greater = _mm_cmpgt_epi32(chunk, max);
+        max = _mm_or_si128(_mm_and_si128(is_greater, chunk), _mm_andnot_si128(is_greater, max));
+    }
+    alignas(16) int64_t sums[2];
+    alignas(16) int mins[4];
+    alignas(16) int maxs[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(sums), sum);
+    _mm_store_si128(reinterpret_cast<__m128i*>(mins), min);
+    _mm_store_si128(reinterpret_cast<__m128i*>(maxs), max);
+    aggregate.sum += sums[0] + sums[1];
+    aggregate.min = *std::min_element(std::begin(mins), std::end(mins));
+    aggregate.max = *std::max_element(std::begin(maxs), std::end(maxs));
+    return i;
+}
+
+#else
+
+size_t AggregateSimd(const int*, size_t, RatingAggregate&) {
+    return 0;
+}
+
+#endif
+
+} // namespace
+
+int RatingAggregate::GetAverage() const {
+    // Среднее целых чисел лежит между наименьшим и наибольшим и всегда помещается в int
+    return count == 0 ? 0 : static_cast<int>(sum / count);
+}
+
+double RatingAggregate::GetMean() const {
+    return count == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(count);
+}
+
+RatingAggregate& RatingAggregate::operator+=(const RatingAggregate& other) {
+    sum += other.sum;
+    count += other.count;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    return *this;
+}
+
+RatingAggregate AggregateRatings(const int* ratings, size_t size) {
+    RatingAggregate aggregate;
+    aggregate.count = static_cast<int64_t>(size);
+    const size_t processed = AggregateSimd(ratings, size, aggregate);
+    AggregateScalar(ratings, processed, size, aggregate);
+    return aggregate;
+}
+
+RatingAggregate AggregateRatings(const std::vector<int>& ratings) {
+    return AggregateRatings(ratings.data(), ratings.size());
+}
+
+}; // namespace rating_stats
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+
+namespace rating_stats {
+
+// Сводка оценок документа. Сумма и число оценок 64-битные: не переполняются и на миллиардах оценок.
+// Сводки складываются, поэтому оценки можно добавлять частями
+struct RatingAggregate {
+    int64_t sum = 0;
+    int64_t count = 0;
+    int min = std::numeric_limits<int>::max(); // без оценок - наибольшее int
+    int max = std::numeric_limits<int>::min(); // без оценок - наименьшее int
+
+    // Средняя оценка с отбрасыванием дробной части (к нулю); без оценок - 0
+    int GetAverage() const;
+
+    // Средняя оценка без округления; без оценок - 0
+    double GetMean() const;
+
+    RatingAggregate& operator+=(const RatingAggregate& other);
+    bool operator==(const RatingAggregate& other) const = default;
+};
+
+// Сводка массива оценок одним проходом: SIMD-редукция (AVX2 или SSE2) с суммой в 64-битных ячейках
+RatingAggregate AggregateRatings(const int* ratings, size_t size);
+RatingAggregate AggregateRatings(const std::vector<int>& ratings);
+
+}; // namespace rating_stats
@@ -4,26 +4,41 @@
 namespace request_queue {
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
+    const Clock::time_point start = Clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query, status);
-    AddRequest(static_cast<int>(result.size()));
+    AddRequest(raw_query, static_cast<int>(result.size()), start);
     return result;
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
+    const Clock::time_point start = Clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query);
-    AddRequest(static_cast<int>(result.size()));
+    AddRequest(raw_query, static_cast<int>(result.size()), start);
     return result;
 }
 
 int RequestQueue::GetNoResultRequests() const {
+    std::lock_guard lock(mutex_);
     return no_results_requests_;
 }
 
+void RequestQueue::EnableSlowQueryLog(std::chrono::nanoseconds threshold, size_t capacity) {
+    slow_query_log_.emplace(threshold, capacity);
+}
+
+const SlowQueryLog* RequestQueue::GetSlowQueryLog() const {
+    return slow_query_log_ ? &*slow_query_log_ : nullptr;
+}
+
 bool RequestQueue::IsNextDay() {
     return current_time_ - requests_.front().time >= min_in_day_;
 }
 
-void RequestQueue::AddRequest(int results_num) {
+void RequestQueue::AddRequest(const std::string& raw_query, int results_num, Clock::time_point start) {
+    if (slow_query_log_) {
+        slow_query_log_->Record(raw_query, Clock::now() - start, results_num);
+    }
+    std::lock_guard lock(mutex_);
     ++current_time_;
     while (!requests_.empty() && IsNextDay()) {
         if (requests_.front().results == 0) {
@@ -2,8 +2,12 @@
 
 #include "document.h"
 #include "search_server.h"
+#include "slow_query_log.h"
 
+#include <chrono>
 #include <deque>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -12,7 +16,9 @@ namespace request_queue {
 
 using namespace document;
 using namespace search_server;
+using namespace slow_query_log;
 
+// Поиск выполняется без блокировки, учёт запросов - под мьютексом: AddFindRequest можно вызывать из нескольких потоков
 class RequestQueue {
 public:
     static constexpr int MINUTES_IN_DAY = 1440;
@@ -27,6 +33,10 @@ public:
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
 
+    // Фильтрация по предикату или статусу с выбранной политикой ранжирования
+    template <typename DocumentPredicate, RankingPolicy Ranking>
+    std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate, const Ranking& ranking);
+
     // Фильтрация по статусу
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
 
@@ -35,28 +45,48 @@ public:
 
     int GetNoResultRequests() const;
 
+    // Запросы, выполнявшиеся не меньше threshold, попадают в журнал медленных запросов (не более capacity последних).
+    // Включается до того, как запросы пойдут из нескольких потоков
+    void EnableSlowQueryLog(std::chrono::nanoseconds threshold, size_t capacity = SlowQueryLog::DEFAULT_CAPACITY);
+
+    // Журнал медленных запросов; nullptr, если он не включён
+    const SlowQueryLog* GetSlowQueryLog() const;
+
 private:
+    using Clock = std::chrono::steady_clock;
+
     struct QueryResult {
         int time;
         int results;
     };
     
     const SearchServer& search_server_;
+    mutable std::mutex mutex_;
     int no_results_requests_;
     int current_time_;
     
     std::deque<QueryResult> requests_;
     const static int min_in_day_ = MINUTES_IN_DAY;
+    std::optional<SlowQueryLog> slow_query_log_;
 
     bool IsNextDay();
-    void AddRequest(int results_num);
+    void AddRequest(const std::string& raw_query, int results_num, Clock::time_point start);
 };
 
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+    const Clock::time_point start = Clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-    AddRequest(result.size());
+    AddRequest(raw_query, static_cast<int>(result.size()), start);
+    return result;
+}
+
+template <typename DocumentPredicate, RankingPolicy Ranking>
+std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate, const Ranking& ranking) {
+    const Clock::time_point start = Clock::now();
+    const auto result = search_server_.FindTopDocuments(raw_query, document_predicate, ranking);
+    AddRequest(raw_query, static_cast<int>(result.size()), start);
     return result;
 }
 
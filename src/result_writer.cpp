@@ -0,0 +1,185 @@
+#include "result_writer.h"
+
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace result_writer {
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace {
+
+// Достаточно для любого int64 и double в формате to_chars
+constexpr size_t MAX_NUMBER_LENGTH = 32;
+
+// Точность operator<< для double по умолчанию (как у printf("%g"))
+constexpr int STREAM_PRECISION = 6;
+
+uint64_t ReadLittleEndian(std::string_view data, size_t offset, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(data[offset + i])) << (8 * i);
+    }
+    return value;
+}
+
+} // namespace
+
+void ResultWriter::Append(std::string_view text) {
+    while (!text.empty()) {
+        const size_t size = std::min(text.size(), CHUNK_SIZE);
+        char* out = Reserve(size);
+        std::memcpy(out, text.data(), size);
+        Commit(out + size);
+        text.remove_prefix(size);
+    }
+}
+
+void ResultWriter::AppendText(const Document& document) {
+    Append("{ document_id = "sv);
+    AppendInteger(document.id);
+    Append(", relevance = "sv);
+    AppendRelevance(document.relevance);
+    Append(", rating = "sv);
+    AppendInteger(document.rating);
+    Append(" }"sv);
+}
+
+void ResultWriter::AppendText(const std::vector<Document>& documents) {
+    for (const Document& document : documents) {
+        AppendText(document);
+    }
+}
+
+void ResultWriter::AppendJson(const std::vector<Document>& documents) {
+    Append("["sv);
+    bool is_first = true;
+    for (const Document& document : documents) {
+        Append(is_first ? "{\"document_id\":"sv : ",{\"document_id\":"sv);
+        AppendInteger(document.id);
+        Append(",\"relevance\":"sv);
+        AppendDouble(document.relevance);
+        Append(",\"rating\":"sv);
+        AppendInteger(document.rating);
+        Append("}"sv);
+        is_first = false;
+    }
+    Append("]"sv);
+}
+
+void ResultWriter::AppendBinary(const std::vector<Document>& documents) {
+    AppendLittleEndian(documents.size(), 4);
+    for (const Document& document : documents) {
+        AppendLittleEndian(static_cast<uint32_t>(document.id), 4);
+        AppendLittleEndian(static_cast<uint32_t>(document.rating), 4);
+        AppendLittleEndian(std::bit_cast<uint64_t>(document.relevance), 8);
+    }
+}
+
+size_t ResultWriter::GetSize() const {
+    size_t size = 0;
+    for (size_t i = 0; i < chunks_.size() && i <= current_chunk_; ++i) {
+        size += chunks_[i].size();
+    }
+    return size;
+}
+
+std::string ResultWriter::ToString() const {
+    std::string result;
+    result.reserve(GetSize());
+    for (size_t i = 0; i < chunks_.size() && i <= current_chunk_; ++i) {
+        result += chunks_[i];
+    }
+    return result;
+}
+
+void ResultWriter::Clear() {
+    for (std::string& chunk : chunks_) {
+        chunk.clear();
+    }
+    current_chunk_ = 0;
+}
+
+void ResultWriter::FlushTo(int fd) {
+    write_buffers_.clear();
+    for (size_t i = 0; i < chunks_.size() && i <= current_chunk_; ++i) {
+        if (!chunks_[i].empty()) {
+            write_buffers_.push_back({ chunks_[i].data(), chunks_[i].size() });
+        }
+    }
+    file_io::WriteAll(fd, write_buffers_);
+    Clear();
+}
+
+char* ResultWriter::Reserve(size_t size) {
+    if (chunks_.empty()) {
+        chunks_.emplace_back().reserve(CHUNK_SIZE);
+    }
+    if (chunks_[current_chunk_].size() + size > CHUNK_SIZE) {
+        if (++current_chunk_ == chunks_.size()) {
+            chunks_.emplace_back().reserve(CHUNK_SIZE);
+        }
+    }
+    std::string& chunk = chunks_[current_chunk_];
+    const size_t offset = chunk.size();
+    chunk.resize(offset + size);
+    return chunk.data() + offset;
+}
+
+void ResultWriter::Commit(char* end) {
+    std::string& chunk = chunks_[current_chunk_];
+    chunk.resize(static_cast<size_t>(end - chunk.data()));
+}
+
+void ResultWriter::AppendInteger(int64_t value) {
+    char* out = Reserve(MAX_NUMBER_LENGTH);
+    Commit(std::to_chars(out, out + MAX_NUMBER_LENGTH, value).ptr);
+}
+
+void ResultWriter::AppendRelevance(double value) {
+    char* out = Reserve(MAX_NUMBER_LENGTH);
+    Commit(std::to_chars(out, out + MAX_NUMBER_LENGTH, value, std::chars_format::general, STREAM_PRECISION).ptr);
+}
+
+void ResultWriter::AppendDouble(double value) {
+    // В JSON нет бесконечностей и NaN
+    if (!std::isfinite(value)) {
+        Append("null"sv);
+        return;
+    }
+    char* out = Reserve(MAX_NUMBER_LENGTH);
+    Commit(std::to_chars(out, out + MAX_NUMBER_LENGTH, value).ptr);
+}
+
+void ResultWriter::AppendLittleEndian(uint64_t value, size_t size) {
+    char* out = Reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        out[i] = static_cast<char>(value >> (8 * i));
+    }
+    Commit(out + size);
+}
+
+std::vector<Document> ParseBinary(std::string_view data) {
+    if (data.size() < 4) {
+        throw std::invalid_argument("Binary result is too short"s);
+    }
+    const size_t count = ReadLittleEndian(data, 0, 4);
+    if (data.size() != 4 + count * ResultWriter::BINARY_DOCUMENT_SIZE) {
+        throw std::invalid_argument("Binary result length does not match document count"s);
+    }
+    std::vector<Document> documents;
+    documents.reserve(count);
+    for (size_t offset = 4; offset < data.size(); offset += ResultWriter::BINARY_DOCUMENT_SIZE) {
+        documents.emplace_back(static_cast<int>(static_cast<uint32_t>(ReadLittleEndian(data, offset, 4))),
+                               std::bit_cast<double>(ReadLittleEndian(data, offset + 8, 8)),
+                               static_cast<int>(static_cast<uint32_t>(ReadLittleEndian(data, offset + 4, 4))));
+    }
+    return documents;
+}
+
+}; // namespace result_writer
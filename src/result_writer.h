@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "file_io.h"
+
+
+namespace result_writer {
+
+using namespace document;
+
+// Потоковая сериализация результатов поиска без iostreams.
+// Числа форматируются std::to_chars, данные копятся в переиспользуемых блоках по CHUNK_SIZE байт
+// (рост буфера не перекопирует уже записанное) и отправляются в файловый дескриптор сборной записью (writev на POSIX).
+// После Clear() и FlushTo() блоки и массив фрагментов остаются выделенными, поэтому в установившемся режиме запись не выделяет память
+class ResultWriter {
+public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    // Размер записи одного документа в бинарном формате: id (int32), rating (int32), relevance (float64)
+    static constexpr size_t BINARY_DOCUMENT_SIZE = 16;
+
+    void Append(std::string_view text);
+    void AppendInteger(int64_t value);
+
+    // Тот же формат, что у operator<<(std::ostream&, const Document&)
+    void AppendText(const Document& document);
+    void AppendText(const std::vector<Document>& documents);
+
+    // Массив объектов [{"document_id":1,"relevance":0.5,"rating":3},...]; релевантность - кратчайшее точное представление
+    void AppendJson(const std::vector<Document>& documents);
+
+    // Число документов (uint32), затем записи по BINARY_DOCUMENT_SIZE байт; все числа little-endian
+    void AppendBinary(const std::vector<Document>& documents);
+
+    // Число накопленных байт
+    size_t GetSize() const;
+
+    // Накопленные данные одной строкой (для отладки и тестов)
+    std::string ToString() const;
+
+    // Отбрасывает накопленные данные, сохраняя выделенные блоки
+    void Clear();
+
+    // Записывает накопленные данные в fd (с дозаписью при частичной записи) и очищает буфер.
+    // При ошибке записи бросает std::system_error
+    void FlushTo(int fd);
+
+private:
+    std::vector<std::string> chunks_; // каждый блок зарезервирован на CHUNK_SIZE байт
+    size_t current_chunk_ = 0;
+    std::vector<file_io::WriteBuffer> write_buffers_; // переиспользуется в FlushTo, растёт только вместе с chunks_
+
+    // Непрерывное место под size байт (size <= CHUNK_SIZE) в текущем или следующем блоке
+    char* Reserve(size_t size);
+    void Commit(char* end);
+
+    void AppendRelevance(double value);
+    void AppendDouble(double value);
+    void AppendLittleEndian(uint64_t value, size_t size);
+};
+
+// Разбор бинарного формата AppendBinary; бросает std::invalid_argument при неверной длине
+std::vector<Document> ParseBinary(std::string_view data);
+
+}; // namespace result_writer
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+
+namespace search_paginator {
+
+using namespace document;
+using namespace search_server;
+
+// Постраничная выдача результатов запроса прямо из поискового сервера.
+// Страницы не материализуются: страница k вычисляется окном offset/limit (в памяти не более (k + 1) * page_size документов),
+// а последовательное чтение курсором продолжает выдачу после последнего документа (search-after) и держит page_size документов
+template <typename DocumentPredicate>
+class SearchPaginator {
+public:
+    // Курсор для последовательного чтения страниц
+    class Cursor {
+    public:
+        explicit Cursor(const SearchPaginator& paginator)
+            : paginator_(&paginator) {
+        }
+
+        // Следующая страница; пустая, если результаты закончились
+        std::vector<Document> NextPage() {
+            if (exhausted_) {
+                return {};
+            }
+            std::vector<Document> page = last_document_
+                ? paginator_->search_server_.FindTopDocumentsAfter(paginator_->raw_query_, paginator_->document_predicate_,
+                                                                   *last_document_, paginator_->page_size_)
+                : (*paginator_)[0];
+            exhausted_ = page.size() < paginator_->page_size_;
+            if (!page.empty()) {
+                last_document_ = page.back();
+            }
+            return page;
+        }
+
+        bool HasMore() const {
+            return !exhausted_;
+        }
+
+    private:
+        const SearchPaginator* paginator_;
+        std::optional<SearchCursor> last_document_;
+        bool exhausted_ = false;
+    };
+
+    SearchPaginator(const SearchServer& search_server, std::string raw_query, DocumentPredicate document_predicate, size_t page_size)
+        : search_server_(search_server)
+        , raw_query_(std::move(raw_query))
+        , document_predicate_(std::move(document_predicate))
+        , page_size_(page_size) {
+        if (page_size_ == 0) {
+            throw std::invalid_argument("Page size must be positive"s);
+        }
+    }
+
+    // Страница с номером page (с нуля); пустая, если результатов меньше
+    std::vector<Document> operator[](size_t page) const {
+        return search_server_.FindTopDocuments(raw_query_, document_predicate_, PageRequest{ page * page_size_, page_size_ });
+    }
+
+    Cursor GetCursor() const {
+        return Cursor(*this);
+    }
+
+    size_t GetPageSize() const {
+        return page_size_;
+    }
+
+private:
+    const SearchServer& search_server_;
+    std::string raw_query_;
+    DocumentPredicate document_predicate_;
+    size_t page_size_;
+};
+
+template <typename DocumentPredicate>
+auto PaginateSearch(const SearchServer& search_server, const std::string& raw_query, DocumentPredicate document_predicate, size_t page_size) {
+    return SearchPaginator<DocumentPredicate>(search_server, raw_query, document_predicate, page_size);
+}
+
+inline auto PaginateSearch(const SearchServer& search_server, const std::string& raw_query, DocumentStatus find_status, size_t page_size) {
+    return PaginateSearch(search_server, raw_query, StatusPredicate{ find_status }, page_size);
+}
+
+// Только актуальные документы DocumentStatus::ACTUAL
+inline auto PaginateSearch(const SearchServer& search_server, const std::string& raw_query, size_t page_size) {
+    return PaginateSearch(search_server, raw_query, DocumentStatus::ACTUAL, page_size);
+}
+
+}; // namespace search_paginator
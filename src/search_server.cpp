@@ -1,137 +1,988 @@
 #include "search_server.h"
 
+#include <charconv>
+#include <cmath>
+#include <iterator>
+#include <ostream>
+
 
 namespace search_server {
 
-void SearchServer::AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings) {
-    std::vector<std::string> words = SplitIntoWordsNoStop(document);
+template <typename Policy>
+BasicSearchServer<Policy>::BasicSearchServer(IndexOptions options)
+    : BasicSearchServer(std::vector<std::string>{}, options) {
+}
+
+template <typename Policy>
+void BasicSearchServer<Policy>::AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings) {
+    if (!fields_.empty()) {
+        AddDocument(document_id, DocumentFields{ { document } }, status, ratings);
+        return;
+    }
+    std::string normalized;
+    const std::vector<std::string_view> words = stem_cache_ ? AnalyzeDocument<true>(document, normalized)
+                                                            : AnalyzeDocument<false>(document, normalized);
+    IndexDocument(document_id, words, status, ratings);
+}
+
+template <typename Policy>
+void BasicSearchServer<Policy>::AddDocument(int document_id, const DocumentFields& fields, DocumentStatus status, const std::vector<int>& ratings) {
+    if (fields_.empty()) {
+        throw std::invalid_argument("Multi-field documents require IndexOptions::fields"s);
+    }
+    if (fields.texts.size() > fields_.size()) {
+        throw std::invalid_argument("Document has "s + std::to_string(fields.texts.size()) + " fields, expected at most "s
+                                    + std::to_string(fields_.size()));
+    }
+    // Термины всех полей подряд: позиции продолжаются от поля к полю, но фраза из терминов одного поля
+    // не совпадёт через границу полей
+    std::vector<std::string> terms;
+    std::string normalized;
+    for (size_t field = 0; field < fields.texts.size(); ++field) {
+        for (std::string_view word : stem_cache_ ? AnalyzeDocument<true>(fields.texts[field], normalized)
+                                                 : AnalyzeDocument<false>(fields.texts[field], normalized)) {
+            terms.push_back(MakeFieldTerm(field, word));
+        }
+    }
+    IndexDocument(document_id, std::vector<std::string_view>(terms.begin(), terms.end()), status, ratings);
+}
+
+template <typename Policy>
+void BasicSearchServer<Policy>::IndexDocument(int document_id, const std::vector<std::string_view>& words, DocumentStatus status,
+                                              const std::vector<int>& ratings) {
     if (IsValidDocumentID(document_id)) {
+        EnsureMemoryAvailable();
         const double inv_word_count = 1.0 / static_cast<int>(words.size());
-        for (const std::string& word : words) {
-            word_to_document_freqs_[word][document_id] += inv_word_count;
+        std::unordered_map<std::string_view, double> term_freqs;
+        for (std::string_view word : words) {
+            term_freqs[word] += inv_word_count;
+        }
+        const RatingAggregate aggregate = AggregateRatings(ratings);
+        const int rating = aggregate.GetAverage();
+        index_.AddDocument(document_id, status, rating, term_freqs);
+        if (positions_) {
+            positions_->AddDocument(document_id, words);
         }
             added_ids_.push_back(document_id);
-            documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
+            documents_.emplace(document_id, DocumentData{rating, status, static_cast<int>(words.size())});
+            document_ratings_.emplace(document_id, aggregate);
+            total_document_length_ += static_cast<int64_t>(words.size());
     } else {
         throw std::invalid_argument("Incorrect document ID: "s + std::to_string(document_id));
     }
 }
-    
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query) const {
+
+template <typename Policy>
+void BasicSearchServer<Policy>::RemoveDocument(int document_id) {
+    const auto document_it = documents_.find(document_id);
+    if (document_it == documents_.end()) {
+        throw std::invalid_argument("Unknown document ID: "s + std::to_string(document_id));
+    }
+    index_.RemoveDocument(document_id);
+    if (positions_) {
+        positions_->RemoveDocument(document_id);
+    }
+    total_document_length_ -= document_it->second.length;
+    documents_.erase(document_it);
+    document_ratings_.erase(document_id);
+    added_ids_.erase(std::find(added_ids_.begin(), added_ids_.end(), document_id));
+}
+
+template <typename Policy>
+void BasicSearchServer<Policy>::SetDocumentStatus(int document_id, DocumentStatus status) {
+    const auto document_it = documents_.find(document_id);
+    if (document_it == documents_.end()) {
+        throw std::invalid_argument("Unknown document ID: "s + std::to_string(document_id));
+    }
+    index_.SetDocumentStatus(document_id, status);
+    document_it->second.status = status;
+}
+
+template <typename Policy>
+void BasicSearchServer<Policy>::AddRatings(int document_id, const std::vector<int>& ratings) {
+    const auto document_it = documents_.find(document_id);
+    if (document_it == documents_.end()) {
+        throw std::invalid_argument("Unknown document ID: "s + std::to_string(document_id));
+    }
+    RatingAggregate& aggregate = document_ratings_.at(document_id);
+    aggregate += AggregateRatings(ratings);
+    const int rating = aggregate.GetAverage();
+    if (rating != document_it->second.rating) {
+        index_.SetDocumentRating(document_id, rating);
+        document_it->second.rating = rating;
+    }
+}
+
+template <typename Policy>
+const RatingAggregate& BasicSearchServer<Policy>::GetDocumentRatings(int document_id) const {
+    const auto it = document_ratings_.find(document_id);
+    if (it == document_ratings_.end()) {
+        throw std::invalid_argument("Unknown document ID: "s + std::to_string(document_id));
+    }
+    return it->second;
+}
+
+template <typename Policy>
+std::vector<Document> BasicSearchServer<Policy>::FindTopDocuments(const std::string& raw_query) const {
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query, DocumentStatus find_status) const {
-    return FindTopDocuments(raw_query,
-        [find_status]([[maybe_unused]] int document_id, DocumentStatus status, [[maybe_unused]] int rating) {
-            return status == find_status;
-        });
+template <typename Policy>
+std::vector<Document> BasicSearchServer<Policy>::FindTopDocuments(const std::string& raw_query, DocumentStatus find_status) const {
+    return FindTopDocuments(raw_query, StatusPredicate{ find_status });
+}
+
+template <typename Policy>
+std::vector<Document> BasicSearchServer<Policy>::FindTopDocuments(const std::string& raw_query, DocumentStatus find_status, PageRequest page) const {
+    return FindTopDocuments(raw_query, StatusPredicate{ find_status }, page);
+}
+
+template <typename Policy>
+std::vector<Document> BasicSearchServer<Policy>::FindTopDocuments(const std::string& raw_query, PageRequest page) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL, page);
+}
+
+template <typename Policy>
+std::vector<Document> BasicSearchServer<Policy>::FindTopDocumentsAfter(const std::string& raw_query, DocumentStatus find_status, const SearchCursor& after,
+                                                                       size_t limit) const {
+    return FindTopDocumentsAfter(raw_query, StatusPredicate{ find_status }, after, limit);
+}
+
+template <typename Policy>
+std::vector<Document> BasicSearchServer<Policy>::FindTopDocumentsAfter(const std::string& raw_query, const SearchCursor& after, size_t limit) const {
+    return FindTopDocumentsAfter(raw_query, DocumentStatus::ACTUAL, after, limit);
 }
 
-int SearchServer::GetDocumentCount() const {
+template <typename Policy>
+int BasicSearchServer<Policy>::GetDocumentCount() const {
     return static_cast<int>(documents_.size());
 }
 
-std::tuple<std::vector<std::string>, DocumentStatus> SearchServer::MatchDocument(const std::string& raw_query, int document_id) const {
-    std::tuple<std::vector<std::string>, DocumentStatus> result;
+template <typename Policy>
+std::tuple<std::vector<std::string>, DocumentStatus> BasicSearchServer<Policy>::MatchDocument(const std::string& raw_query, int document_id) const {
     Query query = ParseQuery(raw_query);
+    if (query.plan && !MatchesPlan(*query.plan, document_id)) {
+        return { std::vector<std::string>{}, documents_.at(document_id).status };
+    }
     std::vector<std::string> matched_words;
     for (const std::string& word : query.plus_words) {
-        if (!word_to_document_freqs_.contains(word)) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).contains(document_id)) {
+        if (index_.FindTermFreq(word, document_id)) {
             matched_words.push_back(word);
         }
     }
-    for (const std::string& word : query.minus_words) {
-        if (!word_to_document_freqs_.contains(word)) {
+    for (const ProximityClause& clause : query.proximity_clauses) {
+        if (!IsProximityMatched(clause, document_id)) {
             continue;
         }
-        if (word_to_document_freqs_.at(word).contains(document_id)) {
+        for (const std::string& word : clause.words) {
+            if (std::find(matched_words.begin(), matched_words.end(), word) == matched_words.end()) {
+                matched_words.push_back(word);
+            }
+        }
+    }
+    for (const std::string& word : query.minus_words) {
+        if (index_.FindTermFreq(word, document_id)) {
             matched_words.clear();
             break;
         }
     }
+    if (!fields_.empty()) {
+        // Слово, найденное в нескольких полях, выдаётся один раз
+        for (std::string& word : matched_words) {
+            word.erase(0, 1);
+        }
+        std::sort(matched_words.begin(), matched_words.end());
+        matched_words.erase(std::unique(matched_words.begin(), matched_words.end()), matched_words.end());
+    }
     return { matched_words, documents_.at(document_id).status }; 
 }
 
-int SearchServer::GetDocumentId(int index) const {
+template <typename Policy>
+QueryExplanation BasicSearchServer<Policy>::ExplainQuery(const std::string& raw_query, DocumentStatus status) const {
+    return ExplainQuery(raw_query, StatusPredicate{ status });
+}
+
+template <typename Policy>
+int BasicSearchServer<Policy>::GetDocumentId(int index) const {
     return added_ids_.at(static_cast<size_t>(index));
 }
 
-bool SearchServer::IsValidDocumentID(int document_id) {
+template <typename Policy>
+IndexStats BasicSearchServer<Policy>::GetIndexStats() const {
+    return index_.GetStats();
+}
+
+template <typename Policy>
+void BasicSearchServer<Policy>::WaitForMerges() {
+    index_.WaitForMerges();
+}
+
+template <typename Policy>
+MemoryUsage BasicSearchServer<Policy>::GetMemoryUsage() const {
+    const IndexMemoryUsage index_usage = index_.GetMemoryUsage();
+    MemoryUsage usage;
+    usage.term_dictionary = index_usage.terms;
+    usage.postings = index_usage.postings;
+    usage.document_table = GetHashTableBytes(documents_) + GetHashTableBytes(document_ratings_) + index_usage.documents;
+    usage.document_ids = GetVectorBytes(added_ids_);
+    usage.stop_words = stop_words_.GetMemoryUsage();
+    usage.positions = positions_ ? positions_->GetMemoryUsage() : 0;
+    usage.stems = stem_cache_ ? stem_cache_->GetMemoryUsage() : 0;
+    usage.spilled_postings = index_usage.spilled_postings;
+    return usage;
+}
+
+size_t MemoryUsage::GetTotal() const {
+    return term_dictionary + postings + document_table + document_ids + stop_words + positions + stems;
+}
+
+template <typename Policy>
+void BasicSearchServer<Policy>::EnsureMemoryAvailable() {
+    if (memory_limits_.max_bytes == 0) {
+        return;
+    }
+    size_t total = GetMemoryUsage().GetTotal();
+    if (total >= memory_limits_.max_bytes && memory_limits_.policy == MemoryLimitPolicy::SPILL) {
+        index_.SpillSegments(memory_limits_.spill_directory.empty() ? std::filesystem::temp_directory_path()
+                                                                    : memory_limits_.spill_directory);
+        total = GetMemoryUsage().GetTotal();
+    }
+    if (total >= memory_limits_.max_bytes) {
+        throw std::length_error("Index memory limit exceeded: "s + std::to_string(total) + " of "s
+                                + std::to_string(memory_limits_.max_bytes) + " bytes"s);
+    }
+}
+
+template <typename Policy>
+bool BasicSearchServer<Policy>::IsValidDocumentID(int document_id) {
     return (document_id >= 0 && !documents_.contains(document_id));
 }
 
-bool SearchServer::IsStopWord(const std::string& word) const {
-    return stop_words_.contains(word);
+template <typename Policy>
+bool BasicSearchServer<Policy>::IsStopWord(std::string_view word) const {
+    return stop_words_.Contains(word);
+}
+
+template <typename Policy>
+std::vector<std::string_view> BasicSearchServer<Policy>::SplitIntoWordsNoStop(std::string_view text) const {
+    std::vector<std::string_view> words;
+    if (!SplitIntoWordsView(text, words)) {
+        const auto invalid_word = std::find_if_not(words.begin(), words.end(), IsValidWord);
+        throw std::invalid_argument("Word "s + std::string(*invalid_word) + " is invalid"s);
+    }
+    std::erase_if(words, [this](std::string_view word) {
+        return IsStopWord(word);
+    });
+    return words;
+}
+
+template <typename Policy>
+template <bool Stemming>
+std::vector<std::string_view> BasicSearchServer<Policy>::AnalyzeDocument(std::string_view document, std::string& normalized) const {
+    if (normalize_text_) {
+        NormalizeText(document, NormalizationMode::DOCUMENT, normalized);
+        document = normalized;
+    }
+    std::vector<std::string_view> words = SplitIntoWordsNoStop(document);
+    if constexpr (Stemming) {
+        stem_cache_->StemAll(words);
+    }
+    return words;
+}
+
+template <typename Policy>
+std::string BasicSearchServer<Policy>::StemQueryWord(std::string_view word) const {
+    return stem_cache_ ? stem_cache_->StemQuery(word) : std::string(word);
+}
+
+template <typename Policy>
+std::string BasicSearchServer<Policy>::DescribeTerm(std::string_view term) const {
+    if (fields_.empty()) {
+        return std::string(term);
+    }
+    return fields_[static_cast<size_t>(term.front()) - 1].name + ':' + std::string(term.substr(1));
+}
+
+template <typename Policy>
+int BasicSearchServer<Policy>::GetRankingDocumentFreq(std::string_view term, int document_freq) const {
+    if (fields_.empty()) {
+        return document_freq;
+    }
+    const std::string_view word = term.substr(1);
+    for (size_t field = 0; field < fields_.size(); ++field) {
+        if (field + 1 != static_cast<size_t>(term.front())) {
+            document_freq = std::max(document_freq, index_.GetDocumentFreq(MakeFieldTerm(field, word)));
+        }
+    }
+    return document_freq;
 }
 
-std::vector<std::string> SearchServer::SplitIntoWordsNoStop(const std::string& text) const {
-    std::vector<std::string> words;
-    for (const std::string& word : SplitIntoWords(text)) {
-        if (IsValidWord(word)) {
-            if (!IsStopWord(word)) {
-                words.push_back(word);
+template <typename Policy>
+void BasicSearchServer<Policy>::DescribeQuery(const Query& query, QueryExplanation& explanation) const {
+    const TfIdfRanking ranking;
+    for (const std::string& word : query.plus_words) {
+        const int document_freq = index_.GetDocumentFreq(word);
+        explanation.plus_words.push_back({ DescribeTerm(word), document_freq,
+                                           document_freq == 0 ? 0.0 : ComputePlusWordInverseDocumentFreq(query, ranking, word, document_freq) });
+    }
+    for (const std::string& word : query.minus_words) {
+        explanation.minus_words.push_back({ DescribeTerm(word), index_.GetDocumentFreq(word), 0.0 });
+    }
+    for (std::vector<TermExplanation>* terms : { &explanation.plus_words, &explanation.minus_words }) {
+        std::sort(terms->begin(), terms->end(), [](const TermExplanation& lhs, const TermExplanation& rhs) {
+            return lhs.term < rhs.term;
+        });
+    }
+    for (const ProximityClause& clause : query.proximity_clauses) {
+        std::string description = clause.max_distance == 0 ? "\""s : ""s;
+        for (size_t i = 0; i < clause.words.size(); ++i) {
+            if (i > 0) {
+                description += clause.max_distance == 0 ? " "s : " NEAR/"s + std::to_string(clause.max_distance) + ' ';
             }
+            description += DescribeTerm(clause.words[i]);
+        }
+        if (clause.max_distance == 0) {
+            description += '"';
+        }
+        explanation.proximity_clauses.push_back(std::move(description));
+    }
+    if (query.plan) {
+        explanation.plan = DescribePlan(*query.plan, [this](std::string_view term) {
+            return DescribeTerm(term);
+        });
+    }
+}
+
+template <typename Policy>
+std::string BasicSearchServer<Policy>::MakeFieldTerm(size_t field, std::string_view word) const {
+    if (fields_.empty()) {
+        return std::string(word);
+    }
+    std::string term;
+    term.reserve(word.size() + 1);
+    term.push_back(static_cast<char>(field + 1));
+    term.append(word);
+    return term;
+}
+
+template <typename Policy>
+void BasicSearchServer<Policy>::AddPlusWord(Query& query, std::string term, double weight) {
+    if (weight == 1.0 && query.plus_word_weights.empty()) {
+        query.plus_words.insert(std::move(term));
+        return;
+    }
+    const auto weight_it = query.plus_word_weights.find(term);
+    const auto [it, inserted] = query.plus_words.insert(term);
+    // Слово без записи в plus_word_weights имеет вес 1
+    const double new_weight = inserted ? weight : std::max(weight_it == query.plus_word_weights.end() ? 1.0 : weight_it->second, weight);
+    if (weight_it != query.plus_word_weights.end()) {
+        if (new_weight == 1.0) {
+            query.plus_word_weights.erase(weight_it);
         } else {
-            words.clear();
-            throw std::invalid_argument("Word "s + word + " is invalid"s); 
-        }            
+            weight_it->second = new_weight;
+        }
+    } else if (new_weight != 1.0) {
+        query.plus_word_weights.emplace(std::move(term), new_weight);
     }
-    return words;
 }
 
-bool SearchServer::IsValidWord(const std::string& word) {
+template <typename Policy>
+bool BasicSearchServer<Policy>::IsValidWord(std::string_view word) {
     // A valid word must not contain special characters
-    return none_of(word.begin(), word.end(), [](char c) {
+    return std::none_of(word.begin(), word.end(), [](char c) {
         return c >= '\0' && c < ' ';
     });
 }
 
-bool SearchServer::IsValidMinusWord(const std::string& word) {
+template <typename Policy>
+bool BasicSearchServer<Policy>::IsValidMinusWord(std::string_view word) {
     return !((word.size() == 1u && word[0] == '-') || (word.size() > 1u && word[0] == '-' && word[1] == '-'));
 }
 
-int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
-    if (ratings.empty()) {
-        return 0;
-    }
-    return accumulate(ratings.begin(),ratings.end(),0) / static_cast<int>(ratings.size());
-}
-
-SearchServer::QueryWord SearchServer::ParseQueryWord(std::string text) const {
+template <typename Policy>
+typename BasicSearchServer<Policy>::QueryWord BasicSearchServer<Policy>::ParseQueryWord(std::string_view text) const {
     bool is_minus = false;
     // Word shouldn't be empty
     if (text[0] == '-') {
         is_minus = true;
-        text = text.substr(1);
+        text.remove_prefix(1);
     }
     return { text, is_minus, IsStopWord(text) };
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string& text) const {
+// Разбор булева запроса рекурсивным спуском. Приоритет операторов: NOT, AND, OR; соседние операнды без оператора
+// объединяются через OR, как слова обычного запроса, а "a NOT b" читается как "a AND NOT b". Минус-слова исключают
+// документы из всей выдачи. Слова операндов вне отрицаний ранжируют выдачу так же, как слова обычного запроса
+template <typename Policy>
+class BasicSearchServer<Policy>::BooleanQueryParser {
+public:
+    BooleanQueryParser(const BasicSearchServer& server, std::string_view text, const std::vector<std::string_view>& words,
+                       const std::vector<size_t>& word_fields, Query& query)
+        : server_(server)
+        , text_(text)
+        , words_(words)
+        , word_fields_(word_fields)
+        , query_(query) {
+    }
+
+    PlanNode Parse() {
+        std::optional<PlanNode> root = ParseOr(false);
+        if (index_ < words_.size()) {
+            throw std::invalid_argument("Incorrect query, unexpected closing parenthesis: "s + std::string(text_));
+        }
+        // Запрос из одних отрицаний (NOT cat, NOT cat NOT dog) не совпадает ни с чем, а не перечисляет весь индекс
+        if (!root || IsNegationOnly(*root)) {
+            return PlanNode{};
+        }
+        return std::move(*root);
+    }
+
+private:
+    const BasicSearchServer& server_;
+    std::string_view text_;
+    const std::vector<std::string_view>& words_;
+    const std::vector<size_t>& word_fields_;
+    Query& query_;
+    size_t index_ = 0;
+
+    bool IsAt(std::string_view token) const {
+        return index_ < words_.size() && words_[index_] == token;
+    }
+
+    static PlanNode MakeNode(PlanNode::Type type, std::vector<PlanNode> children) {
+        PlanNode node;
+        node.type = type;
+        node.children = std::move(children);
+        return node;
+    }
+
+    static std::optional<PlanNode> Combine(PlanNode::Type type, std::vector<PlanNode> operands) {
+        if (operands.empty()) {
+            return std::nullopt;
+        }
+        if (operands.size() == 1) {
+            return std::move(operands.front());
+        }
+        return MakeNode(type, std::move(operands));
+    }
+
+    static bool IsNegationOnly(const PlanNode& node) {
+        if (node.type == PlanNode::Type::NOT) {
+            return true;
+        }
+        return node.type != PlanNode::Type::TERMS && std::all_of(node.children.begin(), node.children.end(), IsNegationOnly);
+    }
+
+    static void AddOperand(std::vector<PlanNode>& operands, std::optional<PlanNode> operand) {
+        if (operand) {
+            operands.push_back(std::move(*operand));
+        }
+    }
+
+    // or := and ([OR] and)*
+    std::optional<PlanNode> ParseOr(bool negated) {
+        std::vector<PlanNode> operands;
+        AddOperand(operands, ParseAnd(negated));
+        while (index_ < words_.size() && !IsAt(")"sv)) {
+            if (IsAt("OR"sv)) {
+                ++index_;
+            }
+            AddOperand(operands, ParseAnd(negated));
+        }
+        return Combine(PlanNode::Type::OR, std::move(operands));
+    }
+
+    // and := unary ((AND unary) | (NOT unary))*
+    std::optional<PlanNode> ParseAnd(bool negated) {
+        std::vector<PlanNode> operands;
+        AddOperand(operands, ParseUnary(negated));
+        while (IsAt("AND"sv) || IsAt("NOT"sv)) {
+            if (IsAt("AND"sv)) {
+                ++index_;
+            }
+            AddOperand(operands, ParseUnary(negated));
+        }
+        return Combine(PlanNode::Type::AND, std::move(operands));
+    }
+
+    // unary := NOT unary | primary
+    std::optional<PlanNode> ParseUnary(bool negated) {
+        if (!IsAt("NOT"sv)) {
+            return ParsePrimary(negated);
+        }
+        ++index_;
+        std::optional<PlanNode> operand = ParseUnary(!negated);
+        if (!operand) {
+            return std::nullopt;
+        }
+        if (operand->type == PlanNode::Type::NOT) {
+            return std::move(operand->children.front());
+        }
+        std::vector<PlanNode> children;
+        children.push_back(std::move(*operand));
+        return MakeNode(PlanNode::Type::NOT, std::move(children));
+    }
+
+    // primary := ( or ) | условие обычного запроса
+    std::optional<PlanNode> ParsePrimary(bool negated) {
+        if (index_ == words_.size() || IsAt(")"sv) || IsAt("AND"sv) || IsAt("OR"sv)) {
+            throw std::invalid_argument("Incorrect query, operand is missing: "s + std::string(text_));
+        }
+        if (IsAt("("sv)) {
+            ++index_;
+            std::optional<PlanNode> node = ParseOr(negated);
+            if (!IsAt(")"sv)) {
+                throw std::invalid_argument("Incorrect query, closing parenthesis is missing: "s + std::string(text_));
+            }
+            ++index_;
+            return node;
+        }
+        const size_t first = index_;
+        Query term_query;
+        server_.ParseQueryTerm(text_, words_, word_fields_, index_, term_query);
+        ++index_;
+
+        // Условие - любое из своих слов или фраз
+        std::vector<PlanNode> alternatives;
+        if (!term_query.plus_words.empty()) {
+            PlanNode terms_node;
+            terms_node.terms.assign(term_query.plus_words.begin(), term_query.plus_words.end());
+            alternatives.push_back(std::move(terms_node));
+        }
+        for (const ProximityClause& clause : term_query.proximity_clauses) {
+            std::vector<PlanNode> word_nodes;
+            for (const std::string& word : clause.words) {
+                PlanNode word_node;
+                word_node.terms.push_back(word);
+                word_nodes.push_back(std::move(word_node));
+            }
+            PlanNode clause_node = MakeNode(PlanNode::Type::AND, std::move(word_nodes));
+            clause_node.verifier = [&server = server_, clause](int document_id) {
+                return server.IsProximityMatched(clause, document_id);
+            };
+            alternatives.push_back(std::move(clause_node));
+        }
+        query_.minus_words.merge(term_query.minus_words);
+        if (!negated) {
+            for (const std::string& word : term_query.plus_words) {
+                const auto weight_it = term_query.plus_word_weights.find(word);
+                AddPlusWord(query_, word, weight_it == term_query.plus_word_weights.end() ? 1.0 : weight_it->second);
+            }
+            std::move(term_query.proximity_clauses.begin(), term_query.proximity_clauses.end(), std::back_inserter(query_.proximity_clauses));
+        }
+        if (alternatives.empty()) {
+            // Минус-слова и стоп-слова не ограничивают выдачу, шаблон без терминов не совпадает ни с чем
+            const bool is_ignored = std::all_of(words_.begin() + static_cast<std::ptrdiff_t>(first),
+                                                words_.begin() + static_cast<std::ptrdiff_t>(index_), [this](std::string_view word) {
+                while (!word.empty() && word.front() == '"') {
+                    word.remove_prefix(1);
+                }
+                while (!word.empty() && word.back() == '"') {
+                    word.remove_suffix(1);
+                }
+                return word.empty() || word.front() == '-' || server_.IsStopWord(word);
+            });
+            if (is_ignored) {
+                return std::nullopt;
+            }
+            return PlanNode{};
+        }
+        return Combine(PlanNode::Type::OR, std::move(alternatives));
+    }
+};
+
+template <typename Policy>
+typename BasicSearchServer<Policy>::Query BasicSearchServer<Policy>::ParseQuery(std::string_view text) const {
+    std::string normalized;
+    std::vector<std::string> field_words;
+    std::vector<std::string_view> words;
+    std::vector<size_t> word_fields; // только для многопольного сервера
+    if (!fields_.empty()) {
+        SplitFieldedQuery(text, field_words, words, word_fields);
+    } else {
+        if (normalize_text_) {
+            NormalizeText(text, NormalizationMode::QUERY, normalized);
+            text = normalized;
+        }
+        const bool valid_text = SplitIntoWordsView(text, words);
+        if (!valid_text) {
+            const auto invalid_word = std::find_if_not(words.begin(), words.end(), IsValidWord);
+            throw std::invalid_argument("Incorrect query: "s + std::string(text) + ", invalid word: "s + std::string(*invalid_word));
+        }
+    }
     Query query;
-    for (const std::string& word : SplitIntoWords(text)) {
-        if (IsValidWord(word) && IsValidMinusWord(word)) {
-            const QueryWord query_word = ParseQueryWord(word);
-            if (!query_word.is_stop) {
-                if (query_word.is_minus) {
-                    query.minus_words.emplace(query_word.data);
-                } else {
-                    query.plus_words.emplace(query_word.data);
+    const bool is_boolean = boolean_syntax_ && IsBooleanQuery(words);
+    if (is_boolean || normalize_text_) {
+        // Нормализатор сохраняет скобки по краям слов, вне булева запроса они отбрасываются как прочая пунктуация
+        SplitParentheses(words, word_fields, is_boolean);
+    }
+    if (is_boolean) {
+        query.plan = BooleanQueryParser(*this, text, words, word_fields, query).Parse();
+        CompilePlan(index_, *query.plan);
+        return query;
+    }
+    for (size_t i = 0; i < words.size(); ++i) {
+        ParseQueryTerm(text, words, word_fields, i, query);
+    }
+    return query;
+}
+
+template <typename Policy>
+void BasicSearchServer<Policy>::ParseQueryTerm(std::string_view text, const std::vector<std::string_view>& words, const std::vector<size_t>& word_fields,
+                                               size_t& index, Query& query) const {
+    const std::string_view word = words[index];
+    const size_t field = word_fields.empty() ? ALL_FIELDS : word_fields[index];
+    if (word.front() == '"') {
+        ParsePhrase(words, index, field, query);
+        return;
+    }
+    if (index + 1 < words.size() && words[index + 1].starts_with("NEAR/"sv)) {
+        ParseNearChain(words, word_fields, index, query);
+        return;
+    }
+    if (!IsValidMinusWord(word)) {
+        throw std::invalid_argument("Incorrect query: "s + std::string(text) + ", invalid word: "s + std::string(word));
+    }
+    const QueryWord query_word = ParseQueryWord(word);
+    if (expand_wildcards_ && IsWildcardPattern(query_word.data)) {
+        ExpandWildcard(query_word, field, query);
+    } else if (!(expand_fuzzy_ && TryExpandFuzzy(query_word, field, query)) && !query_word.is_stop) {
+        ForEachFieldTerm(StemQueryWord(query_word.data), field, [&](std::string term, double boost) {
+            if (query_word.is_minus) {
+                query.minus_words.insert(std::move(term));
+            } else {
+                AddPlusWord(query, std::move(term), boost);
+            }
+        });
+    }
+}
+
+template <typename Policy>
+bool BasicSearchServer<Policy>::IsBooleanQuery(const std::vector<std::string_view>& words) {
+    return std::any_of(words.begin(), words.end(), [](std::string_view word) {
+        return word == "AND"sv || word == "OR"sv || word == "NOT"sv;
+    });
+}
+
+template <typename Policy>
+void BasicSearchServer<Policy>::SplitParentheses(std::vector<std::string_view>& words, std::vector<size_t>& word_fields, bool keep) {
+    std::vector<std::string_view> split_words;
+    std::vector<size_t> split_fields;
+    for (size_t i = 0; i < words.size(); ++i) {
+        std::string_view word = words[i];
+        const auto push = [&](std::string_view token) {
+            split_words.push_back(token);
+            if (!word_fields.empty()) {
+                split_fields.push_back(word_fields[i]);
+            }
+        };
+        for (; !word.empty() && word.front() == '('; word.remove_prefix(1)) {
+            if (keep) {
+                push(word.substr(0, 1));
+            }
+        }
+        size_t close_count = 0;
+        while (close_count < word.size() && word[word.size() - 1 - close_count] == ')') {
+            ++close_count;
+        }
+        if (close_count < word.size()) {
+            push(word.substr(0, word.size() - close_count));
+        }
+        for (; keep && close_count > 0; --close_count) {
+            push(word.substr(word.size() - close_count, 1));
+        }
+    }
+    words = std::move(split_words);
+    if (!word_fields.empty()) {
+        word_fields = std::move(split_fields);
+    }
+}
+
+template <typename Policy>
+void BasicSearchServer<Policy>::SplitFieldedQuery(std::string_view text, std::vector<std::string>& field_words, std::vector<std::string_view>& words,
+                                                  std::vector<size_t>& word_fields) const {
+    std::vector<std::string_view> raw_words;
+    if (!SplitIntoWordsView(text, raw_words)) {
+        const auto invalid_word = std::find_if_not(raw_words.begin(), raw_words.end(), IsValidWord);
+        throw std::invalid_argument("Incorrect query: "s + std::string(text) + ", invalid word: "s + std::string(*invalid_word));
+    }
+    if (boolean_syntax_ && IsBooleanQuery(raw_words)) {
+        // Скобка перед префиксом поля: (title:cat
+        std::vector<size_t> no_fields;
+        SplitParentheses(raw_words, no_fields, true);
+    }
+    // Переписанные слова не должны перемещаться: на них ссылается words
+    field_words.reserve(raw_words.size());
+    std::vector<std::string_view> split_words;
+    for (std::string_view raw_word : raw_words) {
+        // [-]поле:слово, слово может начинаться с кавычки фразы
+        const std::string_view sign = raw_word.substr(0, raw_word.front() == '-' ? 1 : 0);
+        std::string_view body = raw_word.substr(sign.size());
+        size_t field = ALL_FIELDS;
+        const size_t colon = body.find(':');
+        if (colon != std::string_view::npos && colon + 1 < body.size()) {
+            const std::string_view name = body.substr(0, colon);
+            const auto field_it = std::find_if(fields_.begin(), fields_.end(), [name](const FieldOptions& options) {
+                return options.name == name;
+            });
+            if (field_it != fields_.end()) {
+                field = static_cast<size_t>(field_it - fields_.begin());
+                body.remove_prefix(colon + 1);
+            }
+        }
+        if (field == ALL_FIELDS && !normalize_text_) {
+            words.push_back(raw_word);
+            word_fields.push_back(field);
+            continue;
+        }
+        std::string& field_word = field_words.emplace_back(sign);
+        field_word.append(body);
+        if (normalize_text_) {
+            field_word = NormalizeText(field_word, NormalizationMode::QUERY);
+        }
+        SplitIntoWordsView(field_word, split_words);
+        words.insert(words.end(), split_words.begin(), split_words.end());
+        word_fields.resize(words.size(), field);
+    }
+}
+
+template <typename Policy>
+void BasicSearchServer<Policy>::ParsePhrase(const std::vector<std::string_view>& words, size_t& index, size_t field, Query& query) const {
+    // Фраза: слова от открывающей до закрывающей кавычки, стоп-слова внутри фразы пропускаются
+    ProximityClause clause{ {}, 0 };
+    bool closed = false;
+    for (; index < words.size() && !closed; ++index) {
+        std::string_view word = words[index];
+        if (clause.words.empty() && word.front() == '"') {
+            word.remove_prefix(1);
+        }
+        if (!word.empty() && word.back() == '"') {
+            word.remove_suffix(1);
+            closed = true;
+        }
+        if (word.find('"') != std::string_view::npos) {
+            throw std::invalid_argument("Incorrect phrase, unexpected quote in word: "s + std::string(words[index]));
+        }
+        if (!word.empty() && !IsStopWord(word)) {
+            clause.words.emplace_back(StemQueryWord(word));
+        }
+    }
+    --index;
+    if (!closed) {
+        throw std::invalid_argument("Incorrect phrase, closing quote is missing"s);
+    }
+    if (clause.words.size() > 1 && positions_) {
+        AddProximityClause(std::move(clause), field, query);
+        return;
+    }
+    // Фраза из одного слова или индекс без позиций: слова фразы - обычные плюс-слова
+    for (std::string& word : clause.words) {
+        ForEachFieldTerm(std::move(word), field, [&query](std::string term, double boost) {
+            AddPlusWord(query, std::move(term), boost);
+        });
+    }
+}
+
+template <typename Policy>
+void BasicSearchServer<Policy>::ParseNearChain(const std::vector<std::string_view>& words, const std::vector<size_t>& word_fields, size_t& index,
+                                               Query& query) const {
+    // Цепочка "a NEAR/k b NEAR/m c" превращается в попарные условия (a, b, k) и (b, c, m)
+    while (index + 1 < words.size() && words[index + 1].starts_with("NEAR/"sv)) {
+        if (index + 2 >= words.size()) {
+            throw std::invalid_argument("Incorrect query, NEAR without right operand"s);
+        }
+        const std::string_view op = words[index + 1].substr(5);
+        uint32_t max_distance = 0;
+        const auto [ptr, ec] = std::from_chars(op.data(), op.data() + op.size(), max_distance);
+        if (ec != std::errc{} || ptr != op.data() + op.size() || max_distance == 0) {
+            throw std::invalid_argument("Incorrect NEAR operator: "s + std::string(words[index + 1]));
+        }
+        const std::string_view lhs = words[index];
+        const std::string_view rhs = words[index + 2];
+        for (std::string_view word : { lhs, rhs }) {
+            if (word.front() == '-' || word.front() == '"') {
+                throw std::invalid_argument("Incorrect NEAR operand: "s + std::string(word));
+            }
+        }
+        // Поле условия - поле операнда с префиксом поля; оба операнда с разными полями не совпадут нигде
+        size_t field = ALL_FIELDS;
+        if (!word_fields.empty()) {
+            const size_t lhs_field = word_fields[index];
+            const size_t rhs_field = word_fields[index + 2];
+            if (lhs_field != ALL_FIELDS && rhs_field != ALL_FIELDS && lhs_field != rhs_field) {
+                throw std::invalid_argument("Incorrect query, NEAR operands are in different fields"s);
+            }
+            field = lhs_field != ALL_FIELDS ? lhs_field : rhs_field;
+        }
+        if (!positions_ || IsStopWord(lhs) || IsStopWord(rhs)) {
+            // Без позиций или рядом со стоп-словом близость не проверить, операнды остаются обычными плюс-словами
+            for (size_t i : { index, index + 2 }) {
+                if (!IsStopWord(words[i])) {
+                    ForEachFieldTerm(StemQueryWord(words[i]), word_fields.empty() ? ALL_FIELDS : word_fields[i],
+                                     [&query](std::string term, double boost) {
+                        AddPlusWord(query, std::move(term), boost);
+                    });
                 }
             }
         } else {
-            throw std::invalid_argument("Incorrect query: "s + text + ", invalid word: "s + word);
+            AddProximityClause({ { StemQueryWord(lhs), StemQueryWord(rhs) }, max_distance }, field, query);
         }
+        index += 2;
+    }
+}
+
+template <typename Policy>
+void BasicSearchServer<Policy>::AddProximityClause(ProximityClause clause, size_t field, Query& query) const {
+    if (fields_.empty()) {
+        query.proximity_clauses.push_back(std::move(clause));
+        return;
+    }
+    // Условие проверяется в каждом поле отдельно, вклад умножается на boost поля
+    for (size_t i = 0; i < fields_.size(); ++i) {
+        if (field != ALL_FIELDS && field != i) {
+            continue;
+        }
+        ProximityClause field_clause{ {}, clause.max_distance, fields_[i].boost };
+        for (const std::string& word : clause.words) {
+            field_clause.words.push_back(MakeFieldTerm(i, word));
+        }
+        query.proximity_clauses.push_back(std::move(field_clause));
     }
-    return query;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string& word) const {
-    return log(GetDocumentCount() * 1.0 / static_cast<int>(word_to_document_freqs_.at(word).size()));
+template <typename Policy>
+void BasicSearchServer<Policy>::ExpandWildcard(const QueryWord& query_word, size_t field, Query& query) const {
+    const std::string_view pattern = query_word.data;
+    if (pattern.front() == '*' || pattern.front() == '?') {
+        throw std::invalid_argument("Incorrect query, wildcard cannot start a word: "s + std::string(pattern));
+    }
+    // Шаблон с байтом поля раскрывается только в термины этого поля
+    ForEachFieldTerm(pattern, field, [&](std::string field_pattern, double boost) {
+        for (std::string& term : index_.ExpandPattern(field_pattern, max_wildcard_expansions_)) {
+            if (query_word.is_minus) {
+                query.minus_words.insert(std::move(term));
+            } else {
+                AddPlusWord(query, std::move(term), boost);
+            }
+        }
+    });
 }
 
+template <typename Policy>
+bool BasicSearchServer<Policy>::TryExpandFuzzy(const QueryWord& query_word, size_t field, Query& query) const {
+    // Нечёткое слово: hamstr~ (одна правка) или hamstr~2 (до двух правок)
+    const size_t tilde = query_word.data.rfind('~');
+    if (tilde == std::string_view::npos || tilde == 0) {
+        return false;
+    }
+    const std::string_view suffix = query_word.data.substr(tilde + 1);
+    if (suffix.size() > 1 || (suffix.size() == 1 && suffix != "1"sv && suffix != "2"sv)) {
+        return false;
+    }
+    const int max_distance = suffix.empty() ? 1 : suffix[0] - '0';
+    const std::string_view word = query_word.data.substr(0, tilde);
+    // Нечёткое стоп-слово отбрасывается, как и само стоп-слово
+    if (IsStopWord(word)) {
+        return true;
+    }
+
+    // Байт поля - префикс терминов, в расстояние правки не входит
+    ForEachFieldTerm(""sv, field, [&](std::string field_prefix, double boost) {
+        for (FuzzyMatch& match : index_.ExpandFuzzy(word, max_distance, max_fuzzy_expansions_, field_prefix)) {
+            if (query_word.is_minus) {
+                query.minus_words.insert(std::move(match.term));
+            } else {
+                AddPlusWord(query, std::move(match.term), std::pow(fuzzy_weight_, match.distance) * boost);
+            }
+        }
+    });
+    return true;
+}
+
+template <typename Policy>
+bool BasicSearchServer<Policy>::IsProximityMatched(const ProximityClause& clause, int document_id) const {
+    if (!positions_) {
+        return false;
+    }
+    std::vector<std::vector<uint32_t>> word_positions(clause.words.size());
+    for (size_t i = 0; i < clause.words.size(); ++i) {
+        if (!positions_->GetPositions(clause.words[i], document_id, word_positions[i])) {
+            return false;
+        }
+    }
+    if (clause.max_distance == 0) {
+        return HasPhrase(word_positions);
+    }
+    return HasNear(word_positions[0], word_positions[1], clause.max_distance);
+}
+
+template <typename Policy>
+void BasicSearchServer<Policy>::PushTopDocument(std::vector<Document>& heap, size_t count, const Document& document) {
+    if (heap.size() < count) {
+        heap.push_back(document);
+        std::push_heap(heap.begin(), heap.end(), IsMoreRelevant);
+    } else if (count > 0 && IsMoreRelevant(document, heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), IsMoreRelevant);
+        heap.back() = document;
+        std::push_heap(heap.begin(), heap.end(), IsMoreRelevant);
+    }
+}
+
+template <typename Policy>
+bool BasicSearchServer<Policy>::IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < Policy::relevance_epsilon) {
+        if (lhs.rating == rhs.rating) {
+            return lhs.id < rhs.id;
+        }
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+template <typename Policy>
+double BasicSearchServer<Policy>::ComputeAverageDocumentLength() const {
+    return documents_.empty() ? 0.0 : static_cast<double>(total_document_length_) / static_cast<double>(documents_.size());
+}
+
+std::ostream& operator<<(std::ostream& out, const QueryExplanation& explanation) {
+    const auto print_terms = [&out](const std::string& name, const std::vector<TermExplanation>& terms, bool with_idf) {
+        out << name << ':';
+        for (size_t i = 0; i < terms.size(); ++i) {
+            out << (i > 0 ? ", " : " ") << terms[i].term << " (documents = " << terms[i].document_freq;
+            if (with_idf) {
+                out << ", idf = " << terms[i].inverse_document_freq;
+            }
+            out << ')';
+        }
+        out << '\n';
+    };
+    print_terms("plus words"s, explanation.plus_words, true);
+    print_terms("minus words"s, explanation.minus_words, false);
+    if (!explanation.proximity_clauses.empty()) {
+        out << "proximity:";
+        for (size_t i = 0; i < explanation.proximity_clauses.size(); ++i) {
+            out << (i > 0 ? ", " : " ") << explanation.proximity_clauses[i];
+        }
+        out << '\n';
+    }
+    if (!explanation.plan.empty()) {
+        out << "plan: " << explanation.plan << '\n';
+    }
+    out << "candidates = " << explanation.candidate_count
+        << ", rejected by minus words = " << explanation.minus_word_rejected_count
+        << ", by plan = " << explanation.plan_rejected_count
+        << ", by predicate = " << explanation.predicate_rejected_count
+        << ", results = " << explanation.result_count << '\n';
+    const auto us = [](std::chrono::nanoseconds time) {
+        return std::chrono::duration<double, std::micro>(time).count();
+    };
+    const QueryStageTimes& times = explanation.times;
+    out << "stages, us: parse = " << us(times.parse) << ", plan = " << us(times.plan) << ", scoring = " << us(times.scoring)
+        << ", filtering = " << us(times.filtering) << ", selection = " << us(times.selection) << '\n';
+    return out;
+}
+
+template class BasicSearchServer<DefaultSearchPolicy>;
+template class BasicSearchServer<FloatScorePolicy>;
+
 }; // namespace search_server
\ No newline at end of file
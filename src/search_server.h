@@ -1,43 +1,274 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <filesystem>
+#include <iosfwd>
+#include <limits>
 #include <numeric>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
 #include "document.h"
+#include "positional_index.h"
+#include "query_plan.h"
+#include "ranking.h"
+#include "rating_stats.h"
+#include "segmented_index.h"
+#include "stemmer.h"
+#include "stop_words.h"
 #include "string_processing.h"
+#include "term_dictionary.h"
+#include "text_normalizer.h"
 
 
 namespace search_server {
 
 using namespace std::string_literals;
+using namespace std::string_view_literals;
 using namespace document;
 using namespace string_processing;
+using namespace positional_index;
+using namespace query_plan;
+using namespace term_dictionary;
+using namespace ranking;
+using namespace rating_stats;
+using namespace segmented_index;
+using namespace text_normalizer;
+using namespace stemmer;
+using namespace stop_words;
 
 constexpr int MAX_RESULT_DOCUMENT_COUNT = 5; // Количество выводимых документов
 
-class SearchServer {
+// Документов в блоке накопителей релевантности: массив накопителей блока (128 КиБ для double, 64 КиБ для float) помещается в L2
+constexpr size_t ACCUMULATOR_BLOCK_SIZE = 1 << 14;
+
+// Значение PageRequest::limit "по политике сервера": FindTopDocuments подставляет Policy::max_result_document_count
+constexpr size_t POLICY_RESULT_LIMIT = std::numeric_limits<size_t>::max();
+
+// Окно выдачи: пропустить offset лучших документов и вернуть не более limit следующих
+struct PageRequest {
+    size_t offset = 0;
+    size_t limit = POLICY_RESULT_LIMIT;
+};
+
+// Курсор продолжения выдачи (search-after): последний выданный документ (релевантность, рейтинг, ID).
+// Следующая страница начинается со следующего за ним документа в порядке выдачи
+using SearchCursor = Document;
+
+// Предикат фильтрации по статусу. Запросы с ним читают только записи индекса документов этого статуса
+struct StatusPredicate {
+    DocumentStatus status = DocumentStatus::ACTUAL;
+
+    bool operator()([[maybe_unused]] int document_id, DocumentStatus document_status, [[maybe_unused]] int rating) const {
+        return document_status == status;
+    }
+};
+
+// Предикат фильтрации по диапазону рейтинга [min_rating, max_rating] и, если задан, по статусу.
+// При SegmentOptions::impact_ordered запросы с ним пропускают блоки списков, все рейтинги которых вне диапазона
+struct RatingRangePredicate {
+    int min_rating = std::numeric_limits<int>::min();
+    int max_rating = std::numeric_limits<int>::max();
+    std::optional<DocumentStatus> status;
+
+    bool operator()([[maybe_unused]] int document_id, DocumentStatus document_status, int rating) const {
+        return rating >= min_rating && rating <= max_rating && (!status || document_status == *status);
+    }
+};
+
+// Что делает AddDocument, когда память индекса достигла MemoryLimits::max_bytes
+enum class MemoryLimitPolicy {
+    FAIL,  // бросает std::length_error, документ не добавляется
+    SPILL, // сбрасывает списки документов сегментов на диск; если и это не помогло - как FAIL
+};
+
+struct MemoryLimits {
+    size_t max_bytes = 0; // предел MemoryUsage::GetTotal(); 0 - без предела
+    MemoryLimitPolicy policy = MemoryLimitPolicy::FAIL;
+    std::filesystem::path spill_directory; // каталог файлов сброшенных сегментов; пустой - временный каталог системы
+};
+
+// Память сервера по структурам, в байтах (оценка для libstdc++ с учётом узлов и корзин хеш-таблиц)
+struct MemoryUsage {
+    size_t term_dictionary = 0;  // словари терминов сегментов и термины изменяемого сегмента
+    size_t postings = 0;         // списки документов терминов в куче
+    size_t document_table = 0;   // данные документов сервера и таблицы документов сегментов
+    size_t document_ids = 0;     // ID в порядке добавления
+    size_t stop_words = 0;
+    size_t positions = 0;        // позиционный индекс
+    size_t stems = 0;            // кэш основ слов
+    size_t spilled_postings = 0; // списки сброшенных на диск сегментов, в GetTotal не входят
+
+    size_t GetTotal() const;
+};
+
+// Термин разобранного запроса (ExplainQuery)
+struct TermExplanation {
+    std::string term;                   // у многопольного сервера - поле:слово
+    int document_freq = 0;              // длина списка документов термина
+    double inverse_document_freq = 0.0; // IDF плюс-слова с весом нечёткого совпадения и boost поля
+};
+
+// Время этапов выполнения запроса
+struct QueryStageTimes {
+    std::chrono::nanoseconds parse{ 0 };     // разбор запроса и компиляция плана булева запроса
+    std::chrono::nanoseconds plan{ 0 };      // отбор документов планом булева запроса
+    std::chrono::nanoseconds scoring{ 0 };   // релевантность кандидатов по спискам плюс-слов и фраз
+    std::chrono::nanoseconds filtering{ 0 }; // минус-слова, план и предикат
+    std::chrono::nanoseconds selection{ 0 }; // отбор лучших MAX_RESULT_DOCUMENT_COUNT документов
+};
+
+// Разбор запроса и счётчики его выполнения. Кандидаты отсеиваются по очереди минус-словами, планом и предикатом
+struct QueryExplanation {
+    std::vector<TermExplanation> plus_words;
+    std::vector<TermExplanation> minus_words;
+    std::vector<std::string> proximity_clauses; // фразы и NEAR
+    std::string plan;                           // план булева запроса (DescribePlan), для обычного запроса пуст
+    size_t candidate_count = 0;                 // документов хотя бы с одним плюс-словом или фразой
+    size_t minus_word_rejected_count = 0;
+    size_t plan_rejected_count = 0;
+    size_t predicate_rejected_count = 0;
+    size_t result_count = 0;
+    QueryStageTimes times;
+};
+
+std::ostream& operator<<(std::ostream& out, const QueryExplanation& explanation);
+
+// Поле многопольного документа (заголовок, теги, текст) и множитель релевантности совпадений в нём
+struct FieldOptions {
+    std::string name;  // имя для запросов с полем: title:cat
+    double boost = 1.0;
+};
+
+// Текст документа по полям IndexOptions::fields в том же порядке; недостающие поля пусты
+struct DocumentFields {
+    std::vector<std::string_view> texts;
+};
+
+// Настройки индекса, задаются при создании сервера
+struct IndexOptions {
+    bool store_positions = false; // хранить позиции слов для фраз ("lost cat") и запросов lost NEAR/k cat
+    bool boolean_syntax = false; // операторы AND, OR, NOT и скобки в запросах; без флага это обычные слова
+    bool expand_wildcards = false; // раскрывать шаблоны слов cat* и c?t; без флага '*' и '?' - обычные символы слова
+    size_t max_wildcard_expansions = 64; // максимум терминов, в которые раскрывается шаблон (cat*, c?t)
+    bool expand_fuzzy = false; // раскрывать нечёткие слова hamstr~ и hamstr~2; без флага '~' - обычный символ слова
+    size_t max_fuzzy_expansions = 16; // максимум терминов, в которые раскрывается нечёткое слово (hamstr~)
+    double fuzzy_weight = 0.5; // множитель релевантности за каждую правку в нечётком совпадении
+    SegmentOptions segments; // размер изменяемого сегмента, политика слияния и порядок по TF (impact_ordered) сегментов индекса
+    MemoryLimits memory; // предел памяти для AddDocument
+    bool normalize_text = false; // свёртка регистра, NFC и удаление пунктуации в документах, запросах и стоп-словах
+    Stemmer stemmer; // основы слов документов и запросов после стоп-фильтра (StemWord, StemEnglish, StemRussian или своя функция)
+    // Поля документов (не больше MAX_FIELD_COUNT). Пусто - документ из одного текста без накладных расходов на поля
+    std::vector<FieldOptions> fields;
+};
+
+// Параметры сервера, которые выбираются при компиляции. Своя политика - наследник DefaultSearchPolicy
+// с переопределёнными членами. Тип ID документов не параметризуется: int ID хранят сегменты, журнал WAL
+// и весь публичный API, а 64-битный ID только в накопителях ничего бы не дал
+struct DefaultSearchPolicy {
+    // Окно выдачи FindTopDocuments без PageRequest или с PageRequest::limit = POLICY_RESULT_LIMIT
+    static constexpr size_t max_result_document_count = MAX_RESULT_DOCUMENT_COUNT;
+
+    // Тип накопителей релевантности при ранжировании; float вдвое уменьшает память накопителей
+    using Score = double;
+
+    // Контейнер накопителей релевантности полного перебора: ID : релевантность
+    template <typename Key, typename Value>
+    using Map = std::unordered_map<Key, Value>;
+
+    // Релевантности, различающиеся меньше чем на relevance_epsilon, равны: порядок решают рейтинг и ID
+    static constexpr double relevance_epsilon = std::numeric_limits<double>::epsilon();
+};
+
+// Релевантность складывается во float
+struct FloatScorePolicy : DefaultSearchPolicy {
+    using Score = float;
+    static constexpr double relevance_epsilon = std::numeric_limits<float>::epsilon();
+};
+
+// Поисковый сервер с параметрами Policy. Методы скомпилированы в search_server.cpp для DefaultSearchPolicy
+// и FloatScorePolicy; новая политика добавляется туда строкой явного инстанцирования.
+// Один писатель: изменяющие методы (AddDocument, RemoveDocument, SetDocumentStatus, AddRatings, WaitForMerges)
+// вызываются из одного потока и не параллельно с запросами; несколько писателей сериализуют вызовы сами.
+// Константные методы можно вызывать из многих потоков одновременно, в том числе пока идёт фоновое слияние сегментов
+template <typename Policy = DefaultSearchPolicy>
+class BasicSearchServer {
 public:
-    SearchServer() = default;
+    BasicSearchServer() = default;
+
+    explicit BasicSearchServer(IndexOptions options);
 
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words);
+    explicit BasicSearchServer(const StringContainer& stop_words, IndexOptions options = {});
 
-    explicit SearchServer(const std::string& stop_words_text)
-        : SearchServer(SplitIntoWords(stop_words_text)) {
+    explicit BasicSearchServer(const std::string& stop_words_text, IndexOptions options = {})
+        : BasicSearchServer(SplitIntoWords(stop_words_text), options) {
     }
 
+    // Термины полей хранятся с байтом поля 0x01..0x1F в начале, такие байты не встречаются в словах
+    static constexpr size_t MAX_FIELD_COUNT = 31;
+
+    // Изменения индекса - только из потока-писателя (см. комментарий к классу)
+
+    // С IndexOptions::fields текст документа становится первым полем
     void AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
 
+    // Многопольный документ, требует IndexOptions::fields. Слово запроса ищется во всех полях, вклад совпадения
+    // в поле умножается на boost поля; title:cat, -title:cat, title:"lost cat" ищут только в поле title
+    void AddDocument(int document_id, const DocumentFields& fields, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Удаляет документ из индекса (из замороженных сегментов - отметкой об удалении). Неизвестный ID - std::invalid_argument
+    void RemoveDocument(int document_id);
+
+    // Меняет статус документа без переиндексации его слов. Неизвестный ID - std::invalid_argument
+    void SetDocumentStatus(int document_id, DocumentStatus status);
+
+    // Добавляет оценки документу без переиндексации его слов: сводка оценок пополняется, а средний рейтинг
+    // пересчитывается и сразу действует в предикатах и порядке выдачи. Неизвестный ID - std::invalid_argument
+    void AddRatings(int document_id, const std::vector<int>& ratings);
+
+    // Сводка всех оценок документа: при добавлении и из AddRatings. Неизвестный ID - std::invalid_argument
+    const RatingAggregate& GetDocumentRatings(int document_id) const;
+
     // Фильтрация по пользовательскому предикату int document_id, DocumentStatus status, int rating
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const;
 
+    // Фильтрация по предикату с выбранной политикой ранжирования (TfIdfRanking, Bm25Ranking)
+    template <typename DocumentPredicate, RankingPolicy Ranking>
+    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate, const Ranking& ranking) const;
+
+    // Фильтрация по статусу с выбранной политикой ранжирования
+    template <RankingPolicy Ranking>
+    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentStatus find_status, const Ranking& ranking) const;
+
+    // Окно выдачи offset/limit; в памяти держатся не более offset + limit лучших документов
+    template <typename DocumentPredicate, RankingPolicy Ranking = TfIdfRanking>
+    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate, PageRequest page,
+                                           const Ranking& ranking = {}) const;
+
+    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentStatus find_status, PageRequest page) const;
+
+    std::vector<Document> FindTopDocuments(const std::string& raw_query, PageRequest page) const;
+
+    // Не более limit документов, следующих в порядке выдачи за курсором after (последним документом предыдущей страницы)
+    template <typename DocumentPredicate, RankingPolicy Ranking = TfIdfRanking>
+    std::vector<Document> FindTopDocumentsAfter(const std::string& raw_query, DocumentPredicate document_predicate, const SearchCursor& after,
+                                                size_t limit, const Ranking& ranking = {}) const;
+
+    std::vector<Document> FindTopDocumentsAfter(const std::string& raw_query, DocumentStatus find_status, const SearchCursor& after,
+                                                size_t limit) const;
+
+    std::vector<Document> FindTopDocumentsAfter(const std::string& raw_query, const SearchCursor& after, size_t limit) const;
+
     // Простая фильтрация, только актуальные документы DocumentStatus::ACTUAL
     std::vector<Document> FindTopDocuments(const std::string& raw_query) const;
 
@@ -48,107 +279,802 @@ public:
 
     std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const;
 
+    // Разбор запроса (термины с длинами списков и IDF, фразы, план булева запроса), число кандидатов и отсеянных
+    // на каждом этапе и время этапов. Запрос выполняется полным перебором с TF-IDF, а не быстрыми путями выдачи
+    template <typename DocumentPredicate>
+    QueryExplanation ExplainQuery(const std::string& raw_query, DocumentPredicate document_predicate) const;
+
+    QueryExplanation ExplainQuery(const std::string& raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+
     int GetDocumentId(int index) const;
 
+    // Сегменты индекса, усиление записи и число слияний
+    IndexStats GetIndexStats() const;
+
+    // Дожидается фоновых слияний сегментов и подменяет ими исходные сегменты; вызывается потоком-писателем
+    void WaitForMerges();
+
+    // O(число сегментов)
+    MemoryUsage GetMemoryUsage() const;
+
 private:
+    using Score = typename Policy::Score;
+    using RelevanceMap = typename Policy::template Map<int, Score>;
+
     // данные слова запроса (слово, флаги для типа)
     struct QueryWord {
-        std::string data;
+        std::string_view data;
         bool is_minus;
         bool is_stop;
     };
 
-    // поисковый запрос (плюс-слова, минус-слова)
+    // фраза или близость слов, проверяется по позиционному индексу
+    struct ProximityClause {
+        std::vector<std::string> words;
+        uint32_t max_distance; // 0 - слова фразы стоят подряд, иначе NEAR/max_distance для двух слов
+        double weight = 1.0;   // boost поля
+    };
+
+    // Поле слова запроса: номер в fields_ или все поля
+    static constexpr size_t ALL_FIELDS = std::numeric_limits<size_t>::max();
+
+    // поисковый запрос (плюс-слова, минус-слова, фразы)
     struct Query {
         std::unordered_set<std::string> plus_words;
         std::unordered_set<std::string> minus_words;
+        std::vector<ProximityClause> proximity_clauses;
+        std::unordered_map<std::string, double> plus_word_weights; // веса плюс-слов из нечёткого поиска (по умолчанию 1)
+        std::optional<PlanNode> plan; // булев запрос (AND, OR, NOT, скобки): план отбора документов выдачи
     };
 
-    std::unordered_set<std::string> stop_words_; // множество стоп-слов
-    std::unordered_map<std::string, std::unordered_map<int, double>> word_to_document_freqs_; // слово : словарь(ID : TF)
+    class BooleanQueryParser;
+
+    StopWordSet stop_words_; // множество стоп-слов на совершенной хеш-функции
+    SegmentedIndex index_; // слово : документы со словом и их TF, по сегментам
     std::unordered_map<int, DocumentData> documents_; // ID : данные документа
+    std::unordered_map<int, RatingAggregate> document_ratings_; // ID : сводка оценок (вне DocumentData, которую читает ранжирование)
     std::vector<int> added_ids_; // вектор ID в хронологическом порядке добавления документа
+    int64_t total_document_length_ = 0; // сумма длин документов (без стоп-слов) для средней длины в BM25
+    std::optional<PositionalIndex> positions_; // позиции слов, только при IndexOptions::store_positions
+    bool boolean_syntax_ = false;
+    bool expand_wildcards_ = false;
+    size_t max_wildcard_expansions_ = IndexOptions{}.max_wildcard_expansions;
+    bool expand_fuzzy_ = false;
+    size_t max_fuzzy_expansions_ = IndexOptions{}.max_fuzzy_expansions;
+    double fuzzy_weight_ = IndexOptions{}.fuzzy_weight;
+    MemoryLimits memory_limits_;
+    bool normalize_text_ = false;
+    std::optional<StemCache> stem_cache_; // только при IndexOptions::stemmer
+    std::vector<FieldOptions> fields_; // пусто - документы из одного поля, термины без байта поля
 
     bool IsValidDocumentID(int document_id);
-    bool IsStopWord(const std::string& word) const;
 
-    // Разбивает строку по пробелам на слова, исключив стоп-слова
-    std::vector<std::string> SplitIntoWordsNoStop(const std::string& text) const;
+    // Добавляет проанализированные слова документа в индексы
+    void IndexDocument(int document_id, const std::vector<std::string_view>& words, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Проверка предела памяти перед добавлением документа
+    void EnsureMemoryAvailable();
+    bool IsStopWord(std::string_view word) const;
+
+    // Разбивает строку по пробелам на слова, исключив стоп-слова (слова ссылаются на text)
+    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
+
+    // Цепочка анализа документа: токенизатор -> нормализация -> стоп-слова -> стемминг. Вариант без стемминга
+    // (цепочка по умолчанию) не обращается к кэшу основ. Слова ссылаются на document, normalized или кэш основ
+    template <bool Stemming>
+    std::vector<std::string_view> AnalyzeDocument(std::string_view document, std::string& normalized) const;
+
+    // Основа слова запроса; без стеммера - само слово
+    std::string StemQueryWord(std::string_view word) const;
 
-    static bool IsValidWord(const std::string& word);
-    static bool IsValidMinusWord(const std::string& word);
+    // Термин слова в поле: байт поля и слово; без полей - само слово
+    std::string MakeFieldTerm(size_t field, std::string_view word) const;
 
-    static int ComputeAverageRating(const std::vector<int>& ratings);
+    // Читаемый вид термина: поле:слово; без полей - само слово
+    std::string DescribeTerm(std::string_view term) const;
+
+    // Термины, фразы и план запроса для ExplainQuery
+    void DescribeQuery(const Query& query, QueryExplanation& explanation) const;
+
+    // callback(term, boost) для терминов слова в поле field или во всех полях (ALL_FIELDS)
+    template <typename Callback>
+    void ForEachFieldTerm(std::string_view word, size_t field, Callback callback) const;
+
+    // Разбивает запрос многопольного сервера на слова, отделяя префиксы полей (title:cat); field_words хранит
+    // переписанные слова, на которые ссылается words. word_fields[i] - поле слова i или ALL_FIELDS
+    void SplitFieldedQuery(std::string_view text, std::vector<std::string>& field_words, std::vector<std::string_view>& words,
+                           std::vector<size_t>& word_fields) const;
+
+    // Плюс-слово с весом; при повторе слова остаётся наибольший вес
+    static void AddPlusWord(Query& query, std::string term, double weight);
+
+    static bool IsValidWord(std::string_view word);
+    static bool IsValidMinusWord(std::string_view word);
 
     //разделяет строку запроса на плюс- и минус-слова
-    QueryWord ParseQueryWord(std::string text) const;
-    Query ParseQuery(const std::string& text) const;
+    QueryWord ParseQueryWord(std::string_view text) const;
+    Query ParseQuery(std::string_view text) const;
 
-    double ComputeWordInverseDocumentFreq(const std::string& word) const;
-    
-    template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+    // Разбирает условие запроса со слова index: фразу, цепочку NEAR или слово (с шаблоном или опечатками).
+    // После разбора index указывает на последнее слово условия
+    void ParseQueryTerm(std::string_view text, const std::vector<std::string_view>& words, const std::vector<size_t>& word_fields,
+                        size_t& index, Query& query) const;
+
+    // Есть ли среди слов операторы булева запроса AND, OR, NOT
+    static bool IsBooleanQuery(const std::vector<std::string_view>& words);
+
+    // Скобки в начале и в конце слов становятся отдельными словами (keep) или отбрасываются.
+    // word_fields, если не пуст, расширяется вместе с words
+    static void SplitParentheses(std::vector<std::string_view>& words, std::vector<size_t>& word_fields, bool keep);
+    void ParsePhrase(const std::vector<std::string_view>& words, size_t& index, size_t field, Query& query) const;
+    void ParseNearChain(const std::vector<std::string_view>& words, const std::vector<size_t>& word_fields, size_t& index,
+                        Query& query) const;
+    void AddProximityClause(ProximityClause clause, size_t field, Query& query) const;
+    void ExpandWildcard(const QueryWord& query_word, size_t field, Query& query) const;
+    bool TryExpandFuzzy(const QueryWord& query_word, size_t field, Query& query) const;
+
+    bool IsProximityMatched(const ProximityClause& clause, int document_id) const;
+
+    template <typename DocumentPredicate, RankingPolicy Ranking>
+    void AddProximityRelevance(const Query& query, DocumentPredicate document_predicate, const Ranking& ranking,
+                               RelevanceMap& document_to_relevance) const;
+
+    double ComputeAverageDocumentLength() const;
+
+    // Порядок выдачи: по убыванию релевантности, затем рейтинга, затем по возрастанию ID
+    static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+    // Добавляет документ в ограниченную кучу размера count; на вершине кучи - худший из отобранных
+    static void PushTopDocument(std::vector<Document>& heap, size_t count, const Document& document);
+
+    // Лучшие count документов, удовлетворяющих filter, в порядке выдачи (ограниченная куча размера count)
+    template <typename DocumentFilter>
+    std::vector<Document> SelectTopDocuments(const RelevanceMap& document_to_relevance, size_t count,
+                                             DocumentFilter filter) const;
+
+    // Лучшие count документов запроса. План булева запроса отбирает документы до ранжирования
+    template <typename DocumentPredicate, RankingPolicy Ranking, typename DocumentFilter>
+    std::vector<Document> FindTopMatchedDocuments(const Query& query, DocumentPredicate document_predicate, const Ranking& ranking,
+                                                  size_t count, DocumentFilter filter) const;
+
+    // Лучшие count документов по словам запроса. При TF-IDF без фраз - SelectTopDocumentsByImpact
+    // (SegmentOptions::impact_ordered) или SelectTopDocumentsBlocked, иначе полный перебор FindAllDocuments
+    template <typename DocumentPredicate, RankingPolicy Ranking, typename DocumentFilter>
+    std::vector<Document> FindTopRankedDocuments(const Query& query, DocumentPredicate document_predicate, const Ranking& ranking,
+                                                 size_t count, DocumentFilter filter) const;
+
+    // Top-K по спискам в порядке убывания TF (threshold algorithm): документы читаются от наибольшего вклада слова,
+    // релевантность каждого нового документа считается целиком поиском по остальным словам. Чтение прекращается,
+    // когда сумма наибольших оставшихся вкладов слов не может обогнать худший документ кучи
+    template <typename DocumentPredicate, typename DocumentFilter>
+    std::vector<Document> SelectTopDocumentsByImpact(const Query& query, DocumentPredicate document_predicate, size_t count,
+                                                     DocumentFilter filter) const;
+
+    // Top-K по term-at-a-time с блочными накопителями: пространство ID делится на блоки по ACCUMULATOR_BLOCK_SIZE,
+    // в каждом блоке все плюс-слова складываются в плотный массив, затем минус-слова помечают исключённые документы,
+    // и кандидаты блока проверяются предикатом и попадают в кучу. Списки читаются по возрастанию ID, блоки без записей
+    // пропускаются. Релевантность складывается в том же порядке слов, что в FindAllDocuments
+    template <typename DocumentPredicate, typename DocumentFilter>
+    std::vector<Document> SelectTopDocumentsBlocked(const Query& query, DocumentPredicate document_predicate, size_t count,
+                                                    DocumentFilter filter) const;
+
+    template <RankingPolicy Ranking>
+    double ComputeWordInverseDocumentFreq(const Ranking& ranking, std::string_view word) const;
+
+    // Число документов для IDF термина: у термина поля - наибольшее по полям число документов с тем же словом,
+    // чтобы IDF слова был общим для всех полей и вес поля не перекрывался разницей частот по полям
+    int GetRankingDocumentFreq(std::string_view term, int document_freq) const;
+
+    // IDF плюс-слова с весом нечёткого совпадения
+    template <RankingPolicy Ranking>
+    double ComputePlusWordInverseDocumentFreq(const Query& query, const Ranking& ranking, const std::string& word, int document_freq) const;
+
+    // callback(document_id, term_freq, document_data) для документов со словом, подходящих под предикат.
+    // Для StatusPredicate перебираются только записи индекса нужного статуса
+    template <typename DocumentPredicate, typename Callback>
+    void ForEachMatchingPosting(std::string_view word, DocumentPredicate document_predicate, Callback callback) const;
+
+    // Релевантность всех документов, подходящих под запрос и предикат
+    template <typename DocumentPredicate, RankingPolicy Ranking>
+    RelevanceMap FindAllDocuments(const Query& query, DocumentPredicate document_predicate, const Ranking& ranking) const;
 };
 
+using SearchServer = BasicSearchServer<>;
+
+extern template class BasicSearchServer<DefaultSearchPolicy>;
+extern template class BasicSearchServer<FloatScorePolicy>;
 
+
+template <typename Policy>
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
-    : stop_words_(MakeUniqueNonEmptyStrings(stop_words)) {
-    if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
+BasicSearchServer<Policy>::BasicSearchServer(const StringContainer& stop_words, IndexOptions options)
+{
+    StringSet words = MakeUniqueNonEmptyStrings(stop_words);
+    if (!all_of(words.begin(), words.end(), IsValidWord)) {
         throw std::invalid_argument("Incorrect stop words"s);
     }
+    if (options.normalize_text) {
+        // Стоп-слово после нормализации может распасться на несколько слов ("don't" -> "don", "t")
+        StringSet normalized_words;
+        for (const std::string& word : words) {
+            for (std::string& normalized_word : SplitIntoWords(NormalizeText(word))) {
+                normalized_words.insert(std::move(normalized_word));
+            }
+        }
+        words = std::move(normalized_words);
+    }
+    stop_words_ = StopWordSet(words);
+    if (options.store_positions) {
+        positions_.emplace();
+    }
+    index_ = SegmentedIndex(options.segments);
+    boolean_syntax_ = options.boolean_syntax;
+    expand_wildcards_ = options.expand_wildcards;
+    max_wildcard_expansions_ = options.max_wildcard_expansions;
+    expand_fuzzy_ = options.expand_fuzzy;
+    max_fuzzy_expansions_ = options.max_fuzzy_expansions;
+    fuzzy_weight_ = options.fuzzy_weight;
+    memory_limits_ = options.memory;
+    normalize_text_ = options.normalize_text;
+    if (options.stemmer) {
+        stem_cache_.emplace(std::move(options.stemmer));
+    }
+    if (options.fields.size() > MAX_FIELD_COUNT) {
+        throw std::invalid_argument("Too many fields: "s + std::to_string(options.fields.size()));
+    }
+    for (size_t i = 0; i < options.fields.size(); ++i) {
+        const FieldOptions& field = options.fields[i];
+        const bool is_duplicate = std::any_of(options.fields.begin(), options.fields.begin() + static_cast<std::ptrdiff_t>(i),
+                                              [&field](const FieldOptions& other) {
+            return other.name == field.name;
+        });
+        if (field.name.empty() || field.name.find_first_of(" :\"-"sv) != std::string::npos || !IsValidWord(field.name)
+            || is_duplicate || !(field.boost > 0.0)) {
+            throw std::invalid_argument("Incorrect field: "s + field.name);
+        }
+    }
+    fields_ = std::move(options.fields);
+}
+
+template <typename Policy>
+template <typename Callback>
+void BasicSearchServer<Policy>::ForEachFieldTerm(std::string_view word, size_t field, Callback callback) const {
+    if (fields_.empty()) {
+        callback(std::string(word), 1.0);
+    } else if (field != ALL_FIELDS) {
+        callback(MakeFieldTerm(field, word), fields_[field].boost);
+    } else {
+        for (size_t i = 0; i < fields_.size(); ++i) {
+            callback(MakeFieldTerm(i, word), fields_[i].boost);
+        }
+    }
 }
 
+template <typename Policy>
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const {
-    Query query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(query, document_predicate);
+std::vector<Document> BasicSearchServer<Policy>::FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const {
+    return FindTopDocuments(raw_query, document_predicate, TfIdfRanking{});
+}
 
-    sort(matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < std::numeric_limits<double>::epsilon()) {
-                return lhs.rating > rhs.rating;
-            }
-            return lhs.relevance > rhs.relevance;
-        });
+template <typename Policy>
+template <RankingPolicy Ranking>
+std::vector<Document> BasicSearchServer<Policy>::FindTopDocuments(const std::string& raw_query, DocumentStatus find_status, const Ranking& ranking) const {
+    return FindTopDocuments(raw_query, StatusPredicate{ find_status }, ranking);
+}
+
+template <typename Policy>
+template <typename DocumentPredicate, RankingPolicy Ranking>
+std::vector<Document> BasicSearchServer<Policy>::FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate, const Ranking& ranking) const {
+    return FindTopDocuments(raw_query, document_predicate, PageRequest{}, ranking);
+}
 
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+template <typename Policy>
+template <typename DocumentPredicate, RankingPolicy Ranking>
+std::vector<Document> BasicSearchServer<Policy>::FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate, PageRequest page,
+                                                                  const Ranking& ranking) const {
+    if (page.limit == POLICY_RESULT_LIMIT) {
+        page.limit = Policy::max_result_document_count;
     }
+    Query query = ParseQuery(raw_query);
+    std::vector<Document> matched_documents = FindTopMatchedDocuments(query, document_predicate, ranking, page.offset + page.limit,
+        [](const Document&) {
+            return true;
+        });
+    matched_documents.erase(matched_documents.begin(),
+                            matched_documents.begin() + static_cast<std::ptrdiff_t>(std::min(page.offset, matched_documents.size())));
 
     return matched_documents;
 }
 
+template <typename Policy>
+template <typename DocumentPredicate, RankingPolicy Ranking>
+std::vector<Document> BasicSearchServer<Policy>::FindTopDocumentsAfter(const std::string& raw_query, DocumentPredicate document_predicate,
+                                                                       const SearchCursor& after, size_t limit, const Ranking& ranking) const {
+    Query query = ParseQuery(raw_query);
+    return FindTopMatchedDocuments(query, document_predicate, ranking, limit,
+        [&after](const Document& document) {
+            return IsMoreRelevant(after, document);
+        });
+}
+
+template <typename Policy>
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    std::unordered_map<int, double> document_to_relevance;
+QueryExplanation BasicSearchServer<Policy>::ExplainQuery(const std::string& raw_query, DocumentPredicate document_predicate) const {
+    using Clock = std::chrono::steady_clock;
+    QueryExplanation explanation;
+    Clock::time_point stage_start = Clock::now();
+    const auto finish_stage = [&stage_start](std::chrono::nanoseconds& time) {
+        const Clock::time_point now = Clock::now();
+        time = std::chrono::duration_cast<std::chrono::nanoseconds>(now - stage_start);
+        stage_start = now;
+    };
+
+    const Query query = ParseQuery(raw_query);
+    finish_stage(explanation.times.parse);
+    std::vector<int> plan_documents;
+    if (query.plan) {
+        plan_documents = EvaluatePlan(*query.plan);
+    }
+    finish_stage(explanation.times.plan);
+
+    const TfIdfRanking ranking;
+    const auto accept_all = []([[maybe_unused]] int document_id, [[maybe_unused]] DocumentStatus status, [[maybe_unused]] int rating) {
+        return true;
+    };
+    RelevanceMap document_to_relevance;
     for (const std::string& word : query.plus_words) {
-        if (!word_to_document_freqs_.contains(word)) {
+        const int document_freq = index_.GetDocumentFreq(word);
+        if (document_freq == 0) {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto& [ document_id, term_freq ] : word_to_document_freqs_.at(word)) {
-            if (document_predicate(document_id, documents_.at(document_id).status, documents_.at(document_id).rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+        const double inverse_document_freq = ComputePlusWordInverseDocumentFreq(query, ranking, word, document_freq);
+        ForEachMatchingPosting(word, accept_all, [&](int document_id, double term_freq, [[maybe_unused]] const DocumentData& document_data) {
+            document_to_relevance[document_id] += ranking.ComputeScore(term_freq, 0, 0.0, inverse_document_freq);
+        });
+    }
+    if (!query.proximity_clauses.empty()) {
+        AddProximityRelevance(query, accept_all, ranking, document_to_relevance);
+    }
+    explanation.candidate_count = document_to_relevance.size();
+    finish_stage(explanation.times.scoring);
+
+    for (const std::string& word : query.minus_words) {
+        index_.ForEachPosting(word, [&](int document_id, [[maybe_unused]] double term_freq) {
+            explanation.minus_word_rejected_count += document_to_relevance.erase(document_id);
+        });
+    }
+    if (query.plan) {
+        explanation.plan_rejected_count = std::erase_if(document_to_relevance, [&plan_documents](const auto& entry) {
+            return !std::binary_search(plan_documents.begin(), plan_documents.end(), entry.first);
+        });
+    }
+    explanation.predicate_rejected_count = std::erase_if(document_to_relevance, [&](const auto& entry) {
+        const DocumentData& document_data = documents_.at(entry.first);
+        return !document_predicate(entry.first, document_data.status, document_data.rating);
+    });
+    finish_stage(explanation.times.filtering);
+
+    explanation.result_count = SelectTopDocuments(document_to_relevance, Policy::max_result_document_count, [](const Document&) {
+        return true;
+    }).size();
+    finish_stage(explanation.times.selection);
+
+    DescribeQuery(query, explanation);
+    return explanation;
+}
+
+template <typename Policy>
+template <typename DocumentPredicate, RankingPolicy Ranking, typename DocumentFilter>
+std::vector<Document> BasicSearchServer<Policy>::FindTopMatchedDocuments(const Query& query, DocumentPredicate document_predicate, const Ranking& ranking,
+                                                                         size_t count, DocumentFilter filter) const {
+    if (!query.plan) {
+        return FindTopRankedDocuments(query, document_predicate, ranking, count, filter);
+    }
+    // Ранжируются только документы плана, релевантность - по словам операндов вне отрицаний
+    const std::vector<int> plan_documents = EvaluatePlan(*query.plan);
+    if (plan_documents.empty()) {
+        return {};
+    }
+    return FindTopRankedDocuments(query,
+        [&plan_documents, &document_predicate](int document_id, DocumentStatus status, int rating) {
+            return std::binary_search(plan_documents.begin(), plan_documents.end(), document_id)
+                && document_predicate(document_id, status, rating);
+        }, ranking, count, filter);
+}
+
+template <typename Policy>
+template <typename DocumentPredicate, RankingPolicy Ranking, typename DocumentFilter>
+std::vector<Document> BasicSearchServer<Policy>::FindTopRankedDocuments(const Query& query, DocumentPredicate document_predicate, const Ranking& ranking,
+                                                                        size_t count, DocumentFilter filter) const {
+    if constexpr (std::is_same_v<Ranking, TfIdfRanking>) {
+        if (query.proximity_clauses.empty()) {
+            if (index_.IsImpactOrdered()) {
+                return SelectTopDocumentsByImpact(query, document_predicate, count, filter);
             }
+            return SelectTopDocumentsBlocked(query, document_predicate, count, filter);
+        }
+    }
+    return SelectTopDocuments(FindAllDocuments(query, document_predicate, ranking), count, filter);
+}
+
+template <typename Policy>
+template <typename DocumentFilter>
+std::vector<Document> BasicSearchServer<Policy>::SelectTopDocuments(const RelevanceMap& document_to_relevance, size_t count,
+                                                                    DocumentFilter filter) const {
+    std::vector<Document> heap;
+    heap.reserve(std::min(count, document_to_relevance.size()));
+    for (const auto& [ document_id, relevance ] : document_to_relevance) {
+        const Document document{ document_id, relevance, documents_.at(document_id).rating };
+        if (filter(document)) {
+            PushTopDocument(heap, count, document);
         }
     }
+    std::sort_heap(heap.begin(), heap.end(), IsMoreRelevant);
+    return heap;
+}
 
+template <typename Policy>
+template <typename DocumentPredicate, typename DocumentFilter>
+std::vector<Document> BasicSearchServer<Policy>::SelectTopDocumentsByImpact(const Query& query, DocumentPredicate document_predicate, size_t count,
+                                                                            DocumentFilter filter) const {
+    constexpr size_t BOUND_CHECK_PERIOD = 16; // граница пересчитывается раз в столько прочитанных записей
+    const TfIdfRanking ranking;
+    const double average_length = ComputeAverageDocumentLength();
+
+    // Слова в порядке обхода query.plus_words, как в FindAllDocuments: релевантность складывается в том же порядке
+    std::vector<std::string_view> words;
+    std::vector<double> inverse_document_freqs;
+    std::vector<SegmentedIndex::TermLookup> word_lookups;
+    for (const std::string& word : query.plus_words) {
+        const int document_freq = index_.GetDocumentFreq(word);
+        if (document_freq > 0) {
+            words.push_back(word);
+            inverse_document_freqs.push_back(ComputePlusWordInverseDocumentFreq(query, ranking, word, document_freq));
+            word_lookups.push_back(index_.LookupTerm(word));
+        }
+    }
+    std::vector<SegmentedIndex::TermLookup> minus_word_lookups;
     for (const std::string& word : query.minus_words) {
-        if (!word_to_document_freqs_.contains(word)) {
+        minus_word_lookups.push_back(index_.LookupTerm(word));
+    }
+
+    std::vector<Document> heap;
+    std::unordered_set<int> seen_ids;
+    const auto add_document = [&](int document_id) {
+        const auto document_it = documents_.find(document_id);
+        if (document_it == documents_.end()) {
+            return;
+        }
+        const DocumentData& document_data = document_it->second;
+        if (!document_predicate(document_id, document_data.status, document_data.rating) || !seen_ids.insert(document_id).second) {
+            return;
+        }
+        const SegmentedIndex::DocumentLocation location = index_.LocateDocument(document_id);
+        for (const SegmentedIndex::TermLookup& lookup : minus_word_lookups) {
+            if (lookup.FindTermFreq(document_id, location)) {
+                return;
+            }
+        }
+        // Устаревшая копия повторно добавленного документа может не содержать ни одного слова запроса
+        Score relevance = 0;
+        bool is_matched = false;
+        for (size_t i = 0; i < words.size(); ++i) {
+            if (const std::optional<double> term_freq = word_lookups[i].FindTermFreq(document_id, location)) {
+                relevance += ranking.ComputeScore(*term_freq, document_data.length, average_length, inverse_document_freqs[i]);
+                is_matched = true;
+            }
+        }
+        const Document document{ document_id, relevance, document_data.rating };
+        if (is_matched && filter(document)) {
+            PushTopDocument(heap, count, document);
+        }
+    };
+
+    // Изменяемый сегмент не упорядочен по TF и невелик: его документы оцениваются сразу
+    for (std::string_view word : words) {
+        index_.ForEachMutablePosting(word, [&add_document](int document_id, [[maybe_unused]] double term_freq) {
+            add_document(document_id);
+        });
+    }
+
+    struct ImpactCursor {
+        IndexSegment::ImpactList list;
+        size_t word_index;
+        double inverse_document_freq;
+        size_t position = 0;
+
+        // Наибольший вклад слова среди ещё не прочитанных записей списка
+        double GetBound() const {
+            return position < list.size ? list.term_freqs[position] * inverse_document_freq : 0.0;
+        }
+    };
+    std::vector<ImpactCursor> cursors;
+    for (size_t i = 0; i < words.size(); ++i) {
+        for (const IndexSegment::ImpactList& list : index_.FindImpactLists(words[i])) {
+            cursors.push_back({ list, i, inverse_document_freqs[i] });
+        }
+    }
+
+    // Рейтинги списков устарели у документов, сменивших рейтинг после заморозки: тогда отбор по ним не применяется,
+    // рейтинг проверяет предикат в add_document
+    int min_rating = std::numeric_limits<int>::min();
+    int max_rating = std::numeric_limits<int>::max();
+    if constexpr (std::is_same_v<DocumentPredicate, RatingRangePredicate>) {
+        if (!index_.HasRatingOverrides()) {
+            min_rating = document_predicate.min_rating;
+            max_rating = document_predicate.max_rating;
+        }
+    }
+
+    std::vector<double> word_bounds(words.size());
+    for (size_t read_count = 0; count > 0; ++read_count) {
+        ImpactCursor* best = nullptr;
+        for (ImpactCursor& cursor : cursors) {
+            if (cursor.position < cursor.list.size && (!best || cursor.GetBound() > best->GetBound())) {
+                best = &cursor;
+            }
+        }
+        if (!best) {
+            break;
+        }
+        if (heap.size() == count && read_count % BOUND_CHECK_PERIOD == 0) {
+            // Непрочитанный документ набирает не больше суммы наибольших оставшихся вкладов его слов
+            std::fill(word_bounds.begin(), word_bounds.end(), 0.0);
+            for (const ImpactCursor& cursor : cursors) {
+                word_bounds[cursor.word_index] = std::max(word_bounds[cursor.word_index], cursor.GetBound());
+            }
+            if (heap.front().relevance - std::accumulate(word_bounds.begin(), word_bounds.end(), 0.0) >= Policy::relevance_epsilon) {
+                break;
+            }
+        }
+        if (best->position % IndexSegment::IMPACT_BLOCK_SIZE == 0) {
+            const IndexSegment::ImpactBlock& block = best->list.blocks[best->position / IndexSegment::IMPACT_BLOCK_SIZE];
+            if (block.max_rating < min_rating || block.min_rating > max_rating) {
+                best->position = std::min(best->position + IndexSegment::IMPACT_BLOCK_SIZE, best->list.size);
+                continue;
+            }
+        }
+        // Рейтинг записи совпадает с рейтингом действующей копии документа, устаревшие копии отбрасывать можно
+        const size_t position = best->position++;
+        if (best->list.ratings[position] >= min_rating && best->list.ratings[position] <= max_rating) {
+            add_document(best->list.document_ids[position]);
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end(), IsMoreRelevant);
+    return heap;
+}
+
+template <typename Policy>
+template <typename DocumentPredicate, typename DocumentFilter>
+std::vector<Document> BasicSearchServer<Policy>::SelectTopDocumentsBlocked(const Query& query, DocumentPredicate document_predicate, size_t count,
+                                                                           DocumentFilter filter) const {
+    const TfIdfRanking ranking;
+    std::optional<DocumentStatus> status;
+    if constexpr (std::is_same_v<DocumentPredicate, StatusPredicate>) {
+        status = document_predicate.status;
+    }
+
+    struct ListCursor {
+        const SegmentedIndex::SortedPostings* postings;
+        const SegmentedIndex::SortedPostings::List* list;
+        double inverse_document_freq;
+        size_t position = 0;
+    };
+    std::vector<SegmentedIndex::SortedPostings> word_postings;
+    word_postings.reserve(query.plus_words.size() + query.minus_words.size());
+    // Курсоры плюс-слов сгруппированы по словам в порядке обхода query.plus_words
+    std::vector<ListCursor> plus_cursors;
+    for (const std::string& word : query.plus_words) {
+        const int document_freq = index_.GetDocumentFreq(word);
+        if (document_freq == 0) {
+            continue;
+        }
+        const double inverse_document_freq = ComputePlusWordInverseDocumentFreq(query, ranking, word, document_freq);
+        const SegmentedIndex::SortedPostings& postings = word_postings.emplace_back(index_.GetSortedPostings(word, status));
+        for (const SegmentedIndex::SortedPostings::List& list : postings.GetLists()) {
+            plus_cursors.push_back({ &postings, &list, inverse_document_freq });
+        }
+    }
+    std::vector<ListCursor> minus_cursors;
+    for (const std::string& word : query.minus_words) {
+        const SegmentedIndex::SortedPostings& postings = word_postings.emplace_back(index_.GetSortedPostings(word, std::nullopt));
+        for (const SegmentedIndex::SortedPostings::List& list : postings.GetLists()) {
+            minus_cursors.push_back({ &postings, &list, 0.0 });
+        }
+    }
+
+    enum : uint8_t { UNSEEN, CANDIDATE, EXCLUDED };
+    // Накопители переиспользуются между запросами потока и после каждого блока обнуляются только в тронутых ячейках
+    thread_local std::vector<Score> accumulators(ACCUMULATOR_BLOCK_SIZE);
+    thread_local std::vector<uint8_t> states(ACCUMULATOR_BLOCK_SIZE, UNSEEN);
+    std::vector<uint32_t> touched;
+    // Если предикат, фильтр или выделение памяти бросят исключение посреди блока, тронутые ячейки
+    // обнуляются при выходе, иначе релевантности и отметки утекли бы в следующий запрос потока
+    struct TouchedReset {
+        std::vector<uint32_t>& touched;
+
+        ~TouchedReset() {
+            for (const uint32_t slot : touched) {
+                accumulators[slot] = 0;
+                states[slot] = UNSEEN;
+            }
+        }
+    } touched_reset{ touched };
+    std::vector<Document> heap;
+    while (true) {
+        int64_t next_id = std::numeric_limits<int64_t>::max();
+        for (const ListCursor& cursor : plus_cursors) {
+            if (cursor.position < cursor.list->size) {
+                next_id = std::min<int64_t>(next_id, cursor.list->document_ids[cursor.position]);
+            }
+        }
+        if (next_id == std::numeric_limits<int64_t>::max()) {
+            break;
+        }
+        const int64_t block_begin = next_id - next_id % static_cast<int64_t>(ACCUMULATOR_BLOCK_SIZE);
+        const int64_t block_end = block_begin + static_cast<int64_t>(ACCUMULATOR_BLOCK_SIZE);
+
+        for (ListCursor& cursor : plus_cursors) {
+            const int* document_ids = cursor.list->document_ids;
+            const double* term_freqs = cursor.list->term_freqs;
+            size_t position = cursor.position;
+            for (; position < cursor.list->size && document_ids[position] < block_end; ++position) {
+                if (!cursor.postings->IsLive(*cursor.list, document_ids[position])) {
+                    continue;
+                }
+                const auto slot = static_cast<uint32_t>(document_ids[position] - block_begin);
+                if (states[slot] == UNSEEN) {
+                    touched.push_back(slot);
+                    states[slot] = CANDIDATE;
+                }
+                accumulators[slot] += ranking.ComputeScore(term_freqs[position], 0, 0.0, cursor.inverse_document_freq);
+            }
+            cursor.position = position;
+        }
+        if (touched.empty()) {
+            continue;
+        }
+
+        for (ListCursor& cursor : minus_cursors) {
+            const int* document_ids = cursor.list->document_ids;
+            size_t position = static_cast<size_t>(std::lower_bound(document_ids + cursor.position, document_ids + cursor.list->size,
+                                                                   block_begin) - document_ids);
+            for (; position < cursor.list->size && document_ids[position] < block_end; ++position) {
+                const auto slot = static_cast<uint32_t>(document_ids[position] - block_begin);
+                if (states[slot] == CANDIDATE && cursor.postings->IsLive(*cursor.list, document_ids[position])) {
+                    states[slot] = EXCLUDED;
+                }
+            }
+            cursor.position = position;
+        }
+
+        for (const uint32_t slot : touched) {
+            if (states[slot] == CANDIDATE) {
+                const int document_id = static_cast<int>(block_begin + slot);
+                const DocumentData& document_data = documents_.at(document_id);
+                if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                    const Document document{ document_id, accumulators[slot], document_data.rating };
+                    if (filter(document)) {
+                        PushTopDocument(heap, count, document);
+                    }
+                }
+            }
+            accumulators[slot] = 0;
+            states[slot] = UNSEEN;
+        }
+        touched.clear();
+    }
+    std::sort_heap(heap.begin(), heap.end(), IsMoreRelevant);
+    return heap;
+}
+
+template <typename Policy>
+template <RankingPolicy Ranking>
+double BasicSearchServer<Policy>::ComputeWordInverseDocumentFreq(const Ranking& ranking, std::string_view word) const {
+    return ranking.ComputeInverseDocumentFreq(GetDocumentCount(), GetRankingDocumentFreq(word, index_.GetDocumentFreq(word)));
+}
+
+template <typename Policy>
+template <RankingPolicy Ranking>
+double BasicSearchServer<Policy>::ComputePlusWordInverseDocumentFreq(const Query& query, const Ranking& ranking, const std::string& word,
+                                                                     int document_freq) const {
+    double inverse_document_freq = ranking.ComputeInverseDocumentFreq(GetDocumentCount(), GetRankingDocumentFreq(word, document_freq));
+    if (!query.plus_word_weights.empty()) {
+        const auto weight_it = query.plus_word_weights.find(word);
+        if (weight_it != query.plus_word_weights.end()) {
+            inverse_document_freq *= weight_it->second;
+        }
+    }
+    return inverse_document_freq;
+}
+
+template <typename Policy>
+template <typename DocumentPredicate, typename Callback>
+void BasicSearchServer<Policy>::ForEachMatchingPosting(std::string_view word, DocumentPredicate document_predicate, Callback callback) const {
+    if constexpr (std::is_same_v<DocumentPredicate, StatusPredicate>) {
+        index_.ForEachPosting(word, document_predicate.status, [&](int document_id, double term_freq) {
+            callback(document_id, term_freq, documents_.at(document_id));
+        });
+    } else {
+        index_.ForEachPosting(word, [&](int document_id, double term_freq) {
+            const DocumentData& document_data = documents_.at(document_id);
+            if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                callback(document_id, term_freq, document_data);
+            }
+        });
+    }
+}
+
+template <typename Policy>
+template <typename DocumentPredicate, RankingPolicy Ranking>
+typename BasicSearchServer<Policy>::RelevanceMap BasicSearchServer<Policy>::FindAllDocuments(const Query& query, DocumentPredicate document_predicate,
+                                                                                            const Ranking& ranking) const {
+    RelevanceMap document_to_relevance;
+    const double average_length = ComputeAverageDocumentLength();
+    for (const std::string& word : query.plus_words) {
+        const int document_freq = index_.GetDocumentFreq(word);
+        if (document_freq == 0) {
             continue;
         }
-        std::erase_if(document_to_relevance, [&](const auto& pair) {
-            return word_to_document_freqs_.at(word).contains(pair.first);
+        const double inverse_document_freq = ComputePlusWordInverseDocumentFreq(query, ranking, word, document_freq);
+        ForEachMatchingPosting(word, document_predicate, [&](int document_id, double term_freq, const DocumentData& document_data) {
+            document_to_relevance[document_id] += ranking.ComputeScore(term_freq, document_data.length, average_length, inverse_document_freq);
         });
     }
 
-    std::vector<Document> matched_documents;
-    for (const auto& [ document_id, relevance ] : document_to_relevance) {
-        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+    if (!query.proximity_clauses.empty()) {
+        AddProximityRelevance(query, document_predicate, ranking, document_to_relevance);
     }
 
-    return matched_documents;
+    for (const std::string& word : query.minus_words) {
+        index_.ForEachPosting(word, [&document_to_relevance](int document_id, [[maybe_unused]] double term_freq) {
+            document_to_relevance.erase(document_id);
+        });
+    }
+
+    return document_to_relevance;
+}
+
+template <typename Policy>
+template <typename DocumentPredicate, RankingPolicy Ranking>
+void BasicSearchServer<Policy>::AddProximityRelevance(const Query& query, DocumentPredicate document_predicate, const Ranking& ranking,
+                                                      RelevanceMap& document_to_relevance) const {
+    const double average_length = ComputeAverageDocumentLength();
+    for (const ProximityClause& clause : query.proximity_clauses) {
+        // Кандидаты перебираются по самому короткому списку документов, остальные слова проверяются поиском
+        std::vector<int> document_freqs;
+        for (const std::string& word : clause.words) {
+            document_freqs.push_back(index_.GetDocumentFreq(word));
+        }
+        if (std::find(document_freqs.begin(), document_freqs.end(), 0) != document_freqs.end()) {
+            continue;
+        }
+        std::vector<double> inverse_document_freqs;
+        for (size_t i = 0; i < clause.words.size(); ++i) {
+            inverse_document_freqs.push_back(ranking.ComputeInverseDocumentFreq(GetDocumentCount(),
+                                                                                GetRankingDocumentFreq(clause.words[i], document_freqs[i])));
+        }
+        const size_t rarest = static_cast<size_t>(std::min_element(document_freqs.begin(), document_freqs.end()) - document_freqs.begin());
+        std::vector<double> term_freqs(clause.words.size());
+        ForEachMatchingPosting(clause.words[rarest], document_predicate,
+                               [&](int document_id, [[maybe_unused]] double term_freq, const DocumentData& document_data) {
+            for (size_t i = 0; i < clause.words.size(); ++i) {
+                const std::optional<double> word_term_freq = index_.FindTermFreq(clause.words[i], document_id);
+                if (!word_term_freq) {
+                    return;
+                }
+                term_freqs[i] = *word_term_freq;
+            }
+            if (!IsProximityMatched(clause, document_id)) {
+                return;
+            }
+            double relevance = 0;
+            for (size_t i = 0; i < term_freqs.size(); ++i) {
+                relevance += ranking.ComputeScore(term_freqs[i], document_data.length, average_length, inverse_document_freqs[i]);
+            }
+            document_to_relevance[document_id] += relevance * clause.weight;
+        });
+    }
 }
 
 }; // namespace search_server
\ No newline at end of file
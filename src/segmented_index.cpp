@@ -0,0 +1,949 @@
+#include "segmented_index.h"
+
+#include "file_io.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <tuple>
+
+
+namespace segmented_index {
+
+using namespace std::string_literals;
+
+namespace {
+
+bool IsHidden(const std::unordered_map<int, uint64_t>& tombstones, int document_id, uint64_t sequence) {
+    const auto it = tombstones.find(document_id);
+    return it != tombstones.end() && sequence < it->second;
+}
+
+struct StatusPosting {
+    DocumentStatus status;
+    int document_id;
+    double term_freq;
+
+    bool operator<(const StatusPosting& other) const {
+        return std::tie(status, document_id) < std::tie(other.status, other.document_id);
+    }
+};
+
+// Дописывает отсортированные записи термина и границы частей его статусов
+void AppendPartitions(const std::vector<StatusPosting>& postings, std::vector<size_t>& partitions_begin,
+                      std::vector<int>& document_ids, std::vector<double>& term_freqs) {
+    auto it = postings.begin();
+    for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+        for (; it != postings.end() && static_cast<size_t>(it->status) == status; ++it) {
+            document_ids.push_back(it->document_id);
+            term_freqs.push_back(it->term_freq);
+        }
+        partitions_begin.push_back(document_ids.size());
+    }
+}
+
+// Сливает соседние сегменты в один, вычищая удалённые документы и термины без документов,
+// перенося записи документов со сменённым статусом в части их текущих статусов и записывая сменённые рейтинги
+std::shared_ptr<const IndexSegment> MergeSegments(std::vector<std::shared_ptr<const IndexSegment>> inputs,
+                                                  std::unordered_map<int, uint64_t> tombstones,
+                                                  std::unordered_map<int, DocumentStatus> status_overrides,
+                                                  std::unordered_map<int, int> rating_overrides, bool impact_ordered) {
+    std::vector<TermDictionary::Cursor> cursors;
+    for (const auto& input : inputs) {
+        cursors.emplace_back(input->GetTerms(), 0);
+    }
+
+    std::vector<std::string> terms;
+    std::vector<size_t> partitions_begin{ 0 };
+    std::vector<int> document_ids;
+    std::vector<double> term_freqs;
+    std::vector<StatusPosting> postings;
+    while (true) {
+        const TermDictionary::Cursor* smallest = nullptr;
+        for (const auto& cursor : cursors) {
+            if (cursor.IsValid() && (!smallest || cursor.GetTerm() < smallest->GetTerm())) {
+                smallest = &cursor;
+            }
+        }
+        if (!smallest) {
+            break;
+        }
+        std::string term(smallest->GetTerm());
+
+        postings.clear();
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            if (!cursors[i].IsValid() || cursors[i].GetTerm() != term) {
+                continue;
+            }
+            for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+                const IndexSegment::PostingList list = inputs[i]->GetPostings(cursors[i].GetIndex(), static_cast<DocumentStatus>(status));
+                for (size_t j = 0; j < list.size; ++j) {
+                    const int document_id = list.document_ids[j];
+                    if (IsHidden(tombstones, document_id, inputs[i]->GetSequence())) {
+                        continue;
+                    }
+                    const auto override_it = status_overrides.find(document_id);
+                    postings.push_back({ override_it == status_overrides.end() ? static_cast<DocumentStatus>(status) : override_it->second,
+                                         document_id, list.term_freqs[j] });
+                }
+            }
+            cursors[i].Next();
+        }
+        if (postings.empty()) {
+            continue;
+        }
+        std::sort(postings.begin(), postings.end());
+        AppendPartitions(postings, partitions_begin, document_ids, term_freqs);
+        terms.push_back(std::move(term));
+    }
+
+    std::vector<std::pair<int, int>> document_ratings;
+    for (const auto& input : inputs) {
+        for (size_t i = 0; i < input->GetDocumentIds().size(); ++i) {
+            const int document_id = input->GetDocumentIds()[i];
+            if (!IsHidden(tombstones, document_id, input->GetSequence())) {
+                const auto override_it = rating_overrides.find(document_id);
+                document_ratings.emplace_back(document_id, override_it == rating_overrides.end() ? input->GetDocumentRatings()[i]
+                                                                                                   : override_it->second);
+            }
+        }
+    }
+    std::sort(document_ratings.begin(), document_ratings.end());
+
+    const std::vector<std::string_view> term_views(terms.begin(), terms.end());
+    return std::make_shared<const IndexSegment>(inputs.back()->GetSequence(), term_views, std::move(partitions_begin),
+                                                std::move(document_ids), std::move(term_freqs), document_ratings, impact_ordered);
+}
+
+} // namespace
+
+IndexSegment::IndexSegment(uint64_t sequence, const std::vector<std::string_view>& terms, std::vector<size_t> partitions_begin,
+                           std::vector<int> document_ids, std::vector<double> term_freqs,
+                           const std::vector<std::pair<int, int>>& document_ratings, bool impact_ordered)
+    : sequence_(sequence)
+    , terms_(terms)
+    , partitions_begin_(std::move(partitions_begin))
+    , document_ids_(std::move(document_ids))
+    , term_freqs_(std::move(term_freqs)) {
+    std::vector<std::pair<int, DocumentStatus>> documents;
+    documents.reserve(document_ids_.size());
+    for (size_t partition = 0; partition + 1 < partitions_begin_.size(); ++partition) {
+        const DocumentStatus status = static_cast<DocumentStatus>(partition % DOCUMENT_STATUS_COUNT);
+        for (size_t i = partitions_begin_[partition]; i < partitions_begin_[partition + 1]; ++i) {
+            documents.emplace_back(document_ids_[i], status);
+        }
+    }
+    std::sort(documents.begin(), documents.end());
+    documents.erase(std::unique(documents.begin(), documents.end()), documents.end());
+    segment_document_ids_.reserve(documents.size());
+    segment_document_statuses_.reserve(documents.size());
+    segment_document_ratings_.reserve(documents.size());
+    auto rating_it = document_ratings.begin();
+    for (const auto& [ document_id, status ] : documents) {
+        segment_document_ids_.push_back(document_id);
+        segment_document_statuses_.push_back(status);
+        rating_it = std::lower_bound(rating_it, document_ratings.end(), std::pair(document_id, std::numeric_limits<int>::min()));
+        segment_document_ratings_.push_back(rating_it->second);
+    }
+    if (impact_ordered) {
+        BuildImpactOrder();
+    }
+}
+
+void IndexSegment::BuildImpactOrder() {
+    const size_t term_count = terms_.GetSize();
+    std::vector<int> impact_document_ids(document_ids_.size());
+    std::vector<double> impact_term_freqs(term_freqs_.size());
+    std::vector<int> impact_ratings(document_ids_.size());
+    std::vector<ImpactBlock> impact_blocks;
+    std::vector<size_t> impact_blocks_begin{ 0 };
+    impact_blocks_begin.reserve(term_count + 1);
+    struct Entry {
+        double term_freq;
+        int rating;
+        int document_id;
+    };
+    std::vector<Entry> entries;
+    for (size_t term_index = 0; term_index < term_count; ++term_index) {
+        const size_t begin = partitions_begin_[term_index * DOCUMENT_STATUS_COUNT];
+        const size_t end = partitions_begin_[(term_index + 1) * DOCUMENT_STATUS_COUNT];
+        entries.clear();
+        for (size_t i = begin; i < end; ++i) {
+            const size_t document_index = static_cast<size_t>(
+                std::lower_bound(segment_document_ids_.begin(), segment_document_ids_.end(), document_ids_[i]) - segment_document_ids_.begin());
+            entries.push_back({ term_freqs_[i], segment_document_ratings_[document_index], document_ids_[i] });
+        }
+        std::sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) {
+            return std::tie(rhs.term_freq, rhs.rating, lhs.document_id) < std::tie(lhs.term_freq, lhs.rating, rhs.document_id);
+        });
+        for (size_t i = 0; i < entries.size(); ++i) {
+            impact_document_ids[begin + i] = entries[i].document_id;
+            impact_term_freqs[begin + i] = entries[i].term_freq;
+            impact_ratings[begin + i] = entries[i].rating;
+            if (i % IMPACT_BLOCK_SIZE == 0) {
+                impact_blocks.push_back({ entries[i].term_freq, entries[i].rating, entries[i].rating });
+            }
+            ImpactBlock& block = impact_blocks.back();
+            block.min_rating = std::min(block.min_rating, entries[i].rating);
+            block.max_rating = std::max(block.max_rating, entries[i].rating);
+        }
+        impact_blocks_begin.push_back(impact_blocks.size());
+    }
+    impact_document_ids_ = SegmentArray<int>(std::move(impact_document_ids));
+    impact_term_freqs_ = SegmentArray<double>(std::move(impact_term_freqs));
+    impact_ratings_ = SegmentArray<int>(std::move(impact_ratings));
+    impact_blocks_ = SegmentArray<ImpactBlock>(std::move(impact_blocks));
+    impact_blocks_begin_ = SegmentArray<size_t>(std::move(impact_blocks_begin));
+}
+
+IndexSegment::IndexSegment(const IndexSegment& other, std::shared_ptr<const void> mapping)
+    : sequence_(other.sequence_)
+    , terms_(other.terms_)
+    , segment_document_ids_(other.segment_document_ids_)
+    , segment_document_statuses_(other.segment_document_statuses_)
+    , segment_document_ratings_(other.segment_document_ratings_)
+    , mapping_(std::move(mapping)) {
+}
+
+uint64_t IndexSegment::GetSequence() const {
+    return sequence_;
+}
+
+const TermDictionary& IndexSegment::GetTerms() const {
+    return terms_;
+}
+
+size_t IndexSegment::GetPostingCount() const {
+    return document_ids_.size();
+}
+
+const std::vector<int>& IndexSegment::GetDocumentIds() const {
+    return segment_document_ids_;
+}
+
+const std::vector<int>& IndexSegment::GetDocumentRatings() const {
+    return segment_document_ratings_;
+}
+
+std::optional<DocumentStatus> IndexSegment::FindDocumentStatus(int document_id) const {
+    const auto it = std::lower_bound(segment_document_ids_.begin(), segment_document_ids_.end(), document_id);
+    if (it == segment_document_ids_.end() || *it != document_id) {
+        return std::nullopt;
+    }
+    return segment_document_statuses_[static_cast<size_t>(it - segment_document_ids_.begin())];
+}
+
+std::optional<int> IndexSegment::FindDocumentRating(int document_id) const {
+    const auto it = std::lower_bound(segment_document_ids_.begin(), segment_document_ids_.end(), document_id);
+    if (it == segment_document_ids_.end() || *it != document_id) {
+        return std::nullopt;
+    }
+    return segment_document_ratings_[static_cast<size_t>(it - segment_document_ids_.begin())];
+}
+
+IndexSegment::PostingList IndexSegment::GetPostings(size_t term_index) const {
+    const size_t begin = partitions_begin_[term_index * DOCUMENT_STATUS_COUNT];
+    const size_t end = partitions_begin_[(term_index + 1) * DOCUMENT_STATUS_COUNT];
+    return { document_ids_.data() + begin, term_freqs_.data() + begin, end - begin };
+}
+
+IndexSegment::PostingList IndexSegment::GetPostings(size_t term_index, DocumentStatus status) const {
+    const size_t partition = term_index * DOCUMENT_STATUS_COUNT + static_cast<size_t>(status);
+    const size_t begin = partitions_begin_[partition];
+    return { document_ids_.data() + begin, term_freqs_.data() + begin, partitions_begin_[partition + 1] - begin };
+}
+
+IndexSegment::PostingList IndexSegment::FindPostings(std::string_view term) const {
+    const TermDictionary::Cursor cursor = terms_.Seek(term);
+    if (!cursor.IsValid() || cursor.GetTerm() != term) {
+        return {};
+    }
+    return GetPostings(cursor.GetIndex());
+}
+
+IndexSegment::PostingList IndexSegment::FindPostings(std::string_view term, DocumentStatus status) const {
+    const TermDictionary::Cursor cursor = terms_.Seek(term);
+    if (!cursor.IsValid() || cursor.GetTerm() != term) {
+        return {};
+    }
+    return GetPostings(cursor.GetIndex(), status);
+}
+
+std::optional<size_t> IndexSegment::FindTermIndex(std::string_view term) const {
+    const TermDictionary::Cursor cursor = terms_.Seek(term);
+    if (!cursor.IsValid() || cursor.GetTerm() != term) {
+        return std::nullopt;
+    }
+    return cursor.GetIndex();
+}
+
+std::optional<double> IndexSegment::FindTermFreq(std::string_view term, int document_id) const {
+    const std::optional<size_t> term_index = FindTermIndex(term);
+    return term_index ? FindTermFreq(*term_index, document_id) : std::nullopt;
+}
+
+std::optional<double> IndexSegment::FindTermFreq(size_t term_index, int document_id) const {
+    const std::optional<DocumentStatus> status = FindDocumentStatus(document_id);
+    if (!status) {
+        return std::nullopt;
+    }
+    const PostingList postings = GetPostings(term_index, *status);
+    const int* const end = postings.document_ids + postings.size;
+    const int* const it = std::lower_bound(postings.document_ids, end, document_id);
+    if (it == end || *it != document_id) {
+        return std::nullopt;
+    }
+    return postings.term_freqs[it - postings.document_ids];
+}
+
+bool IndexSegment::HasImpactOrder() const {
+    return !impact_blocks_begin_.empty();
+}
+
+IndexSegment::ImpactList IndexSegment::FindImpactList(std::string_view term) const {
+    if (!HasImpactOrder()) {
+        return {};
+    }
+    const TermDictionary::Cursor cursor = terms_.Seek(term);
+    if (!cursor.IsValid() || cursor.GetTerm() != term) {
+        return {};
+    }
+    const size_t term_index = cursor.GetIndex();
+    const size_t begin = partitions_begin_[term_index * DOCUMENT_STATUS_COUNT];
+    const size_t end = partitions_begin_[(term_index + 1) * DOCUMENT_STATUS_COUNT];
+    return { impact_document_ids_.data() + begin, impact_term_freqs_.data() + begin, impact_ratings_.data() + begin,
+             impact_blocks_.data() + impact_blocks_begin_[term_index], end - begin };
+}
+
+IndexMemoryUsage IndexSegment::GetMemoryUsage() const {
+    IndexMemoryUsage usage;
+    usage.terms = terms_.GetMemoryUsage();
+    usage.postings = partitions_begin_.GetHeapBytes() + document_ids_.GetHeapBytes() + term_freqs_.GetHeapBytes()
+        + impact_document_ids_.GetHeapBytes() + impact_term_freqs_.GetHeapBytes() + impact_ratings_.GetHeapBytes()
+        + impact_blocks_.GetHeapBytes() + impact_blocks_begin_.GetHeapBytes();
+    usage.documents = GetVectorBytes(segment_document_ids_) + GetVectorBytes(segment_document_statuses_)
+        + GetVectorBytes(segment_document_ratings_);
+    if (IsSpilled()) {
+        usage.spilled_postings = partitions_begin_.size() * sizeof(size_t) + document_ids_.size() * (sizeof(int) + sizeof(double))
+            + impact_document_ids_.size() * (2 * sizeof(int) + sizeof(double)) + impact_blocks_.size() * sizeof(ImpactBlock)
+            + impact_blocks_begin_.size() * sizeof(size_t);
+    }
+    return usage;
+}
+
+std::shared_ptr<const IndexSegment> IndexSegment::Spill(const std::filesystem::path& directory) const {
+    static std::atomic<uint64_t> file_counter = 0;
+    const std::filesystem::path path = directory / ("segment-"s + std::to_string(file_io::GetProcessId()) + '-'
+                                                    + std::to_string(file_counter++) + ".spill"s);
+    const int fd = file_io::OpenFile(path, file_io::OpenMode::CREATE_NEW);
+
+    // Файл удаляется сразу после отображения: отображение остаётся действительным до munmap,
+    // а на Windows данные уже скопированы в кучу
+    const auto discard_file = [fd, &path] {
+        file_io::CloseFile(fd);
+        std::filesystem::remove(path);
+    };
+
+    // Массивы записываются подряд, каждый с выравниванием 8 байт
+    size_t file_size = 0;
+    const auto write_array = [fd, &file_size, &discard_file](const auto& array) {
+        using Value = std::remove_cvref_t<decltype(array[0])>;
+        static_assert(alignof(Value) <= 8);
+        file_size = (file_size + 7) / 8 * 8;
+        const size_t offset = file_size;
+        const size_t size = array.size() * sizeof(Value);
+        try {
+            file_io::WriteAt(fd, std::string_view(reinterpret_cast<const char*>(array.data()), size), offset);
+        } catch (...) {
+            discard_file();
+            throw;
+        }
+        file_size += size;
+        return offset;
+    };
+    const size_t partitions_begin_offset = write_array(partitions_begin_);
+    const size_t document_ids_offset = write_array(document_ids_);
+    const size_t term_freqs_offset = write_array(term_freqs_);
+    const size_t impact_document_ids_offset = write_array(impact_document_ids_);
+    const size_t impact_term_freqs_offset = write_array(impact_term_freqs_);
+    const size_t impact_ratings_offset = write_array(impact_ratings_);
+    const size_t impact_blocks_offset = write_array(impact_blocks_);
+    const size_t impact_blocks_begin_offset = write_array(impact_blocks_begin_);
+
+    std::shared_ptr<const void> mapping;
+    try {
+        mapping = file_io::MapReadOnly(fd, file_size);
+    } catch (...) {
+        discard_file();
+        throw;
+    }
+    discard_file();
+
+    const char* const base = static_cast<const char*>(mapping.get());
+    std::shared_ptr<IndexSegment> spilled(new IndexSegment(*this, mapping));
+    const auto map = [base](auto& target, const auto& source, size_t offset) {
+        using Value = std::remove_cvref_t<decltype(source[0])>;
+        target.Map(reinterpret_cast<const Value*>(base + offset), source.size());
+    };
+    map(spilled->partitions_begin_, partitions_begin_, partitions_begin_offset);
+    map(spilled->document_ids_, document_ids_, document_ids_offset);
+    map(spilled->term_freqs_, term_freqs_, term_freqs_offset);
+    map(spilled->impact_document_ids_, impact_document_ids_, impact_document_ids_offset);
+    map(spilled->impact_term_freqs_, impact_term_freqs_, impact_term_freqs_offset);
+    map(spilled->impact_ratings_, impact_ratings_, impact_ratings_offset);
+    map(spilled->impact_blocks_, impact_blocks_, impact_blocks_offset);
+    map(spilled->impact_blocks_begin_, impact_blocks_begin_, impact_blocks_begin_offset);
+    return spilled;
+}
+
+bool IndexSegment::IsSpilled() const {
+    return mapping_ != nullptr;
+}
+
+IndexMemoryUsage& IndexMemoryUsage::operator+=(const IndexMemoryUsage& other) {
+    terms += other.terms;
+    postings += other.postings;
+    documents += other.documents;
+    spilled_postings += other.spilled_postings;
+    return *this;
+}
+
+double IndexStats::GetWriteAmplification() const {
+    return postings_added == 0 ? 0.0 : static_cast<double>(postings_written) / static_cast<double>(postings_added);
+}
+
+SegmentedIndex::SegmentedIndex(SegmentOptions options)
+    : options_(options) {
+    options_.max_mutable_postings = std::max<size_t>(options_.max_mutable_postings, 1);
+    options_.merge_factor = std::max<size_t>(options_.merge_factor, 2);
+}
+
+SegmentedIndex::SegmentedIndex(const SegmentedIndex& other)
+    : options_(other.options_)
+    , segments_(other.segments_)
+    , mutable_(other.mutable_)
+    , tombstones_(other.tombstones_)
+    , status_overrides_(other.status_overrides_)
+    , rating_overrides_(other.rating_overrides_)
+    , next_sequence_(other.next_sequence_)
+    , postings_added_(other.postings_added_)
+    , postings_written_(other.postings_written_)
+    , merge_count_(other.merge_count_) {
+}
+
+SegmentedIndex& SegmentedIndex::operator=(const SegmentedIndex& other) {
+    if (this != &other) {
+        *this = SegmentedIndex(other);
+    }
+    return *this;
+}
+
+void SegmentedIndex::AddDocument(int document_id, DocumentStatus status, int rating,
+                                 const std::unordered_map<std::string_view, double>& term_freqs) {
+    CommitFinishedMerge(false);
+    mutable_.documents.emplace(document_id, MutableDocument{ status, rating });
+    for (const auto& [ word, term_freq ] : term_freqs) {
+        auto it = mutable_.word_to_document_freqs.find(word);
+        if (it == mutable_.word_to_document_freqs.end()) {
+            it = mutable_.word_to_document_freqs.emplace(std::string(word), std::vector<std::pair<int, double>>{}).first;
+            mutable_.term_heap_bytes += GetStringHeapBytes(it->first);
+        }
+        const size_t capacity = it->second.capacity();
+        it->second.emplace_back(document_id, term_freq);
+        mutable_.posting_heap_bytes += (it->second.capacity() - capacity) * sizeof(std::pair<int, double>);
+    }
+    mutable_.posting_count += term_freqs.size();
+    postings_added_ += term_freqs.size();
+    if (mutable_.posting_count >= options_.max_mutable_postings) {
+        Freeze();
+    }
+}
+
+void SegmentedIndex::RemoveDocument(int document_id) {
+    CommitFinishedMerge(false);
+    if (mutable_.documents.erase(document_id)) {
+        mutable_.term_heap_bytes = 0;
+        mutable_.posting_heap_bytes = 0;
+        for (auto it = mutable_.word_to_document_freqs.begin(); it != mutable_.word_to_document_freqs.end();) {
+            mutable_.posting_count -= std::erase_if(it->second, [document_id](const auto& posting) {
+                return posting.first == document_id;
+            });
+            if (it->second.empty()) {
+                it = mutable_.word_to_document_freqs.erase(it);
+            } else {
+                mutable_.term_heap_bytes += GetStringHeapBytes(it->first);
+                mutable_.posting_heap_bytes += GetVectorBytes(it->second);
+                ++it;
+            }
+        }
+        return;
+    }
+    // Скрывает документ во всех уже замороженных сегментах, но не в тех, что будут заморожены позже
+    tombstones_[document_id] = next_sequence_;
+    status_overrides_.erase(document_id);
+    rating_overrides_.erase(document_id);
+}
+
+void SegmentedIndex::SetDocumentStatus(int document_id, DocumentStatus status) {
+    CommitFinishedMerge(false);
+    if (const auto it = mutable_.documents.find(document_id); it != mutable_.documents.end()) {
+        it->second.status = status;
+        return;
+    }
+    // Пока слияние пишет документ со сменой статуса из снимка, смена остаётся: при фиксации слияния
+    // она сверяется со статусом в слитом сегменте
+    const IndexSegment* segment = FindLiveSegment(document_id);
+    if (segment && segment->FindDocumentStatus(document_id) == status && !pending_merge_overrides_.contains(document_id)) {
+        status_overrides_.erase(document_id);
+    } else {
+        status_overrides_[document_id] = status;
+    }
+}
+
+void SegmentedIndex::SetDocumentRating(int document_id, int rating) {
+    CommitFinishedMerge(false);
+    if (const auto it = mutable_.documents.find(document_id); it != mutable_.documents.end()) {
+        it->second.rating = rating;
+        return;
+    }
+    const IndexSegment* segment = FindLiveSegment(document_id);
+    if (segment && segment->FindDocumentRating(document_id) == rating && !pending_merge_rating_overrides_.contains(document_id)) {
+        rating_overrides_.erase(document_id);
+    } else {
+        rating_overrides_[document_id] = rating;
+    }
+}
+
+bool SegmentedIndex::HasRatingOverrides() const {
+    return !rating_overrides_.empty();
+}
+
+int SegmentedIndex::GetDocumentFreq(std::string_view word) const {
+    size_t document_freq = 0;
+    for (const auto& segment : segments_) {
+        const IndexSegment::PostingList postings = segment->FindPostings(word);
+        if (tombstones_.empty()) {
+            document_freq += postings.size;
+            continue;
+        }
+        for (size_t i = 0; i < postings.size; ++i) {
+            document_freq += !IsDeleted(postings.document_ids[i], *segment);
+        }
+    }
+    const auto it = mutable_.word_to_document_freqs.find(word);
+    if (it != mutable_.word_to_document_freqs.end()) {
+        document_freq += it->second.size();
+    }
+    return static_cast<int>(document_freq);
+}
+
+SegmentedIndex::SortedPostings SegmentedIndex::GetSortedPostings(std::string_view word, std::optional<DocumentStatus> status) const {
+    SortedPostings postings;
+    postings.index_ = this;
+    postings.check_tombstones_ = !tombstones_.empty();
+    postings.check_overrides_ = status && !status_overrides_.empty();
+    for (const auto& segment : segments_) {
+        const std::optional<size_t> term_index = segment->FindTermIndex(word);
+        if (!term_index) {
+            continue;
+        }
+        for (size_t i = 0; i < DOCUMENT_STATUS_COUNT; ++i) {
+            if (status && static_cast<size_t>(*status) != i) {
+                continue;
+            }
+            const IndexSegment::PostingList list = segment->GetPostings(*term_index, static_cast<DocumentStatus>(i));
+            if (list.size > 0) {
+                postings.lists_.push_back({ list.document_ids, list.term_freqs, list.size, segment.get() });
+            }
+        }
+    }
+
+    std::vector<std::pair<int, double>> copied;
+    if (status) {
+        // Документы, сменившие статус после заморозки, лежат в части прежнего статуса
+        for (const auto& [ document_id, current_status ] : status_overrides_) {
+            if (current_status != *status) {
+                continue;
+            }
+            if (const IndexSegment* segment = FindLiveSegment(document_id)) {
+                if (const std::optional<double> term_freq = segment->FindTermFreq(word, document_id)) {
+                    copied.emplace_back(document_id, *term_freq);
+                }
+            }
+        }
+    }
+    const auto it = mutable_.word_to_document_freqs.find(word);
+    if (it != mutable_.word_to_document_freqs.end()) {
+        for (const auto& [ document_id, term_freq ] : it->second) {
+            if (!status || mutable_.documents.at(document_id).status == *status) {
+                copied.emplace_back(document_id, term_freq);
+            }
+        }
+    }
+    if (!copied.empty()) {
+        if (!std::is_sorted(copied.begin(), copied.end())) {
+            std::sort(copied.begin(), copied.end());
+        }
+        postings.copied_document_ids_.reserve(copied.size());
+        postings.copied_term_freqs_.reserve(copied.size());
+        for (const auto& [ document_id, term_freq ] : copied) {
+            postings.copied_document_ids_.push_back(document_id);
+            postings.copied_term_freqs_.push_back(term_freq);
+        }
+        postings.lists_.push_back({ postings.copied_document_ids_.data(), postings.copied_term_freqs_.data(), copied.size(), nullptr });
+    }
+    return postings;
+}
+
+std::optional<double> SegmentedIndex::FindTermFreq(std::string_view word, int document_id) const {
+    if (mutable_.documents.contains(document_id)) {
+        const auto it = mutable_.word_to_document_freqs.find(word);
+        if (it == mutable_.word_to_document_freqs.end()) {
+            return std::nullopt;
+        }
+        const auto posting_it = std::find_if(it->second.begin(), it->second.end(), [document_id](const auto& posting) {
+            return posting.first == document_id;
+        });
+        return posting_it == it->second.end() ? std::nullopt : std::optional(posting_it->second);
+    }
+    const IndexSegment* segment = FindLiveSegment(document_id);
+    return segment ? segment->FindTermFreq(word, document_id) : std::nullopt;
+}
+
+std::optional<double> SegmentedIndex::TermLookup::FindTermFreq(int document_id, const DocumentLocation& location) const {
+    if (location.is_mutable) {
+        if (!mutable_postings_) {
+            return std::nullopt;
+        }
+        const auto it = std::find_if(mutable_postings_->begin(), mutable_postings_->end(), [document_id](const auto& posting) {
+            return posting.first == document_id;
+        });
+        return it == mutable_postings_->end() ? std::nullopt : std::optional(it->second);
+    }
+    if (!location.segment_index || !term_indexes_[*location.segment_index]) {
+        return std::nullopt;
+    }
+    return index_->segments_[*location.segment_index]->FindTermFreq(*term_indexes_[*location.segment_index], document_id);
+}
+
+SegmentedIndex::DocumentLocation SegmentedIndex::LocateDocument(int document_id) const {
+    if (mutable_.documents.contains(document_id)) {
+        return { true, std::nullopt };
+    }
+    return { false, FindLiveSegmentIndex(document_id) };
+}
+
+SegmentedIndex::TermLookup SegmentedIndex::LookupTerm(std::string_view word) const {
+    TermLookup lookup;
+    lookup.index_ = this;
+    lookup.term_indexes_.reserve(segments_.size());
+    for (const auto& segment : segments_) {
+        lookup.term_indexes_.push_back(segment->FindTermIndex(word));
+    }
+    const auto it = mutable_.word_to_document_freqs.find(word);
+    if (it != mutable_.word_to_document_freqs.end()) {
+        lookup.mutable_postings_ = &it->second;
+    }
+    return lookup;
+}
+
+bool SegmentedIndex::IsImpactOrdered() const {
+    return options_.impact_ordered;
+}
+
+std::vector<IndexSegment::ImpactList> SegmentedIndex::FindImpactLists(std::string_view word) const {
+    std::vector<IndexSegment::ImpactList> lists;
+    for (const auto& segment : segments_) {
+        const IndexSegment::ImpactList list = segment->FindImpactList(word);
+        if (list.size > 0) {
+            lists.push_back(list);
+        }
+    }
+    return lists;
+}
+
+std::vector<std::string> SegmentedIndex::ExpandPattern(std::string_view pattern, size_t max_count) const {
+    // Первые max_count терминов каждого сегмента содержат все термины из первых max_count общего результата
+    std::vector<std::string> terms;
+    for (const auto& segment : segments_) {
+        for (std::string& term : segment->GetTerms().ExpandPattern(pattern, max_count)) {
+            terms.push_back(std::move(term));
+        }
+    }
+    const std::string_view prefix = pattern.substr(0, pattern.find_first_of("*?"));
+    for (const auto& [term, _] : mutable_.word_to_document_freqs) {
+        if (term.starts_with(prefix) && MatchesWildcard(term, pattern)) {
+            terms.push_back(term);
+        }
+    }
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    if (terms.size() > max_count) {
+        terms.resize(max_count);
+    }
+    return terms;
+}
+
+std::vector<FuzzyMatch> SegmentedIndex::ExpandFuzzy(std::string_view word, int max_distance, size_t max_count,
+                                                    std::string_view term_prefix) const {
+    // Расстояние зависит только от термина, поэтому лучшие max_count каждого сегмента содержат все лучшие общие
+    std::vector<FuzzyMatch> matches;
+    for (const auto& segment : segments_) {
+        for (FuzzyMatch& match : segment->GetTerms().ExpandFuzzy(word, max_distance, max_count, term_prefix)) {
+            matches.push_back(std::move(match));
+        }
+    }
+    for (const auto& [term, _] : mutable_.word_to_document_freqs) {
+        if (!term.starts_with(term_prefix)) {
+            continue;
+        }
+        const int distance = ComputeEditDistance(std::string_view(term).substr(term_prefix.size()), word, max_distance);
+        if (distance <= max_distance) {
+            matches.push_back({ term, distance });
+        }
+    }
+    std::sort(matches.begin(), matches.end(), [](const FuzzyMatch& lhs, const FuzzyMatch& rhs) {
+        return std::tie(lhs.distance, lhs.term) < std::tie(rhs.distance, rhs.term);
+    });
+    matches.erase(std::unique(matches.begin(), matches.end(), [](const FuzzyMatch& lhs, const FuzzyMatch& rhs) {
+        return lhs.term == rhs.term;
+    }), matches.end());
+    if (matches.size() > max_count) {
+        matches.resize(max_count);
+    }
+    return matches;
+}
+
+void SegmentedIndex::WaitForMerges() {
+    while (pending_merge_.valid()) {
+        CommitFinishedMerge(true);
+    }
+}
+
+IndexStats SegmentedIndex::GetStats() const {
+    IndexStats stats;
+    for (const auto& segment : segments_) {
+        SegmentStats& segment_stats = stats.segments.emplace_back();
+        segment_stats.sequence = segment->GetSequence();
+        segment_stats.term_count = segment->GetTerms().GetSize();
+        segment_stats.posting_count = segment->GetPostingCount();
+        segment_stats.document_count = segment->GetDocumentIds().size();
+        segment_stats.deleted_document_count = static_cast<size_t>(std::count_if(
+            segment->GetDocumentIds().begin(), segment->GetDocumentIds().end(), [this, &segment](int document_id) {
+                return IsDeleted(document_id, *segment);
+            }));
+        const IndexMemoryUsage memory_usage = segment->GetMemoryUsage();
+        segment_stats.memory_bytes = memory_usage.terms + memory_usage.postings + memory_usage.documents;
+        segment_stats.is_spilled = segment->IsSpilled();
+    }
+    stats.mutable_posting_count = mutable_.posting_count;
+    stats.mutable_document_count = mutable_.documents.size();
+    stats.status_override_count = status_overrides_.size();
+    stats.rating_override_count = rating_overrides_.size();
+    stats.postings_added = postings_added_;
+    stats.postings_written = postings_written_;
+    stats.merge_count = merge_count_;
+    return stats;
+}
+
+IndexMemoryUsage SegmentedIndex::GetMemoryUsage() const {
+    IndexMemoryUsage usage;
+    for (const auto& segment : segments_) {
+        usage += segment->GetMemoryUsage();
+    }
+    usage.terms += GetHashTableBytes(mutable_.word_to_document_freqs) + mutable_.term_heap_bytes;
+    usage.postings += mutable_.posting_heap_bytes;
+    usage.documents += GetHashTableBytes(mutable_.documents) + GetHashTableBytes(tombstones_) + GetHashTableBytes(status_overrides_)
+        + GetHashTableBytes(pending_merge_overrides_) + GetHashTableBytes(rating_overrides_)
+        + GetHashTableBytes(pending_merge_rating_overrides_);
+    return usage;
+}
+
+size_t SegmentedIndex::SpillSegments(const std::filesystem::path& directory) {
+    CommitFinishedMerge(false);
+    if (mutable_.posting_count > 0) {
+        Freeze();
+    }
+    size_t freed_bytes = 0;
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        const bool is_merging = pending_merge_.valid() && i >= pending_merge_begin_ && i < pending_merge_begin_ + pending_merge_size_;
+        if (is_merging || segments_[i]->IsSpilled()) {
+            continue;
+        }
+        freed_bytes += segments_[i]->GetMemoryUsage().postings;
+        segments_[i] = segments_[i]->Spill(directory);
+    }
+    return freed_bytes;
+}
+
+bool SegmentedIndex::IsDeleted(int document_id, const IndexSegment& segment) const {
+    return IsHidden(tombstones_, document_id, segment.GetSequence());
+}
+
+const IndexSegment* SegmentedIndex::FindLiveSegment(int document_id) const {
+    const std::optional<size_t> segment_index = FindLiveSegmentIndex(document_id);
+    return segment_index ? segments_[*segment_index].get() : nullptr;
+}
+
+std::optional<size_t> SegmentedIndex::FindLiveSegmentIndex(int document_id) const {
+    // Действующая копия - в самом новом сегменте, где документ есть: более старые копии скрыты отметками
+    for (size_t i = segments_.size(); i-- > 0;) {
+        const std::vector<int>& document_ids = segments_[i]->GetDocumentIds();
+        if (std::binary_search(document_ids.begin(), document_ids.end(), document_id)) {
+            return IsDeleted(document_id, *segments_[i]) ? std::nullopt : std::optional(i);
+        }
+    }
+    return std::nullopt;
+}
+
+void SegmentedIndex::Freeze() {
+    using Entry = std::pair<std::string_view, std::vector<std::pair<int, double>>*>;
+    std::vector<Entry> entries;
+    entries.reserve(mutable_.word_to_document_freqs.size());
+    for (auto& [word, postings] : mutable_.word_to_document_freqs) {
+        entries.emplace_back(word, &postings);
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) {
+        return lhs.first < rhs.first;
+    });
+
+    std::vector<std::string_view> terms;
+    terms.reserve(entries.size());
+    std::vector<size_t> partitions_begin{ 0 };
+    partitions_begin.reserve(entries.size() * DOCUMENT_STATUS_COUNT + 1);
+    std::vector<int> document_ids;
+    std::vector<double> term_freqs;
+    document_ids.reserve(mutable_.posting_count);
+    term_freqs.reserve(mutable_.posting_count);
+    std::vector<StatusPosting> status_postings;
+    for (auto& [term, postings] : entries) {
+        terms.push_back(term);
+        status_postings.clear();
+        for (const auto& [ document_id, term_freq ] : *postings) {
+            status_postings.push_back({ mutable_.documents.at(document_id).status, document_id, term_freq });
+        }
+        std::sort(status_postings.begin(), status_postings.end());
+        AppendPartitions(status_postings, partitions_begin, document_ids, term_freqs);
+    }
+    std::vector<std::pair<int, int>> document_ratings;
+    document_ratings.reserve(mutable_.documents.size());
+    for (const auto& [ document_id, document ] : mutable_.documents) {
+        document_ratings.emplace_back(document_id, document.rating);
+    }
+    std::sort(document_ratings.begin(), document_ratings.end());
+
+    postings_written_ += document_ids.size();
+    segments_.push_back(std::make_shared<const IndexSegment>(next_sequence_++, terms, std::move(partitions_begin),
+                                                             std::move(document_ids), std::move(term_freqs), document_ratings,
+                                                             options_.impact_ordered));
+    mutable_ = MutableSegment{};
+    MaybeStartMerge();
+}
+
+void SegmentedIndex::CommitFinishedMerge(bool wait) {
+    if (!pending_merge_.valid()) {
+        return;
+    }
+    if (!wait && pending_merge_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+    std::shared_ptr<const IndexSegment> merged = pending_merge_.get();
+    const auto begin = segments_.begin() + static_cast<std::ptrdiff_t>(pending_merge_begin_);
+    segments_.erase(begin, begin + static_cast<std::ptrdiff_t>(pending_merge_size_));
+    segments_.insert(segments_.begin() + static_cast<std::ptrdiff_t>(pending_merge_begin_), merged);
+    postings_written_ += merged->GetPostingCount();
+    ++merge_count_;
+
+    // Смена статуса больше не нужна, если слитый сегмент с действующей копией документа уже записан с текущим статусом
+    for (const auto& [ document_id, applied_status ] : pending_merge_overrides_) {
+        const auto it = status_overrides_.find(document_id);
+        if (it != status_overrides_.end() && it->second == applied_status && !IsDeleted(document_id, *merged)
+            && merged->FindDocumentStatus(document_id) == applied_status) {
+            status_overrides_.erase(it);
+        }
+    }
+    pending_merge_overrides_.clear();
+    for (const auto& [ document_id, applied_rating ] : pending_merge_rating_overrides_) {
+        const auto it = rating_overrides_.find(document_id);
+        if (it != rating_overrides_.end() && it->second == applied_rating && !IsDeleted(document_id, *merged)
+            && merged->FindDocumentRating(document_id) == applied_rating) {
+            rating_overrides_.erase(it);
+        }
+    }
+    pending_merge_rating_overrides_.clear();
+
+    // Отметка не нужна, если не осталось сегментов старше неё
+    const uint64_t oldest_sequence = segments_.front()->GetSequence();
+    std::erase_if(tombstones_, [oldest_sequence](const auto& tombstone) {
+        return tombstone.second <= oldest_sequence;
+    });
+    MaybeStartMerge();
+}
+
+void SegmentedIndex::MaybeStartMerge() {
+    const size_t merge_factor = options_.merge_factor;
+    if (pending_merge_.valid() || segments_.size() < merge_factor) {
+        return;
+    }
+    // Ярус: 0 - до max_mutable_postings * merge_factor записей, дальше каждый ярус в merge_factor раз больше
+    const auto get_tier = [this, merge_factor](const IndexSegment& segment) {
+        int tier = 0;
+        for (size_t limit = options_.max_mutable_postings * merge_factor; segment.GetPostingCount() >= limit; limit *= merge_factor) {
+            ++tier;
+        }
+        return tier;
+    };
+    // Сливается самый младший ярус, в котором есть merge_factor соседних сегментов (из таких - самые старые)
+    std::vector<int> tiers;
+    for (const auto& segment : segments_) {
+        tiers.push_back(get_tier(*segment));
+    }
+    std::optional<size_t> best_begin;
+    for (size_t begin = 0; begin + merge_factor <= tiers.size(); ++begin) {
+        const bool is_same_tier = std::all_of(tiers.begin() + static_cast<std::ptrdiff_t>(begin),
+                                              tiers.begin() + static_cast<std::ptrdiff_t>(begin + merge_factor),
+                                              [tier = tiers[begin]](int other) { return other == tier; });
+        if (is_same_tier && (!best_begin || tiers[begin] < tiers[*best_begin])) {
+            best_begin = begin;
+        }
+    }
+    if (!best_begin) {
+        return;
+    }
+    const size_t begin = *best_begin;
+    std::vector<std::shared_ptr<const IndexSegment>> inputs(segments_.begin() + static_cast<std::ptrdiff_t>(begin),
+                                                            segments_.begin() + static_cast<std::ptrdiff_t>(begin + merge_factor));
+
+    pending_merge_begin_ = begin;
+    pending_merge_size_ = merge_factor;
+    const auto is_merged = [&inputs](int document_id) {
+        return std::any_of(inputs.begin(), inputs.end(), [document_id](const auto& input) {
+            return std::binary_search(input->GetDocumentIds().begin(), input->GetDocumentIds().end(), document_id);
+        });
+    };
+    pending_merge_overrides_.clear();
+    for (const auto& [ document_id, status ] : status_overrides_) {
+        if (is_merged(document_id)) {
+            pending_merge_overrides_.emplace(document_id, status);
+        }
+    }
+    pending_merge_rating_overrides_.clear();
+    for (const auto& [ document_id, rating ] : rating_overrides_) {
+        if (is_merged(document_id)) {
+            pending_merge_rating_overrides_.emplace(document_id, rating);
+        }
+    }
+    if (options_.background_merge) {
+        pending_merge_ = std::async(std::launch::async, MergeSegments, std::move(inputs), tombstones_, pending_merge_overrides_,
+                                    pending_merge_rating_overrides_, options_.impact_ordered);
+    } else {
+        std::promise<std::shared_ptr<const IndexSegment>> merged;
+        merged.set_value(MergeSegments(std::move(inputs), tombstones_, pending_merge_overrides_, pending_merge_rating_overrides_,
+                                       options_.impact_ordered));
+        pending_merge_ = merged.get_future();
+        CommitFinishedMerge(true);
+    }
+}
+
+}; // namespace segmented_index
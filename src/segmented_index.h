@@ -0,0 +1,479 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "memory_usage.h"
+#include "string_processing.h"
+#include "term_dictionary.h"
+
+
+namespace segmented_index {
+
+using namespace document;
+using namespace memory_usage;
+using namespace string_processing;
+using namespace term_dictionary;
+
+// Массив записей сегмента: в куче (std::vector) или в отображённом в память файле сброшенного на диск сегмента
+template <typename T>
+class SegmentArray {
+public:
+    SegmentArray() = default;
+    explicit SegmentArray(std::vector<T> values)
+        : values_(std::move(values))
+        , data_(values_.data())
+        , size_(values_.size()) {
+    }
+
+    // Указывает на внешнюю память; владелец памяти должен пережить массив
+    void Map(const T* data, size_t size) {
+        values_ = std::vector<T>();
+        data_ = data;
+        size_ = size;
+    }
+
+    SegmentArray(const SegmentArray&) = delete;
+    SegmentArray& operator=(const SegmentArray&) = delete;
+    SegmentArray(SegmentArray&&) = default;
+    SegmentArray& operator=(SegmentArray&&) = default;
+
+    const T* data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    const T& operator[](size_t index) const {
+        return data_[index];
+    }
+
+    // Байт в куче; у отображённого массива - 0
+    size_t GetHeapBytes() const {
+        return values_.capacity() * sizeof(T);
+    }
+
+private:
+    std::vector<T> values_;
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Память индекса по структурам, в байтах
+struct IndexMemoryUsage {
+    size_t terms = 0;            // словари терминов сегментов и термины изменяемого сегмента
+    size_t postings = 0;         // списки документов в куче
+    size_t documents = 0;        // таблицы документов сегментов, отметки удалений и смен статуса
+    size_t spilled_postings = 0; // списки документов сброшенных на диск сегментов: отображены в память и не занимают кучу
+
+    IndexMemoryUsage& operator+=(const IndexMemoryUsage& other);
+};
+
+// Неизменяемый сегмент индекса: front-coded словарь терминов и списки документов терминов.
+// Список термина разбит на части по статусу документа, внутри части ID идут по возрастанию,
+// поэтому запрос с фильтром по статусу читает только нужную часть.
+// По желанию сегмент хранит вторую копию списков в порядке убывания TF (при равенстве - рейтинга)
+// с блочными сводками: наибольший TF и диапазон рейтингов блока из IMPACT_BLOCK_SIZE записей.
+// sequence - порядковый номер заморозки; у слитого сегмента - наибольший из номеров исходных
+class IndexSegment {
+public:
+    static constexpr size_t IMPACT_BLOCK_SIZE = 16;
+
+    // Документы одного термина: ID по возрастанию (в пределах статуса) и соответствующие TF
+    struct PostingList {
+        const int* document_ids = nullptr;
+        const double* term_freqs = nullptr;
+        size_t size = 0;
+    };
+
+    struct ImpactBlock {
+        double max_term_freq = 0;
+        int min_rating = 0;
+        int max_rating = 0;
+    };
+
+    // Документы термина по убыванию TF с их рейтингами; блок i описывает записи i * IMPACT_BLOCK_SIZE..(i + 1) * IMPACT_BLOCK_SIZE
+    struct ImpactList {
+        const int* document_ids = nullptr;
+        const double* term_freqs = nullptr;
+        const int* ratings = nullptr;
+        const ImpactBlock* blocks = nullptr;
+        size_t size = 0;
+    };
+
+    // terms - отсортированные термины; документы i-го термина со статусом s лежат в
+    // partitions_begin[i * DOCUMENT_STATUS_COUNT + s]..partitions_begin[i * DOCUMENT_STATUS_COUNT + s + 1].
+    // document_ratings - пары (ID, рейтинг) по возрастанию ID, в них есть все документы сегмента
+    IndexSegment(uint64_t sequence, const std::vector<std::string_view>& terms, std::vector<size_t> partitions_begin,
+                 std::vector<int> document_ids, std::vector<double> term_freqs,
+                 const std::vector<std::pair<int, int>>& document_ratings, bool impact_ordered);
+
+    uint64_t GetSequence() const;
+    const TermDictionary& GetTerms() const;
+    size_t GetPostingCount() const;
+
+    // ID документов сегмента по возрастанию и их рейтинги
+    const std::vector<int>& GetDocumentIds() const;
+    const std::vector<int>& GetDocumentRatings() const;
+
+    // Статус, с которым документ записан в сегмент, если документ в сегменте есть
+    std::optional<DocumentStatus> FindDocumentStatus(int document_id) const;
+
+    // Рейтинг, с которым документ записан в сегмент, если документ в сегменте есть
+    std::optional<int> FindDocumentRating(int document_id) const;
+
+    // Все документы термина, по частям статусов
+    PostingList GetPostings(size_t term_index) const;
+    PostingList GetPostings(size_t term_index, DocumentStatus status) const;
+
+    // Пустой список, если термина в сегменте нет
+    PostingList FindPostings(std::string_view term) const;
+    PostingList FindPostings(std::string_view term, DocumentStatus status) const;
+
+    // Номер термина в словаре сегмента
+    std::optional<size_t> FindTermIndex(std::string_view term) const;
+
+    // TF термина в документе, если документ с таким термином в сегменте есть
+    std::optional<double> FindTermFreq(std::string_view term, int document_id) const;
+    std::optional<double> FindTermFreq(size_t term_index, int document_id) const;
+
+    bool HasImpactOrder() const;
+
+    // Пустой список, если термина в сегменте нет или сегмент без порядка по TF
+    ImpactList FindImpactList(std::string_view term) const;
+
+    IndexMemoryUsage GetMemoryUsage() const;
+
+    // Копия сегмента, списки документов которой записаны в файл в directory и отображены в память (на Windows - копия в куче).
+    // Файл удаляется сразу после отображения и исчезает вместе с последней копией сегмента. Ошибки - std::system_error
+    std::shared_ptr<const IndexSegment> Spill(const std::filesystem::path& directory) const;
+
+    bool IsSpilled() const;
+
+private:
+    uint64_t sequence_;
+    TermDictionary terms_;
+    SegmentArray<size_t> partitions_begin_;
+    SegmentArray<int> document_ids_;
+    SegmentArray<double> term_freqs_;
+    std::vector<int> segment_document_ids_;
+    std::vector<DocumentStatus> segment_document_statuses_; // статусы документов segment_document_ids_
+    std::vector<int> segment_document_ratings_;
+    // Списки по убыванию TF: записи по тем же смещениям, что и основные, блоки i-го термина начинаются с impact_blocks_begin_[i]
+    SegmentArray<int> impact_document_ids_;
+    SegmentArray<double> impact_term_freqs_;
+    SegmentArray<int> impact_ratings_;
+    SegmentArray<ImpactBlock> impact_blocks_;
+    SegmentArray<size_t> impact_blocks_begin_;
+    std::shared_ptr<const void> mapping_; // отображённый файл сброшенного сегмента
+
+    // Сегмент с таблицей документов и словарём other, массивы записей отображаются из файла в Spill
+    IndexSegment(const IndexSegment& other, std::shared_ptr<const void> mapping);
+
+    void BuildImpactOrder();
+};
+
+// Настройки сегментов, задаются через IndexOptions
+struct SegmentOptions {
+    size_t max_mutable_postings = 1 << 16; // изменяемый сегмент замораживается, когда в нём столько записей (слово, документ)
+    size_t merge_factor = 4;               // сливаются merge_factor соседних сегментов одного яруса размера (ярусы растут в merge_factor раз)
+    bool background_merge = true;          // сливать в фоновом потоке (иначе - сразу при заморозке)
+    bool impact_ordered = false;           // хранить копию списков по убыванию TF для досрочной остановки top-K (+16 байт на запись)
+};
+
+struct SegmentStats {
+    uint64_t sequence = 0;
+    size_t term_count = 0;
+    size_t posting_count = 0;
+    size_t document_count = 0;
+    size_t deleted_document_count = 0; // документы, удалённые после заморозки и ещё не вычищенные слиянием
+    size_t memory_bytes = 0;           // куча, без отображённых списков сброшенного сегмента
+    bool is_spilled = false;
+};
+
+struct IndexStats {
+    std::vector<SegmentStats> segments; // от старых к новым
+    size_t mutable_posting_count = 0;
+    size_t mutable_document_count = 0;
+    size_t status_override_count = 0; // документы, сменившие статус после заморозки и ещё не переписанные слиянием
+    size_t rating_override_count = 0; // то же для рейтинга
+    uint64_t postings_added = 0;   // записей (слово, документ), добавленных в индекс
+    uint64_t postings_written = 0; // записей, записанных в сегменты заморозкой и слияниями
+    size_t merge_count = 0;
+
+    // Усиление записи: сколько раз в среднем каждая запись переписывалась в сегменты
+    double GetWriteAmplification() const;
+};
+
+// Сегментированный индекс в духе LSM: небольшой изменяемый сегмент принимает новые документы и при заполнении
+// замораживается в неизменяемый отсортированный сегмент. Соседние сегменты одного яруса размера сливаются в фоне.
+// Удаление документа из неизменяемого сегмента - отметка (tombstone), документ вычищается при слиянии.
+// Смена статуса документа в неизменяемом сегменте тоже запоминается отдельно и переносит его записи
+// в часть нового статуса при слиянии.
+// Все методы вызываются из одного потока-владельца, константные можно вызывать параллельно между собой.
+// Фоновое слияние работает только с неизменяемыми сегментами; результат подменяет исходные сегменты
+// при следующем изменении индекса или в WaitForMerges
+class SegmentedIndex {
+public:
+    // Где лежит действующая копия документа
+    struct DocumentLocation {
+        bool is_mutable = false;
+        std::optional<size_t> segment_index; // номер неизменяемого сегмента
+    };
+
+    // Слово, заранее найденное в словарях всех сегментов: поиск TF многих документов без повторного поиска термина.
+    // Действует, пока индекс не изменён
+    class TermLookup {
+    public:
+        std::optional<double> FindTermFreq(int document_id, const DocumentLocation& location) const;
+
+    private:
+        friend class SegmentedIndex;
+
+        const SegmentedIndex* index_ = nullptr;
+        std::vector<std::optional<size_t>> term_indexes_; // номер термина в словаре каждого сегмента
+        const std::vector<std::pair<int, double>>* mutable_postings_ = nullptr;
+    };
+
+    // Записи слова, разложенные на списки с ID по возрастанию: части статусов неизменяемых сегментов и отсортированная
+    // копия записей изменяемого сегмента (при фильтре по статусу - и документов, сменивших статус после заморозки).
+    // Действующие записи всех списков - те же, что у ForEachPosting. Действует, пока индекс не изменён.
+    // Только перемещается: список копии указывает на собственные векторы
+    class SortedPostings {
+    public:
+        SortedPostings() = default;
+        SortedPostings(SortedPostings&&) = default;
+        SortedPostings& operator=(SortedPostings&&) = default;
+        SortedPostings(const SortedPostings&) = delete;
+        SortedPostings& operator=(const SortedPostings&) = delete;
+
+        struct List {
+            const int* document_ids = nullptr;
+            const double* term_freqs = nullptr;
+            size_t size = 0;
+            const IndexSegment* segment = nullptr; // nullptr - копия, все её записи действующие
+        };
+
+        const std::vector<List>& GetLists() const {
+            return lists_;
+        }
+
+        // Не удалён ли документ записи и, при фильтре по статусу, не сменил ли статус
+        bool IsLive(const List& list, int document_id) const {
+            return !list.segment
+                || ((!check_tombstones_ || !index_->IsDeleted(document_id, *list.segment))
+                    && (!check_overrides_ || !index_->status_overrides_.contains(document_id)));
+        }
+
+    private:
+        friend class SegmentedIndex;
+
+        const SegmentedIndex* index_ = nullptr;
+        bool check_tombstones_ = false;
+        bool check_overrides_ = false;
+        std::vector<List> lists_;
+        std::vector<int> copied_document_ids_;
+        std::vector<double> copied_term_freqs_;
+    };
+
+    SegmentedIndex() = default;
+    explicit SegmentedIndex(SegmentOptions options);
+
+    // Копия не наследует незавершённое слияние: сегменты исходного индекса разделяются, а не копируются
+    SegmentedIndex(const SegmentedIndex& other);
+    SegmentedIndex& operator=(const SegmentedIndex& other);
+    SegmentedIndex(SegmentedIndex&&) = default;
+    SegmentedIndex& operator=(SegmentedIndex&&) = default;
+
+    // Добавляет документ с TF его слов
+    void AddDocument(int document_id, DocumentStatus status, int rating, const std::unordered_map<std::string_view, double>& term_freqs);
+
+    // Документ должен быть в индексе
+    void RemoveDocument(int document_id);
+
+    // Документ должен быть в индексе. Не переписывает списки документов: O(1) для изменяемого сегмента
+    // и O(log) для неизменяемого
+    void SetDocumentStatus(int document_id, DocumentStatus status);
+
+    // Документ должен быть в индексе. Как и смена статуса, не переписывает списки: новый рейтинг документа
+    // неизменяемого сегмента запоминается отдельно и записывается в сегмент при слиянии
+    void SetDocumentRating(int document_id, int rating);
+
+    // Есть ли документы, сменившие рейтинг после заморозки: их рейтинги в FindImpactLists и в сводках блоков устарели
+    bool HasRatingOverrides() const;
+
+    // Число документов со словом во всех сегментах (с учётом удалений)
+    int GetDocumentFreq(std::string_view word) const;
+
+    // Вызывает callback(document_id, term_freq) для всех документов со словом
+    template <typename Callback>
+    void ForEachPosting(std::string_view word, Callback callback) const;
+
+    // То же только для документов со статусом status; записи других статусов в неизменяемых сегментах не читаются
+    template <typename Callback>
+    void ForEachPosting(std::string_view word, DocumentStatus status, Callback callback) const;
+
+    // Записи слова (со статусом status, если задан) списками по возрастанию ID
+    SortedPostings GetSortedPostings(std::string_view word, std::optional<DocumentStatus> status) const;
+
+    // TF слова в документе, если слово в документе есть
+    std::optional<double> FindTermFreq(std::string_view word, int document_id) const;
+
+    DocumentLocation LocateDocument(int document_id) const;
+
+    TermLookup LookupTerm(std::string_view word) const;
+
+    // Включён ли SegmentOptions::impact_ordered
+    bool IsImpactOrdered() const;
+
+    // Списки слова по убыванию TF из неизменяемых сегментов. Могут содержать удалённые документы
+    // и устаревшие копии повторно добавленных: проверять документ нужно по FindTermFreq
+    std::vector<IndexSegment::ImpactList> FindImpactLists(std::string_view word) const;
+
+    // Вызывает callback(document_id, term_freq) для документов со словом из изменяемого сегмента
+    template <typename Callback>
+    void ForEachMutablePosting(std::string_view word, Callback callback) const;
+
+    // Раскрытие шаблонов и нечётких слов без общего словаря индекса: словари неизменяемых сегментов строятся
+    // при заморозке и не меняются, термины небольшого изменяемого сегмента перебираются. Кандидаты сегментов
+    // сливаются без повторов; могут остаться термины только удалённых документов, до их слияния.
+    // Термины под шаблон с '*' и '?' по возрастанию, не более max_count
+    std::vector<std::string> ExpandPattern(std::string_view pattern, size_t max_count) const;
+
+    // Термины на расстоянии Левенштейна не более max_distance от word (с term_prefix - только термины с этим префиксом,
+    // расстояние по остатку), ближайшие первыми, при равном расстоянии по возрастанию, не более max_count
+    std::vector<FuzzyMatch> ExpandFuzzy(std::string_view word, int max_distance, size_t max_count, std::string_view term_prefix) const;
+
+    // Дожидается фонового слияния и применяет его (и следующие, если политика их требует)
+    void WaitForMerges();
+
+    IndexStats GetStats() const;
+
+    // O(число сегментов): изменяемый сегмент учитывается по ходу добавления документов
+    IndexMemoryUsage GetMemoryUsage() const;
+
+    // Замораживает изменяемый сегмент и сбрасывает списки документов всех сегментов в куче в файлы в directory
+    // (кроме сливаемых сейчас - результат их слияния сбрасывается следующим вызовом). Возвращает освобождённые байты кучи
+    size_t SpillSegments(const std::filesystem::path& directory);
+
+private:
+    struct MutableDocument {
+        DocumentStatus status;
+        int rating;
+    };
+
+    // Изменяемый сегмент: слово : пары (ID, TF) в порядке добавления документов, и статусы и рейтинги его документов
+    struct MutableSegment {
+        StringMap<std::vector<std::pair<int, double>>> word_to_document_freqs;
+        std::unordered_map<int, MutableDocument> documents;
+        size_t posting_count = 0;
+        size_t term_heap_bytes = 0;    // строки терминов вне SSO
+        size_t posting_heap_bytes = 0; // ёмкость векторов пар (ID, TF)
+    };
+
+    SegmentOptions options_;
+    std::vector<std::shared_ptr<const IndexSegment>> segments_; // по возрастанию sequence
+    MutableSegment mutable_;
+    std::unordered_map<int, uint64_t> tombstones_; // ID : sequence, документ скрыт в сегментах с меньшим sequence
+    std::unordered_map<int, DocumentStatus> status_overrides_; // ID : текущий статус документа из неизменяемого сегмента
+    std::unordered_map<int, int> rating_overrides_; // ID : текущий рейтинг документа из неизменяемого сегмента
+    uint64_t next_sequence_ = 0;
+
+    std::future<std::shared_ptr<const IndexSegment>> pending_merge_;
+    std::unordered_map<int, DocumentStatus> pending_merge_overrides_; // смены статусов, применённые слиянием
+    std::unordered_map<int, int> pending_merge_rating_overrides_; // смены рейтингов, применённые слиянием
+    size_t pending_merge_begin_ = 0; // первый из сливаемых сегментов в segments_
+    size_t pending_merge_size_ = 0;
+
+    uint64_t postings_added_ = 0;
+    uint64_t postings_written_ = 0;
+    size_t merge_count_ = 0;
+
+    bool IsDeleted(int document_id, const IndexSegment& segment) const;
+
+    // Сегмент с действующей копией документа
+    const IndexSegment* FindLiveSegment(int document_id) const;
+    std::optional<size_t> FindLiveSegmentIndex(int document_id) const;
+
+    void Freeze();
+    void CommitFinishedMerge(bool wait);
+    void MaybeStartMerge();
+};
+
+
+template <typename Callback>
+void SegmentedIndex::ForEachPosting(std::string_view word, Callback callback) const {
+    for (const auto& segment : segments_) {
+        const IndexSegment::PostingList postings = segment->FindPostings(word);
+        for (size_t i = 0; i < postings.size; ++i) {
+            if (tombstones_.empty() || !IsDeleted(postings.document_ids[i], *segment)) {
+                callback(postings.document_ids[i], postings.term_freqs[i]);
+            }
+        }
+    }
+    const auto it = mutable_.word_to_document_freqs.find(word);
+    if (it != mutable_.word_to_document_freqs.end()) {
+        for (const auto& [ document_id, term_freq ] : it->second) {
+            callback(document_id, term_freq);
+        }
+    }
+}
+
+template <typename Callback>
+void SegmentedIndex::ForEachPosting(std::string_view word, DocumentStatus status, Callback callback) const {
+    for (const auto& segment : segments_) {
+        const IndexSegment::PostingList postings = segment->FindPostings(word, status);
+        for (size_t i = 0; i < postings.size; ++i) {
+            const int document_id = postings.document_ids[i];
+            if ((tombstones_.empty() || !IsDeleted(document_id, *segment))
+                && (status_overrides_.empty() || !status_overrides_.contains(document_id))) {
+                callback(document_id, postings.term_freqs[i]);
+            }
+        }
+    }
+    // Документы, сменившие статус после заморозки, лежат в части прежнего статуса
+    for (const auto& [ document_id, current_status ] : status_overrides_) {
+        if (current_status != status) {
+            continue;
+        }
+        if (const IndexSegment* segment = FindLiveSegment(document_id)) {
+            if (const std::optional<double> term_freq = segment->FindTermFreq(word, document_id)) {
+                callback(document_id, *term_freq);
+            }
+        }
+    }
+    const auto it = mutable_.word_to_document_freqs.find(word);
+    if (it != mutable_.word_to_document_freqs.end()) {
+        for (const auto& [ document_id, term_freq ] : it->second) {
+            if (mutable_.documents.at(document_id).status == status) {
+                callback(document_id, term_freq);
+            }
+        }
+    }
+}
+
+template <typename Callback>
+void SegmentedIndex::ForEachMutablePosting(std::string_view word, Callback callback) const {
+    const auto it = mutable_.word_to_document_freqs.find(word);
+    if (it != mutable_.word_to_document_freqs.end()) {
+        for (const auto& [ document_id, term_freq ] : it->second) {
+            callback(document_id, term_freq);
+        }
+    }
+}
+
+}; // namespace segmented_index
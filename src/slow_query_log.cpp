@@ -0,0 +1,47 @@
+#include "slow_query_log.h"
+
+#include <algorithm>
+
+
+namespace slow_query_log {
+
+SlowQueryLog::SlowQueryLog(std::chrono::nanoseconds threshold, size_t capacity)
+    : threshold_(threshold)
+    , capacity_(std::max<size_t>(capacity, 1)) {
+}
+
+bool SlowQueryLog::Record(std::string_view query, std::chrono::nanoseconds duration, int result_count) {
+    const uint64_t sequence = query_count_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (duration < threshold_) {
+        return false;
+    }
+    std::lock_guard lock(mutex_);
+    ++slow_query_count_;
+    if (entries_.size() == capacity_) {
+        entries_.pop_front();
+    }
+    entries_.push_back({ sequence, std::string(query), duration, result_count });
+    return true;
+}
+
+std::vector<SlowQuery> SlowQueryLog::GetEntries() const {
+    std::lock_guard lock(mutex_);
+    return { entries_.begin(), entries_.end() };
+}
+
+uint64_t SlowQueryLog::GetSlowQueryCount() const {
+    std::lock_guard lock(mutex_);
+    return slow_query_count_;
+}
+
+std::chrono::nanoseconds SlowQueryLog::GetThreshold() const {
+    return threshold_;
+}
+
+void SlowQueryLog::Clear() {
+    std::lock_guard lock(mutex_);
+    entries_.clear();
+    slow_query_count_ = 0;
+}
+
+}; // namespace slow_query_log
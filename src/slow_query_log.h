@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace slow_query_log {
+
+struct SlowQuery {
+    uint64_t sequence = 0;             // номер запроса среди всех записанных журналом
+    std::string query;
+    std::chrono::nanoseconds duration{ 0 };
+    int result_count = 0;
+};
+
+// Журнал медленных запросов: хранит не более capacity последних запросов, выполнявшихся не меньше threshold,
+// более старые записи вытесняются. Потокобезопасен, быстрые запросы не берут блокировку
+class SlowQueryLog {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 128;
+
+    explicit SlowQueryLog(std::chrono::nanoseconds threshold, size_t capacity = DEFAULT_CAPACITY);
+
+    // Отмечает выполненный запрос; true, если он медленный и записан
+    bool Record(std::string_view query, std::chrono::nanoseconds duration, int result_count);
+
+    // Записи от старых к новым
+    std::vector<SlowQuery> GetEntries() const;
+
+    // Все медленные запросы, включая вытесненные
+    uint64_t GetSlowQueryCount() const;
+
+    std::chrono::nanoseconds GetThreshold() const;
+
+    void Clear();
+
+private:
+    const std::chrono::nanoseconds threshold_;
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    std::deque<SlowQuery> entries_;
+    std::atomic<uint64_t> query_count_ = 0; // все запросы, переданные Record
+    uint64_t slow_query_count_ = 0;
+};
+
+}; // namespace slow_query_log
@@ -0,0 +1,476 @@
+#include "stemmer.h"
+
+#include "memory_usage.h"
+
+#include <algorithm>
+#include <array>
+#include <initializer_list>
+
+
+namespace stemmer {
+
+using namespace std::string_view_literals;
+
+namespace {
+
+// Стеммер Портера по эталонной реализации автора: b[0..k] - текущее слово, j - конец основы перед найденным окончанием
+class PorterStemmer {
+public:
+    explicit PorterStemmer(std::string_view word)
+        : b_(word)
+        , k_(static_cast<int>(word.size()) - 1) {
+    }
+
+    std::string Stem() {
+        if (k_ > 1) {
+            Step1ab();
+            if (k_ > 0) {
+                Step1c();
+                Step2();
+                Step3();
+                Step4();
+                Step5();
+            }
+        }
+        b_.resize(static_cast<size_t>(k_ + 1));
+        return std::move(b_);
+    }
+
+private:
+    std::string b_;
+    int k_;
+    int j_ = 0;
+
+    bool IsConsonant(int i) const {
+        switch (b_[i]) {
+        case 'a': case 'e': case 'i': case 'o': case 'u':
+            return false;
+        case 'y':
+            return i == 0 || !IsConsonant(i - 1);
+        default:
+            return true;
+        }
+    }
+
+    // Число последовательностей гласные-согласные в b[0..j]: [C](VC)^m[V]
+    int Measure() const {
+        int n = 0;
+        int i = 0;
+        while (true) {
+            if (i > j_) {
+                return n;
+            }
+            if (!IsConsonant(i)) {
+                break;
+            }
+            ++i;
+        }
+        ++i;
+        while (true) {
+            while (true) {
+                if (i > j_) {
+                    return n;
+                }
+                if (IsConsonant(i)) {
+                    break;
+                }
+                ++i;
+            }
+            ++i;
+            ++n;
+            while (true) {
+                if (i > j_) {
+                    return n;
+                }
+                if (!IsConsonant(i)) {
+                    break;
+                }
+                ++i;
+            }
+            ++i;
+        }
+    }
+
+    bool HasVowelInStem() const {
+        for (int i = 0; i <= j_; ++i) {
+            if (!IsConsonant(i)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool IsDoubleConsonant(int j) const {
+        return j >= 1 && b_[j] == b_[j - 1] && IsConsonant(j);
+    }
+
+    // согласная-гласная-согласная на i, последняя не w, x, y (hop, но не snow)
+    bool IsCvc(int i) const {
+        if (i < 2 || !IsConsonant(i) || IsConsonant(i - 1) || !IsConsonant(i - 2)) {
+            return false;
+        }
+        return b_[i] != 'w' && b_[i] != 'x' && b_[i] != 'y';
+    }
+
+    bool EndsWith(std::string_view suffix) {
+        const int length = static_cast<int>(suffix.size());
+        if (length > k_ + 1 || std::string_view(b_).substr(static_cast<size_t>(k_ + 1 - length), suffix.size()) != suffix) {
+            return false;
+        }
+        j_ = k_ - length;
+        return true;
+    }
+
+    void SetTo(std::string_view replacement) {
+        b_.replace(static_cast<size_t>(j_ + 1), static_cast<size_t>(k_ - j_), replacement);
+        k_ = j_ + static_cast<int>(replacement.size());
+    }
+
+    void ReplaceIfMeasured(std::string_view replacement) {
+        if (Measure() > 0) {
+            SetTo(replacement);
+        }
+    }
+
+    // Множественное число и -ed, -ing
+    void Step1ab() {
+        if (b_[k_] == 's') {
+            if (EndsWith("sses"sv)) {
+                k_ -= 2;
+            } else if (EndsWith("ies"sv)) {
+                SetTo("i"sv);
+            } else if (b_[k_ - 1] != 's') {
+                --k_;
+            }
+        }
+        if (EndsWith("eed"sv)) {
+            if (Measure() > 0) {
+                --k_;
+            }
+        } else if ((EndsWith("ed"sv) || EndsWith("ing"sv)) && HasVowelInStem()) {
+            k_ = j_;
+            if (EndsWith("at"sv)) {
+                SetTo("ate"sv);
+            } else if (EndsWith("bl"sv)) {
+                SetTo("ble"sv);
+            } else if (EndsWith("iz"sv)) {
+                SetTo("ize"sv);
+            } else if (IsDoubleConsonant(k_)) {
+                --k_;
+                const char c = b_[k_];
+                if (c == 'l' || c == 's' || c == 'z') {
+                    ++k_;
+                }
+            } else if (Measure() == 1 && IsCvc(k_)) {
+                SetTo("e"sv);
+            }
+        }
+    }
+
+    // y -> i, если в основе есть гласная
+    void Step1c() {
+        if (EndsWith("y"sv) && HasVowelInStem()) {
+            b_[k_] = 'i';
+        }
+    }
+
+    // Двойные суффиксы сводятся к одинарным: -ization -> -ize
+    void Step2() {
+        static constexpr std::pair<std::string_view, std::string_view> RULES[] = {
+            {"ational"sv, "ate"sv}, {"tional"sv, "tion"sv}, {"enci"sv, "ence"sv}, {"anci"sv, "ance"sv}, {"izer"sv, "ize"sv},
+            {"bli"sv, "ble"sv}, {"alli"sv, "al"sv}, {"entli"sv, "ent"sv}, {"eli"sv, "e"sv}, {"ousli"sv, "ous"sv},
+            {"ization"sv, "ize"sv}, {"ation"sv, "ate"sv}, {"ator"sv, "ate"sv}, {"alism"sv, "al"sv}, {"iveness"sv, "ive"sv},
+            {"fulness"sv, "ful"sv}, {"ousness"sv, "ous"sv}, {"aliti"sv, "al"sv}, {"iviti"sv, "ive"sv}, {"biliti"sv, "ble"sv},
+            {"logi"sv, "log"sv},
+        };
+        ApplyFirstRule(RULES);
+    }
+
+    // -ic-, -full, -ness и т.п.
+    void Step3() {
+        static constexpr std::pair<std::string_view, std::string_view> RULES[] = {
+            {"icate"sv, "ic"sv}, {"ative"sv, ""sv}, {"alize"sv, "al"sv}, {"iciti"sv, "ic"sv}, {"ical"sv, "ic"sv},
+            {"ful"sv, ""sv}, {"ness"sv, ""sv},
+        };
+        ApplyFirstRule(RULES);
+    }
+
+    template <size_t N>
+    void ApplyFirstRule(const std::pair<std::string_view, std::string_view> (&rules)[N]) {
+        // Правила с разными предпоследними буквами не пересекаются, поэтому первое совпавшее окончание - единственное
+        for (const auto& [suffix, replacement] : rules) {
+            if (EndsWith(suffix)) {
+                ReplaceIfMeasured(replacement);
+                return;
+            }
+        }
+    }
+
+    // -ant, -ence и т.п. в контексте <c>vcvc<v>
+    void Step4() {
+        static constexpr std::string_view SUFFIXES[] = {
+            "al"sv, "ance"sv, "ence"sv, "er"sv, "ic"sv, "able"sv, "ible"sv, "ant"sv, "ement"sv, "ment"sv, "ent"sv,
+            "ion"sv, "ou"sv, "ism"sv, "ate"sv, "iti"sv, "ous"sv, "ive"sv, "ize"sv,
+        };
+        const auto it = std::find_if(std::begin(SUFFIXES), std::end(SUFFIXES), [this](std::string_view suffix) {
+            if (!EndsWith(suffix)) {
+                return false;
+            }
+            // -ion только после s или t
+            return suffix != "ion"sv || (j_ >= 0 && (b_[j_] == 's' || b_[j_] == 't'));
+        });
+        if (it != std::end(SUFFIXES) && Measure() > 1) {
+            k_ = j_;
+        }
+    }
+
+    // Конечная -e и двойная -ll
+    void Step5() {
+        j_ = k_;
+        if (b_[k_] == 'e') {
+            const int measure = Measure();
+            if (measure > 1 || (measure == 1 && !IsCvc(k_ - 1))) {
+                --k_;
+            }
+        }
+        if (b_[k_] == 'l' && IsDoubleConsonant(k_) && Measure() > 1) {
+            --k_;
+        }
+    }
+};
+
+// Русский стеммер работает с кодовыми точками букв
+using RussianWord = std::u32string;
+
+bool IsRussianVowel(char32_t c) {
+    return U"аеиоуыэюя"sv.find(c) != std::u32string_view::npos;
+}
+
+// Окончание с флагом "только после а или я" (группа 1 в описании Snowball)
+struct Ending {
+    std::u32string_view text;
+    bool after_a_or_ya = false;
+};
+
+// Самое длинное окончание, целиком лежащее в [region, size). Для окончаний группы 1 предшествующая а или я тоже
+// должна лежать в области, иначе окончание не удаляется (более короткие не проверяются, как в Snowball)
+size_t FindEnding(const RussianWord& word, size_t region, std::initializer_list<Ending> endings) {
+    const Ending* best = nullptr;
+    for (const Ending& ending : endings) {
+        if (region <= word.size() && ending.text.size() <= word.size() - region && std::u32string_view(word).ends_with(ending.text)
+            && (best == nullptr || ending.text.size() > best->text.size())) {
+            best = &ending;
+        }
+    }
+    if (best == nullptr) {
+        return 0;
+    }
+    if (best->after_a_or_ya) {
+        const size_t stem_size = word.size() - best->text.size();
+        if (stem_size <= region || (word[stem_size - 1] != U'а' && word[stem_size - 1] != U'я')) {
+            return 0;
+        }
+    }
+    return best->text.size();
+}
+
+bool RemoveEnding(RussianWord& word, size_t region, std::initializer_list<Ending> endings) {
+    const size_t length = FindEnding(word, region, endings);
+    word.resize(word.size() - length);
+    return length > 0;
+}
+
+bool RemovePerfectiveGerund(RussianWord& word, size_t rv) {
+    return RemoveEnding(word, rv, {
+        {U"в"sv, true}, {U"вши"sv, true}, {U"вшись"sv, true},
+        {U"ив"sv}, {U"ивши"sv}, {U"ившись"sv}, {U"ыв"sv}, {U"ывши"sv}, {U"ывшись"sv},
+    });
+}
+
+// Прилагательное, возможно после причастия: -ующая, -ившее
+bool RemoveAdjectival(RussianWord& word, size_t rv) {
+    const bool removed = RemoveEnding(word, rv, {
+        {U"ее"sv}, {U"ие"sv}, {U"ые"sv}, {U"ое"sv}, {U"ими"sv}, {U"ыми"sv}, {U"ей"sv}, {U"ий"sv}, {U"ый"sv}, {U"ой"sv},
+        {U"ем"sv}, {U"им"sv}, {U"ым"sv}, {U"ом"sv}, {U"его"sv}, {U"ого"sv}, {U"ему"sv}, {U"ому"sv}, {U"их"sv}, {U"ых"sv},
+        {U"ую"sv}, {U"юю"sv}, {U"ая"sv}, {U"яя"sv}, {U"ою"sv}, {U"ею"sv},
+    });
+    if (removed) {
+        RemoveEnding(word, rv, {
+            {U"ем"sv, true}, {U"нн"sv, true}, {U"вш"sv, true}, {U"ющ"sv, true}, {U"щ"sv, true},
+            {U"ивш"sv}, {U"ывш"sv}, {U"ующ"sv},
+        });
+    }
+    return removed;
+}
+
+bool RemoveVerb(RussianWord& word, size_t rv) {
+    return RemoveEnding(word, rv, {
+        {U"ла"sv, true}, {U"на"sv, true}, {U"ете"sv, true}, {U"йте"sv, true}, {U"ли"sv, true}, {U"й"sv, true},
+        {U"л"sv, true}, {U"ем"sv, true}, {U"н"sv, true}, {U"ло"sv, true}, {U"но"sv, true}, {U"ет"sv, true},
+        {U"ют"sv, true}, {U"ны"sv, true}, {U"ть"sv, true}, {U"ешь"sv, true}, {U"нно"sv, true},
+        {U"ила"sv}, {U"ыла"sv}, {U"ена"sv}, {U"ейте"sv}, {U"уйте"sv}, {U"ите"sv}, {U"или"sv}, {U"ыли"sv}, {U"ей"sv},
+        {U"уй"sv}, {U"ил"sv}, {U"ыл"sv}, {U"им"sv}, {U"ым"sv}, {U"ен"sv}, {U"ило"sv}, {U"ыло"sv}, {U"ено"sv},
+        {U"ят"sv}, {U"ует"sv}, {U"уют"sv}, {U"ит"sv}, {U"ыт"sv}, {U"ены"sv}, {U"ить"sv}, {U"ыть"sv}, {U"ишь"sv},
+        {U"ую"sv}, {U"ю"sv},
+    });
+}
+
+bool RemoveNoun(RussianWord& word, size_t rv) {
+    return RemoveEnding(word, rv, {
+        {U"а"sv}, {U"ев"sv}, {U"ов"sv}, {U"ие"sv}, {U"ье"sv}, {U"е"sv}, {U"иями"sv}, {U"ями"sv}, {U"ами"sv}, {U"еи"sv},
+        {U"ии"sv}, {U"и"sv}, {U"ией"sv}, {U"ей"sv}, {U"ой"sv}, {U"ий"sv}, {U"й"sv}, {U"иям"sv}, {U"ям"sv}, {U"ием"sv},
+        {U"ем"sv}, {U"ам"sv}, {U"ом"sv}, {U"о"sv}, {U"у"sv}, {U"ах"sv}, {U"иях"sv}, {U"ях"sv}, {U"ы"sv}, {U"ь"sv},
+        {U"ию"sv}, {U"ью"sv}, {U"ю"sv}, {U"ия"sv}, {U"ья"sv}, {U"я"sv},
+    });
+}
+
+// Декодирует слово из строчных букв а-я и ё (ё заменяется на е); false для любых других символов
+bool DecodeRussianWord(std::string_view word, RussianWord& letters) {
+    for (size_t i = 0; i + 1 < word.size(); i += 2) {
+        const uint8_t lead = static_cast<uint8_t>(word[i]);
+        const uint8_t trail = static_cast<uint8_t>(word[i + 1]);
+        const char32_t c = (static_cast<char32_t>(lead & 0x1F) << 6) | (trail & 0x3F);
+        if ((lead != 0xD0 && lead != 0xD1) || (trail & 0xC0) != 0x80) {
+            return false;
+        }
+        if (c == U'ё') {
+            letters.push_back(U'е');
+        } else if (c >= U'а' && c <= U'я') {
+            letters.push_back(c);
+        } else {
+            return false;
+        }
+    }
+    return word.size() % 2 == 0;
+}
+
+std::string EncodeRussianWord(const RussianWord& letters) {
+    std::string word;
+    word.reserve(letters.size() * 2);
+    for (char32_t c : letters) {
+        word.push_back(static_cast<char>(0xC0 | (c >> 6)));
+        word.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+    }
+    return word;
+}
+
+} // namespace
+
+std::string StemEnglish(std::string_view word) {
+    if (!std::all_of(word.begin(), word.end(), [](char c) {
+            return c >= 'a' && c <= 'z';
+        })) {
+        return std::string(word);
+    }
+    return PorterStemmer(word).Stem();
+}
+
+std::string StemRussian(std::string_view word) {
+    RussianWord letters;
+    if (!DecodeRussianWord(word, letters)) {
+        return std::string(word);
+    }
+
+    // RV - после первой гласной; R1 - после первой согласной, следующей за гласной; R2 - R1 внутри R1
+    const auto find_region = [&letters](size_t begin) {
+        for (size_t i = begin + 1; i < letters.size(); ++i) {
+            if (!IsRussianVowel(letters[i]) && IsRussianVowel(letters[i - 1])) {
+                return i + 1;
+            }
+        }
+        return letters.size();
+    };
+    const auto first_vowel = std::find_if(letters.begin(), letters.end(), IsRussianVowel);
+    if (first_vowel == letters.end()) {
+        return std::string(word);
+    }
+    const size_t rv = static_cast<size_t>(first_vowel - letters.begin()) + 1;
+    const size_t r2 = find_region(find_region(0));
+
+    // Шаг 1: деепричастие, иначе возвратная частица и одно из: прилагательное, глагол, существительное
+    if (!RemovePerfectiveGerund(letters, rv)) {
+        RemoveEnding(letters, rv, {{U"ся"sv}, {U"сь"sv}});
+        if (!RemoveAdjectival(letters, rv) && !RemoveVerb(letters, rv)) {
+            RemoveNoun(letters, rv);
+        }
+    }
+    // Шаг 2: конечная и
+    RemoveEnding(letters, rv, {{U"и"sv}});
+    // Шаг 3: словообразовательный суффикс в R2
+    RemoveEnding(letters, r2, {{U"ост"sv}, {U"ость"sv}});
+    // Шаг 4: превосходная степень, удвоенная н, мягкий знак
+    if (RemoveEnding(letters, rv, {{U"ейш"sv}, {U"ейше"sv}})) {
+        if (FindEnding(letters, rv, {{U"нн"sv}}) > 0) {
+            letters.pop_back();
+        }
+    } else if (FindEnding(letters, rv, {{U"нн"sv}}) > 0) {
+        letters.pop_back();
+    } else {
+        RemoveEnding(letters, rv, {{U"ь"sv}});
+    }
+    return EncodeRussianWord(letters);
+}
+
+std::string StemWord(std::string_view word) {
+    const uint8_t lead = word.empty() ? 0 : static_cast<uint8_t>(word[0]);
+    return lead == 0xD0 || lead == 0xD1 ? StemRussian(word) : StemEnglish(word);
+}
+
+StemCache::StemCache(Stemmer stemmer)
+    : stemmer_(std::move(stemmer)) {
+}
+
+StemCache::StemCache(const StemCache& other) {
+    std::lock_guard guard(other.mutex_);
+    stemmer_ = other.stemmer_;
+    stems_ = other.stems_;
+    string_bytes_ = other.string_bytes_;
+}
+
+StemCache& StemCache::operator=(const StemCache& other) {
+    if (this != &other) {
+        std::scoped_lock guard(mutex_, other.mutex_);
+        stemmer_ = other.stemmer_;
+        stems_ = other.stems_;
+        string_bytes_ = other.string_bytes_;
+    }
+    return *this;
+}
+
+std::string_view StemCache::Stem(std::string_view word) const {
+    std::lock_guard guard(mutex_);
+    return StemLocked(word);
+}
+
+void StemCache::StemAll(std::vector<std::string_view>& words) const {
+    std::lock_guard guard(mutex_);
+    for (std::string_view& word : words) {
+        word = StemLocked(word);
+    }
+}
+
+std::string StemCache::StemQuery(std::string_view word) const {
+    {
+        std::lock_guard guard(mutex_);
+        if (const auto it = stems_.find(word); it != stems_.end()) {
+            return it->second;
+        }
+    }
+    return stemmer_(word);
+}
+
+std::string_view StemCache::StemLocked(std::string_view word) const {
+    auto it = stems_.find(word);
+    if (it == stems_.end()) {
+        it = stems_.emplace(std::string(word), stemmer_(word)).first;
+        string_bytes_ += memory_usage::GetStringHeapBytes(it->first) + memory_usage::GetStringHeapBytes(it->second);
+    }
+    return it->second;
+}
+
+size_t StemCache::GetMemoryUsage() const {
+    std::lock_guard guard(mutex_);
+    return memory_usage::GetHashTableBytes(stems_) + string_bytes_;
+}
+
+}; // namespace stemmer
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "string_processing.h"
+
+
+namespace stemmer {
+
+using namespace string_processing;
+
+// Основа слова. Слово приходит после стоп-фильтра, стеммер может вернуть его без изменений
+using Stemmer = std::function<std::string(std::string_view word)>;
+
+// Английский стеммер Портера (1980). Слова не из строчных букв a-z возвращаются без изменений
+std::string StemEnglish(std::string_view word);
+
+// Русский стеммер Snowball (UTF-8, ё приравнивается к е). Слова не из строчных букв а-я и ё возвращаются без изменений
+std::string StemRussian(std::string_view word);
+
+// Русский стеммер для слов кириллицей, английский - для остальных
+std::string StemWord(std::string_view word);
+
+// Кэш основ слово -> основа: основа каждого слова документов вычисляется один раз. Потокобезопасен,
+// ссылки на основы действительны, пока жив кэш (записи не удаляются)
+class StemCache {
+public:
+    explicit StemCache(Stemmer stemmer);
+    StemCache(const StemCache& other);
+    StemCache& operator=(const StemCache& other);
+
+    std::string_view Stem(std::string_view word) const;
+
+    // Заменяет слова их основами под одной блокировкой
+    void StemAll(std::vector<std::string_view>& words) const;
+
+    // Основа слова запроса: из кэша, а если слова нет - вычисленная без записи в кэш,
+    // чтобы слова, которые встречаются только в запросах, не накапливались
+    std::string StemQuery(std::string_view word) const;
+
+    size_t GetMemoryUsage() const;
+
+private:
+    Stemmer stemmer_;
+    mutable std::mutex mutex_;
+    mutable StringMap<std::string> stems_;
+    mutable size_t string_bytes_ = 0; // память строк слов и основ вне узлов stems_
+
+    std::string_view StemLocked(std::string_view word) const;
+};
+
+}; // namespace stemmer
@@ -0,0 +1,125 @@
+#include "stop_words.h"
+
+#include "memory_usage.h"
+
+#include <algorithm>
+#include <numeric>
+
+
+namespace stop_words {
+
+namespace {
+
+constexpr uint32_t MAX_SEED = 1u << 16;
+constexpr size_t MAX_LENGTH_BIT = 63;
+
+uint64_t HashWord(std::string_view word) {
+    return std::hash<std::string_view>{}(word);
+}
+
+// Перемешивание хеша с зерном корзины (финализатор splitmix64)
+uint64_t MixSeed(uint64_t hash, uint32_t seed) {
+    uint64_t x = hash + (static_cast<uint64_t>(seed) + 1) * 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+size_t GetBucket(uint64_t hash, size_t bucket_count) {
+    return static_cast<size_t>((hash >> 32) % bucket_count);
+}
+
+uint64_t GetLengthBit(size_t length) {
+    return uint64_t{1} << std::min(length, MAX_LENGTH_BIT);
+}
+
+} // namespace
+
+StopWordSet::StopWordSet(const StringSet& words) {
+    if (words.empty()) {
+        return;
+    }
+    std::vector<std::string_view> sorted_words(words.begin(), words.end());
+    std::sort(sorted_words.begin(), sorted_words.end());
+    // В среднем по 4 слова на корзину; если зерно не подобралось, корзин становится больше
+    for (size_t bucket_count = (sorted_words.size() + 3) / 4; !TryBuild(sorted_words, bucket_count); bucket_count *= 2) {
+    }
+    for (std::string_view word : sorted_words) {
+        length_mask_ |= GetLengthBit(word.size());
+    }
+}
+
+bool StopWordSet::TryBuild(const std::vector<std::string_view>& words, size_t bucket_count) {
+    std::vector<std::vector<uint64_t>> buckets(bucket_count);
+    for (std::string_view word : words) {
+        const uint64_t hash = HashWord(word);
+        buckets[GetBucket(hash, bucket_count)].push_back(hash);
+    }
+    // Сначала самые большие корзины, пока свободных ячеек много
+    std::vector<size_t> order(bucket_count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&buckets](size_t lhs, size_t rhs) {
+        return buckets[lhs].size() > buckets[rhs].size();
+    });
+
+    const size_t slot_count = words.size();
+    std::vector<bool> is_taken(slot_count, false);
+    seeds_.assign(bucket_count, 0);
+    std::vector<size_t> bucket_slots;
+    for (size_t bucket : order) {
+        if (buckets[bucket].empty()) {
+            break;
+        }
+        uint32_t seed = 0;
+        for (; seed < MAX_SEED; ++seed) {
+            bucket_slots.clear();
+            for (uint64_t hash : buckets[bucket]) {
+                const size_t slot = static_cast<size_t>(MixSeed(hash, seed) % slot_count);
+                if (is_taken[slot] || std::find(bucket_slots.begin(), bucket_slots.end(), slot) != bucket_slots.end()) {
+                    break;
+                }
+                bucket_slots.push_back(slot);
+            }
+            if (bucket_slots.size() == buckets[bucket].size()) {
+                break;
+            }
+        }
+        if (seed == MAX_SEED) {
+            return false;
+        }
+        seeds_[bucket] = seed;
+        for (size_t slot : bucket_slots) {
+            is_taken[slot] = true;
+        }
+    }
+
+    slots_.assign(slot_count, Slot{});
+    chars_.clear();
+    for (std::string_view word : words) {
+        slots_[GetSlot(HashWord(word))] = Slot{ static_cast<uint32_t>(chars_.size()), static_cast<uint32_t>(word.size()) };
+        chars_.append(word);
+    }
+    return true;
+}
+
+size_t StopWordSet::GetSlot(uint64_t hash) const {
+    return static_cast<size_t>(MixSeed(hash, seeds_[GetBucket(hash, seeds_.size())]) % slots_.size());
+}
+
+bool StopWordSet::Contains(std::string_view word) const {
+    if ((length_mask_ & GetLengthBit(word.size())) == 0) {
+        return false;
+    }
+    const Slot& slot = slots_[GetSlot(HashWord(word))];
+    return std::string_view(chars_).substr(slot.offset, slot.length) == word;
+}
+
+size_t StopWordSet::GetSize() const {
+    return slots_.size();
+}
+
+size_t StopWordSet::GetMemoryUsage() const {
+    return memory_usage::GetVectorBytes(seeds_) + memory_usage::GetVectorBytes(slots_) + memory_usage::GetStringHeapBytes(chars_);
+}
+
+}; // namespace stop_words
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "string_processing.h"
+
+
+namespace stop_words {
+
+using namespace string_processing;
+
+// Неизменяемое множество стоп-слов на минимальной совершенной хеш-функции (hash and displace): слова разложены
+// по корзинам, для каждой корзины подобрано зерно, при котором все её слова попадают в свободные ячейки таблицы
+// из ровно n ячеек. Проверка слова - маска длин, один хеш и одно сравнение с ячейкой, без выделения памяти
+class StopWordSet {
+public:
+    StopWordSet() = default;
+
+    explicit StopWordSet(const StringSet& words);
+
+    bool Contains(std::string_view word) const;
+
+    size_t GetSize() const;
+
+    size_t GetMemoryUsage() const;
+
+private:
+    // Слово ячейки - отрезок chars_
+    struct Slot {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    uint64_t length_mask_ = 0;   // бит i - есть стоп-слово длины i (длины от 63 и больше - бит 63)
+    std::vector<uint32_t> seeds_; // зерно каждой корзины
+    std::vector<Slot> slots_;
+    std::string chars_;           // слова ячеек подряд
+
+    bool TryBuild(const std::vector<std::string_view>& words, size_t bucket_count);
+    size_t GetSlot(uint64_t hash) const;
+};
+
+}; // namespace stop_words
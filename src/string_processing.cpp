@@ -1,14 +1,130 @@
 #include "string_processing.h"
 
+#include <bit>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 
 namespace string_processing {
 
-std::vector<std::string> SplitIntoWords(std::string_view text) {
-    std::vector<std::string> words;
-    for (auto word : text | std::views::split(' ')) {
-        words.emplace_back(word.begin(), word.end());
+namespace {
+
+// Состояние токенизатора между блоками текста
+struct TokenizerState {
+    const char* data;
+    size_t word_begin = 0;
+    bool in_word = false;
+};
+
+// Выдаёт слова блока [base, base + width) по битовой маске пробелов (бит i = 1, если data[base + i] == ' ')
+template <typename Mask>
+void EmitWords(TokenizerState& state, Mask spaces, size_t base, size_t width, std::vector<std::string_view>& words) {
+    const Mask all = width == sizeof(Mask) * 8 ? ~Mask{0} : (Mask{1} << width) - 1;
+    const Mask non_spaces = ~spaces & all;
+    size_t pos = 0;
+    while (pos < width) {
+        const Mask rest = (state.in_word ? spaces : non_spaces) >> pos;
+        if (rest == 0) {
+            break;
+        }
+        pos += static_cast<size_t>(std::countr_zero(rest));
+        if (state.in_word) {
+            words.emplace_back(state.data + state.word_begin, base + pos - state.word_begin);
+        } else {
+            state.word_begin = base + pos;
+        }
+        state.in_word = !state.in_word;
     }
-    return words;
 }
 
-}; // namespace string_processing
\ No newline at end of file
+bool IsControlChar(char c) {
+    return c >= '\0' && c < ' ';
+}
+
+// Скалярная обработка блоками по 64 байта (используется и для хвоста SIMD-версии)
+bool ScanScalar(TokenizerState& state, std::string_view text, size_t begin, std::vector<std::string_view>& words) {
+    bool valid = true;
+    for (size_t base = begin; base < text.size(); base += 64) {
+        const size_t width = std::min<size_t>(64, text.size() - base);
+        uint64_t spaces = 0;
+        for (size_t i = 0; i < width; ++i) {
+            const char c = text[base + i];
+            spaces |= static_cast<uint64_t>(c == ' ') << i;
+            valid &= !IsControlChar(c);
+        }
+        EmitWords(state, spaces, base, width, words);
+    }
+    return valid;
+}
+
+#if defined(__AVX2__)
+
+bool ScanSimd(TokenizerState& state, std::string_view text, size_t& processed, std::vector<std::string_view>& words) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i minus_one = _mm256_set1_epi8(-1);
+    uint32_t control = 0;
+    size_t base = 0;
+    for (; base + 32 <= text.size(); base += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + base));
+        const uint32_t spaces = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, space)));
+        // 0 <= c < ' ' (в знаковой арифметике байты UTF-8 отрицательны и допустимы)
+        const __m256i is_control = _mm256_and_si256(_mm256_cmpgt_epi8(space, chunk), _mm256_cmpgt_epi8(chunk, minus_one));
+        control |= static_cast<uint32_t>(_mm256_movemask_epi8(is_control));
+        EmitWords(state, spaces, base, 32, words);
+    }
+    processed = base;
+    return control == 0;
+}
+
+#elif defined(__SSE2__)
+
+bool ScanSimd(TokenizerState& state, std::string_view text, size_t& processed, std::vector<std::string_view>& words) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i minus_one = _mm_set1_epi8(-1);
+    uint32_t control = 0;
+    size_t base = 0;
+    for (; base + 16 <= text.size(); base += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + base));
+        const uint32_t spaces = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, space)));
+        // 0 <= c < ' ' (в знаковой арифметике байты UTF-8 отрицательны и допустимы)
+        const __m128i is_control = _mm_and_si128(_mm_cmplt_epi8(chunk, space), _mm_cmpgt_epi8(chunk, minus_one));
+        control |= static_cast<uint32_t>(_mm_movemask_epi8(is_control));
+        EmitWords(state, spaces, base, 16, words);
+    }
+    processed = base;
+    return control == 0;
+}
+
+#else
+
+bool ScanSimd(TokenizerState&, std::string_view, size_t& processed, std::vector<std::string_view>&) {
+    processed = 0;
+    return true;
+}
+
+#endif
+
+} // namespace
+
+bool SplitIntoWordsView(std::string_view text, std::vector<std::string_view>& words) {
+    words.clear();
+    TokenizerState state{text.data()};
+    size_t processed = 0;
+    bool valid = ScanSimd(state, text, processed, words);
+    valid &= ScanScalar(state, text, processed, words);
+    if (state.in_word) {
+        words.emplace_back(text.data() + state.word_begin, text.size() - state.word_begin);
+    }
+    return valid;
+}
+
+std::vector<std::string> SplitIntoWords(std::string_view text) {
+    std::vector<std::string_view> views;
+    SplitIntoWordsView(text, views);
+    return { views.begin(), views.end() };
+}
+
+}; // namespace string_processing
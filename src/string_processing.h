@@ -4,23 +4,44 @@
 #include <string>
 #include <string_view>
 #include <vector>
+#include <unordered_map>
 #include <unordered_set>
 
 
 namespace string_processing {
 
+// Хеш для гетерогенного поиска std::string по std::string_view без создания временной строки
+struct StringHash {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view str) const {
+        return std::hash<std::string_view>{}(str);
+    }
+};
+
+using StringSet = std::unordered_set<std::string, StringHash, std::equal_to<>>;
+
+template <typename Value>
+using StringMap = std::unordered_map<std::string, Value, StringHash, std::equal_to<>>;
+
+// Разбивает текст на слова по пробелам за один проход (SSE2/AVX2 при наличии, иначе скалярно).
+// Повторяющиеся пробелы схлопываются, пустые слова не выдаются.
+// Слова записываются в буфер words (он предварительно очищается) как string_view на исходный текст.
+// Возвращает false, если в тексте встретился управляющий символ (код от 0 до ' ')
+bool SplitIntoWordsView(std::string_view text, std::vector<std::string_view>& words);
+
 std::vector<std::string> SplitIntoWords(std::string_view text);
 
 template <typename StringContainer>
-std::unordered_set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-    std::unordered_set<std::string> non_empty_strings;
+StringSet MakeUniqueNonEmptyStrings(const StringContainer& strings) {
+    StringSet non_empty_strings;
     for (const std::string& str : strings) {
         if (!str.empty()) {
             non_empty_strings.emplace(str);
         }
     }
-    
+
     return non_empty_strings;
 }
 
-}; // namespace string_processing
\ No newline at end of file
+}; // namespace string_processing
@@ -0,0 +1,362 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+
+namespace term_dictionary {
+
+namespace {
+
+void AppendVarint(std::vector<uint8_t>& data, size_t value) {
+    while (value >= 0x80) {
+        data.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+size_t ReadVarint(const std::vector<uint8_t>& data, size_t& offset) {
+    size_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        const uint8_t byte = data[offset++];
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+}
+
+// Наименьшая строка, большая всех строк с префиксом prefix (пустая, если такой нет)
+std::string PrefixSuccessor(std::string_view prefix) {
+    std::string successor(prefix);
+    while (!successor.empty() && static_cast<unsigned char>(successor.back()) == 0xFF) {
+        successor.pop_back();
+    }
+    if (!successor.empty()) {
+        successor.back() = static_cast<char>(static_cast<unsigned char>(successor.back()) + 1);
+    }
+    return successor;
+}
+
+} // namespace
+
+TermDictionary::TermDictionary(const std::vector<std::string_view>& terms)
+    : size_(terms.size()) {
+    std::string_view previous;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        const std::string_view term = terms[i];
+        size_t shared = 0;
+        if (i % BLOCK_SIZE == 0) {
+            block_offsets_.push_back(static_cast<uint32_t>(data_.size()));
+        } else {
+            const size_t max_shared = std::min(term.size(), previous.size());
+            while (shared < max_shared && term[shared] == previous[shared]) {
+                ++shared;
+            }
+            AppendVarint(data_, shared);
+        }
+        AppendVarint(data_, term.size() - shared);
+        data_.insert(data_.end(), term.begin() + static_cast<std::ptrdiff_t>(shared), term.end());
+        previous = term;
+    }
+    data_.shrink_to_fit();
+    block_offsets_.shrink_to_fit();
+}
+
+size_t TermDictionary::GetSize() const {
+    return size_;
+}
+
+std::string_view TermDictionary::GetBlockHead(size_t block) const {
+    size_t offset = block_offsets_[block];
+    const size_t length = ReadVarint(data_, offset);
+    return { reinterpret_cast<const char*>(data_.data() + offset), length };
+}
+
+size_t TermDictionary::LowerBound(std::string_view key) const {
+    return Seek(key).GetIndex();
+}
+
+TermDictionary::Cursor TermDictionary::Seek(std::string_view key, size_t first_block) const {
+    // Первый блок, начало которого больше key; искомый термин - в предыдущем блоке.
+    // Границы сужаются экспоненциальным шагом от first_block: при обходе словаря цель обычно рядом
+    size_t low = first_block;
+    size_t high = block_offsets_.size();
+    for (size_t step = 1; low + step < high; step *= 2) {
+        if (GetBlockHead(low + step) > key) {
+            high = low + step;
+            break;
+        }
+        low += step;
+    }
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (GetBlockHead(middle) <= key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    Cursor cursor(*this, (low == 0 ? 0 : low - 1) * BLOCK_SIZE);
+    while (cursor.IsValid() && cursor.GetTerm() < key) {
+        cursor.Next();
+    }
+    return cursor;
+}
+
+bool TermDictionary::Contains(std::string_view term) const {
+    const Cursor cursor = Seek(term);
+    return cursor.IsValid() && cursor.GetTerm() == term;
+}
+
+std::vector<std::string> TermDictionary::ExpandPrefix(std::string_view prefix, size_t max_count) const {
+    std::vector<std::string> terms;
+    for (Cursor cursor = Seek(prefix); cursor.IsValid() && terms.size() < max_count; cursor.Next()) {
+        if (!cursor.GetTerm().starts_with(prefix)) {
+            break;
+        }
+        terms.emplace_back(cursor.GetTerm());
+    }
+    return terms;
+}
+
+std::vector<std::string> TermDictionary::ExpandPattern(std::string_view pattern, size_t max_count) const {
+    const std::string_view prefix = pattern.substr(0, pattern.find_first_of("*?"));
+    if (prefix.size() == pattern.size()) {
+        return Contains(pattern) && max_count > 0 ? std::vector<std::string>{ std::string(pattern) } : std::vector<std::string>{};
+    }
+    std::vector<std::string> terms;
+    for (Cursor cursor = Seek(prefix); cursor.IsValid() && terms.size() < max_count; cursor.Next()) {
+        if (!cursor.GetTerm().starts_with(prefix)) {
+            break;
+        }
+        if (MatchesWildcard(cursor.GetTerm(), pattern)) {
+            terms.emplace_back(cursor.GetTerm());
+        }
+    }
+    return terms;
+}
+
+std::vector<FuzzyMatch> TermDictionary::ExpandFuzzy(std::string_view word, int max_distance, size_t max_count,
+                                                    std::string_view term_prefix) const {
+    std::vector<FuzzyMatch> matches;
+    // Строка d буфера rows - состояние автомата (строка ДП) после первых d символов prefix
+    const size_t width = word.size() + 1;
+    std::vector<int> rows(width);
+    std::iota(rows.begin(), rows.end(), 0);
+    std::string prefix;
+
+    // Переход автомата из состояния depth по символу c в строку depth + 1; возвращает минимум строки.
+    // Ячейка j строки depth не меньше |depth - j|, поэтому считается только полоса |depth + 1 - j| <= max_distance,
+    // а соседние с полосой ячейки получают max_distance + 1: за допуск они не выводят, а строку ниже считать не мешают
+    const size_t band = static_cast<size_t>(max_distance);
+    const auto step = [&](size_t depth, char c) {
+        rows.resize(std::max(rows.size(), (depth + 2) * width));
+        const int* row = rows.data() + depth * width;
+        int* next = rows.data() + (depth + 1) * width;
+        const size_t low = depth + 1 > band ? depth + 1 - band : 1;
+        const size_t high = std::min(depth + 1 + band, word.size());
+        next[0] = row[0] + 1;
+        int row_min = next[0];
+        if (low > 1 && low - 1 < width) {
+            next[low - 1] = max_distance + 1;
+        }
+        for (size_t j = low; j <= high; ++j) {
+            next[j] = std::min({ row[j] + 1, next[j - 1] + 1, row[j - 1] + (word[j - 1] == c ? 0 : 1) });
+            row_min = std::min(row_min, next[j]);
+        }
+        if (high + 1 < width) {
+            next[high + 1] = max_distance + 1;
+        }
+        return row_min;
+    };
+
+    // Символ, не встречающийся в слове, переводит автомат в то же состояние, что и любой другой такой символ,
+    // и не лучше совпадающего. Поэтому после тупика продолжить ветку могут только символы слова
+    std::string word_chars(word);
+    std::sort(word_chars.begin(), word_chars.end(), [](char lhs, char rhs) {
+        return static_cast<unsigned char>(lhs) < static_cast<unsigned char>(rhs);
+    });
+    word_chars.erase(std::unique(word_chars.begin(), word_chars.end()), word_chars.end());
+
+    Cursor cursor = Seek(term_prefix);
+    std::string target;
+    while (cursor.IsValid() && cursor.GetTerm().starts_with(term_prefix)) {
+        const std::string_view term = cursor.GetTerm().substr(term_prefix.size());
+        size_t depth = 0;
+        while (depth < prefix.size() && depth < term.size() && prefix[depth] == term[depth]) {
+            ++depth;
+        }
+        prefix.resize(depth);
+
+        bool dead = false;
+        for (; depth < term.size(); ++depth) {
+            if (step(depth, term[depth]) > max_distance) {
+                dead = true;
+                break;
+            }
+            prefix.push_back(term[depth]);
+        }
+
+        if (!dead) {
+            // Последняя ячейка строки вне полосы - расстояние заведомо больше допуска
+            const bool in_band = term.size() <= word.size() + band && word.size() <= term.size() + band;
+            const int distance = in_band ? rows[term.size() * width + word.size()] : max_distance + 1;
+            if (distance <= max_distance) {
+                matches.push_back({ std::string(cursor.GetTerm()), distance });
+            }
+            cursor.Next();
+            continue;
+        }
+
+        // Тупик на символе term[depth]: переход к ближайшему живому продолжению prefix
+        // либо, если его нет, к термину после всех терминов с префиксом prefix
+        const auto dead_char = static_cast<unsigned char>(term[depth]);
+        target.clear();
+        for (char c : word_chars) {
+            if (static_cast<unsigned char>(c) > dead_char && step(depth, c) <= max_distance) {
+                target.append(term_prefix).append(prefix).push_back(c);
+                break;
+            }
+        }
+        if (target.empty()) {
+            if (prefix.empty()) {
+                break;
+            }
+            target = PrefixSuccessor(std::string(term_prefix) + prefix);
+            if (target.empty()) {
+                break;
+            }
+        }
+        // Блоки, следующий за которыми начинается не дальше target, пропускаются целиком без декодирования терминов
+        const size_t next_block = cursor.GetIndex() / BLOCK_SIZE + 1;
+        if (next_block < block_offsets_.size() && GetBlockHead(next_block) <= target) {
+            cursor = Seek(target, next_block);
+        } else {
+            while (cursor.IsValid() && cursor.GetTerm() < target) {
+                cursor.Next();
+            }
+        }
+    }
+
+    std::stable_sort(matches.begin(), matches.end(), [](const FuzzyMatch& lhs, const FuzzyMatch& rhs) {
+        return lhs.distance < rhs.distance;
+    });
+    if (matches.size() > max_count) {
+        matches.resize(max_count);
+    }
+    return matches;
+}
+
+size_t TermDictionary::GetMemoryUsage() const {
+    return sizeof(*this) + data_.capacity() + block_offsets_.capacity() * sizeof(uint32_t);
+}
+
+TermDictionary::Cursor::Cursor(const TermDictionary& dictionary, size_t index)
+    : dictionary_(&dictionary)
+    , index_(index) {
+    if (!IsValid()) {
+        return;
+    }
+    // Декодирование с начала блока до нужного термина
+    const size_t block = index / BLOCK_SIZE;
+    offset_ = dictionary_->block_offsets_[block];
+    index_ = block * BLOCK_SIZE;
+    DecodeEntry();
+    while (index_ < index) {
+        Next();
+    }
+}
+
+bool TermDictionary::Cursor::IsValid() const {
+    return index_ < dictionary_->size_;
+}
+
+size_t TermDictionary::Cursor::GetIndex() const {
+    return index_;
+}
+
+std::string_view TermDictionary::Cursor::GetTerm() const {
+    return term_;
+}
+
+void TermDictionary::Cursor::Next() {
+    ++index_;
+    if (IsValid()) {
+        DecodeEntry();
+    }
+}
+
+void TermDictionary::Cursor::DecodeEntry() {
+    const std::vector<uint8_t>& data = dictionary_->data_;
+    const size_t shared = index_ % BLOCK_SIZE == 0 ? 0 : ReadVarint(data, offset_);
+    const size_t suffix_length = ReadVarint(data, offset_);
+    term_.resize(shared);
+    term_.append(reinterpret_cast<const char*>(data.data() + offset_), suffix_length);
+    offset_ += suffix_length;
+}
+
+bool IsWildcardPattern(std::string_view word) {
+    return word.find_first_of("*?") != std::string_view::npos;
+}
+
+bool MatchesWildcard(std::string_view term, std::string_view pattern) {
+    // Жадное сопоставление с возвратом к последней звёздочке
+    size_t t = 0;
+    size_t p = 0;
+    size_t star = std::string_view::npos;
+    size_t star_match = 0;
+    while (t < term.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == term[t])) {
+            ++t;
+            ++p;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            star_match = t;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            t = ++star_match;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+int ComputeEditDistance(std::string_view lhs, std::string_view rhs, int max_distance) {
+    const size_t band = static_cast<size_t>(max_distance);
+    if (lhs.size() > rhs.size() + band || rhs.size() > lhs.size() + band) {
+        return max_distance + 1;
+    }
+    // Две строки ДП: на стеке для коротких слов, иначе в куче
+    constexpr size_t STACK_WIDTH = 64;
+    std::array<int, 2 * STACK_WIDTH> stack_rows;
+    std::vector<int> heap_rows;
+    const size_t width = rhs.size() + 1;
+    if (width > STACK_WIDTH) {
+        heap_rows.resize(2 * width);
+    }
+    int* previous = width > STACK_WIDTH ? heap_rows.data() : stack_rows.data();
+    int* current = previous + width;
+    std::iota(previous, previous + width, 0);
+    for (size_t i = 1; i <= lhs.size(); ++i) {
+        current[0] = static_cast<int>(i);
+        int row_min = current[0];
+        for (size_t j = 1; j < width; ++j) {
+            current[j] = std::min({ previous[j] + 1, current[j - 1] + 1, previous[j - 1] + (lhs[i - 1] == rhs[j - 1] ? 0 : 1) });
+            row_min = std::min(row_min, current[j]);
+        }
+        if (row_min > max_distance) {
+            return max_distance + 1;
+        }
+        std::swap(previous, current);
+    }
+    return std::min(previous[width - 1], max_distance + 1);
+}
+
+}; // namespace term_dictionary
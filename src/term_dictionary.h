@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace term_dictionary {
+
+// Термин, найденный нечётким поиском, и его расстояние редактирования до слова запроса
+struct FuzzyMatch {
+    std::string term;
+    int distance;
+};
+
+// Компактный отсортированный словарь терминов с префиксным (front) кодированием.
+// Термины хранятся блоками по BLOCK_SIZE: первый термин блока целиком, остальные -
+// длиной общего с предыдущим термином префикса и суффиксом. Поиск - бинарный по началам блоков
+class TermDictionary {
+public:
+    static constexpr size_t BLOCK_SIZE = 16;
+
+    // Последовательный обход терминов начиная с заданного индекса
+    class Cursor {
+    public:
+        Cursor(const TermDictionary& dictionary, size_t index);
+
+        bool IsValid() const;
+        size_t GetIndex() const;
+        std::string_view GetTerm() const;
+        void Next();
+
+    private:
+        const TermDictionary* dictionary_;
+        size_t index_;
+        size_t offset_ = 0; // смещение следующей записи в data_
+        std::string term_;
+
+        void DecodeEntry();
+    };
+
+    TermDictionary() = default;
+
+    // terms - отсортированные уникальные термины
+    explicit TermDictionary(const std::vector<std::string_view>& terms);
+
+    size_t GetSize() const;
+
+    // Индекс первого термина, не меньшего key (GetSize(), если такого нет)
+    size_t LowerBound(std::string_view key) const;
+
+    // Курсор на первый термин, не меньший key; поиск только среди блоков начиная с first_block
+    Cursor Seek(std::string_view key, size_t first_block = 0) const;
+
+    bool Contains(std::string_view term) const;
+
+    // Термины, начинающиеся с prefix, в лексикографическом порядке, не более max_count
+    std::vector<std::string> ExpandPrefix(std::string_view prefix, size_t max_count) const;
+
+    // Термины, подходящие под шаблон с '*' (любая последовательность) и '?' (любой символ), не более max_count.
+    // Перебираются только термины с префиксом шаблона до первого подстановочного символа
+    std::vector<std::string> ExpandPattern(std::string_view pattern, size_t max_count) const;
+
+    // Термины на расстоянии Левенштейна не более max_distance от word, ближайшие первыми, не более max_count.
+    // Автомат Левенштейна моделируется строками ДП (только полоса ширины 2 * max_distance + 1) и обходит словарь
+    // как неявный бор: ветки с общим префиксом, из которых автомат не может дойти до допуска, пропускаются целиком,
+    // переход через блоки словаря - по началам блоков без декодирования терминов.
+    // Время пропорционально числу префиксов словаря в пределах допуска, а не размеру словаря, но в отличие
+    // от точного поиска это сотни и тысячи посещённых терминов: на плотных словарях до двух правок - миллисекунды.
+    // С term_prefix перебираются только термины с этим префиксом, расстояние считается по остатку термина
+    std::vector<FuzzyMatch> ExpandFuzzy(std::string_view word, int max_distance, size_t max_count,
+                                        std::string_view term_prefix = {}) const;
+
+    // Объём памяти, занимаемый словарём, в байтах
+    size_t GetMemoryUsage() const;
+
+private:
+    std::vector<uint8_t> data_;
+    std::vector<uint32_t> block_offsets_;
+    size_t size_ = 0;
+
+    std::string_view GetBlockHead(size_t block) const;
+};
+
+bool IsWildcardPattern(std::string_view word);
+bool MatchesWildcard(std::string_view term, std::string_view pattern);
+
+// Расстояние Левенштейна между lhs и rhs, если оно не больше max_distance, иначе max_distance + 1.
+// Строки ДП обрываются, как только все ячейки строки превысили допуск
+int ComputeEditDistance(std::string_view lhs, std::string_view rhs, int max_distance);
+
+}; // namespace term_dictionary
@@ -0,0 +1,340 @@
+#include "text_normalizer.h"
+
+#include "string_processing.h"
+#include "unicode_tables.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+
+namespace text_normalizer {
+
+using namespace std::string_view_literals;
+using namespace unicode_tables;
+
+namespace {
+
+constexpr char32_t TWO_BYTE_LIMIT = 0x800;
+constexpr uint64_t ASCII_HIGH_BITS = 0x8080808080808080ull;
+
+using AsciiTable = std::array<char, 128>;
+
+// Буквы - в нижний регистр, пунктуация (кроме keep) - пробел, цифры и управляющие символы без изменений
+constexpr AsciiTable MakeAsciiTable(std::string_view keep) {
+    AsciiTable table{};
+    for (int c = 0; c < 128; ++c) {
+        const bool is_alnum = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        if (c >= 'A' && c <= 'Z') {
+            table[c] = static_cast<char>(c - 'A' + 'a');
+        } else if (c > ' ' && c < 127 && !is_alnum && keep.find(static_cast<char>(c)) == std::string_view::npos) {
+            table[c] = ' ';
+        } else {
+            table[c] = static_cast<char>(c);
+        }
+    }
+    return table;
+}
+
+constexpr AsciiTable DOCUMENT_ASCII = MakeAsciiTable(""sv);
+constexpr AsciiTable QUERY_ASCII = MakeAsciiTable("*?~"sv);
+
+// Длина последовательности UTF-8 по первому байту, 0 - байт не может начинать последовательность
+constexpr std::array<uint8_t, 256> MakeSequenceLengths() {
+    std::array<uint8_t, 256> lengths{};
+    for (int byte = 0; byte < 256; ++byte) {
+        lengths[byte] = byte < 0x80 ? 1 : byte < 0xC2 ? 0 : byte < 0xE0 ? 2 : byte < 0xF0 ? 3 : byte < 0xF5 ? 4 : 0;
+    }
+    return lengths;
+}
+
+constexpr std::array<uint8_t, 256> SEQUENCE_LENGTHS = MakeSequenceLengths();
+constexpr uint8_t LEAD_MASKS[] = {0, 0x7F, 0x1F, 0x0F, 0x07};
+constexpr char32_t MIN_CODE_POINTS[] = {0, 0, 0x80, 0x800, 0x10000};
+
+template <typename Range>
+constexpr const Range* FindRange(const Range* begin, const Range* end, char32_t code_point) {
+    const Range* it = std::upper_bound(begin, end, code_point, [](char32_t value, const Range& range) {
+        return value < range.first;
+    });
+    return it == begin || code_point > (it - 1)->last ? nullptr : it - 1;
+}
+
+constexpr char32_t FoldCase(char32_t code_point) {
+    const CaseFoldRange* range = FindRange(std::begin(CASE_FOLD_RANGES), std::end(CASE_FOLD_RANGES), code_point);
+    if (range != nullptr && (code_point - range->first) % range->stride == 0) {
+        return static_cast<char32_t>(static_cast<int32_t>(code_point) + range->delta);
+    }
+    return code_point;
+}
+
+constexpr bool IsSeparator(char32_t code_point) {
+    return FindRange(std::begin(SEPARATOR_RANGES), std::end(SEPARATOR_RANGES), code_point) != nullptr;
+}
+
+// Результат нормализации символов U+0000-U+07FF (двухбайтовые последовательности): свёрнутый символ или пробел
+constexpr std::array<char32_t, TWO_BYTE_LIMIT> MakeTwoByteMap() {
+    std::array<char32_t, TWO_BYTE_LIMIT> map{};
+    for (char32_t code_point = 0; code_point < TWO_BYTE_LIMIT; ++code_point) {
+        map[code_point] = IsSeparator(code_point) ? U' ' : FoldCase(code_point);
+    }
+    return map;
+}
+
+constexpr std::array<char32_t, TWO_BYTE_LIMIT> TWO_BYTE_MAP = MakeTwoByteMap();
+
+char32_t MapCodePoint(char32_t code_point) {
+    if (code_point < TWO_BYTE_LIMIT) {
+        return TWO_BYTE_MAP[code_point];
+    }
+    return IsSeparator(code_point) ? U' ' : FoldCase(code_point);
+}
+
+// Вторые символы пар композиции по возрастанию, без повторов
+std::vector<char32_t> MakeCompositionMarks() {
+    std::vector<char32_t> marks;
+    for (const Composition& composition : COMPOSITIONS) {
+        marks.push_back(composition.mark);
+    }
+    std::sort(marks.begin(), marks.end());
+    marks.erase(std::unique(marks.begin(), marks.end()), marks.end());
+    return marks;
+}
+
+const std::vector<char32_t> COMPOSITION_MARKS = MakeCompositionMarks();
+
+// Хангыль: слоги собираются из чамо формулой (ведущая L, гласная V, конечная T)
+constexpr char32_t HANGUL_S_BASE = 0xAC00, HANGUL_L_BASE = 0x1100, HANGUL_V_BASE = 0x1161, HANGUL_T_BASE = 0x11A7;
+constexpr char32_t HANGUL_L_COUNT = 19, HANGUL_V_COUNT = 21, HANGUL_T_COUNT = 28;
+constexpr char32_t HANGUL_S_COUNT = HANGUL_L_COUNT * HANGUL_V_COUNT * HANGUL_T_COUNT;
+
+// Знаки композиции среди U+0000-U+07FF, чтобы не искать в таблице для каждой буквы кириллицы или греческого
+constexpr std::array<bool, TWO_BYTE_LIMIT> MakeTwoByteMarks() {
+    std::array<bool, TWO_BYTE_LIMIT> marks{};
+    for (const Composition& composition : COMPOSITIONS) {
+        if (composition.mark < TWO_BYTE_LIMIT) {
+            marks[composition.mark] = true;
+        }
+    }
+    return marks;
+}
+
+constexpr std::array<bool, TWO_BYTE_LIMIT> TWO_BYTE_MARKS = MakeTwoByteMarks();
+
+bool IsCompositionMark(char32_t code_point) {
+    if (code_point < TWO_BYTE_LIMIT) {
+        return TWO_BYTE_MARKS[code_point];
+    }
+    if ((code_point >= HANGUL_V_BASE && code_point < HANGUL_V_BASE + HANGUL_V_COUNT)
+        || (code_point > HANGUL_T_BASE && code_point < HANGUL_T_BASE + HANGUL_T_COUNT)) {
+        return true;
+    }
+    return std::binary_search(COMPOSITION_MARKS.begin(), COMPOSITION_MARKS.end(), code_point);
+}
+
+// Составной символ для пары base + mark или 0, если пара не составляется
+char32_t Compose(char32_t base, char32_t mark) {
+    if (base >= HANGUL_L_BASE && base < HANGUL_L_BASE + HANGUL_L_COUNT && mark >= HANGUL_V_BASE && mark < HANGUL_V_BASE + HANGUL_V_COUNT) {
+        return HANGUL_S_BASE + ((base - HANGUL_L_BASE) * HANGUL_V_COUNT + (mark - HANGUL_V_BASE)) * HANGUL_T_COUNT;
+    }
+    if (base >= HANGUL_S_BASE && base < HANGUL_S_BASE + HANGUL_S_COUNT && (base - HANGUL_S_BASE) % HANGUL_T_COUNT == 0
+        && mark > HANGUL_T_BASE && mark < HANGUL_T_BASE + HANGUL_T_COUNT) {
+        return base + (mark - HANGUL_T_BASE);
+    }
+    const Composition* it = std::lower_bound(std::begin(COMPOSITIONS), std::end(COMPOSITIONS), std::pair{base, mark},
+                                             [](const Composition& composition, const std::pair<char32_t, char32_t>& key) {
+        return std::pair{composition.base, composition.mark} < key;
+    });
+    return it != std::end(COMPOSITIONS) && it->base == base && it->mark == mark ? it->composed : 0;
+}
+
+// Декодирует символ в начале [data, data + available); возвращает длину последовательности или 0, если она недопустима
+size_t DecodeUtf8(const char* data, size_t available, char32_t& code_point) {
+    const uint8_t lead = static_cast<uint8_t>(data[0]);
+    const size_t length = SEQUENCE_LENGTHS[lead];
+    if (length == 0 || length > available) {
+        return 0;
+    }
+    code_point = lead & LEAD_MASKS[length];
+    for (size_t i = 1; i < length; ++i) {
+        const uint8_t byte = static_cast<uint8_t>(data[i]);
+        if ((byte & 0xC0) != 0x80) {
+            return 0;
+        }
+        code_point = (code_point << 6) | (byte & 0x3F);
+    }
+    if (code_point < MIN_CODE_POINTS[length] || code_point > 0x10FFFF || (code_point >= 0xD800 && code_point < 0xE000)) {
+        return 0;
+    }
+    return length;
+}
+
+size_t EncodeUtf8(char32_t code_point, char* out) {
+    if (code_point < 0x80) {
+        out[0] = static_cast<char>(code_point);
+        return 1;
+    }
+    if (code_point < 0x800) {
+        out[0] = static_cast<char>(0xC0 | (code_point >> 6));
+        out[1] = static_cast<char>(0x80 | (code_point & 0x3F));
+        return 2;
+    }
+    if (code_point < 0x10000) {
+        out[0] = static_cast<char>(0xE0 | (code_point >> 12));
+        out[1] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out[2] = static_cast<char>(0x80 | (code_point & 0x3F));
+        return 3;
+    }
+    out[0] = static_cast<char>(0xF0 | (code_point >> 18));
+    out[1] = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+    out[2] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    out[3] = static_cast<char>(0x80 | (code_point & 0x3F));
+    return 4;
+}
+
+// Свёртка регистра может удлинить двухбайтовый символ до трёх байт, остальные преобразования не удлиняют текст
+size_t GetMaxNormalizedSize(size_t size) {
+    return size + size / 2 + 1;
+}
+
+// Нормализует text в буфер out (не меньше GetMaxNormalizedSize байт), возвращает конец записанного
+char* NormalizeSpan(std::string_view text, const AsciiTable& ascii, char* out) {
+    const char* in = text.data();
+    const char* const end = in + text.size();
+    char* last_begin = nullptr; // начало последнего записанного символа, с которым может составиться следующий знак
+    char32_t last = 0;
+    while (in < end) {
+        if (end - in >= 8) {
+            uint64_t block;
+            std::memcpy(&block, in, sizeof(block));
+            if ((block & ASCII_HIGH_BITS) == 0) {
+                for (int i = 0; i < 8; ++i) {
+                    out[i] = ascii[static_cast<uint8_t>(in[i])];
+                }
+                in += 8;
+                out += 8;
+                last_begin = out - 1;
+                last = static_cast<uint8_t>(out[-1]);
+                continue;
+            }
+        }
+        const uint8_t byte = static_cast<uint8_t>(*in);
+        if (byte < 0x80) {
+            *out = ascii[byte];
+            last_begin = out;
+            last = static_cast<uint8_t>(*out);
+            ++in;
+            ++out;
+            continue;
+        }
+        char32_t code_point = 0;
+        size_t length = 0;
+        if (SEQUENCE_LENGTHS[byte] == 2 && end - in >= 2 && (static_cast<uint8_t>(in[1]) & 0xC0) == 0x80) {
+            // Двухбайтовые последовательности (кириллица, греческий, диакритика латиницы) - без общего цикла декодирования
+            code_point = (static_cast<char32_t>(byte & 0x1F) << 6) | (static_cast<uint8_t>(in[1]) & 0x3F);
+            length = 2;
+        } else {
+            length = DecodeUtf8(in, static_cast<size_t>(end - in), code_point);
+        }
+        if (length == 0) {
+            *out++ = *in++;
+            last_begin = nullptr;
+            continue;
+        }
+        in += length;
+        if (last_begin != nullptr && IsCompositionMark(code_point)) {
+            if (const char32_t composed = Compose(last, code_point); composed != 0) {
+                out = last_begin;
+                code_point = composed;
+            }
+        }
+        code_point = MapCodePoint(code_point);
+        last_begin = out;
+        last = code_point;
+        out += EncodeUtf8(code_point, out);
+    }
+    return out;
+}
+
+// Условие запроса: синтаксис в начале и в конце слова сохраняется, середина нормализуется.
+// Минус-слово, от которого после нормализации ничего не осталось, пропускается
+char* NormalizeQueryTerm(std::string_view word, char* out) {
+    char* const word_begin = out;
+    const bool is_minus = word.front() == '-';
+    if (is_minus || word.front() == '"') {
+        *out++ = word.front();
+        word.remove_prefix(1);
+    }
+    const bool has_closing_quote = !word.empty() && word.back() == '"';
+    if (has_closing_quote) {
+        word.remove_suffix(1);
+    }
+    char* const body_begin = out;
+    char* body_end = NormalizeSpan(word, QUERY_ASCII, body_begin);
+    // Пунктуация по краям не должна отрывать синтаксис от слова
+    char* const first = std::find_if(body_begin, body_end, [](char c) {
+        return c != ' ';
+    });
+    while (body_end != first && body_end[-1] == ' ') {
+        --body_end;
+    }
+    if (first == body_end && is_minus) {
+        return word_begin;
+    }
+    out = std::copy(first, body_end, body_begin);
+    if (has_closing_quote) {
+        *out++ = '"';
+    }
+    return out;
+}
+
+// Слово запроса: операторы (AND, OR, NOT, NEAR/k) копируются как есть, скобки по краям слова сохраняются
+char* NormalizeQueryWord(std::string_view word, char* out) {
+    if (word == "AND"sv || word == "OR"sv || word == "NOT"sv || word.starts_with("NEAR/"sv)) {
+        std::memcpy(out, word.data(), word.size());
+        return out + word.size();
+    }
+    const size_t open_count = std::min(word.find_first_not_of('('), word.size());
+    out = std::fill_n(out, open_count, '(');
+    word.remove_prefix(open_count);
+    const size_t close_count = word.size() - (word.find_last_not_of(')') + 1);
+    word.remove_suffix(close_count);
+    if (!word.empty()) {
+        out = NormalizeQueryTerm(word, out);
+    }
+    return std::fill_n(out, close_count, ')');
+}
+
+} // namespace
+
+void NormalizeText(std::string_view text, NormalizationMode mode, std::string& normalized) {
+    normalized.resize(GetMaxNormalizedSize(text.size()));
+    char* const begin = normalized.data();
+    char* out = begin;
+    if (mode == NormalizationMode::DOCUMENT) {
+        out = NormalizeSpan(text, DOCUMENT_ASCII, begin);
+    } else {
+        std::vector<std::string_view> words;
+        string_processing::SplitIntoWordsView(text, words);
+        for (std::string_view word : words) {
+            char* const word_begin = out;
+            if (out != begin) {
+                *out++ = ' ';
+            }
+            char* const word_end = NormalizeQueryWord(word, out);
+            out = word_end == out ? word_begin : word_end;
+        }
+    }
+    normalized.resize(static_cast<size_t>(out - begin));
+}
+
+std::string NormalizeText(std::string_view text, NormalizationMode mode) {
+    std::string normalized;
+    NormalizeText(text, mode, normalized);
+    return normalized;
+}
+
+}; // namespace text_normalizer
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+
+namespace text_normalizer {
+
+// DOCUMENT - вся пунктуация становится пробелом.
+// QUERY - текст разбирается по словам и сохраняется синтаксис запроса: минус и кавычка в начале слова,
+// кавычка в конце слова, шаблоны * и ?, нечёткое ~, скобки по краям слова, слова NEAR/k, AND, OR, NOT (без свёртки регистра)
+enum class NormalizationMode {
+    DOCUMENT,
+    QUERY,
+};
+
+// Нормализация UTF-8 текста перед разбиением на слова:
+// - свёртка регистра (простая, один символ в один; "Кот" и "кот" - один термин);
+// - каноническая композиция NFC для пар база + комбинируемый знак (е + U+0308 -> ё), без переупорядочивания знаков;
+// - пунктуация (Unicode P*) и пробелы (Z*) заменяются пробелом.
+// ASCII обрабатывается блоками по 8 байт через таблицу, остальное декодируется по таблице длин последовательностей.
+// Управляющие символы и недопустимые байты UTF-8 копируются как есть. Результат пишется в normalized (он очищается)
+void NormalizeText(std::string_view text, NormalizationMode mode, std::string& normalized);
+
+std::string NormalizeText(std::string_view text, NormalizationMode mode = NormalizationMode::DOCUMENT);
+
+}; // namespace text_normalizer
@@ -0,0 +1,344 @@
+#include "write_ahead_log.h"
+
+#include "file_io.h"
+
+#include <array>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+
+namespace write_ahead_log {
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace {
+
+constexpr uint32_t CRC32C_POLYNOMIAL = 0x82F63B78; // отражённый полином Кастаньоли
+constexpr size_t FRAME_HEADER_SIZE = 8;
+constexpr std::string_view SNAPSHOT_MAGIC = "SRCHSNP1"sv;
+
+// Таблицы slicing-by-8: TABLES[k][b] - CRC байта b, за которым следуют k нулевых байт
+constexpr std::array<std::array<uint32_t, 256>, 8> MakeCrc32cTables() {
+    std::array<std::array<uint32_t, 256>, 8> tables{};
+    for (uint32_t byte = 0; byte < 256; ++byte) {
+        uint32_t crc = byte;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLYNOMIAL : 0);
+        }
+        tables[0][byte] = crc;
+    }
+    for (size_t k = 1; k < 8; ++k) {
+        for (uint32_t byte = 0; byte < 256; ++byte) {
+            const uint32_t previous = tables[k - 1][byte];
+            tables[k][byte] = (previous >> 8) ^ tables[0][previous & 0xFF];
+        }
+    }
+    return tables;
+}
+
+constexpr auto CRC32C_TABLES = MakeCrc32cTables();
+
+void AppendLittleEndian(std::string& out, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+uint64_t ReadLittleEndian(std::string_view data, size_t offset, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(data[offset + i])) << (8 * i);
+    }
+    return value;
+}
+
+// Последовательное чтение полезной нагрузки кадра; false при выходе за границу
+class PayloadReader {
+public:
+    explicit PayloadReader(std::string_view payload)
+        : payload_(payload) {
+    }
+
+    bool Read(size_t size, uint64_t& value) {
+        if (payload_.size() - offset_ < size) {
+            return false;
+        }
+        value = ReadLittleEndian(payload_, offset_, size);
+        offset_ += size;
+        return true;
+    }
+
+    bool Read(size_t size, std::string& value) {
+        if (payload_.size() - offset_ < size) {
+            return false;
+        }
+        value.assign(payload_.substr(offset_, size));
+        offset_ += size;
+        return true;
+    }
+
+    bool IsFinished() const {
+        return offset_ == payload_.size();
+    }
+
+private:
+    std::string_view payload_;
+    size_t offset_ = 0;
+};
+
+bool ParsePayload(std::string_view payload, LogRecord& record) {
+    PayloadReader reader(payload);
+    uint64_t type = 0;
+    uint64_t document_id = 0;
+    uint64_t status = 0;
+    uint64_t rating_count = 0;
+    if (!reader.Read(1, type) || !reader.Read(4, document_id) || !reader.Read(1, status) || !reader.Read(4, rating_count)) {
+        return false;
+    }
+    if (type < static_cast<uint64_t>(LogRecord::Type::ADD_DOCUMENT) || type > static_cast<uint64_t>(LogRecord::Type::ADD_RATINGS)
+        || status >= DOCUMENT_STATUS_COUNT) {
+        return false;
+    }
+    record.type = static_cast<LogRecord::Type>(type);
+    record.document_id = static_cast<int>(static_cast<uint32_t>(document_id));
+    record.status = static_cast<DocumentStatus>(status);
+    record.ratings.clear();
+    for (uint64_t i = 0; i < rating_count; ++i) {
+        uint64_t rating = 0;
+        if (!reader.Read(4, rating)) {
+            return false;
+        }
+        record.ratings.push_back(static_cast<int>(static_cast<uint32_t>(rating)));
+    }
+    uint64_t text_size = 0;
+    return reader.Read(4, text_size) && reader.Read(static_cast<size_t>(text_size), record.text) && reader.IsFinished();
+}
+
+std::string ReadFile(const std::filesystem::path& path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        return {};
+    }
+    std::ostringstream buffer;
+    buffer << input.rdbuf();
+    return std::move(buffer).str();
+}
+
+} // namespace
+
+uint32_t ComputeCrc32c(std::string_view data) {
+    uint32_t crc = 0xFFFFFFFF;
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+    size_t size = data.size();
+    while (size >= 8) {
+        const uint32_t low = crc ^ (static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8
+                                    | static_cast<uint32_t>(bytes[2]) << 16 | static_cast<uint32_t>(bytes[3]) << 24);
+        crc = CRC32C_TABLES[7][low & 0xFF] ^ CRC32C_TABLES[6][(low >> 8) & 0xFF]
+            ^ CRC32C_TABLES[5][(low >> 16) & 0xFF] ^ CRC32C_TABLES[4][low >> 24]
+            ^ CRC32C_TABLES[3][bytes[4]] ^ CRC32C_TABLES[2][bytes[5]]
+            ^ CRC32C_TABLES[1][bytes[6]] ^ CRC32C_TABLES[0][bytes[7]];
+        bytes += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = (crc >> 8) ^ CRC32C_TABLES[0][(crc ^ *bytes++) & 0xFF];
+    }
+    return ~crc;
+}
+
+void AppendFrame(std::string& out, const LogRecord& record) {
+    const size_t frame_begin = out.size();
+    out.append(FRAME_HEADER_SIZE, '\0');
+    AppendLittleEndian(out, static_cast<uint8_t>(record.type), 1);
+    AppendLittleEndian(out, static_cast<uint32_t>(record.document_id), 4);
+    AppendLittleEndian(out, static_cast<uint8_t>(record.status), 1);
+    AppendLittleEndian(out, record.ratings.size(), 4);
+    for (int rating : record.ratings) {
+        AppendLittleEndian(out, static_cast<uint32_t>(rating), 4);
+    }
+    AppendLittleEndian(out, record.text.size(), 4);
+    out += record.text;
+
+    const std::string_view payload = std::string_view(out).substr(frame_begin + FRAME_HEADER_SIZE);
+    const uint64_t header = payload.size() | static_cast<uint64_t>(ComputeCrc32c(payload)) << 32;
+    for (size_t i = 0; i < FRAME_HEADER_SIZE; ++i) {
+        out[frame_begin + i] = static_cast<char>(header >> (8 * i));
+    }
+}
+
+ParsedFrames ParseFrames(std::string_view data) {
+    ParsedFrames result;
+    while (data.size() - result.valid_bytes >= FRAME_HEADER_SIZE) {
+        const size_t payload_size = ReadLittleEndian(data, result.valid_bytes, 4);
+        const uint32_t checksum = static_cast<uint32_t>(ReadLittleEndian(data, result.valid_bytes + 4, 4));
+        if (data.size() - result.valid_bytes - FRAME_HEADER_SIZE < payload_size) {
+            break;
+        }
+        const std::string_view payload = data.substr(result.valid_bytes + FRAME_HEADER_SIZE, payload_size);
+        LogRecord record;
+        if (ComputeCrc32c(payload) != checksum || !ParsePayload(payload, record)) {
+            break;
+        }
+        result.records.push_back(std::move(record));
+        result.valid_bytes += FRAME_HEADER_SIZE + payload_size;
+    }
+    return result;
+}
+
+ParsedFrames ReadLogFile(const std::filesystem::path& path) {
+    return ParseFrames(ReadFile(path));
+}
+
+void WriteSnapshot(const std::filesystem::path& path, const Snapshot& snapshot) {
+    std::filesystem::path temporary_path = path;
+    temporary_path += ".tmp"s;
+
+    const int fd = file_io::OpenFile(temporary_path, file_io::OpenMode::TRUNCATE);
+    try {
+        std::string buffer(SNAPSHOT_MAGIC);
+        AppendLittleEndian(buffer, snapshot.next_log_generation, 8);
+        for (const LogRecord& record : snapshot.records) {
+            AppendFrame(buffer, record);
+            if (buffer.size() >= (1 << 20)) {
+                file_io::WriteAll(fd, buffer);
+                buffer.clear();
+            }
+        }
+        file_io::WriteAll(fd, buffer);
+        file_io::SyncFile(fd);
+    } catch (...) {
+        file_io::CloseFile(fd);
+        throw;
+    }
+    file_io::CloseFile(fd);
+    std::filesystem::rename(temporary_path, path);
+    file_io::SyncDirectory(path.parent_path());
+}
+
+Snapshot ReadSnapshot(const std::filesystem::path& path) {
+    const std::string data = ReadFile(path);
+    const size_t header_size = SNAPSHOT_MAGIC.size() + 8;
+    if (data.size() < header_size || std::string_view(data).substr(0, SNAPSHOT_MAGIC.size()) != SNAPSHOT_MAGIC) {
+        throw std::runtime_error("Snapshot "s + path.string() + " is corrupted"s);
+    }
+    Snapshot snapshot;
+    snapshot.next_log_generation = ReadLittleEndian(data, SNAPSHOT_MAGIC.size(), 8);
+    ParsedFrames frames = ParseFrames(std::string_view(data).substr(header_size));
+    if (header_size + frames.valid_bytes != data.size()) {
+        throw std::runtime_error("Snapshot "s + path.string() + " is corrupted"s);
+    }
+    snapshot.records = std::move(frames.records);
+    return snapshot;
+}
+
+WriteAheadLog::WriteAheadLog(const std::filesystem::path& path, GroupCommitOptions options)
+    : fd_(file_io::OpenFile(path, file_io::OpenMode::APPEND))
+    , options_(options)
+    , flusher_([this] { FlushLoop(); }) {
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    try {
+        Close();
+    } catch (...) {
+    }
+}
+
+uint64_t WriteAheadLog::Append(const LogRecord& record) {
+    std::unique_lock lock(mutex_);
+    flushed_.wait(lock, [this] {
+        return pending_.size() < options_.max_pending_bytes || error_;
+    });
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+    if (stopping_) {
+        throw std::logic_error("Write-ahead log is closed"s);
+    }
+    AppendFrame(pending_, record);
+    if (pending_.size() >= options_.batch_bytes) {
+        flush_requested_.notify_one();
+    }
+    return ++appended_;
+}
+
+void WriteAheadLog::WaitDurable(uint64_t sequence) {
+    std::unique_lock lock(mutex_);
+    if (sync_target_ < sequence) {
+        sync_target_ = sequence;
+        flush_requested_.notify_one();
+    }
+    flushed_.wait(lock, [this, sequence] {
+        return durable_ >= sequence || error_;
+    });
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+void WriteAheadLog::Sync() {
+    uint64_t sequence = 0;
+    {
+        std::lock_guard guard(mutex_);
+        sequence = appended_;
+    }
+    WaitDurable(sequence);
+}
+
+void WriteAheadLog::Close() {
+    {
+        std::lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    flush_requested_.notify_one();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+    if (fd_ >= 0) {
+        file_io::CloseFile(fd_);
+        fd_ = -1;
+    }
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+void WriteAheadLog::FlushLoop() {
+    std::string writing;
+    std::unique_lock lock(mutex_);
+    while (true) {
+        flush_requested_.wait_for(lock, options_.batch_interval, [this] {
+            return stopping_ || pending_.size() >= options_.batch_bytes || sync_target_ > durable_;
+        });
+        // После ошибки записи журнал больше не пишется: её получат следующие Append и Sync
+        if (error_ || (stopping_ && pending_.empty())) {
+            return;
+        }
+        if (pending_.empty()) {
+            continue;
+        }
+        // Пакет забирается целиком, новые записи копятся в pending_ параллельно с записью на диск
+        writing.swap(pending_);
+        const uint64_t batch_end = appended_;
+        lock.unlock();
+        std::exception_ptr error;
+        try {
+            file_io::WriteAll(fd_, writing);
+            file_io::SyncData(fd_);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        writing.clear();
+        lock.lock();
+        if (error) {
+            error_ = error;
+        } else {
+            durable_ = batch_end;
+        }
+        flushed_.notify_all();
+    }
+}
+
+}; // namespace write_ahead_log
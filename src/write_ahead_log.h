@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+
+
+namespace write_ahead_log {
+
+using namespace document;
+
+// Операция над индексом, записываемая в журнал и снимок
+struct LogRecord {
+    enum class Type : uint8_t {
+        ADD_DOCUMENT = 1,
+        REMOVE_DOCUMENT = 2,
+        SET_DOCUMENT_STATUS = 3,
+        ADD_RATINGS = 4,
+    };
+
+    Type type = Type::ADD_DOCUMENT;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL; // для ADD_DOCUMENT и SET_DOCUMENT_STATUS
+    std::vector<int> ratings;                       // для ADD_DOCUMENT и ADD_RATINGS
+    std::string text;                               // только для ADD_DOCUMENT
+};
+
+// CRC32C (полином Кастаньоли), табличный вариант slicing-by-8
+uint32_t ComputeCrc32c(std::string_view data);
+
+// Дописывает кадр записи: длина полезной нагрузки (uint32), CRC32C нагрузки (uint32), нагрузка. Числа little-endian
+void AppendFrame(std::string& out, const LogRecord& record);
+
+struct ParsedFrames {
+    std::vector<LogRecord> records;
+    size_t valid_bytes = 0; // длина корректного начала данных; остальное - оборванный или повреждённый хвост
+};
+
+// Разбирает кадры до конца data или до первого оборванного или повреждённого кадра
+ParsedFrames ParseFrames(std::string_view data);
+
+// Читает журнал целиком (пустой результат, если файла нет)
+ParsedFrames ReadLogFile(const std::filesystem::path& path);
+
+// Снимок: все живые документы в порядке добавления и номер первого журнала, не вошедшего в снимок
+struct Snapshot {
+    uint64_t next_log_generation = 0;
+    std::vector<LogRecord> records;
+};
+
+// Пишет снимок во временный файл, сбрасывает его на диск и атомарно переименовывает в path
+void WriteSnapshot(const std::filesystem::path& path, const Snapshot& snapshot);
+
+// Читает снимок; повреждённый снимок - std::runtime_error
+Snapshot ReadSnapshot(const std::filesystem::path& path);
+
+// Настройки группового сброса журнала на диск
+struct GroupCommitOptions {
+    size_t batch_bytes = 1 << 20;                     // сбрасывать, как только накопилось столько байт
+    std::chrono::milliseconds batch_interval{ 10 };   // и не реже, чем раз в этот интервал
+    size_t max_pending_bytes = 16 << 20;              // Append ждёт, пока на диск не уйдёт часть накопленного
+};
+
+// Журнал упреждающей записи с групповым сбросом (group commit).
+// Append только кодирует запись в память; фоновый поток пишет накопленное одной записью и одним fdatasync (_commit на Windows),
+// так что все записи пакета становятся надёжными за один сброс. Sync ждёт, пока на диск попадут все записи,
+// добавленные до вызова. Ошибка записи фонового потока запоминается: журнал больше не пишется,
+// а каждый следующий Append, Sync и Close бросает её
+class WriteAheadLog {
+public:
+    // Открывает журнал на дозапись, создавая файл при необходимости
+    explicit WriteAheadLog(const std::filesystem::path& path, GroupCommitOptions options = {});
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Закрывает журнал, если Close не вызывался; ошибка записи при этом теряется
+    ~WriteAheadLog();
+
+    // Порядковый номер записи (с единицы). После Close - std::logic_error
+    uint64_t Append(const LogRecord& record);
+
+    // Ждёт, пока на диск попадут записи с номерами до sequence включительно
+    void WaitDurable(uint64_t sequence);
+
+    void Sync();
+
+    // Сбрасывает на диск всё накопленное, останавливает фоновый поток и закрывает файл.
+    // Бросает ошибку записи, если не все записи попали на диск
+    void Close();
+
+private:
+    int fd_ = -1;
+    GroupCommitOptions options_;
+
+    std::mutex mutex_;
+    std::condition_variable flush_requested_;
+    std::condition_variable flushed_;
+    std::string pending_;       // закодированные, но ещё не записанные кадры
+    uint64_t appended_ = 0;     // номер последней добавленной записи
+    uint64_t durable_ = 0;      // номер последней записи, сброшенной на диск
+    uint64_t sync_target_ = 0;  // до какой записи нужно сбросить без ожидания пакета
+    bool stopping_ = false;
+    std::exception_ptr error_;
+    std::thread flusher_;
+
+    void FlushLoop();
+};
+
+}; // namespace write_ahead_log
@@ -1,16 +1,28 @@
+#include "../src/durable_search_server.h"
+#include "../src/file_io.h"
 #include "../src/paginator.h"
+#include "../src/query_protocol.h"
 #include "../src/search_server.h"
 #include "../src/request_queue.h"
+#include "../src/result_writer.h"
+#include "../src/search_paginator.h"
 #include "../src/string_processing.h"
 
 #include "log_duration.h"
 #include "test_framework.h"
 
+#include <atomic>
 #include <cmath>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <list>
 #include <numeric>
+#include <sstream>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <thread>
 #include <vector>
 #include <unordered_set>
 
@@ -18,11 +30,17 @@
 namespace tests {
 
 using namespace std::string_literals;
+using namespace std::string_view_literals;
 
 using namespace test_framework;
 using namespace search_server;
 using namespace request_queue;
 using namespace paginator;
+using namespace search_paginator;
+using namespace result_writer;
+using namespace write_ahead_log;
+using namespace durable_search_server;
+using namespace query_protocol;
 
 void TestDocumentsComparison() {
     Document doc1(1, 0.9, 5);
@@ -394,6 +412,1745 @@ void TestSplitIntoWords() {
     ASSERT_EQUAL(empty_result.size(), 0);
 }
 
+void TestSplitIntoWordsView() {
+    std::vector<std::string_view> words;
+
+    // Повторяющиеся пробелы схлопываются, пробелы по краям игнорируются
+    ASSERT(SplitIntoWordsView("  curly   cat  tail "sv, words));
+    ASSERT(words == std::vector<std::string_view>({"curly"sv, "cat"sv, "tail"sv}));
+
+    // Длинный текст проходит через SIMD-блоки, слова на границах блоков не разрываются
+    std::string long_text;
+    std::vector<std::string> expected;
+    for (int i = 0; i < 100; ++i) {
+        expected.push_back("word"s + std::to_string(i * 37));
+        long_text += expected.back() + std::string(static_cast<size_t>(i % 3 + 1), ' ');
+    }
+    ASSERT(SplitIntoWordsView(long_text, words));
+    ASSERT_EQUAL(words.size(), expected.size());
+    ASSERT(std::ranges::equal(words, expected));
+
+    // Управляющие символы обнаруживаются за тот же проход, в том числе в SIMD-блоках
+    ASSERT(!SplitIntoWordsView("cat\x01dog"sv, words));
+    long_text[70] = '\t';
+    ASSERT(!SplitIntoWordsView(long_text, words));
+
+    // Символы UTF-8 допустимы
+    ASSERT(SplitIntoWordsView("пушистый кот"sv, words));
+    ASSERT_EQUAL(words.size(), 2);
+
+    ASSERT(SplitIntoWordsView(""sv, words));
+    ASSERT(words.empty());
+}
+
+void TestPositionsEncoding() {
+    const std::vector<uint32_t> positions = {0, 1, 5, 200, 70000, 70001};
+    std::vector<uint32_t> decoded;
+    DecodePositions(EncodePositions(positions), decoded);
+    ASSERT(decoded == positions);
+
+    ASSERT(HasPhrase({{0, 4, 9}, {2, 5, 12}, {6}}));
+    ASSERT(!HasPhrase({{0, 4, 9}, {2, 5, 12}, {7}}));
+    ASSERT(HasNear({10, 50}, {3, 47}, 3));
+    ASSERT(!HasNear({10, 50}, {3, 46}, 3));
+}
+
+void TestPhraseQuery() {
+    IndexOptions options;
+    options.store_positions = true;
+    SearchServer server("the"s, options);
+    server.AddDocument(1, "lost cat with blue collar"s, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(2, "cat lost near the park"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(3, "lost the cat in the alley"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "blue dog"s, DocumentStatus::ACTUAL, {2});
+
+    // Документ 2 содержит оба слова, но не подряд; стоп-слова внутри фразы не учитываются
+    const auto results = server.FindTopDocuments("\"lost cat\""s);
+    ASSERT_EQUAL(results.size(), 2);
+    ASSERT(results[0].id == 1 || results[0].id == 3);
+    ASSERT(results[1].id == 1 || results[1].id == 3);
+
+    // Фраза сочетается с обычными плюс- и минус-словами
+    const auto mixed = server.FindTopDocuments("\"lost cat\" dog -alley"s);
+    ASSERT_EQUAL(mixed.size(), 2);
+
+    const auto [words, status] = server.MatchDocument("\"lost cat\""s, 2);
+    ASSERT(words.empty());
+
+    try {
+        server.FindTopDocuments("\"lost cat"s);
+        ASSERT_HINT(false, "Unterminated phrase must be rejected"s);
+    } catch (const std::invalid_argument&) {
+    }
+}
+
+void TestNearQuery() {
+    IndexOptions options;
+    options.store_positions = true;
+    SearchServer server(""s, options);
+    server.AddDocument(1, "lost black and white cat"s, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(2, "cat was lost"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(3, "lost dog found cat"s, DocumentStatus::ACTUAL, {3});
+
+    auto results = server.FindTopDocuments("lost NEAR/2 cat"s);
+    ASSERT_EQUAL(results.size(), 1);
+    ASSERT_EQUAL(results[0].id, 2);
+
+    results = server.FindTopDocuments("lost NEAR/4 cat"s);
+    ASSERT_EQUAL(results.size(), 3);
+}
+
+void TestPhraseWithoutPositions() {
+    SearchServer server("the"s);
+    server.AddDocument(1, "lost cat"s, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(2, "cat lost in the garden"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(3, "white dog"s, DocumentStatus::ACTUAL, {3});
+
+    // Без позиционного индекса фразы и NEAR/k - запрос из тех же слов без проверки порядка и расстояния
+    for (const std::string& query : {"\"lost cat\""s, "lost NEAR/1 cat"s, "\"lost the cat\""s}) {
+        ASSERT_HINT(server.FindTopDocuments(query) == server.FindTopDocuments("lost cat"s), "Bag-of-words fallback for "s + query);
+    }
+    ASSERT_EQUAL(server.FindTopDocuments("\"lost cat\""s).size(), 2);
+    ASSERT_EQUAL(server.FindTopDocuments("white NEAR/2 dog NEAR/3 cat"s).size(), 3);
+    // Фраза из одного слова - обычное плюс-слово
+    ASSERT_EQUAL(server.FindTopDocuments("\"cat\""s).size(), 2);
+
+    // Синтаксические ошибки по-прежнему отклоняются
+    for (const std::string& query : {"\"lost cat"s, "lost NEAR/x cat"s, "lost NEAR/2"s}) {
+        try {
+            server.FindTopDocuments(query);
+            ASSERT_HINT(false, "Malformed query must be rejected: "s + query);
+        } catch (const std::invalid_argument&) {
+        }
+    }
+}
+
+void TestTermDictionary() {
+    std::vector<std::string> words;
+    for (int i = 0; i < 1000; ++i) {
+        words.push_back("hamster"s + std::to_string(i));
+    }
+    words.push_back("cat"s);
+    words.push_back("catalog"s);
+    words.push_back("dog"s);
+    std::sort(words.begin(), words.end());
+    const TermDictionary dictionary(std::vector<std::string_view>(words.begin(), words.end()));
+
+    ASSERT_EQUAL(dictionary.GetSize(), words.size());
+    for (size_t i = 0; i < words.size(); i += 37) {
+        ASSERT_EQUAL(TermDictionary::Cursor(dictionary, i).GetTerm(), words[i]);
+        ASSERT_EQUAL(dictionary.LowerBound(words[i]), i);
+    }
+    ASSERT(dictionary.Contains("catalog"sv));
+    ASSERT(!dictionary.Contains("cats"sv));
+    ASSERT_EQUAL(dictionary.LowerBound("zebra"sv), words.size());
+
+    ASSERT(dictionary.ExpandPrefix("cat"sv, 10) == std::vector<std::string>({"cat"s, "catalog"s}));
+    ASSERT_EQUAL(dictionary.ExpandPrefix("hamster"sv, 5).size(), 5);
+    ASSERT(dictionary.ExpandPattern("hamster99?"sv, 100) == std::vector<std::string>({"hamster990"s, "hamster991"s,
+        "hamster992"s, "hamster993"s, "hamster994"s, "hamster995"s, "hamster996"s, "hamster997"s, "hamster998"s, "hamster999"s}));
+    ASSERT(dictionary.ExpandPattern("c*g"sv, 10) == std::vector<std::string>({"catalog"s}));
+
+    // Префиксное кодирование компактнее ключей хеш-таблицы (sizeof(std::string) на ключ без учёта узлов)
+    ASSERT(dictionary.GetMemoryUsage() < words.size() * sizeof(std::string));
+}
+
+void TestWildcardQuery() {
+    IndexOptions options;
+    options.expand_wildcards = true;
+    options.max_wildcard_expansions = 2;
+    SearchServer server("and"s, options);
+    server.AddDocument(1, "cat and catalog"s, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(2, "caterpillar"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(3, "dog"s, DocumentStatus::ACTUAL, {3});
+
+    // Раскрытие ограничено двумя терминами: cat, catalog
+    auto results = server.FindTopDocuments("cat*"s);
+    ASSERT_EQUAL(results.size(), 1);
+    ASSERT_EQUAL(results[0].id, 1);
+
+    results = server.FindTopDocuments("cate*"s);
+    ASSERT_EQUAL(results.size(), 1);
+    ASSERT_EQUAL(results[0].id, 2);
+
+    // Словарь перестраивается после добавления новых слов
+    server.AddDocument(4, "dogma"s, DocumentStatus::ACTUAL, {2});
+    ASSERT_EQUAL(server.FindTopDocuments("do*"s).size(), 2);
+    ASSERT_EQUAL(server.FindTopDocuments("do* -dogm?"s).size(), 1);
+
+    const auto [words, status] = server.MatchDocument("catalo*"s, 1);
+    ASSERT(words == std::vector<std::string>({"catalog"s}));
+
+    try {
+        server.FindTopDocuments("*cat"s);
+        ASSERT_HINT(false, "Leading wildcard must be rejected"s);
+    } catch (const std::invalid_argument&) {
+    }
+
+    // Без expand_wildcards '*' и '?' - обычные символы слова
+    SearchServer literal("and"s);
+    literal.AddDocument(1, "what? cat*"s, DocumentStatus::ACTUAL, {1});
+    literal.AddDocument(2, "what cat"s, DocumentStatus::ACTUAL, {2});
+    results = literal.FindTopDocuments("what?"s);
+    ASSERT_EQUAL(results.size(), 1);
+    ASSERT_EQUAL(results[0].id, 1);
+    ASSERT_EQUAL(literal.FindTopDocuments("cat* ?"s).size(), 1);
+}
+
+void TestFuzzyExpansion() {
+    std::vector<std::string> words = {"hamster"s, "hamsters"s, "hammer"s, "hamstring"s, "ham"s, "monster"s};
+    std::sort(words.begin(), words.end());
+    const TermDictionary dictionary(std::vector<std::string_view>(words.begin(), words.end()));
+
+    auto matches = dictionary.ExpandFuzzy("hamstr"sv, 1, 10);
+    ASSERT_EQUAL(matches.size(), 1);
+    ASSERT_EQUAL(matches[0].term, "hamster"s);
+    ASSERT_EQUAL(matches[0].distance, 1);
+
+    matches = dictionary.ExpandFuzzy("hamstr"sv, 2, 10);
+    std::vector<std::string> terms;
+    for (const auto& match : matches) {
+        terms.push_back(match.term);
+    }
+    std::sort(terms.begin(), terms.end());
+    ASSERT(terms == std::vector<std::string>({"hammer"s, "hamster"s, "hamsters"s}));
+    ASSERT_EQUAL(matches[0].term, "hamster"s);
+
+    ASSERT_EQUAL(dictionary.ExpandFuzzy("hammer"sv, 1, 10)[0].distance, 0);
+    ASSERT(dictionary.ExpandFuzzy("zzz"sv, 2, 10).empty());
+
+    // Сверка с полным перебором на плотном словаре из слов над алфавитом {a, b, c}
+    const auto levenshtein = [](std::string_view lhs, std::string_view rhs) {
+        std::vector<size_t> row(rhs.size() + 1);
+        std::iota(row.begin(), row.end(), 0);
+        for (size_t i = 1; i <= lhs.size(); ++i) {
+            size_t diagonal = row[0];
+            row[0] = i;
+            for (size_t j = 1; j <= rhs.size(); ++j) {
+                const size_t up = row[j];
+                row[j] = std::min({ row[j] + 1, row[j - 1] + 1, diagonal + (lhs[i - 1] == rhs[j - 1] ? 0 : 1) });
+                diagonal = up;
+            }
+        }
+        return row.back();
+    };
+    std::vector<std::string> dense;
+    for (int length = 1; length <= 5; ++length) {
+        for (int code = 0; code < static_cast<int>(std::pow(3, length)); ++code) {
+            std::string word;
+            for (int i = 0, rest = code; i < length; ++i, rest /= 3) {
+                word.push_back(static_cast<char>('a' + rest % 3));
+            }
+            dense.push_back(word);
+        }
+    }
+    std::sort(dense.begin(), dense.end());
+    const TermDictionary dense_dictionary(std::vector<std::string_view>(dense.begin(), dense.end()));
+    for (std::string_view query : {"abca"sv, "ccc"sv, "b"sv, "abcab"sv, "bbbbbb"sv, "abcabca"sv, ""sv}) {
+        for (int distance : {1, 2}) {
+            size_t expected = 0;
+            for (const std::string& word : dense) {
+                expected += levenshtein(query, word) <= static_cast<size_t>(distance);
+                ASSERT_EQUAL(ComputeEditDistance(word, query, distance),
+                             static_cast<int>(std::min(levenshtein(query, word), static_cast<size_t>(distance) + 1)));
+            }
+            const auto found = dense_dictionary.ExpandFuzzy(query, distance, dense.size());
+            ASSERT_EQUAL(found.size(), expected);
+            for (const auto& match : found) {
+                ASSERT_EQUAL(levenshtein(query, match.term), static_cast<size_t>(match.distance));
+            }
+        }
+    }
+}
+
+void TestFuzzyQuery() {
+    IndexOptions options;
+    options.expand_fuzzy = true;
+    SearchServer server("with"s, options);
+    server.AddDocument(1, "small hamster with brown fur"s, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(2, "white hamstr"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(3, "big dog"s, DocumentStatus::ACTUAL, {3});
+
+    // Без тильды нечёткий поиск не выполняется
+    auto results = server.FindTopDocuments("hamsterr"s);
+    ASSERT(results.empty());
+
+    results = server.FindTopDocuments("hamstr~"s);
+    ASSERT_EQUAL(results.size(), 2);
+    // Точное совпадение весит больше нечёткого
+    ASSERT_EQUAL(results[0].id, 2);
+
+    results = server.FindTopDocuments("hamsterr~ -whit~"s);
+    ASSERT_EQUAL(results.size(), 1);
+    ASSERT_EQUAL(results[0].id, 1);
+
+    ASSERT_EQUAL(server.FindTopDocuments("dgo~"s).size(), 0);
+    ASSERT_EQUAL(server.FindTopDocuments("dgo~2"s).size(), 1);
+
+    // Нечёткое стоп-слово отбрасывается, а не раскрывается в похожие слова (wit)
+    server.AddDocument(4, "quick wit"s, DocumentStatus::ACTUAL, {2});
+    ASSERT(server.FindTopDocuments("with~"s).empty());
+    ASSERT_EQUAL(server.FindTopDocuments("wot~"s).size(), 1);
+
+    // Без expand_fuzzy '~' - обычный символ слова
+    SearchServer literal("with"s);
+    literal.AddDocument(1, "hamster"s, DocumentStatus::ACTUAL, {1});
+    literal.AddDocument(2, "hamstr~ c++~2"s, DocumentStatus::ACTUAL, {2});
+    results = literal.FindTopDocuments("hamstr~"s);
+    ASSERT_EQUAL(results.size(), 1);
+    ASSERT_EQUAL(results[0].id, 2);
+    ASSERT_EQUAL(literal.FindTopDocuments("c++~2"s).size(), 1);
+
+    // Раскрытие по словарям сегментов и перебору изменяемого сегмента совпадает с раскрытием по одному сегменту
+    // вперемешку с добавлением документов. Термины удалённых документов остаются в неизменяемых сегментах
+    // до слияния и могут занять место в ограниченном раскрытии, поэтому удаления проверяются без ограничения
+    const std::vector<std::string> vocabulary = {"cat"s, "cart"s, "cast"s, "coat"s, "bat"s, "hat"s, "chat"s, "car"s, "cap"s, "cut"s};
+    for (const bool with_removals : {false, true}) {
+        IndexOptions reference_options;
+        reference_options.expand_fuzzy = true;
+        reference_options.expand_wildcards = true;
+        reference_options.max_fuzzy_expansions = with_removals ? 100 : 3;
+        reference_options.max_wildcard_expansions = with_removals ? 100 : 3;
+        reference_options.segments.max_mutable_postings = 1000000;
+        IndexOptions segmented_options = reference_options;
+        segmented_options.segments.max_mutable_postings = 8;
+        segmented_options.segments.merge_factor = 3;
+        SearchServer reference("and"s, reference_options);
+        SearchServer segmented("and"s, segmented_options);
+        for (int id = 0; id < 60; ++id) {
+            std::string text;
+            for (int i = 0; i < 3; ++i) {
+                text += vocabulary[static_cast<size_t>(id * 7 + i * 3) % vocabulary.size()] + std::to_string(id % 4) + ' ';
+            }
+            reference.AddDocument(id, text, DocumentStatus::ACTUAL, {id});
+            segmented.AddDocument(id, text, DocumentStatus::ACTUAL, {id});
+            if (with_removals && id % 9 == 8) {
+                reference.RemoveDocument(id - 4);
+                segmented.RemoveDocument(id - 4);
+            }
+            for (const std::string& query : {"cat1~"s, "cat2~2"s, "hat0~ -car0~"s, "ca*"s, "c?t3"s}) {
+                ASSERT_HINT(segmented.FindTopDocuments(query, PageRequest{ .limit = 100 })
+                                == reference.FindTopDocuments(query, PageRequest{ .limit = 100 }),
+                            "Segmented expansion differs for "s + query);
+            }
+        }
+        ASSERT(segmented.GetIndexStats().segments.size() > 1);
+    }
+}
+
+void TestBm25Ranking() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "cat dog bird fish"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(3, "dog and bird"s, DocumentStatus::ACTUAL, {1});
+
+    // TF-IDF - политика по умолчанию
+    ASSERT(server.FindTopDocuments("cat"s) == server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, TfIdfRanking{}));
+
+    const Bm25Ranking bm25{ .k1 = 1.5, .b = 0.75 };
+    const auto results = server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, bm25);
+    ASSERT_EQUAL(results.size(), 2);
+
+    // Длины документов без стоп-слов: 1, 4, 2; средняя длина 7 / 3
+    const double average_length = 7.0 / 3.0;
+    const double idf = std::log(1.0 + (3 - 2 + 0.5) / (2 + 0.5));
+    const auto expected_score = [&](int length) {
+        return idf * (bm25.k1 + 1.0) / (1.0 + bm25.k1 * (1.0 - bm25.b + bm25.b * length / average_length));
+    };
+    // Короткий документ с тем же числом вхождений выше длинного
+    ASSERT_EQUAL(results[0].id, 1);
+    ASSERT(std::abs(results[0].relevance - expected_score(1)) < 1e-9);
+    ASSERT_EQUAL(results[1].id, 2);
+    ASSERT(std::abs(results[1].relevance - expected_score(4)) < 1e-9);
+
+    // Без нормализации по длине (b = 0) вклад одного вхождения одинаков
+    const auto flat = server.FindTopDocuments("cat"s, [](int, DocumentStatus, int) { return true; }, Bm25Ranking{ .b = 0.0 });
+    ASSERT(std::abs(flat[0].relevance - flat[1].relevance) < 1e-9);
+}
+
+void TestLazyPagination() {
+    std::vector<int> data(10);
+    std::iota(data.begin(), data.end(), 1);
+
+    const auto pages = Paginate(data, 3);
+    ASSERT_EQUAL(pages.size(), 4);
+
+    // Произвольный доступ к странице без обхода предыдущих
+    const auto third = pages[2];
+    ASSERT(std::ranges::equal(std::vector<int>(third.begin(), third.end()), std::vector<int>({7, 8, 9})));
+    ASSERT_EQUAL(pages[3].size(), 1);
+
+    try {
+        pages[4];
+        ASSERT_HINT(false, "Page out of range must be rejected"s);
+    } catch (const std::out_of_range&) {
+    }
+
+    // Последовательный обход двунаправленного диапазона
+    const std::list<int> list(data.begin(), data.end());
+    std::vector<size_t> page_sizes;
+    for (const auto& page : Paginate(list, 4)) {
+        page_sizes.push_back(page.size());
+    }
+    ASSERT(page_sizes == std::vector<size_t>({4, 4, 2}));
+
+    ASSERT_EQUAL(Paginate(std::vector<int>{}, 3).size(), 0);
+    try {
+        Paginate(data, 0);
+        ASSERT_HINT(false, "Zero page size must be rejected"s);
+    } catch (const std::invalid_argument&) {
+    }
+}
+
+void TestSearchPagination() {
+    SearchServer server;
+    for (int id = 0; id < 20; ++id) {
+        server.AddDocument(id, "cat"s + std::string(static_cast<size_t>(id), 'x') + " cat"s, DocumentStatus::ACTUAL, {id});
+    }
+    const auto all = server.FindTopDocuments("cat"s, [](int, DocumentStatus, int) { return true; }, PageRequest{ .limit = 100 });
+    ASSERT_EQUAL(all.size(), 20);
+
+    const auto pages = PaginateSearch(server, "cat"s, 6);
+    const auto third = pages[2];
+    ASSERT_EQUAL(third.size(), 6);
+    ASSERT(std::equal(third.begin(), third.end(), all.begin() + 12));
+    ASSERT_EQUAL(pages[3].size(), 2);
+    ASSERT(pages[4].empty());
+
+    auto cursor = pages.GetCursor();
+    std::vector<Document> collected;
+    while (cursor.HasMore()) {
+        const auto page = cursor.NextPage();
+        collected.insert(collected.end(), page.begin(), page.end());
+    }
+    ASSERT(collected == all);
+}
+
+void TestOffsetLimitAndSearchAfter() {
+    SearchServer server;
+    for (int id = 0; id < 12; ++id) {
+        // Релевантность убывает с ростом ID, у документов 4-7 одинаковая релевантность и рейтинг
+        const int extra_words = id < 4 ? id : id < 8 ? 4 : id;
+        server.AddDocument(id, "cat"s + std::string(static_cast<size_t>(extra_words), ' ') + std::string(static_cast<size_t>(extra_words) * 2, 'x')
+            + " dog"s, DocumentStatus::ACTUAL, {id < 8 ? 1 : id});
+    }
+    const auto all = server.FindTopDocuments("cat"s, PageRequest{ .limit = 100 });
+    ASSERT_EQUAL(all.size(), 12);
+
+    // По умолчанию окно выдачи прежнее - MAX_RESULT_DOCUMENT_COUNT
+    ASSERT(server.FindTopDocuments("cat"s) == std::vector<Document>(all.begin(), all.begin() + MAX_RESULT_DOCUMENT_COUNT));
+
+    const auto window = server.FindTopDocuments("cat"s, { .offset = 5, .limit = 4 });
+    ASSERT(window == std::vector<Document>(all.begin() + 5, all.begin() + 9));
+    ASSERT(server.FindTopDocuments("cat"s, { .offset = 20, .limit = 4 }).empty());
+
+    // search-after проходит ту же выдачу без пропусков и повторов, в том числе среди равных документов
+    std::vector<Document> collected;
+    std::vector<Document> page = server.FindTopDocuments("cat"s, { .offset = 0, .limit = 3 });
+    while (!page.empty()) {
+        collected.insert(collected.end(), page.begin(), page.end());
+        page = server.FindTopDocumentsAfter("cat"s, page.back(), 3);
+    }
+    ASSERT(collected == all);
+}
+
+void TestFileIo() {
+    const std::filesystem::path path = std::filesystem::temp_directory_path()
+        / ("search-server-file-io-test-"s + std::to_string(file_io::GetProcessId()));
+    std::filesystem::remove(path);
+
+    // Сборная запись больше одной пачки writev, с пустыми фрагментами
+    std::vector<std::string> parts;
+    std::vector<file_io::WriteBuffer> buffers;
+    std::string expected;
+    for (int i = 0; i < 300; ++i) {
+        parts.push_back(std::string(static_cast<size_t>(i % 7) * 3, static_cast<char>('a' + i % 26)));
+    }
+    for (const std::string& part : parts) {
+        buffers.push_back({ part.data(), part.size() });
+        expected += part;
+    }
+    int fd = file_io::OpenFile(path, file_io::OpenMode::CREATE_NEW);
+    file_io::WriteAll(fd, buffers);
+    // Запись по смещению не сдвигает позицию и перезаписывает данные
+    file_io::WriteAt(fd, "XYZ"sv, 5);
+    expected.replace(5, 3, "XYZ"s);
+    file_io::WriteAll(fd, "tail"sv);
+    expected += "tail"s;
+    file_io::SyncData(fd);
+    const std::shared_ptr<const void> mapping = file_io::MapReadOnly(fd, expected.size());
+    file_io::CloseFile(fd);
+    ASSERT(std::string_view(static_cast<const char*>(mapping.get()), expected.size()) == expected);
+
+    try {
+        file_io::OpenFile(path, file_io::OpenMode::CREATE_NEW);
+        ASSERT_HINT(false, "Existing file must not be opened as new"s);
+    } catch (const std::system_error&) {
+    }
+    fd = file_io::OpenFile(path, file_io::OpenMode::APPEND);
+    file_io::WriteAll(fd, "!"sv);
+    file_io::SyncFile(fd);
+    file_io::CloseFile(fd);
+    ASSERT_EQUAL(std::filesystem::file_size(path), expected.size() + 1);
+    std::filesystem::remove(path);
+    file_io::SyncDirectory(path.parent_path());
+}
+
+void TestResultWriter() {
+    const std::vector<Document> documents = { {1, 0.47428, 5}, {12, 1.0 / 3.0, -7}, {3, 1.0E-7, 0}, {4, 1234567.0, 2} };
+
+    // Текстовый формат совпадает с operator<<
+    ResultWriter writer;
+    writer.AppendText(documents);
+    std::ostringstream expected;
+    for (const Document& document : documents) {
+        expected << document;
+    }
+    ASSERT_EQUAL(writer.ToString(), expected.str());
+
+    writer.Clear();
+    ASSERT_EQUAL(writer.GetSize(), 0);
+    writer.AppendJson({ {1, 0.5, 5}, {2, 0.25, -3} });
+    ASSERT_EQUAL(writer.ToString(), R"([{"document_id":1,"relevance":0.5,"rating":5},{"document_id":2,"relevance":0.25,"rating":-3}])"s);
+    writer.Clear();
+    writer.AppendJson({});
+    ASSERT_EQUAL(writer.ToString(), "[]"s);
+
+    // Бинарный формат восстанавливается без потери точности
+    writer.Clear();
+    writer.AppendBinary(documents);
+    const std::string binary = writer.ToString();
+    ASSERT_EQUAL(binary.size(), 4 + documents.size() * ResultWriter::BINARY_DOCUMENT_SIZE);
+    const auto parsed = ParseBinary(binary);
+    ASSERT_EQUAL(parsed.size(), documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        ASSERT_EQUAL(parsed[i].id, documents[i].id);
+        ASSERT_EQUAL(parsed[i].rating, documents[i].rating);
+        ASSERT(parsed[i].relevance == documents[i].relevance);
+    }
+    try {
+        ParseBinary(binary.substr(0, binary.size() - 1));
+        ASSERT_HINT(false, "Truncated binary result must be rejected"s);
+    } catch (const std::invalid_argument&) {
+    }
+
+    // Данные больше одного блока не теряются на границах блоков
+    writer.Clear();
+    std::string large;
+    for (int i = 0; i < 5000; ++i) {
+        writer.AppendText(documents);
+        large += expected.str();
+    }
+    ASSERT(writer.GetSize() > ResultWriter::CHUNK_SIZE);
+    ASSERT(writer.ToString() == large);
+
+    // Запись в файловый дескриптор; данные из нескольких блоков уходят одной сборной записью
+    const std::filesystem::path path = std::filesystem::temp_directory_path()
+        / ("search-server-writer-test-"s + std::to_string(file_io::GetProcessId()));
+    const int fd = file_io::OpenFile(path, file_io::OpenMode::TRUNCATE);
+    writer.FlushTo(fd);
+    ASSERT_EQUAL(writer.GetSize(), 0);
+    // Повторная запись тем же writer переиспользует буферы
+    writer.AppendJson(documents);
+    const std::string json = writer.ToString();
+    writer.FlushTo(fd);
+    ASSERT_EQUAL(writer.GetSize(), 0);
+    file_io::CloseFile(fd);
+    std::ifstream input(path, std::ios::binary);
+    const std::string received((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    input.close();
+    std::filesystem::remove(path);
+    ASSERT(received == large + json);
+}
+
+void TestRemoveDocument() {
+    IndexOptions options;
+    options.store_positions = true;
+    options.expand_wildcards = true;
+    SearchServer server("and"s, options);
+    server.AddDocument(1, "lost cat and dog"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "lost parrot"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "white cat"s, DocumentStatus::ACTUAL, {3});
+    const size_t positions_bytes = server.GetMemoryUsage().positions;
+
+    server.RemoveDocument(1);
+    ASSERT(server.GetMemoryUsage().positions < positions_bytes);
+    ASSERT_EQUAL(server.GetDocumentCount(), 2);
+    ASSERT_EQUAL(server.GetDocumentId(0), 2);
+    ASSERT_EQUAL(server.GetDocumentId(1), 3);
+    const auto cats = server.FindTopDocuments("cat"s);
+    ASSERT_EQUAL(cats.size(), 1);
+    ASSERT_EQUAL(cats[0].id, 3);
+    ASSERT(server.FindTopDocuments("dog"s).empty());
+    ASSERT(server.FindTopDocuments("\"lost cat\""s).empty());
+    ASSERT(server.FindTopDocuments("do*"s).empty());
+
+    // ID освобождается и может быть использован снова
+    server.AddDocument(1, "black dog"s, DocumentStatus::ACTUAL, {4});
+    ASSERT_EQUAL(server.FindTopDocuments("dog"s).size(), 1);
+    ASSERT_EQUAL(server.FindTopDocuments("\"black dog\""s).size(), 1);
+
+    try {
+        server.RemoveDocument(42);
+        ASSERT_HINT(false, "Removing unknown document must throw"s);
+    } catch (const std::invalid_argument&) {
+    }
+}
+
+void TestWriteAheadLogFrames() {
+    const std::vector<LogRecord> records = {
+        { LogRecord::Type::ADD_DOCUMENT, 7, DocumentStatus::BANNED, {1, -2, 3}, "lost cat"s },
+        { LogRecord::Type::REMOVE_DOCUMENT, 7, DocumentStatus::ACTUAL, {}, {} },
+        { LogRecord::Type::ADD_DOCUMENT, 8, DocumentStatus::ACTUAL, {}, ""s },
+    };
+    std::string data;
+    for (const LogRecord& record : records) {
+        AppendFrame(data, record);
+    }
+    const ParsedFrames parsed = ParseFrames(data);
+    ASSERT_EQUAL(parsed.valid_bytes, data.size());
+    ASSERT_EQUAL(parsed.records.size(), records.size());
+    ASSERT(parsed.records[0].type == LogRecord::Type::ADD_DOCUMENT);
+    ASSERT_EQUAL(parsed.records[0].document_id, 7);
+    ASSERT(parsed.records[0].status == DocumentStatus::BANNED);
+    ASSERT(parsed.records[0].ratings == records[0].ratings);
+    ASSERT_EQUAL(parsed.records[0].text, "lost cat"s);
+    ASSERT(parsed.records[1].type == LogRecord::Type::REMOVE_DOCUMENT);
+
+    // Оборванный хвост и повреждённый кадр отбрасываются вместе со всем, что после них
+    std::string first_frame;
+    AppendFrame(first_frame, records[0]);
+    ASSERT_EQUAL(ParseFrames(std::string_view(data).substr(0, data.size() - 1)).records.size(), 2);
+    std::string corrupted = data;
+    corrupted[first_frame.size() + 9] ^= 1;
+    const ParsedFrames after_corruption = ParseFrames(corrupted);
+    ASSERT_EQUAL(after_corruption.records.size(), 1);
+    ASSERT_EQUAL(after_corruption.valid_bytes, first_frame.size());
+
+    ASSERT_EQUAL(ComputeCrc32c("123456789"sv), 0xE3069283u);
+
+    // Ошибка записи запоминается: её бросают Sync, все следующие Append и Close
+    if (std::filesystem::exists("/dev/full"s)) {
+        WriteAheadLog log("/dev/full"s);
+        log.Append(records[0]);
+        try {
+            log.Sync();
+            ASSERT_HINT(false, "Sync must report the write error"s);
+        } catch (const std::system_error&) {
+        }
+        try {
+            log.Append(records[1]);
+            ASSERT_HINT(false, "Append after a write error must throw"s);
+        } catch (const std::system_error&) {
+        }
+        try {
+            log.Close();
+            ASSERT_HINT(false, "Close must report the write error"s);
+        } catch (const std::system_error&) {
+        }
+    }
+    {
+        const std::filesystem::path path = std::filesystem::temp_directory_path()
+            / ("search-server-wal-test-"s + std::to_string(file_io::GetProcessId()));
+        WriteAheadLog log(path);
+        log.Append(records[0]);
+        log.Close();
+        ASSERT_EQUAL(ReadLogFile(path).records.size(), 1);
+        try {
+            log.Append(records[1]);
+            ASSERT_HINT(false, "Append after Close must throw"s);
+        } catch (const std::logic_error&) {
+        }
+        std::filesystem::remove(path);
+    }
+}
+
+void TestDurableSearchServer() {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path()
+        / ("search-server-test-"s + std::to_string(file_io::GetProcessId()));
+    std::filesystem::remove_all(directory);
+
+    const auto find_ids = [](const SearchServer& server, const std::string& query) {
+        std::vector<int> ids;
+        for (const Document& document : server.FindTopDocuments(query, PageRequest{ .limit = 100 })) {
+            ids.push_back(document.id);
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+
+    {
+        DurableSearchServer server(directory, SearchServer("and"s));
+        server.AddDocument(1, "lost cat"s, DocumentStatus::ACTUAL, {1});
+        server.AddDocument(2, "black cat and dog"s, DocumentStatus::ACTUAL, {2});
+        server.AddDocument(3, "white dog"s, DocumentStatus::ACTUAL, {3});
+        server.RemoveDocument(1);
+        server.SetDocumentStatus(3, DocumentStatus::BANNED);
+        server.AddRatings(2, {10, 12});
+        try {
+            server.AddDocument(2, "duplicate"s, DocumentStatus::ACTUAL, {});
+            ASSERT_HINT(false, "Duplicate ID must throw"s);
+        } catch (const std::invalid_argument&) {
+        }
+        server.Sync();
+    }
+    {
+        // Журнал проигрывается при открытии
+        DurableSearchServer server(directory, SearchServer("and"s));
+        ASSERT_EQUAL(server.GetServer().GetDocumentCount(), 2);
+        ASSERT(find_ids(server.GetServer(), "cat"s) == std::vector<int>({2}));
+        ASSERT(find_ids(server.GetServer(), "dog"s) == std::vector<int>({2}));
+        ASSERT_EQUAL(server.GetServer().FindTopDocuments("dog"s, DocumentStatus::BANNED).size(), 1);
+        ASSERT_EQUAL(server.GetServer().FindTopDocuments("cat"s).front().rating, 8);
+
+        ASSERT(server.Compact());
+        server.AddDocument(4, "lost parrot"s, DocumentStatus::IRRELEVANT, {4});
+        server.WaitForCompaction();
+        server.RemoveDocument(3);
+    }
+    {
+        // Снимок и журнал после него
+        DurableSearchServer server(directory, SearchServer("and"s));
+        ASSERT_EQUAL(server.GetServer().GetDocumentCount(), 2);
+        ASSERT(find_ids(server.GetServer(), "dog"s) == std::vector<int>({2}));
+        ASSERT_EQUAL(server.GetServer().FindTopDocuments("parrot"s, DocumentStatus::IRRELEVANT).size(), 1);
+        ASSERT_EQUAL(server.GetServer().GetDocumentId(0), 2);
+        ASSERT_EQUAL(server.GetServer().GetDocumentId(1), 4);
+        // Оценки из журнала дописаны к записи добавления в снимке
+        ASSERT(server.GetServer().GetDocumentRatings(2) == AggregateRatings({2, 10, 12}));
+        server.AddDocument(5, "green cat"s, DocumentStatus::ACTUAL, {5});
+    }
+    {
+        // Оборванная при сбое запись в конце журнала отбрасывается
+        std::vector<std::filesystem::path> logs;
+        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+            if (entry.path().filename().string().starts_with("wal."s)) {
+                logs.push_back(entry.path());
+            }
+        }
+        std::sort(logs.begin(), logs.end());
+        std::ofstream(logs.back(), std::ios::binary | std::ios::app) << "\x10\x00\x00"s;
+
+        DurableSearchServer server(directory, SearchServer("and"s));
+        ASSERT(find_ids(server.GetServer(), "cat"s) == std::vector<int>({2, 5}));
+        server.AddDocument(6, "cat"s, DocumentStatus::ACTUAL, {6});
+    }
+    {
+        DurableSearchServer server(directory, SearchServer("and"s));
+        ASSERT(find_ids(server.GetServer(), "cat"s) == std::vector<int>({2, 5, 6}));
+    }
+    std::filesystem::remove_all(directory);
+}
+
+void TestRatingAggregates() {
+    // SIMD-редукция против скалярной на всех остатках от деления на ширину вектора
+    std::vector<int> ratings;
+    for (int size = 0; size <= 40; ++size) {
+        RatingAggregate expected;
+        for (int rating : ratings) {
+            expected.sum += rating;
+            expected.min = std::min(expected.min, rating);
+            expected.max = std::max(expected.max, rating);
+        }
+        expected.count = size;
+        ASSERT_HINT(AggregateRatings(ratings) == expected, "Aggregate differs for size "s + std::to_string(size));
+        ratings.push_back(size % 3 == 0 ? -size * 1000 : size * 7);
+    }
+    ASSERT_EQUAL(AggregateRatings(std::vector<int>{}).GetAverage(), 0);
+    ASSERT_EQUAL(AggregateRatings({-7, 2}).GetAverage(), -2);
+    ASSERT_EQUAL(AggregateRatings({1, 2}).GetMean(), 1.5);
+
+    // Сумма больше int не переполняется
+    const std::vector<int> large(1000, std::numeric_limits<int>::max() - 1);
+    const RatingAggregate aggregate = AggregateRatings(large);
+    ASSERT_EQUAL(aggregate.sum, int64_t{ 1000 } * (std::numeric_limits<int>::max() - 1));
+    ASSERT_EQUAL(aggregate.GetAverage(), std::numeric_limits<int>::max() - 1);
+    RatingAggregate merged = AggregateRatings({ std::numeric_limits<int>::min() });
+    merged += aggregate;
+    ASSERT_EQUAL(merged.count, 1001);
+    ASSERT_EQUAL(merged.min, std::numeric_limits<int>::min());
+    ASSERT_EQUAL(merged.max, std::numeric_limits<int>::max() - 1);
+
+    {
+        SearchServer server("and"s);
+        server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, large);
+        server.AddDocument(2, "white cat"s, DocumentStatus::ACTUAL, {5});
+        ASSERT_EQUAL(server.FindTopDocuments("cat"s).front().rating, std::numeric_limits<int>::max() - 1);
+        // Новые оценки меняют средний рейтинг и порядок документов с равной релевантностью
+        server.AddRatings(2, {10, 12});
+        server.AddRatings(1, std::vector<int>(1000, -std::numeric_limits<int>::max()));
+        ASSERT_EQUAL(server.GetDocumentRatings(1).count, 2000);
+        const std::vector<Document> documents = server.FindTopDocuments("cat"s);
+        ASSERT_EQUAL(documents.size(), 2u);
+        ASSERT_EQUAL(documents[0].id, 2);
+        ASSERT_EQUAL(documents[0].rating, 9);
+        ASSERT_EQUAL(documents[1].rating, 0);
+        server.AddRatings(2, {});
+        ASSERT_EQUAL(server.GetDocumentRatings(2).count, 3);
+        try {
+            server.AddRatings(3, {1});
+            ASSERT_HINT(false, "Unknown ID must throw"s);
+        } catch (const std::invalid_argument&) {
+        }
+    }
+
+    // Смена рейтингов документов замороженных сегментов: отбор по диапазону рейтинга в списках по TF
+    // совпадает с эталоном до и после слияния, которое записывает новые рейтинги в сегмент
+    SearchServer reference("and"s);
+    IndexOptions impact_options;
+    impact_options.segments.max_mutable_postings = 64;
+    impact_options.segments.merge_factor = 3;
+    impact_options.segments.background_merge = false;
+    impact_options.segments.impact_ordered = true;
+    SearchServer server("and"s, impact_options);
+    const std::vector<std::string> vocabulary = { "cat"s, "dog"s, "parrot"s, "lost"s, "black"s, "white"s };
+    for (int id = 0; id < 300; ++id) {
+        std::string text;
+        for (int i = 0; i <= id % 4; ++i) {
+            text += vocabulary[static_cast<size_t>(id * 7 + i * 3) % vocabulary.size()] + ' ';
+        }
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 10});
+        reference.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 10});
+    }
+    for (int id = 0; id < 300; id += 3) {
+        server.AddRatings(id, {100, 100, 100});
+        reference.AddRatings(id, {100, 100, 100});
+    }
+    ASSERT(server.GetIndexStats().rating_override_count > 0);
+    std::vector<RatingRangePredicate> ranges(2);
+    ranges[0].min_rating = 50;
+    ranges[1].max_rating = 5;
+    const auto check = [&server, &reference, &ranges] {
+        for (const std::string& query : {"cat"s, "lost dog"s, "white -black"s}) {
+            for (const RatingRangePredicate& range : ranges) {
+                ASSERT_HINT(server.FindTopDocuments(query, range, PageRequest{ .limit = 20 })
+                                == reference.FindTopDocuments(query, range, PageRequest{ .limit = 20 }),
+                            "Rating range differs for "s + query);
+            }
+            ASSERT(server.FindTopDocuments(query) == reference.FindTopDocuments(query));
+        }
+    };
+    check();
+    for (int id = 300; id < 600; ++id) {
+        server.AddDocument(id, "green parrot"s, DocumentStatus::ACTUAL, {});
+        reference.AddDocument(id, "green parrot"s, DocumentStatus::ACTUAL, {});
+    }
+    ASSERT_EQUAL(server.GetIndexStats().rating_override_count, 0u);
+    check();
+
+    // Рейтинг возвращается к записанному в сегмент, пока фоновое слияние пишет документ с прежним рейтингом
+    IndexOptions options;
+    options.segments.max_mutable_postings = 5000;
+    options.segments.merge_factor = 2;
+    options.segments.background_merge = true;
+    options.segments.impact_ordered = true;
+    SearchServer merging("and"s, options);
+    merging.AddDocument(0, "cat"s, DocumentStatus::ACTUAL, {5});
+    for (int id = 1; id < 5000; ++id) {
+        merging.AddDocument(id, "word"s + std::to_string(id), DocumentStatus::ACTUAL, {1});
+    }
+    merging.AddRatings(0, {100, 100});
+    for (int id = 5000; id < 10000; ++id) {
+        merging.AddDocument(id, "word"s + std::to_string(id), DocumentStatus::ACTUAL, {1});
+    }
+    merging.AddRatings(0, {-185});
+    merging.WaitForMerges();
+    ASSERT_EQUAL(merging.GetIndexStats().merge_count, 1u);
+    RatingRangePredicate range;
+    range.min_rating = 5;
+    range.max_rating = 5;
+    ASSERT_EQUAL(merging.FindTopDocuments("cat"s, range).size(), 1u);
+    ASSERT_EQUAL(merging.FindTopDocuments("cat"s).front().rating, 5);
+}
+
+void TestSegmentedIndex() {
+    const std::vector<std::string> texts = {
+        "lost cat"s, "black cat dog"s, "white dog"s, "lost parrot cage"s, "cat in cage"s, "dog and cat"s,
+        "green parrot"s, "lost dog lost cat"s, "tiny hamster"s, "hamster and cat"s, "old dog"s, "cat cat cat"s,
+    };
+    // Эталон - один изменяемый сегмент без заморозок
+    IndexOptions reference_options;
+    reference_options.expand_wildcards = true;
+    reference_options.segments.max_mutable_postings = 1000000;
+    SearchServer reference("and in"s, reference_options);
+    for (const bool background : {false, true}) {
+        IndexOptions options;
+        options.expand_wildcards = true;
+        options.segments.max_mutable_postings = 4;
+        options.segments.merge_factor = 2;
+        options.segments.background_merge = background;
+        SearchServer server("and in"s, options);
+        for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+            server.AddDocument(id, texts[static_cast<size_t>(id)], DocumentStatus::ACTUAL, {id});
+            if (!background) {
+                reference.AddDocument(id, texts[static_cast<size_t>(id)], DocumentStatus::ACTUAL, {id});
+            }
+        }
+        // Удаление из замороженного сегмента и повторное добавление с тем же ID
+        server.RemoveDocument(1);
+        server.RemoveDocument(7);
+        server.AddDocument(7, "lost cat found"s, DocumentStatus::ACTUAL, {7});
+        server.WaitForMerges();
+        if (!background) {
+            reference.RemoveDocument(1);
+            reference.RemoveDocument(7);
+            reference.AddDocument(7, "lost cat found"s, DocumentStatus::ACTUAL, {7});
+        }
+
+        const IndexStats stats = server.GetIndexStats();
+        ASSERT(stats.segments.size() >= 1);
+        ASSERT(stats.merge_count > 0);
+        ASSERT(stats.GetWriteAmplification() > 1.0);
+        ASSERT_EQUAL(reference.GetIndexStats().segments.size(), 0);
+
+        for (const std::string& query : {"cat"s, "lost -parrot"s, "dog cage"s, "cat dog hamster"s, "found"s, "ca*"s}) {
+            ASSERT_HINT(server.FindTopDocuments(query, PageRequest{ .limit = 100 }) == reference.FindTopDocuments(query, PageRequest{ .limit = 100 }),
+                        "Segmented index differs from reference for "s + query);
+        }
+        const auto [words, status] = server.MatchDocument("lost found cat"s, 7);
+        ASSERT_EQUAL(words.size(), 3);
+        ASSERT(std::get<0>(server.MatchDocument("black"s, 2)).empty());
+    }
+}
+
+void TestQueriesDuringBackgroundMerge() {
+    // Единственный писатель добавляет документы пачками; после каждой пачки фоновые слияния ещё идут,
+    // а запросы выполняются из нескольких потоков и сверяются с эталоном из одного изменяемого сегмента
+    IndexOptions options;
+    options.segments.max_mutable_postings = 128;
+    options.segments.merge_factor = 2;
+    SearchServer server("and in"s, options);
+    IndexOptions reference_options;
+    reference_options.segments.max_mutable_postings = 1000000;
+    SearchServer reference("and in"s, reference_options);
+    const std::vector<std::string> vocabulary = {
+        "cat"s, "dog"s, "parrot"s, "hamster"s, "lost"s, "black"s, "white"s, "cage"s, "old"s, "tiny"s, "collar"s, "tail"s,
+    };
+    const std::vector<std::string> queries = { "cat"s, "lost dog"s, "cat -cage"s, "tiny hamster -old"s, "white black collar tail"s };
+    int next_id = 0;
+    for (int batch = 0; batch < 12; ++batch) {
+        for (int i = 0; i < 150; ++i, ++next_id) {
+            std::string text;
+            for (int j = 0; j <= next_id % 6; ++j) {
+                text += vocabulary[static_cast<size_t>(next_id * 5 + j * 7) % vocabulary.size()] + ' ';
+            }
+            server.AddDocument(next_id, text, DocumentStatus::ACTUAL, { next_id % 9 });
+            reference.AddDocument(next_id, text, DocumentStatus::ACTUAL, { next_id % 9 });
+        }
+        server.RemoveDocument(next_id - 75);
+        reference.RemoveDocument(next_id - 75);
+
+        std::atomic<int> mismatches = 0;
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; ++t) {
+            readers.emplace_back([&] {
+                for (int round = 0; round < 5; ++round) {
+                    for (const std::string& query : queries) {
+                        if (server.FindTopDocuments(query, PageRequest{ .limit = 20 }) != reference.FindTopDocuments(query, PageRequest{ .limit = 20 })) {
+                            ++mismatches;
+                        }
+                    }
+                }
+            });
+        }
+        for (std::thread& reader : readers) {
+            reader.join();
+        }
+        ASSERT_EQUAL(mismatches.load(), 0);
+    }
+    server.WaitForMerges();
+    ASSERT(server.GetIndexStats().merge_count > 0);
+    for (const std::string& query : queries) {
+        ASSERT(server.FindTopDocuments(query, PageRequest{ .limit = 20 }) == reference.FindTopDocuments(query, PageRequest{ .limit = 20 }));
+    }
+}
+
+void TestSetDocumentStatus() {
+    const std::vector<std::string> texts = {
+        "lost cat"s, "black cat dog"s, "white dog"s, "lost parrot cage"s, "cat in cage"s, "dog and cat"s,
+        "green parrot"s, "lost dog lost cat"s, "tiny hamster"s, "hamster and cat"s, "old dog"s, "cat cat cat"s,
+    };
+    const std::vector<DocumentStatus> statuses = {
+        DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED, DocumentStatus::REMOVED,
+    };
+    for (const bool background : {false, true}) {
+        IndexOptions options;
+        options.store_positions = true;
+        options.expand_wildcards = true;
+        options.segments.max_mutable_postings = 4;
+        options.segments.merge_factor = 2;
+        options.segments.background_merge = background;
+        SearchServer server("and in"s, options);
+        const auto check = [&server](const std::string& stage) {
+            for (const std::string& query : {"cat"s, "lost -parrot"s, "dog cage"s, "\"lost cat\""s, "ca*"s}) {
+                for (const DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED}) {
+                    // Произвольный предикат перебирает все записи и сверяет статусы документов
+                    const auto expected = server.FindTopDocuments(query,
+                        [status]([[maybe_unused]] int document_id, DocumentStatus document_status, [[maybe_unused]] int rating) {
+                            return document_status == status;
+                        }, PageRequest{ .limit = 100 });
+                    ASSERT_HINT(server.FindTopDocuments(query, status, PageRequest{ .limit = 100 }) == expected,
+                                "Status partition differs for "s + query + " at "s + stage);
+                }
+            }
+        };
+
+        for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+            server.AddDocument(id, texts[static_cast<size_t>(id)], statuses[static_cast<size_t>(id) % statuses.size()], {id});
+        }
+        check("add"s);
+        ASSERT_EQUAL(server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, PageRequest{ .limit = 100 }).size(), 2);
+
+        // Документы замороженных сегментов и изменяемого сегмента
+        server.SetDocumentStatus(0, DocumentStatus::BANNED);
+        server.SetDocumentStatus(5, DocumentStatus::ACTUAL);
+        server.SetDocumentStatus(11, DocumentStatus::ACTUAL);
+        server.SetDocumentStatus(7, DocumentStatus::ACTUAL);
+        server.SetDocumentStatus(7, DocumentStatus::REMOVED);
+        check("set"s);
+        ASSERT(std::get<1>(server.MatchDocument("cat"s, 0)) == DocumentStatus::BANNED);
+
+        // Слияния переносят записи в части новых статусов
+        for (int id = 100; id < 108; ++id) {
+            server.AddDocument(id, "cat and dog "s + std::to_string(id), DocumentStatus::ACTUAL, {id});
+        }
+        server.SetDocumentStatus(1, DocumentStatus::ACTUAL);
+        server.WaitForMerges();
+        check("merge"s);
+        server.SetDocumentStatus(1, DocumentStatus::IRRELEVANT);
+        server.RemoveDocument(5);
+        server.AddDocument(5, "lost cat again"s, DocumentStatus::BANNED, {5});
+        server.WaitForMerges();
+        check("re-add"s);
+        ASSERT(server.GetIndexStats().status_override_count <= 3);
+
+        try {
+            server.SetDocumentStatus(1000, DocumentStatus::ACTUAL);
+            ASSERT_HINT(false, "Unknown ID must throw"s);
+        } catch (const std::invalid_argument&) {
+        }
+    }
+
+    // Возврат статуса, пока фоновое слияние пишет документ со снимком прежней смены статуса
+    IndexOptions merge_options;
+    merge_options.segments.max_mutable_postings = 5000;
+    merge_options.segments.merge_factor = 2;
+    merge_options.segments.background_merge = true;
+    SearchServer server("and"s, merge_options);
+    server.AddDocument(0, "cat"s, DocumentStatus::ACTUAL, {1});
+    for (int id = 1; id < 5000; ++id) {
+        server.AddDocument(id, "word"s + std::to_string(id), DocumentStatus::ACTUAL, {1});
+    }
+    server.SetDocumentStatus(0, DocumentStatus::BANNED);
+    for (int id = 5000; id < 10000; ++id) {
+        server.AddDocument(id, "word"s + std::to_string(id), DocumentStatus::ACTUAL, {1});
+    }
+    server.SetDocumentStatus(0, DocumentStatus::ACTUAL);
+    server.WaitForMerges();
+    ASSERT_EQUAL(server.GetIndexStats().merge_count, 1u);
+    ASSERT(std::get<1>(server.MatchDocument("cat"s, 0)) == DocumentStatus::ACTUAL);
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s).size(), 1u);
+    ASSERT(server.FindTopDocuments("cat"s, DocumentStatus::BANNED).empty());
+}
+
+void TestImpactOrderedPostings() {
+    // Эталон - полный перебор без списков по TF
+    IndexOptions reference_options;
+    reference_options.expand_wildcards = true;
+    SearchServer reference("and in"s, reference_options);
+    IndexOptions options;
+    options.expand_wildcards = true;
+    options.segments.max_mutable_postings = 200;
+    options.segments.merge_factor = 3;
+    options.segments.background_merge = false;
+    options.segments.impact_ordered = true;
+    SearchServer server("and in"s, options);
+    const std::vector<std::string> vocabulary = {
+        "cat"s, "dog"s, "parrot"s, "hamster"s, "lost"s, "black"s, "white"s, "cage"s, "old"s, "tiny"s,
+    };
+    uint32_t seed = 1;
+    const auto next = [&seed](uint32_t bound) {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) % bound;
+    };
+    for (int id = 0; id < 600; ++id) {
+        std::string text;
+        for (uint32_t i = 0, word_count = 1 + next(6); i < word_count; ++i) {
+            text += vocabulary[next(static_cast<uint32_t>(vocabulary.size()))] + ' ';
+        }
+        const std::vector<int> ratings = { static_cast<int>(next(21)) - 10 };
+        const DocumentStatus status = next(4) == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        server.AddDocument(id, text, status, ratings);
+        reference.AddDocument(id, text, status, ratings);
+    }
+    for (int id = 0; id < 600; id += 7) {
+        server.RemoveDocument(id);
+        reference.RemoveDocument(id);
+    }
+    server.AddDocument(14, "cat cat cat"s, DocumentStatus::ACTUAL, {3});
+    reference.AddDocument(14, "cat cat cat"s, DocumentStatus::ACTUAL, {3});
+    ASSERT(server.GetIndexStats().merge_count > 0);
+
+    const auto is_even = [](int document_id, [[maybe_unused]] DocumentStatus status, [[maybe_unused]] int rating) {
+        return document_id % 2 == 0;
+    };
+    std::vector<RatingRangePredicate> ranges(3);
+    ranges[0].min_rating = 8;
+    ranges[1].min_rating = -2;
+    ranges[1].max_rating = 2;
+    ranges[2].max_rating = -9;
+    ranges[2].status = DocumentStatus::BANNED;
+    for (const std::string& query : {"cat"s, "lost dog"s, "cat -cage"s, "tiny hamster parrot"s, "white black old cat"s, "ca*"s, "missing"s}) {
+        for (const PageRequest page : {PageRequest{}, PageRequest{ .offset = 3, .limit = 10 }, PageRequest{ .limit = 1 }, PageRequest{ .limit = 0 }}) {
+            ASSERT_HINT(server.FindTopDocuments(query, page) == reference.FindTopDocuments(query, page), "Impact order differs for "s + query);
+            ASSERT(server.FindTopDocuments(query, is_even, page) == reference.FindTopDocuments(query, is_even, page));
+            for (const RatingRangePredicate& range : ranges) {
+                ASSERT_HINT(server.FindTopDocuments(query, range, page) == reference.FindTopDocuments(query, range, page),
+                            "Rating range differs for "s + query);
+            }
+        }
+        const std::vector<Document> first_page = server.FindTopDocuments(query, PageRequest{ .limit = 4 });
+        if (!first_page.empty()) {
+            ASSERT(server.FindTopDocumentsAfter(query, first_page.back(), 6) == reference.FindTopDocumentsAfter(query, first_page.back(), 6));
+        }
+        ASSERT(server.FindTopDocuments(query, DocumentStatus::ACTUAL, Bm25Ranking{}) == reference.FindTopDocuments(query, DocumentStatus::ACTUAL, Bm25Ranking{}));
+    }
+}
+
+void TestBlockedAccumulators() {
+    // Наследник TfIdfRanking не попадает под блочный обход: эталон - полный перебор с хеш-таблицей
+    struct HashTfIdfRanking : TfIdfRanking {};
+    IndexOptions options;
+    options.segments.max_mutable_postings = 300;
+    options.segments.merge_factor = 3;
+    options.segments.background_merge = false;
+    SearchServer server("and in"s, options);
+    const std::vector<std::string> vocabulary = {
+        "cat"s, "dog"s, "parrot"s, "hamster"s, "lost"s, "black"s, "white"s, "cage"s, "old"s, "tiny"s,
+    };
+    const std::vector<DocumentStatus> statuses = { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED };
+    uint32_t seed = 7;
+    const auto next = [&seed](uint32_t bound) {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) % bound;
+    };
+    // ID разрежены и занимают несколько блоков накопителей
+    std::vector<int> ids;
+    for (int i = 0; i < 400; ++i) {
+        const int id = i * 613 + static_cast<int>(next(600));
+        std::string text;
+        for (uint32_t j = 0, word_count = 1 + next(6); j < word_count; ++j) {
+            text += vocabulary[next(static_cast<uint32_t>(vocabulary.size()))] + ' ';
+        }
+        server.AddDocument(id, text, statuses[next(static_cast<uint32_t>(statuses.size()))], { static_cast<int>(next(21)) - 10 });
+        ids.push_back(id);
+    }
+    for (size_t i = 0; i < ids.size(); i += 9) {
+        server.RemoveDocument(ids[i]);
+    }
+    for (size_t i = 1; i < ids.size(); i += 11) {
+        if (i % 9 != 0) {
+            server.SetDocumentStatus(ids[i], DocumentStatus::ACTUAL);
+        }
+    }
+    server.AddDocument(ids[0], "cat cat lost"s, DocumentStatus::BANNED, {4});
+    ASSERT(server.GetIndexStats().merge_count > 0);
+
+    const HashTfIdfRanking hash_ranking;
+    const auto is_even = [](int document_id, [[maybe_unused]] DocumentStatus status, [[maybe_unused]] int rating) {
+        return document_id % 2 == 0;
+    };
+    for (const std::string& query : {"cat"s, "lost dog"s, "cat -cage"s, "tiny hamster -old -lost"s, "white black old cat"s, "missing -cat"s}) {
+        ASSERT_HINT(server.FindTopDocuments(query) == server.FindTopDocuments(query, DocumentStatus::ACTUAL, hash_ranking),
+                    "Blocked scoring differs for "s + query);
+        for (const DocumentStatus status : statuses) {
+            ASSERT(server.FindTopDocuments(query, status, PageRequest{ .limit = 50 })
+                   == server.FindTopDocuments(query, StatusPredicate{ status }, PageRequest{ .limit = 50 }, hash_ranking));
+        }
+        ASSERT(server.FindTopDocuments(query, is_even, PageRequest{ .limit = 50 })
+               == server.FindTopDocuments(query, is_even, PageRequest{ .limit = 50 }, hash_ranking));
+        RatingRangePredicate range;
+        range.min_rating = -3;
+        range.max_rating = 5;
+        ASSERT(server.FindTopDocuments(query, range, PageRequest{ .offset = 2, .limit = 7 })
+               == server.FindTopDocuments(query, range, PageRequest{ .offset = 2, .limit = 7 }, hash_ranking));
+
+        // Исключение предиката посреди блока не оставляет накопленных релевантностей следующему запросу
+        // с тем же типом предиката (у каждой специализации свои накопители потока)
+        int calls = 0;
+        const auto throw_once = [&calls](int, DocumentStatus, int) -> bool {
+            if (++calls == 2) {
+                throw std::runtime_error("predicate failed"s);
+            }
+            return true;
+        };
+        try {
+            server.FindTopDocuments(query, throw_once, PageRequest{ .limit = 50 });
+        } catch (const std::runtime_error&) {
+        }
+        ASSERT_HINT(server.FindTopDocuments(query, throw_once, PageRequest{ .limit = 50 })
+                        == server.FindTopDocuments(query, throw_once, PageRequest{ .limit = 50 }, hash_ranking),
+                    "Accumulators leaked after an exception for "s + query);
+    }
+}
+
+void TestBooleanQueries() {
+    IndexOptions options;
+    options.store_positions = true;
+    options.boolean_syntax = true;
+    options.expand_wildcards = true;
+    options.segments.max_mutable_postings = 6;
+    options.segments.merge_factor = 2;
+    options.segments.background_merge = false;
+    SearchServer server("and in the"s, options);
+    server.AddDocument(1, "lost cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "black cat dog"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "white dog"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "lost parrot cage"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(5, "cat in cage"s, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(6, "lost dog and cat"s, DocumentStatus::ACTUAL, {6});
+    server.AddDocument(7, "green parrot"s, DocumentStatus::BANNED, {7});
+    server.AddDocument(8, "old lost cat"s, DocumentStatus::ACTUAL, {8});
+    server.RemoveDocument(8);
+    ASSERT(!server.GetIndexStats().segments.empty());
+
+    const auto find_ids = [&server](const std::string& query) {
+        std::vector<int> ids;
+        for (const Document& document : server.FindTopDocuments(query, PageRequest{ .limit = 100 })) {
+            ids.push_back(document.id);
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+    ASSERT(find_ids("cat AND dog"s) == std::vector<int>({2, 6}));
+    ASSERT(find_ids("cat OR dog"s) == std::vector<int>({1, 2, 3, 5, 6}));
+    ASSERT(find_ids("cat NOT dog"s) == std::vector<int>({1, 5}));
+    ASSERT(find_ids("cat AND NOT dog"s) == find_ids("cat NOT dog"s));
+    ASSERT(find_ids("NOT NOT cat"s) == find_ids("cat"s));
+    // AND связывает сильнее OR, соседние операнды без оператора - OR
+    ASSERT(find_ids("parrot OR cat AND dog"s) == std::vector<int>({2, 4, 6}));
+    ASSERT(find_ids("parrot cat AND dog"s) == find_ids("parrot OR cat AND dog"s));
+    ASSERT(find_ids("(parrot OR cat) AND lost"s) == std::vector<int>({1, 4, 6}));
+    ASSERT(find_ids("((cat OR dog) AND NOT (black OR white)) AND lost"s) == std::vector<int>({1, 6}));
+    // Минус-слова исключают документы из всей выдачи, стоп-слова не ограничивают её
+    ASSERT(find_ids("cat OR parrot -lost"s) == std::vector<int>({2, 5}));
+    ASSERT(find_ids("cat AND the"s) == find_ids("cat"s));
+    ASSERT(find_ids("cat AND missing"s).empty());
+    ASSERT(find_ids("ca* AND lost"s) == std::vector<int>({1, 4, 6}));
+    ASSERT(find_ids("zz* AND lost"s).empty());
+    ASSERT(find_ids("\"lost cat\" OR white"s) == std::vector<int>({1, 3}));
+    ASSERT(find_ids("cat AND NOT \"lost cat\""s) == std::vector<int>({2, 5, 6}));
+    ASSERT(find_ids("cat AND parrot"s).empty());
+    ASSERT(server.FindTopDocuments("parrot AND green"s, DocumentStatus::BANNED).size() == 1);
+
+    // Релевантность - по словам операндов вне отрицаний, как у обычного запроса
+    const std::vector<Document> boolean = server.FindTopDocuments("cat AND (dog OR white) NOT black"s);
+    const std::vector<Document> plain = server.FindTopDocuments("cat dog white"s);
+    ASSERT_EQUAL(boolean.size(), 1u);
+    ASSERT_EQUAL(boolean[0].id, 6);
+    const auto plain_it = std::find_if(plain.begin(), plain.end(), [](const Document& document) {
+        return document.id == 6;
+    });
+    ASSERT(plain_it != plain.end() && std::abs(plain_it->relevance - boolean[0].relevance) < 1e-12);
+
+    const auto [words, status] = server.MatchDocument("lost AND (cat OR parrot) NOT dog"s, 1);
+    ASSERT(words == std::vector<std::string>({"cat"s, "lost"s}) || words == std::vector<std::string>({"lost"s, "cat"s}));
+    ASSERT(std::get<0>(server.MatchDocument("lost AND (cat OR parrot) NOT dog"s, 6)).empty());
+
+    // Запрос из одних отрицаний ничего не находит
+    ASSERT(find_ids("NOT cat"s).empty());
+    ASSERT(find_ids("NOT cat NOT (dog OR parrot)"s).empty());
+    ASSERT(find_ids("NOT cat OR NOT dog"s).empty());
+
+    for (const std::string& query : {"cat AND"s, "(cat OR dog"s, "cat OR dog)"s, "cat OR NOT dog"s, "AND cat"s, "cat AND ()"s}) {
+        bool is_rejected = false;
+        try {
+            server.FindTopDocuments(query);
+        } catch (const std::invalid_argument&) {
+            is_rejected = true;
+        }
+        ASSERT_HINT(is_rejected, "Incorrect boolean query must throw: "s + query);
+    }
+
+    // Без операторов скобки остаются частью слова, с нормализацией - отбрасываются, как раньше
+    ASSERT(server.FindTopDocuments("(cat)"s).empty());
+    IndexOptions normalized_options;
+    normalized_options.boolean_syntax = true;
+    normalized_options.normalize_text = true;
+    SearchServer normalized("and in the"s, normalized_options);
+    normalized.AddDocument(1, "Lost Cat"s, DocumentStatus::ACTUAL, {1});
+    normalized.AddDocument(2, "White Dog"s, DocumentStatus::ACTUAL, {2});
+    ASSERT_EQUAL(normalized.FindTopDocuments("(Cat)"s).size(), 1u);
+    ASSERT_EQUAL(normalized.FindTopDocuments("(Cat OR Dog) AND (White)"s).size(), 1u);
+    ASSERT_EQUAL(normalized.FindTopDocuments("(Cat OR Dog) AND (White)"s)[0].id, 2);
+
+    // Без IndexOptions::boolean_syntax операторы - обычные слова
+    SearchServer plain_server("and in the"s);
+    plain_server.AddDocument(1, "lost cat"s, DocumentStatus::ACTUAL, {1});
+    plain_server.AddDocument(2, "white dog"s, DocumentStatus::ACTUAL, {2});
+    plain_server.AddDocument(3, "NOT a pet"s, DocumentStatus::ACTUAL, {3});
+    ASSERT_EQUAL(plain_server.FindTopDocuments("cat AND dog"s).size(), 2u);
+    ASSERT_EQUAL(plain_server.FindTopDocuments("NOT cat"s).size(), 2u);
+    ASSERT_EQUAL(plain_server.FindTopDocuments("(cat"s).size(), 0u);
+}
+
+void TestExplainQuery() {
+    IndexOptions options;
+    options.store_positions = true;
+    options.boolean_syntax = true;
+    SearchServer server("and in the"s, options);
+    server.AddDocument(1, "lost cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "black cat dog"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "white dog"s, DocumentStatus::BANNED, {3});
+    server.AddDocument(4, "lost parrot cage"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(5, "cat in cage"s, DocumentStatus::ACTUAL, {5});
+
+    const QueryExplanation explanation = server.ExplainQuery("cat dog -cage \"lost cat\""s);
+    ASSERT_EQUAL(explanation.plus_words.size(), 2u);
+    ASSERT_EQUAL(explanation.plus_words[0].term, "cat"s);
+    ASSERT_EQUAL(explanation.plus_words[0].document_freq, 3);
+    ASSERT(std::abs(explanation.plus_words[0].inverse_document_freq - std::log(5.0 / 3.0)) < 1e-12);
+    ASSERT_EQUAL(explanation.plus_words[1].term, "dog"s);
+    ASSERT_EQUAL(explanation.minus_words.size(), 1u);
+    ASSERT_EQUAL(explanation.minus_words[0].document_freq, 2);
+    ASSERT(explanation.proximity_clauses == std::vector<std::string>({"\"lost cat\""s}));
+    ASSERT(explanation.plan.empty());
+    // Кандидаты 1, 2, 3, 5: документ 5 отсеивают минус-слова, документ 3 - статус
+    ASSERT_EQUAL(explanation.candidate_count, 4u);
+    ASSERT_EQUAL(explanation.minus_word_rejected_count, 1u);
+    ASSERT_EQUAL(explanation.predicate_rejected_count, 1u);
+    ASSERT_EQUAL(explanation.result_count, server.FindTopDocuments("cat dog -cage \"lost cat\""s).size());
+    ASSERT_EQUAL(server.ExplainQuery("cat dog -cage"s, DocumentStatus::BANNED).result_count, 1u);
+
+    const QueryExplanation boolean = server.ExplainQuery("(cat OR parrot) AND lost NOT cage"s);
+    ASSERT_EQUAL(boolean.plan, "AND[2](lost[2], OR[4](cat[3], parrot[1]), NOT[2](cage[2]))"s);
+    ASSERT_EQUAL(boolean.candidate_count, 4u);
+    ASSERT_EQUAL(boolean.plan_rejected_count, 3u);
+    ASSERT_EQUAL(boolean.result_count, 1u);
+    std::ostringstream output;
+    output << boolean;
+    ASSERT(output.str().find("plan: AND[2]"s) != std::string::npos);
+
+    // Запросы не быстрее порога попадают в журнал, из него вытесняются старые записи
+    RequestQueue queue(server);
+    ASSERT(queue.GetSlowQueryLog() == nullptr);
+    queue.EnableSlowQueryLog(std::chrono::nanoseconds(0), 2);
+    for (const std::string& query : {"cat"s, "dog"s, "missing"s}) {
+        queue.AddFindRequest(query);
+    }
+    const std::vector<SlowQuery> slow_queries = queue.GetSlowQueryLog()->GetEntries();
+    ASSERT_EQUAL(slow_queries.size(), 2u);
+    ASSERT_EQUAL(slow_queries[0].query, "dog"s);
+    ASSERT_EQUAL(slow_queries[1].query, "missing"s);
+    ASSERT_EQUAL(slow_queries[1].sequence, 3u);
+    ASSERT_EQUAL(slow_queries[1].result_count, 0);
+    ASSERT_EQUAL(queue.GetSlowQueryLog()->GetSlowQueryCount(), 3u);
+
+    SlowQueryLog log(std::chrono::milliseconds(10));
+    ASSERT(!log.Record("fast"sv, std::chrono::milliseconds(9), 1));
+    ASSERT(log.Record("slow"sv, std::chrono::milliseconds(10), 1));
+    ASSERT_EQUAL(log.GetEntries().size(), 1u);
+    ASSERT_EQUAL(log.GetEntries()[0].sequence, 2u);
+}
+
+void TestSearchPolicies() {
+    IndexOptions options;
+    options.segments.max_mutable_postings = 64;
+    options.segments.merge_factor = 3;
+    options.segments.background_merge = false;
+    SearchServer reference("and in"s, options);
+    BasicSearchServer<FloatScorePolicy> float_scores("and in"s, options);
+    options.segments.impact_ordered = true;
+    BasicSearchServer<FloatScorePolicy> float_impact("and in"s, options);
+    const std::vector<std::string> vocabulary = { "cat"s, "dog"s, "parrot"s, "lost"s, "black"s, "white"s, "cage"s };
+    for (int id = 0; id < 200; ++id) {
+        std::string text;
+        for (int i = 0; i <= id % 5; ++i) {
+            text += vocabulary[(id * 7 + i * 3) % vocabulary.size()] + ' ';
+        }
+        reference.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 11 - 5 });
+        float_scores.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 11 - 5 });
+        float_impact.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 11 - 5 });
+    }
+
+    const auto assert_close = [](const std::vector<Document>& lhs, const std::vector<Document>& rhs, double tolerance) {
+        ASSERT_EQUAL(lhs.size(), rhs.size());
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            ASSERT(std::abs(lhs[i].relevance - rhs[i].relevance) <= tolerance);
+            ASSERT_EQUAL(lhs[i].rating, rhs[i].rating);
+        }
+    };
+    for (const std::string& query : { "cat dog"s, "lost parrot -cage"s, "black white cat"s }) {
+        // float-накопители совпадают с double до точности float, в том числе в списках по TF
+        assert_close(float_scores.FindTopDocuments(query), reference.FindTopDocuments(query), 1e-5);
+        assert_close(float_impact.FindTopDocuments(query), reference.FindTopDocuments(query), 1e-5);
+        ASSERT_EQUAL(float_scores.ExplainQuery(query).result_count, reference.ExplainQuery(query).result_count);
+        assert_close(float_scores.FindTopDocuments(query, DocumentStatus::ACTUAL, Bm25Ranking{}),
+                     reference.FindTopDocuments(query, DocumentStatus::ACTUAL, Bm25Ranking{}), 1e-5);
+
+        // Окно PageRequest без limit берёт размер выдачи из политики сервера
+        const std::vector<Document> all = float_scores.FindTopDocuments(query, PageRequest{ .limit = 100 });
+        const size_t expected = std::min(FloatScorePolicy::max_result_document_count, all.size() - std::min<size_t>(2, all.size()));
+        ASSERT_EQUAL(float_scores.FindTopDocuments(query, PageRequest{ .offset = 2 }).size(), expected);
+        ASSERT(float_scores.FindTopDocuments(query, PageRequest{}) == float_scores.FindTopDocuments(query));
+    }
+}
+
+void TestMemoryUsageAndLimits() {
+    const std::vector<std::string> texts = {
+        "white cat and fashionable collar"s, "fluffy cat fluffy tail"s, "groomed dog expressive eyes"s, "groomed starling eugene"s,
+    };
+    {
+        SearchServer server("and in"s);
+        const MemoryUsage empty = server.GetMemoryUsage();
+        ASSERT(empty.stop_words > 0);
+        for (int id = 0; id < 4; ++id) {
+            server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+        }
+        const MemoryUsage usage = server.GetMemoryUsage();
+        ASSERT(usage.term_dictionary > empty.term_dictionary);
+        ASSERT(usage.postings > empty.postings);
+        ASSERT(usage.document_table > empty.document_table);
+        ASSERT(usage.document_ids > 0);
+        ASSERT_EQUAL(usage.spilled_postings, 0u);
+        ASSERT_EQUAL(usage.GetTotal(), usage.term_dictionary + usage.postings + usage.document_table + usage.document_ids
+                                       + usage.stop_words + usage.positions);
+    }
+    {
+        // FAIL: документ сверх предела не добавляется, сервер остаётся рабочим
+        SearchServer probe("and in"s);
+        probe.AddDocument(0, texts[0], DocumentStatus::ACTUAL, {1});
+        IndexOptions options;
+        options.memory.max_bytes = probe.GetMemoryUsage().GetTotal();
+        SearchServer server("and in"s, options);
+        server.AddDocument(0, texts[0], DocumentStatus::ACTUAL, {1});
+        try {
+            server.AddDocument(1, texts[1], DocumentStatus::ACTUAL, {1});
+            ASSERT_HINT(false, "Memory limit is not checked"s);
+        } catch (const std::length_error&) {
+        }
+        ASSERT_EQUAL(server.GetDocumentCount(), 1);
+        ASSERT_EQUAL(server.FindTopDocuments("cat"s).size(), 1u);
+    }
+    {
+        // SPILL: списки замороженных сегментов уходят на диск, результаты не меняются
+        const std::filesystem::path directory = std::filesystem::temp_directory_path() / "search-server-spill-test"s;
+        std::filesystem::create_directories(directory);
+        SearchServer reference("and in"s);
+        IndexOptions options;
+        options.segments.max_mutable_postings = 8;
+        options.segments.background_merge = false;
+        SearchServer probe("and in"s, options);
+        probe.AddDocument(0, texts[0], DocumentStatus::ACTUAL, {1});
+        options.memory.max_bytes = probe.GetMemoryUsage().GetTotal();
+        options.memory.policy = MemoryLimitPolicy::SPILL;
+        options.memory.spill_directory = directory;
+        SearchServer server("and in"s, options);
+        for (int id = 0; id < 2; ++id) {
+            server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {1});
+            reference.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {1});
+        }
+        const MemoryUsage usage = server.GetMemoryUsage();
+        // Второй документ поместился только после сброса первого
+        ASSERT_EQUAL(server.GetDocumentCount(), 2);
+        ASSERT(usage.spilled_postings > 0);
+        ASSERT(server.GetIndexStats().segments.front().is_spilled);
+        for (const std::string& query : {"cat"s, "white collar"s, "fashionable -white"s}) {
+            ASSERT(server.FindTopDocuments(query) == reference.FindTopDocuments(query));
+        }
+        // Файлы сброшенных сегментов удаляются сразу после отображения
+        ASSERT(std::filesystem::is_empty(directory));
+        std::filesystem::remove_all(directory);
+
+        options.memory.max_bytes = 1 << 20;
+        options.memory.spill_directory.clear();
+        SearchServer large("and in"s, options);
+        for (int id = 0; id < 40; ++id) {
+            large.AddDocument(id, texts[id % 4], DocumentStatus::ACTUAL, {id});
+        }
+        ASSERT_EQUAL(large.GetDocumentCount(), 40);
+        ASSERT_EQUAL(large.GetMemoryUsage().spilled_postings, 0u);
+    }
+}
+
+void TestTextNormalization() {
+    ASSERT_EQUAL(NormalizeText("Hello, World!"s), "hello  world "s);
+    ASSERT_EQUAL(NormalizeText("Кот КОТ «Ёж»"s), "кот кот  ёж "s);
+    // NFC: е + U+0308 -> ё, e + U+0301 -> é; недопустимый байт UTF-8 копируется как есть
+    ASSERT_EQUAL(NormalizeText("\xD0\x95\xCC\x88\xD0\xB6 E\xCC\x81t\xC3\xA9 \xFF"s), "ёж été \xFF"s);
+    ASSERT_EQUAL(NormalizeText("Well-known ŁÓDŹ"s), "well known łódź"s);
+    ASSERT_EQUAL(NormalizeText("-Cat, \"Lost Dog\" CA* c?T Hamstr~2 lost NEAR/3 Cat -, \"Ёж,\""s, NormalizationMode::QUERY),
+                 "-cat \"lost dog\" ca* c?t hamstr~2 lost NEAR/3 cat \"ёж\""s);
+
+    IndexOptions options;
+    options.store_positions = true;
+    options.expand_wildcards = true;
+    options.normalize_text = true;
+    SearchServer server("И в"s, options);
+    server.AddDocument(1, "Белый КОТ и модный ошейник."s, DocumentStatus::ACTUAL, {8});
+    server.AddDocument(2, "пушистый кот, пушистый хвост!"s, DocumentStatus::ACTUAL, {7});
+    server.AddDocument(3, "Ухоженный пёс: выразительные глаза"s, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(4, "Ухоженный пе\xCC\x88с"s, DocumentStatus::ACTUAL, {1});
+
+    ASSERT_EQUAL(server.FindTopDocuments("Кот"s).size(), 2u);
+    ASSERT_EQUAL(server.FindTopDocuments("КОТ, -Пушистый"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("ПЁС"s).size(), 2u);
+    ASSERT_EQUAL(server.FindTopDocuments("\"Модный Ошейник\""s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("ПУШИСТ*"s).size(), 1u);
+    // Стоп-слова нормализуются так же, как документы
+    ASSERT(server.FindTopDocuments("И"s).empty());
+    auto [words, status] = server.MatchDocument("Белый ОШЕЙНИК собака"s, 1);
+    std::sort(words.begin(), words.end());
+    ASSERT((words == std::vector<std::string>{"белый"s, "ошейник"s}));
+
+    // Без нормализации регистр различается
+    SearchServer raw_server("и в"s);
+    raw_server.AddDocument(1, "Белый КОТ"s, DocumentStatus::ACTUAL, {8});
+    ASSERT(raw_server.FindTopDocuments("кот"s).empty());
+}
+
+void TestStemming() {
+    ASSERT_EQUAL(StemEnglish("caresses"s), "caress"s);
+    ASSERT_EQUAL(StemEnglish("ponies"s), "poni"s);
+    ASSERT_EQUAL(StemEnglish("hopping"s), "hop"s);
+    ASSERT_EQUAL(StemEnglish("generalization"s), "gener"s);
+    ASSERT_EQUAL(StemEnglish("Cats"s), "Cats"s);
+    ASSERT_EQUAL(StemRussian("книгами"s), "книг"s);
+    ASSERT_EQUAL(StemRussian("красивая"s), "красив"s);
+    ASSERT_EQUAL(StemRussian("важнейшие"s), "важн"s);
+    ASSERT_EQUAL(StemRussian("ёжики"s), "ежик"s);
+    ASSERT_EQUAL(StemWord("кошки"s), StemWord("кошка"s));
+    ASSERT_EQUAL(StemWord("connected"s), StemWord("connection"s));
+
+    IndexOptions options;
+    options.store_positions = true;
+    options.normalize_text = true;
+    options.stemmer = StemWord;
+    SearchServer server("и в the"s, options);
+    server.AddDocument(1, "Пушистые кошки и модные ошейники"s, DocumentStatus::ACTUAL, {8});
+    server.AddDocument(2, "Running dogs in the park"s, DocumentStatus::ACTUAL, {7});
+    server.AddDocument(3, "пушистая кошка"s, DocumentStatus::ACTUAL, {5});
+
+    ASSERT_EQUAL(server.FindTopDocuments("кошка"s).size(), 2u);
+    ASSERT_EQUAL(server.FindTopDocuments("кошкам -ошейник"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("dog runs"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("\"пушистую кошку\""s).size(), 2u);
+    ASSERT(server.FindTopDocuments("\"кошку пушистую\""s).empty());
+    ASSERT_EQUAL(server.FindTopDocuments("run NEAR/2 dog"s).size(), 1u);
+    auto [words, status] = server.MatchDocument("модный ошейник"s, 1);
+    std::sort(words.begin(), words.end());
+    ASSERT((words == std::vector<std::string>{"модн"s, "ошейник"s}));
+    ASSERT(server.GetMemoryUsage().stems > 0);
+
+    // Основа каждого слова вычисляется один раз
+    auto call_count = std::make_shared<int>(0);
+    IndexOptions counted_options;
+    counted_options.stemmer = [call_count](std::string_view word) {
+        ++*call_count;
+        return std::string(word.substr(0, 4));
+    };
+    SearchServer counted(""s, counted_options);
+    for (int id = 0; id < 10; ++id) {
+        counted.AddDocument(id, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {1});
+    }
+    ASSERT_EQUAL(counted.FindTopDocuments("fluffiness"s).size(), 5u);
+    ASSERT_EQUAL(*call_count, 4);
+    // Слова только из запросов не остаются в кэше
+    const size_t stems_bytes = counted.GetMemoryUsage().stems;
+    for (int i = 0; i < 100; ++i) {
+        counted.FindTopDocuments("query"s + std::to_string(i));
+    }
+    ASSERT_EQUAL(counted.GetMemoryUsage().stems, stems_bytes);
+    ASSERT_EQUAL(*call_count, 104);
+}
+
+void TestStopWordSet() {
+    ASSERT(!StopWordSet{}.Contains("and"s));
+    ASSERT(!StopWordSet{}.Contains(""s));
+
+    const StopWordSet small(StringSet{"and"s, "in"s, "on"s, "the"s});
+    ASSERT_EQUAL(small.GetSize(), 4u);
+    for (const std::string& word : {"and"s, "in"s, "on"s, "the"s}) {
+        ASSERT(small.Contains(word));
+    }
+    for (const std::string& word : {"an"s, "ant"s, "at"s, "to"s, "i"s, "andy"s, ""s}) {
+        ASSERT_HINT(!small.Contains(word), word);
+    }
+
+    // Много слов одинаковой длины: совершенная хеш-функция различает их все
+    StringSet words;
+    for (int i = 0; i < 3000; ++i) {
+        words.insert("w"s + std::to_string(100000 + i));
+    }
+    words.insert(std::string(100, 'x'));
+    const StopWordSet large(words);
+    ASSERT_EQUAL(large.GetSize(), words.size());
+    for (const std::string& word : words) {
+        ASSERT(large.Contains(word));
+    }
+    for (int i = 3000; i < 6000; ++i) {
+        ASSERT(!large.Contains("w"s + std::to_string(100000 + i)));
+    }
+    ASSERT(!large.Contains(std::string(99, 'x')));
+    ASSERT(!large.Contains(std::string(101, 'x')));
+}
+
+void TestQueryProtocol() {
+    SearchServer server("and in at"s);
+    server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::BANNED, {1, 2, 3});
+    RequestQueue queue(server);
+    const ServiceStats stats{3, 1, 10, 2};
+
+    const auto handle = [&](std::string_view line) {
+        std::string out;
+        HandleRequest(line, server, queue, stats, out);
+        return out;
+    };
+
+    ASSERT_EQUAL(handle("FIND curly\r"sv), "OK [{\"document_id\":1,\"relevance\":0,\"rating\":5}]\n"s);
+    ASSERT_EQUAL(handle("FIND_BY_STATUS BANNED fancy"sv).substr(0, 20), "OK [{\"document_id\":2"s);
+    ASSERT_EQUAL(handle("FIND_BY_STATUS IRRELEVANT curly"sv), "OK []\n"s);
+    ASSERT_EQUAL(handle("MATCH 1 tail cat -dog"sv), "OK {\"status\":\"ACTUAL\",\"words\":[\"cat\",\"tail\"]}\n"s);
+    ASSERT_EQUAL(handle("MATCH 2 collar -dog"sv), "OK {\"status\":\"BANNED\",\"words\":[]}\n"s);
+    ASSERT_EQUAL(handle("STATS"sv), "OK {\"no_result_requests\":1,\"slow_queries\":0,\"requests\":10,\"batches\":2,"
+                                    "\"accepted_connections\":3,\"open_connections\":1}\n"s);
+
+    // Ошибки разбора и выполнения - одна строка ERR, без исключений
+    for (const std::string_view line : {"BOGUS"sv, "FIND"sv, "FIND_BY_STATUS DELETED cat"sv, "MATCH x cat"sv,
+                                        "MATCH 99 cat"sv, "FIND cat --dog"sv, "STATS now"sv}) {
+        const std::string out = handle(line);
+        ASSERT_HINT(out.starts_with("ERR "s) && out.find('\n') == out.size() - 1, std::string(line));
+    }
+
+    const Request request = ParseRequest("MATCH 2   fancy collar"sv);
+    ASSERT(request.type == Request::Type::MATCH);
+    ASSERT_EQUAL(request.document_id, 2);
+    ASSERT_EQUAL(request.query, "fancy collar"s);
+    ASSERT(ParseRequest("FIND_BY_STATUS REMOVED cat"sv).status == DocumentStatus::REMOVED);
+
+    // Очередь запросов считает запросы без результатов из нескольких потоков
+    RequestQueue shared_queue(server);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 200; ++i) {
+                shared_queue.AddFindRequest(i % 2 == 0 ? "curly"s : "empty request"s);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQUAL(shared_queue.GetNoResultRequests(), 400);
+}
+
+void TestMultiFieldDocuments() {
+    IndexOptions options;
+    options.store_positions = true;
+    options.expand_wildcards = true;
+    options.expand_fuzzy = true;
+    options.fields = { { "title"s, 3.0 }, { "tags"s, 2.0 }, { "body"s, 1.0 } };
+    SearchServer server("a the"s, options);
+    server.AddDocument(1, DocumentFields{ { "cat"sv, ""sv, "grey dog"sv } }, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, DocumentFields{ { "grey dog"sv, ""sv, "a cat"sv } }, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, DocumentFields{ { "mouse"sv, "kitten"sv } }, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, DocumentFields{ { "fluffy"sv, ""sv, "mouse toy"sv } }, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(5, "lonely title"s, DocumentStatus::ACTUAL, {5});
+
+    // Одинаковые TF и IDF, совпадение в заголовке весит втрое больше
+    const auto relevance_of = [&](const std::string& query, int document_id) {
+        for (const Document& document : server.FindTopDocuments(query)) {
+            if (document.id == document_id) {
+                return document.relevance;
+            }
+        }
+        return 0.0;
+    };
+    ASSERT(std::abs(relevance_of("cat"s, 1) - 3 * relevance_of("cat"s, 2)) < Document::EPSILON);
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s).front().id, 1);
+
+    // IDF слова общий для полей: совпадение в заголовке выше совпадения в тексте,
+    // даже если в заголовках слово встречается чаще, чем в текстах
+    SearchServer shared_idf("a the"s, options);
+    shared_idf.AddDocument(1, DocumentFields{ { "cat"sv, ""sv, "grey dog"sv } }, DocumentStatus::ACTUAL, {1});
+    shared_idf.AddDocument(2, DocumentFields{ { "grey dog"sv, ""sv, "cat"sv } }, DocumentStatus::ACTUAL, {1});
+    for (int id = 3; id < 13; ++id) {
+        shared_idf.AddDocument(id, DocumentFields{ { "cat toy"sv, ""sv, "red ball"sv } }, DocumentStatus::ACTUAL, {1});
+    }
+    for (int id = 13; id < 20; ++id) {
+        shared_idf.AddDocument(id, DocumentFields{ { "mouse"sv, ""sv, "toy"sv } }, DocumentStatus::ACTUAL, {1});
+    }
+    double title_relevance = 0.0;
+    double body_relevance = 0.0;
+    for (const Document& document : shared_idf.FindTopDocuments("cat"s, PageRequest{ .limit = 100 })) {
+        if (document.id == 1) {
+            title_relevance = document.relevance;
+        } else if (document.id == 2) {
+            body_relevance = document.relevance;
+        }
+    }
+    ASSERT(title_relevance > body_relevance);
+    ASSERT(std::abs(title_relevance - 3 * body_relevance) < Document::EPSILON);
+
+    const auto find_ids = [&](const std::string& query) {
+        std::vector<int> ids;
+        for (const Document& document : server.FindTopDocuments(query)) {
+            ids.push_back(document.id);
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+    const auto is_rejected = [](const auto& action) {
+        try {
+            action();
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    ASSERT((find_ids("title:cat"s) == std::vector<int>{1}));
+    ASSERT((find_ids("cat -title:cat"s) == std::vector<int>{2}));
+    ASSERT((find_ids("body:gr*"s) == std::vector<int>{1}));
+    ASSERT((find_ids("kiten~"s) == std::vector<int>{3}));
+    ASSERT(find_ids("body:kiten~"s).empty());
+    ASSERT((find_ids("\"grey dog\""s) == std::vector<int>{1, 2}));
+    ASSERT((find_ids("title:\"grey dog\""s) == std::vector<int>{2}));
+    ASSERT((find_ids("title:grey NEAR/2 dog"s) == std::vector<int>{2}));
+    ASSERT(is_rejected([&] { server.FindTopDocuments("title:grey NEAR/2 body:dog"s); }));
+    // Фраза не совпадает через границу полей
+    ASSERT(find_ids("\"fluffy mouse\""s).empty());
+    // Документ из одной строки - первое поле; неизвестное поле - часть слова
+    ASSERT((find_ids("title:lonely"s) == std::vector<int>{5}));
+    ASSERT(find_ids("color:grey"s).empty());
+
+    auto [words, status] = server.MatchDocument("cat grey -mouse"s, 1);
+    ASSERT((words == std::vector<std::string>{"cat"s, "grey"s}));
+
+    ASSERT(is_rejected([&] { server.AddDocument(6, DocumentFields{ { "a"sv, "b"sv, "c"sv, "d"sv } }, DocumentStatus::ACTUAL, {}); }));
+    ASSERT(is_rejected([&] { SearchServer(""s).AddDocument(1, DocumentFields{ { "cat"sv } }, DocumentStatus::ACTUAL, {}); }));
+    IndexOptions invalid_options;
+    invalid_options.fields = { { "title"s }, { "title"s } };
+    ASSERT(is_rejected([&] { SearchServer{ invalid_options }; }));
+    invalid_options.fields = { { "ti:tle"s } };
+    ASSERT(is_rejected([&] { SearchServer{ invalid_options }; }));
+
+    // Префикс поля отделяется до нормализации запроса
+    IndexOptions normalized_options;
+    normalized_options.normalize_text = true;
+    normalized_options.fields = { { "title"s, 2.0 }, { "body"s } };
+    SearchServer normalized(normalized_options);
+    normalized.AddDocument(1, DocumentFields{ { "Fluffy Cat"sv, "Grey dog."sv } }, DocumentStatus::ACTUAL, {});
+    normalized.AddDocument(2, DocumentFields{ { "Grey Dog"sv, "cat!"sv } }, DocumentStatus::ACTUAL, {});
+    ASSERT_EQUAL(normalized.FindTopDocuments("title:CAT,"s).size(), 1u);
+    ASSERT_EQUAL(normalized.FindTopDocuments("Cat -title:Dog."s).size(), 1u);
+
+    // Без полей префикс - обычная часть слова
+    SearchServer single(""s);
+    single.AddDocument(1, "title:cat"s, DocumentStatus::ACTUAL, {});
+    ASSERT_EQUAL(single.FindTopDocuments("title:cat"s).size(), 1u);
+    ASSERT(single.FindTopDocuments("cat"s).empty());
+}
 
 void RunTests() {
     LOG_DURATION("Testing time"s);
@@ -419,8 +2176,47 @@ void RunTests() {
     RUN_TEST(TestFindByTwoWordsTopDocuments);
     RUN_TEST(TestRequestQueue);
     RUN_TEST(TestPagination);
+    RUN_TEST(TestLazyPagination);
+    RUN_TEST(TestSearchPagination);
+    RUN_TEST(TestOffsetLimitAndSearchAfter);
     RUN_TEST(TestMakeUniqueNonEmptyStrings);
     RUN_TEST(TestSplitIntoWords);
+    RUN_TEST(TestSplitIntoWordsView);
+
+    RUN_TEST(TestPositionsEncoding);
+    RUN_TEST(TestPhraseQuery);
+    RUN_TEST(TestNearQuery);
+    RUN_TEST(TestPhraseWithoutPositions);
+
+    RUN_TEST(TestTermDictionary);
+    RUN_TEST(TestWildcardQuery);
+    RUN_TEST(TestFuzzyExpansion);
+    RUN_TEST(TestFuzzyQuery);
+
+    RUN_TEST(TestBm25Ranking);
+
+    RUN_TEST(TestFileIo);
+    RUN_TEST(TestResultWriter);
+
+    RUN_TEST(TestRemoveDocument);
+    RUN_TEST(TestWriteAheadLogFrames);
+    RUN_TEST(TestDurableSearchServer);
+    RUN_TEST(TestRatingAggregates);
+
+    RUN_TEST(TestSegmentedIndex);
+    RUN_TEST(TestQueriesDuringBackgroundMerge);
+    RUN_TEST(TestSetDocumentStatus);
+    RUN_TEST(TestImpactOrderedPostings);
+    RUN_TEST(TestMemoryUsageAndLimits);
+    RUN_TEST(TestTextNormalization);
+    RUN_TEST(TestStemming);
+    RUN_TEST(TestStopWordSet);
+    RUN_TEST(TestQueryProtocol);
+    RUN_TEST(TestMultiFieldDocuments);
+    RUN_TEST(TestBlockedAccumulators);
+    RUN_TEST(TestBooleanQueries);
+    RUN_TEST(TestExplainQuery);
+    RUN_TEST(TestSearchPolicies);
 }
 
 } // namespace tests